@@ -0,0 +1,190 @@
+/**
+ * @file collector.c
+ *
+ * sircollector: drains shared-memory rings that other processes write to
+ * (see ::sir_addshmring) into one log file.
+ *
+ * @author    Ryan M. Lederman \<lederman@gmail.com\>
+ * @date      2018-2023
+ * @version   2.2.0
+ * @copyright The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <sir.h>
+#include <sirhelpers.h>
+#include <sirshmring.h>
+#include <sirthread.h>
+#include <signal.h>
+
+/** Set by SIGINT or SIGTERM; the rings are drained one last time before exiting. */
+static volatile sig_atomic_t stop = 0;
+
+static void on_signal(int sig) {
+    _SIR_UNUSED(sig);
+    stop = 1;
+}
+
+static int report_error(const char* what) {
+    char message[SIR_MAXERROR] = {0};
+    uint16_t code              = sir_geterror(message);
+    fprintf(stderr, "sircollector: %s: libsir error: (%" PRIu16 ", %s)\n", what, code, message);
+    return EXIT_FAILURE;
+}
+
+static int usage(const char* self) {
+    fprintf(stderr,
+        "Usage: %s [-o file] [-s roll size] [-k archives] [-z] ring [ring ...]\n\n"
+        "\t-o\tThe log file to write to (default: sircollector.log).\n"
+        "\t-s\tThe size, in bytes, at which the log file is rolled.\n"
+        "\t-k\tThe number of archives of the log file to keep.\n"
+        "\t-z\tCompress archives of the log file.\n", self);
+    return EXIT_FAILURE;
+}
+
+/** Writes a message read from a ring to the log file, as the writer formatted it. */
+static void write_message(void* ctx, sir_level level, const char* msg, size_t len) {
+    _SIR_UNUSED(ctx);
+
+    if (len > 0 && '\n' == msg[len - 1])
+        len--;
+
+    (void)sir_logat(level, NULL, 0, NULL, "%.*s", (int)len, msg);
+}
+
+/**
+ * @brief Drains the shared-memory rings named on the command line into one log
+ * file, which libsir rolls (and archives, and compresses) as usual.
+ *
+ * @note Build it with `make collector`. Run one collector per set of rings; a
+ * ring can only be drained by one collector at a time.
+ *
+ * @returns EXIT_SUCCESS once stopped by SIGINT or SIGTERM, or EXIT_FAILURE if
+ * an error occurs.
+ */
+int main(int argc, char** argv) {
+    const char* path       = "sircollector.log";
+    sir_file_policy policy = {0};
+
+    /* messages from every ring go through one file; write them in large chunks. */
+    policy.buffer_size  = 65536;
+    policy.flush_msec   = 1000;
+    policy.flush_levels = SIRL_EMERG | SIRL_ALERT | SIRL_CRIT | SIRL_ERROR;
+
+    int opt = 0;
+    while (-1 != (opt = getopt(argc, argv, "o:s:k:z"))) {
+        switch (opt) {
+            case 'o': path = optarg; break;
+            case 's': policy.roll_size = strtoull(optarg, NULL, 10); break;
+            case 'k': policy.max_archives = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 'z': policy.compress = true; break;
+            default:  return usage(argv[0]);
+        }
+    }
+
+    if (optind >= argc)
+        return usage(argv[0]);
+
+    sirinit si;
+    if (!sir_makeinit(&si))
+        return report_error("initialization failed");
+
+    /* the messages are only written to the log file. */
+    si.d_stdout.levels = SIRL_NONE;
+    si.d_stderr.levels = SIRL_NONE;
+    si.d_syslog.levels = SIRL_NONE;
+
+    static const char* appname = "sircollector";
+    _sir_strncpy(si.name, SIR_MAXNAME, appname, strnlen(appname, SIR_MAXNAME));
+
+    if (!sir_init(&si))
+        return report_error("initialization failed");
+
+    /* each message was formatted by the process that wrote it. */
+    sirfileid fileid = sir_addfile(path, SIRL_ALL, SIRO_MSGONLY);
+    if (NULL == fileid || !sir_filepolicy(fileid, &policy)) {
+        int ret = report_error(path);
+        sir_cleanup();
+        return ret;
+    }
+
+    size_t nrings       = (size_t)(argc - optind);
+    sir_shmring** rings = (sir_shmring**)calloc(nrings, sizeof(sir_shmring*));
+    uint64_t* dropped   = (uint64_t*)calloc(nrings, sizeof(uint64_t));
+    int ret             = EXIT_SUCCESS;
+
+    for (size_t n = 0; rings && dropped && n < nrings; n++) {
+        rings[n] = _sir_shmring_open(argv[optind + n], true);
+        if (!rings[n]) {
+            ret  = report_error(argv[optind + n]);
+            stop = 1;
+            break;
+        }
+
+        dropped[n] = _sir_shmring_dropped(rings[n]);
+    }
+
+    if (!rings || !dropped) {
+        fprintf(stderr, "sircollector: out of memory\n");
+        ret  = EXIT_FAILURE;
+        stop = 1;
+    }
+
+#if !defined(__WIN__)
+    struct sigaction sa = {0};
+    sa.sa_handler = on_signal;
+    (void)sigemptyset(&sa.sa_mask);
+    (void)sigaction(SIGINT, &sa, NULL);
+    (void)sigaction(SIGTERM, &sa, NULL);
+#else
+    (void)signal(SIGINT, on_signal);
+    (void)signal(SIGTERM, on_signal);
+#endif
+
+    bool draining = EXIT_SUCCESS == ret;
+    while (draining) {
+        /* once asked to stop, whatever is left is read before exiting. */
+        bool last   = 0 != stop;
+        size_t read = 0;
+
+        for (size_t n = 0; n < nrings; n++) {
+            read += _sir_shmring_drain(rings[n], write_message, NULL);
+
+            uint64_t now = _sir_shmring_dropped(rings[n]);
+            if (now != dropped[n]) {
+                (void)sir_warn("sircollector: %" PRIu64 " message(s) written to ring '%s'"
+                    " were dropped; it was full", now - dropped[n], argv[optind + n]);
+                dropped[n] = now;
+            }
+        }
+
+        if (last)
+            draining = false;
+        else if (0 == read)
+            _sirthread_sleep(SIR_SHMRING_POLLMSEC);
+    }
+
+    for (size_t n = 0; rings && n < nrings; n++)
+        _sir_shmring_close(&rings[n]);
+
+    _sir_safefree(&rings);
+    _sir_safefree(&dropped);
+
+    sir_cleanup();
+    return ret;
+}
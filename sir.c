@@ -30,6 +30,8 @@
 #include "sir.h"
 #include "sirinternal.h"
 #include "sirfilecache.h"
+#include "sirdest.h"
+#include "sirshmring.h"
 #include "sirtextstyle.h"
 #include "sirdefaults.h"
 
@@ -51,60 +53,73 @@ uint16_t sir_geterror(char message[SIR_MAXERROR]) {
 
 bool sir_debug(const char* format, ...) {
     _SIR_L_START(format);
-    r = _sir_logv(SIRL_DEBUG, format, args);
+    r = _sir_logv(SIRL_DEBUG, NULL, format, args);
     _SIR_L_END(args);
     return r;
 }
 
 bool sir_info(const char* format, ...) {
     _SIR_L_START(format);
-    r = _sir_logv(SIRL_INFO, format, args);
+    r = _sir_logv(SIRL_INFO, NULL, format, args);
     _SIR_L_END(args);
     return r;
 }
 
 bool sir_notice(const char* format, ...) {
     _SIR_L_START(format);
-    r = _sir_logv(SIRL_NOTICE, format, args);
+    r = _sir_logv(SIRL_NOTICE, NULL, format, args);
     _SIR_L_END(args);
     return r;
 }
 
 bool sir_warn(const char* format, ...) {
     _SIR_L_START(format);
-    r = _sir_logv(SIRL_WARN, format, args);
+    r = _sir_logv(SIRL_WARN, NULL, format, args);
     _SIR_L_END(args);
     return r;
 }
 
 bool sir_error(const char* format, ...) {
     _SIR_L_START(format);
-    r = _sir_logv(SIRL_ERROR, format, args);
+    r = _sir_logv(SIRL_ERROR, NULL, format, args);
     _SIR_L_END(args);
     return r;
 }
 
 bool sir_crit(const char* format, ...) {
     _SIR_L_START(format);
-    r = _sir_logv(SIRL_CRIT, format, args);
+    r = _sir_logv(SIRL_CRIT, NULL, format, args);
     _SIR_L_END(args);
     return r;
 }
 
 bool sir_alert(const char* format, ...) {
     _SIR_L_START(format);
-    r = _sir_logv(SIRL_ALERT, format, args);
+    r = _sir_logv(SIRL_ALERT, NULL, format, args);
     _SIR_L_END(args);
     return r;
 }
 
 bool sir_emerg(const char* format, ...) {
     _SIR_L_START(format);
-    r = _sir_logv(SIRL_EMERG, format, args);
+    r = _sir_logv(SIRL_EMERG, NULL, format, args);
     _SIR_L_END(args);
     return r;
 }
 
+bool sir_logat(sir_level level, const char* file, uint32_t line, const char* func,
+    const char* format, ...) {
+    sirsrcloc loc = {file, func, line};
+    _SIR_L_START(format);
+    r = _sir_logv(level, &loc, format, args);
+    _SIR_L_END(args);
+    return r;
+}
+
+bool sir_levelenabled(sir_level level) {
+    return _sir_levelenabled(level);
+}
+
 sirfileid sir_addfile(const char* path, sir_levels levels, sir_options opts) {
     return _sir_addfile(path, levels, opts);
 }
@@ -115,16 +130,47 @@ bool sir_remfile(sirfileid id) {
 
 bool sir_filelevels(sirfileid id, sir_levels levels) {
     _sir_defaultlevels(&levels, sir_file_def_lvls);
-    sir_update_config_data data = {SIRU_LEVELS, &levels, NULL, NULL, NULL};
+    sir_update_config_data data = {SIRU_LEVELS, &levels, NULL, NULL, NULL, NULL};
     return _sir_updatefile(id, &data);
 }
 
 bool sir_fileopts(sirfileid id, sir_options opts) {
     _sir_defaultopts(&opts, sir_file_def_opts);
-    sir_update_config_data data = {SIRU_OPTIONS, NULL, &opts, NULL, NULL};
+    sir_update_config_data data = {SIRU_OPTIONS, NULL, &opts, NULL, NULL, NULL};
     return _sir_updatefile(id, &data);
 }
 
+bool sir_filepolicy(sirfileid id, const sir_file_policy* policy) {
+    sir_update_config_data data = {SIRU_POLICY, NULL, NULL, NULL, NULL, policy};
+    return _sir_updatefile(id, &data);
+}
+
+sirdestid sir_adddest(const sir_dest_ops* ops, void* ctx, sir_levels levels,
+    sir_options opts) {
+    return _sir_adddest(ops, ctx, levels, opts);
+}
+
+bool sir_remdest(sirdestid id) {
+    return _sir_remdest(id);
+}
+
+bool sir_destlevels(sirdestid id, sir_levels levels) {
+    _sir_defaultlevels(&levels, sir_dest_def_lvls);
+    sir_update_config_data data = {SIRU_LEVELS, &levels, NULL, NULL, NULL, NULL};
+    return _sir_updatedest(id, &data);
+}
+
+bool sir_destopts(sirdestid id, sir_options opts) {
+    opts &= ~SIRO_QUEUED;
+    _sir_defaultopts(&opts, sir_dest_def_opts);
+    sir_update_config_data data = {SIRU_OPTIONS, NULL, &opts, NULL, NULL, NULL};
+    return _sir_updatedest(id, &data);
+}
+
+sirdestid sir_addshmring(const char* name, sir_levels levels, sir_options opts) {
+    return _sir_addshmring(name, levels, opts);
+}
+
 bool sir_settextstyle(sir_level level, sir_textstyle style) {
     return _sir_settextstyle(level, style);
 }
@@ -135,32 +181,32 @@ bool sir_resettextstyles(void) {
 
 bool sir_stdoutlevels(sir_levels levels) {
     _sir_defaultlevels(&levels, sir_stdout_def_lvls);
-    sir_update_config_data data = {SIRU_LEVELS, &levels, NULL, NULL, NULL};
+    sir_update_config_data data = {SIRU_LEVELS, &levels, NULL, NULL, NULL, NULL};
     return _sir_writeinit(&data, _sir_stdoutlevels);
 }
 
 bool sir_stdoutopts(sir_options opts) {
     _sir_defaultopts(&opts, sir_stdout_def_opts);
-    sir_update_config_data data = {SIRU_OPTIONS, NULL, &opts, NULL, NULL};
+    sir_update_config_data data = {SIRU_OPTIONS, NULL, &opts, NULL, NULL, NULL};
     return _sir_writeinit(&data, _sir_stdoutopts);
 }
 
 bool sir_stderrlevels(sir_levels levels) {
     _sir_defaultlevels(&levels, sir_stderr_def_lvls);
-    sir_update_config_data data = {SIRU_LEVELS, &levels, NULL, NULL, NULL};
+    sir_update_config_data data = {SIRU_LEVELS, &levels, NULL, NULL, NULL, NULL};
     return _sir_writeinit(&data, _sir_stderrlevels);
 }
 
 bool sir_stderropts(sir_options opts) {
     _sir_defaultopts(&opts, sir_stderr_def_opts);
-    sir_update_config_data data = {SIRU_OPTIONS, NULL, &opts, NULL, NULL};
+    sir_update_config_data data = {SIRU_OPTIONS, NULL, &opts, NULL, NULL, NULL};
     return _sir_writeinit(&data, _sir_stderropts);
 }
 
 bool sir_sysloglevels(sir_levels levels) {
 #if !defined(SIR_NO_SYSTEM_LOGGERS)
     _sir_defaultlevels(&levels, sir_syslog_def_lvls);
-    sir_update_config_data data = {SIRU_LEVELS, &levels, NULL, NULL, NULL};
+    sir_update_config_data data = {SIRU_LEVELS, &levels, NULL, NULL, NULL, NULL};
     return _sir_writeinit(&data, _sir_sysloglevels);
 #else
     _SIR_UNUSED(levels);
@@ -172,7 +218,7 @@ bool sir_sysloglevels(sir_levels levels) {
 bool sir_syslogopts(sir_options opts) {
 #if !defined(SIR_NO_SYSTEM_LOGGERS)
     _sir_defaultopts(&opts, sir_syslog_def_opts);
-    sir_update_config_data data = {SIRU_OPTIONS, NULL, &opts, NULL, NULL};
+    sir_update_config_data data = {SIRU_OPTIONS, NULL, &opts, NULL, NULL, NULL};
     return _sir_writeinit(&data, _sir_syslogopts);
 #else
     _SIR_UNUSED(opts);
@@ -183,7 +229,7 @@ bool sir_syslogopts(sir_options opts) {
 
 bool sir_syslogid(const char* identity) {
 #if !defined(SIR_NO_SYSTEM_LOGGERS)
-    sir_update_config_data data = {SIRU_SYSLOG_ID, NULL, NULL, identity, NULL};
+    sir_update_config_data data = {SIRU_SYSLOG_ID, NULL, NULL, identity, NULL, NULL};
     return _sir_writeinit(&data, _sir_syslogid);
 #else
     _SIR_UNUSED(identity);
@@ -194,7 +240,7 @@ bool sir_syslogid(const char* identity) {
 
 bool sir_syslogcat(const char* category) {
 #if !defined(SIR_NO_SYSTEM_LOGGERS)
-    sir_update_config_data data = {SIRU_SYSLOG_CAT, NULL, NULL, NULL, category};
+    sir_update_config_data data = {SIRU_SYSLOG_CAT, NULL, NULL, NULL, category, NULL};
     return _sir_writeinit(&data, _sir_syslogcat);
 #else
     _SIR_UNUSED(category);
@@ -202,3 +248,19 @@ bool sir_syslogcat(const char* category) {
     return false;
 #endif
 }
+
+bool sir_remotelevels(sir_levels levels) {
+    _sir_defaultlevels(&levels, sir_remote_def_lvls);
+    sir_update_config_data data = {SIRU_LEVELS, &levels, NULL, NULL, NULL, NULL};
+    return _sir_writeinit(&data, _sir_remotelevels);
+}
+
+bool sir_remoteopts(sir_options opts) {
+    _sir_defaultopts(&opts, sir_remote_def_opts);
+    sir_update_config_data data = {SIRU_OPTIONS, NULL, &opts, NULL, NULL, NULL};
+    return _sir_writeinit(&data, _sir_remoteopts);
+}
+
+bool sir_setthreadname(const char* name) {
+    return _sir_setthreadname(name);
+}
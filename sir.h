@@ -72,6 +72,14 @@ bool sir_makeinit(sirinit* si);
  * ::sir_cleanup. All exported libsir functions are thread-safe, so you may
  * initialize and cleanup on whichever thread you wish.
  *
+ * libsir starts a housekeeping thread which checks every
+ * ::SIR_HNAME_CHK_INTERVAL seconds whether the hostname has changed, so that
+ * logging threads never have to.
+ *
+ * @remark In a child process created with `fork()`, libsir's threads do not
+ * exist. Logging continues to work there (with the child's PID), but messages
+ * are delivered synchronously, and the hostname is no longer refreshed.
+ *
  * @see ::sir_makeinit
  * @see ::sir_cleanup
  *
@@ -95,6 +103,9 @@ bool sir_init(sirinit* si);
  * May be called from any thread. If you wish to utilize libsir again during the
  * same process' lifetime, simply call ::sir_init again.
  *
+ * If asynchronous delivery is enabled (see ::sir_async_cfg), any messages still
+ * waiting in the queue are delivered before the destinations are torn down.
+ *
  * @returns bool `true` if cleanup was successful, `false otherwise`. Call
  * ::sir_geterror to obtain information about any error that may have occurred.
  */
@@ -313,6 +324,47 @@ bool sir_alert(const char* format, ...);
  */
 bool sir_emerg(const char* format, ...);
 
+/**
+ * @brief Dispatches a message of any level, along with where it was logged from.
+ *
+ * Behaves like the level-specific functions (e.g. ::sir_info), and is what the
+ * ::SIR_INFO family of macros call, passing `__FILE__`, `__LINE__`, and
+ * `__func__`. Destinations that can record the location (such as systemd's
+ * journal, as `CODE_FILE`, `CODE_LINE`, and `CODE_FUNC`) do.
+ *
+ * @param   level  The ::sir_level of the message.
+ * @param   file   The source file name. Must remain valid for the life of the
+ *                 process (e.g. a string literal), or be NULL.
+ * @param   line   The line number in `file`.
+ * @param   func   The function name; the same requirements as `file` apply.
+ * @param   format A printf-style format string, representing the template for
+ *                 the message to dispatch.
+ * @param   ...    Arguments whose type and position align with the format
+ *                 specifiers in `format`.
+ * @returns bool   `true` if the message was dispatched succcessfully to all
+ *                 registered destinations, `false` otherwise. Call ::sir_geterror
+ *                 to obtain information about any error that may have occurred.
+ */
+bool sir_logat(sir_level level, const char* file, uint32_t line, const char* func,
+    const char* format, ...);
+
+/**
+ * @brief Determines whether any destination would receive messages of a level.
+ *
+ * Messages of a level that no destination (stdout, stderr, the system logger
+ * or journal, the remote syslog destination, any log file, or any custom
+ * destination) is registered for are discarded before they are formatted.
+ * Use this function to avoid doing expensive work to produce the arguments for
+ * such a message in the first place.
+ *
+ * The check is a single atomic load; it does not set the last error.
+ *
+ * @param   level The ::sir_level in question.
+ * @returns bool  `true` if at least one destination is registered for `level`,
+ *                `false` otherwise, or if libsir is not initialized.
+ */
+bool sir_levelenabled(sir_level level);
+
 /**
  * @brief Adds a log file and registeres it to receive log output.
  *
@@ -330,6 +382,8 @@ bool sir_emerg(const char* format, ...);
  * @remark Take note of the ::SIR_FROLLSIZE compile-time constant. When any log
  * file reaches that size in bytes, it will be archived to a date-stamped file
  * in the same directory, and logging will resume at the path of the original file.
+ * Use ::sir_filepolicy to set a different size, or to also roll the file every
+ * hour or day.
  *
  * @remark If `path` is a relative path, it shall be treated as relative
  * to the _current working directory_. This is not necessarily the same path
@@ -412,6 +466,192 @@ bool sir_filelevels(sirfileid id, sir_levels levels);
  */
 bool sir_fileopts(sirfileid id, sir_options opts);
 
+/**
+ * @brief Set the buffering and flushing policy for a log file already managed
+ * by libsir.
+ *
+ * Use a large buffer to collect high-volume output into fewer, larger writes,
+ * and `flush_levels` to make sure that important messages (and everything
+ * logged before them) reach the file immediately. With `flush_msec`, buffered
+ * output is never older than that on disk; libsir's housekeeping thread takes
+ * care of files that are not being written to.
+ *
+ * @remark Changing the policy reopens the file, writing any buffered data first.
+ *
+ * @remark With `compress` set, archives are compressed with zlib if libsir was
+ * built with `SIR_ZLIB=1`, and with a simpler built-in encoder otherwise. Any
+ * still waiting to be compressed are taken care of by ::sir_cleanup.
+ *
+ * @remark With a `roll_interval`, the file is rolled by the first message
+ * written to it after each boundary, using the time the message was logged;
+ * a file that nothing is written to is not rolled.
+ *
+ * @remark Retention limits (`max_archives`, `max_archive_bytes` and
+ * `max_archive_age`) are applied after each roll by the same low-priority
+ * thread that compresses archives, deleting the oldest archives first. It
+ * scans the file's directory for archives (named according to
+ * ::SIR_FNAMEFORMAT) only the first time, and keeps track of them from then
+ * on; archives put there by something else later on are not counted.
+ *
+ * @remark With ::SIRFB_URING, the io_uring instance belongs to the process that
+ * set it up; a child process that continues to log after `fork()` without
+ * calling ::sir_cleanup and ::sir_init should not share such a file with its parent.
+ *
+ * @see ::sir_file_policy
+ *
+ * @param   id      The ::sirfileid obtained when the file was added to libsir.
+ * @param   policy  The new policy for the file. Zero-initialize it to restore
+ *                  the default policy.
+ * @returns bool    `true` if the file is known to libsir and was succcessfully
+ *                  updated, `false` otherwise. Use ::sir_geterror to obtain
+ *                  information about any error that may have occurred.
+ */
+bool sir_filepolicy(sirfileid id, const sir_file_policy* policy);
+
+/**
+ * @brief Adds a custom destination, to which libsir hands formatted output.
+ *
+ * libsir formats each message logged at one of `levels` according to `opts`,
+ * exactly as for a log file, and passes it to `ops->write`, along with `ctx`.
+ * What is done with it from there (sent to a GUI, a database, a message bus,
+ * etc.) is up to the destination.
+ *
+ * @remark Without ::SIRO_QUEUED, `ops->write` is called by the logging thread,
+ * which returns once it has. With ::SIRO_QUEUED set in `opts`, the message is
+ * copied into a queue of ::SIR_DEST_QUEUESIZE messages belonging to this
+ * destination alone, and written by a libsir thread of its own, so that a slow
+ * destination holds up neither the logging thread nor any other destination.
+ * If the queue is full, the message is dropped for this destination, and the
+ * logging function returns `false`. ::SIRO_QUEUED can be combined with
+ * ::SIRO_DEFAULT, and cannot be changed after the destination is added.
+ *
+ * @remark A queued destination's `ops->flush` is called each time its thread
+ * has written every message waiting for it.
+ *
+ * @remark `ops->write` may itself log through libsir; such a message is
+ * dispatched as usual, to this destination as well if it is registered for
+ * the message's level (so guard against recursion). Custom destinations cannot
+ * be added, removed, or modified from within the `ops->write` of an inline
+ * (not ::SIRO_QUEUED) destination: those calls fail.
+ *
+ * @remark Up to ::SIR_MAXDESTS custom destinations may be added at once.
+ *
+ * @see ::sir_remdest
+ * @see ::sir_destlevels
+ * @see ::sir_destopts
+ *
+ * @param   ops       The functions that write, flush, and close the destination.
+ *                    `ops->write` is required; the others may be `NULL`.
+ * @param   ctx       Passed to each of the functions in `ops`.
+ * @param   levels    Levels of output to register the destination for.
+ * @param   opts      Formatting options for the output sent to the destination,
+ *                    and whether it is queued.
+ * @returns sirdestid If successful, a unique identifier that can later be used
+ *                    to modify level registrations, options, or remove the
+ *                    destination from libsir. Upon failure, returns `0`. Use
+ *                    ::sir_geterror to obtain information about any error that
+ *                    may have occurred.
+ */
+sirdestid sir_adddest(const sir_dest_ops* ops, void* ctx, sir_levels levels,
+    sir_options opts);
+
+/**
+ * @brief Removes a custom destination previously added to libsir.
+ *
+ * No more messages are sent to the destination. If it is queued, those still
+ * waiting in its queue are written first. Its `flush` and `close` functions
+ * are then called.
+ *
+ * @param   id   The ::sirdestid obtained when the destination was added.
+ * @returns bool `true` if the destination is known to libsir, and was
+ *               successfully removed, `false` otherwise. Use ::sir_geterror to
+ *               obtain information about any error that may have occurred.
+ */
+bool sir_remdest(sirdestid id);
+
+/**
+ * @brief Set new level registrations for a custom destination.
+ *
+ * By default, custom destinations are registered for the following levels:
+ *
+ * - all levels (SIRL_ALL)
+ *
+ * @see ::sir_destopts
+ *
+ * @param   id     The ::sirdestid obtained when the destination was added.
+ * @param   levels New bitmask of ::sir_level to register for. If you wish to use
+ *                 the default levels, pass ::SIRL_DEFAULT.
+ * @returns bool   `true` if the destination is known to libsir and was
+ *                 succcessfully updated, `false` otherwise. Use ::sir_geterror
+ *                 to obtain information about any error that may have occurred.
+ */
+bool sir_destlevels(sirdestid id, sir_levels levels);
+
+/**
+ * @brief Set new formatting options for a custom destination.
+ *
+ * By default, custom destinations have the following formatting options:
+ *
+ * - ::SIRO_ALL
+ * - ::SIRO_NOHOST
+ *
+ * @remark ::SIRO_QUEUED is ignored; it can only be chosen when the destination
+ * is added.
+ *
+ * @see ::sir_destlevels
+ *
+ * @param   id    The ::sirdestid obtained when the destination was added.
+ * @param   opts  New bitmask of ::sir_option for the destination. If you wish to
+ *                use the default options, pass ::SIRO_DEFAULT.
+ * @returns bool  `true` if the destination is known to libsir and was
+ *                succcessfully updated, `false` otherwise. Use ::sir_geterror
+ *                to obtain information about any error that may have occurred.
+ */
+bool sir_destopts(sirdestid id, sir_options opts);
+
+/**
+ * @brief Adds a custom destination that writes to a shared-memory ring.
+ *
+ * Opens (creating it, if need be) the POSIX shared memory object `name`,
+ * which holds a ring of ::SIR_SHMRING_SIZE bytes, and adds a custom
+ * destination that copies each message, formatted according to `opts`, into
+ * it. Space in the ring is reserved without locking, so writing a message
+ * costs little more than copying it, and neither the logging thread nor
+ * libsir does any file I/O for it.
+ *
+ * The ring is drained by another process: the `sircollector` program (built by
+ * `make collector`) writes the messages from any number of rings, in the
+ * order each ring received them, to one log file, which it rolls and archives
+ * like any other. Any number of threads and processes may write to the same
+ * ring.
+ *
+ * @remark If the ring is full, because nothing is draining it or its consumer
+ * can't keep up, the message is dropped (and the logging function returns
+ * `false`). The collector notes how many were dropped in its log file.
+ *
+ * @remark The ring remains after the process exits, and keeps the messages it
+ * holds, until it is removed (`shm_unlink()`, or deleting it from `/dev/shm`
+ * on Linux). A process that writes to a ring again picks up where the last
+ * one left off.
+ *
+ * @remark Only available on platforms with POSIX shared memory and lock-free
+ * C11 atomics; elsewhere, fails with ::SIR_E_UNAVAIL.
+ *
+ * @see ::sir_remdest
+ * @see ::sir_destlevels
+ * @see ::sir_destopts
+ *
+ * @param   name      The name of the ring (a shared memory object name, with or
+ *                    without the leading `/`; it must contain no other `/`).
+ * @param   levels    Levels of output to register the destination for.
+ * @param   opts      Formatting options for the output written to the ring.
+ * @returns sirdestid If successful, an identifier for the destination, which
+ *                    ::sir_remdest unmaps the ring when passed. Upon failure,
+ *                    returns `0`. Use ::sir_geterror to obtain information
+ *                    about any error that may have occurred.
+ */
+sirdestid sir_addshmring(const char* name, sir_levels levels, sir_options opts);
+
 /**
  * @brief Set new text styling for stdio (stdout/stderr) destinations on a
  * per-level basis.
@@ -623,6 +863,114 @@ bool sir_syslogid(const char* identity);
  */
 bool sir_syslogcat(const char* category);
 
+/**
+ * @brief Set new level registrations for the remote syslog destination.
+ *
+ * The remote syslog destination sends messages to the collector named by
+ * ::sir_remote_dest.host in ::sirinit.d_remote; if no host was set when
+ * ::sir_init was called, this function has no visible effect. By default, it
+ * is registered for the following levels:
+ *
+ * - notice    (SIRL_NOTICE)
+ * - warning   (SIRL_WARNING)
+ * - error     (SIRL_ERROR)
+ * - critical  (SIRL_CRIT)
+ * - alert     (SIRL_ALERT)
+ * - emergency (SIRL_EMERG)
+ *
+ * @see ::sir_remoteopts
+ *
+ * @param   levels New bitmask of ::sir_level to register for. If you wish to use
+ *                 the default levels, pass ::SIRL_DEFAULT.
+ * @returns bool   `true` if succcessfully updated, `false` otherwise. Use
+ *                 ::sir_geterror to obtain information about any error that may
+ *                 have occurred.
+ */
+bool sir_remotelevels(sir_levels levels);
+
+/**
+ * @brief Set new formatting options for the remote syslog destination.
+ *
+ * Messages are always sent in RFC 5424 form; the options only determine which
+ * fields are filled in. By default, the remote syslog destination has the
+ * following formatting options:
+ *
+ * - ::SIRO_ALL
+ *
+ * @see ::sir_remotelevels
+ *
+ * @param   opts New bitmask of ::sir_option for the remote syslog destination.
+ *               If you wish to use the default values, pass ::SIRO_DEFAULT.
+ * @returns bool `true` if succcessfully updated, `false` otherwise. Use
+ *               ::sir_geterror to obtain information about any error that may
+ *               have occurred.
+ */
+bool sir_remoteopts(sir_options opts);
+
+/**
+ * @brief Sets the name of the calling thread.
+ *
+ * libsir looks up the identifier and name of each thread once, the first time
+ * it logs a message, and reuses them afterwards. If a thread's name is changed
+ * by other means after that point, libsir will continue to use the old one;
+ * use this function instead, which sets the name in the OS and in libsir.
+ *
+ * The name is used in place of the thread identifier in output (unless
+ * ::SIRO_NOTID is set). May be called before ::sir_init.
+ *
+ * @remark On platforms where the thread name cannot be set (e.g. Windows), only
+ * libsir's copy of the name is updated.
+ *
+ * @param name   The new name; must be shorter than ::SIR_MAXPID characters.
+ * @returns bool `true` if the name was set, `false` otherwise. Use
+ *               ::sir_geterror to obtain information about any error that
+ *               may have occurred.
+ */
+bool sir_setthreadname(const char* name);
+
+/** @} */
+
+/**
+ * @defgroup publicmacros Macros
+ *
+ * Front-ends for the logging functions that are compiled out entirely for
+ * levels less severe than ::SIR_MIN_LEVEL. Unlike a call to a disabled level's
+ * function, a disabled macro does not evaluate its arguments. Each evaluates to
+ * the `bool` returned by the function, or `false` if disabled.
+ *
+ * @{
+ */
+
+/** @cond */
+# define _SIR_LOG_IF(level, ...) \
+    (((level) <= SIR_MIN_LEVEL) ? \
+        sir_logat(level, __FILE__, __LINE__, __func__, __VA_ARGS__) : false)
+/** @endcond */
+
+/** Logs like ::sir_debug (with the location), unless ::SIR_MIN_LEVEL excludes ::SIRL_DEBUG. */
+# define SIR_DEBUG(...)  _SIR_LOG_IF(SIRL_DEBUG, __VA_ARGS__)
+
+/** Logs like ::sir_info (with the location), unless ::SIR_MIN_LEVEL excludes ::SIRL_INFO. */
+# define SIR_INFO(...)   _SIR_LOG_IF(SIRL_INFO, __VA_ARGS__)
+
+/** Logs like ::sir_notice (with the location), unless ::SIR_MIN_LEVEL excludes ::SIRL_NOTICE. */
+# define SIR_NOTICE(...) _SIR_LOG_IF(SIRL_NOTICE, __VA_ARGS__)
+
+/** Logs like ::sir_warn (with the location), unless ::SIR_MIN_LEVEL excludes ::SIRL_WARN. */
+# define SIR_WARN(...)   _SIR_LOG_IF(SIRL_WARN, __VA_ARGS__)
+
+/** Logs like ::sir_error (with the location), unless ::SIR_MIN_LEVEL excludes ::SIRL_ERROR. */
+# define SIR_ERROR(...)  _SIR_LOG_IF(SIRL_ERROR, __VA_ARGS__)
+
+/** Logs like ::sir_crit (with the location), unless ::SIR_MIN_LEVEL excludes ::SIRL_CRIT. */
+# define SIR_CRIT(...)   _SIR_LOG_IF(SIRL_CRIT, __VA_ARGS__)
+
+/** Logs like ::sir_alert (with the location), unless ::SIR_MIN_LEVEL excludes ::SIRL_ALERT. */
+# define SIR_ALERT(...)  _SIR_LOG_IF(SIRL_ALERT, __VA_ARGS__)
+
+/** Logs like ::sir_emerg (with the location), unless ::SIR_MIN_LEVEL is ::SIRL_NONE. */
+# define SIR_EMERG(...)  _SIR_LOG_IF(SIRL_EMERG, __VA_ARGS__)
+
 /**
  * @}
  * @}
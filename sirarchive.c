@@ -0,0 +1,596 @@
+/*
+ * sirarchive.c
+ *
+ * Author:    Ryan M. Lederman <lederman@gmail.com>
+ * Copyright: Copyright (c) 2018-2023
+ * Version:   2.2.0
+ * License:   The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "sirarchive.h"
+#include "sirgzip.h"
+#include "sirinternal.h"
+#include "sirfilesystem.h"
+#include "sirmutex.h"
+#include "sirthread.h"
+
+#if !defined(__WIN__)
+# include <dirent.h>
+#endif
+
+/** An archive on its way to the archive thread. */
+typedef struct {
+    char* logpath;
+    char* archive;
+    sir_file_policy policy;
+} _sir_archivejob;
+
+/** One of a log file's archives, as known to the archive thread. */
+typedef struct {
+    char* path;
+    char stamp[SIR_MAXTIME];
+    uint32_t seq;
+    uint64_t size;
+    time_t mtime;
+} _sir_archiveentry;
+
+/**
+ * The archives of one log file, oldest first. Built by scanning the directory
+ * the first time the file's retention limits are applied, and kept up to date
+ * from then on, so that each roll doesn't have to scan it again.
+ */
+typedef struct {
+    char* logpath;
+    _sir_archiveentry* entries;
+    size_t count;
+    size_t capacity;
+    uint64_t bytes;
+} _sir_archiveindex;
+
+/** How a log file's archives are named (see ::SIR_FNAMEFORMAT). */
+typedef struct {
+    char dir[SIR_MAXPATH];    /**< Directory, including the separator ("" if none). */
+    char prefix[SIR_MAXPATH]; /**< File name without extension, and the '-'. */
+    char ext[SIR_MAXPATH];    /**< Extension, including the full stop ("" if none). */
+    char sample[SIR_MAXTIME]; /**< A time stamp, to match the format of others against. */
+} _sir_archivenames;
+
+/** Archives waiting for the archive thread, and the thread itself. */
+static struct {
+    sir_mutex mutex;
+    sir_event wake;
+    sir_thread thread;
+    _sir_archivejob jobs[SIR_ARCHIVE_QUEUE];
+    size_t head;
+    size_t count;
+    bool init;
+    bool running;
+    bool stop;
+    /* only touched by the archive thread (and by cleanup, once it's gone). */
+    _sir_archiveindex* indexes;
+    size_t nindexes;
+} _sir_aq;
+
+static
+void _sir_archives_freejob(_sir_archivejob* job) {
+    _sir_safefree(&job->logpath);
+    _sir_safefree(&job->archive);
+}
+
+static
+void _sir_archives_freequeue(void) {
+    for (; _sir_aq.count > 0; _sir_aq.count--) {
+        _sir_archives_freejob(&_sir_aq.jobs[_sir_aq.head]);
+        _sir_aq.head = (_sir_aq.head + 1) % SIR_ARCHIVE_QUEUE;
+    }
+    _sir_aq.head = 0;
+}
+
+static
+void _sir_archives_freeindexes(void) {
+    for (size_t n = 0; n < _sir_aq.nindexes; n++) {
+        _sir_archiveindex* idx = &_sir_aq.indexes[n];
+        for (size_t e = 0; e < idx->count; e++)
+            _sir_safefree(&idx->entries[e].path);
+        _sir_safefree(&idx->entries);
+        _sir_safefree(&idx->logpath);
+    }
+    _sir_safefree(&_sir_aq.indexes);
+    _sir_aq.nindexes = 0;
+}
+
+bool _sir_archives_init(void) {
+    if (_sir_aq.init)
+        return true;
+
+    if (!_sirmutex_create(&_sir_aq.mutex))
+        return false;
+
+    if (!_sirevent_create(&_sir_aq.wake)) {
+        (void)_sirmutex_destroy(&_sir_aq.mutex);
+        return false;
+    }
+
+    _sir_aq.head    = 0;
+    _sir_aq.count   = 0;
+    _sir_aq.running = false;
+    _sir_aq.stop    = false;
+    _sir_aq.init    = true;
+    return true;
+}
+
+bool _sir_archives_wanted(const sir_file_policy* policy) {
+    return policy->compress || policy->max_archives > 0 ||
+        policy->max_archive_bytes > 0 || policy->max_archive_age > 0;
+}
+
+bool _sir_archives_enqueue(const char* logpath, const char* archive,
+    const sir_file_policy* policy) {
+    if (!_sir_validstr(logpath) || !_sir_validstr(archive) || !_sir_validptr(policy))
+        return false;
+
+    if (!_sir_aq.init || !_sirmutex_lock(&_sir_aq.mutex))
+        return false;
+
+    bool queued = false;
+    if (_sir_aq.count < SIR_ARCHIVE_QUEUE) {
+        _sir_archivejob* job = &_sir_aq.jobs[(_sir_aq.head + _sir_aq.count) % SIR_ARCHIVE_QUEUE];
+        job->logpath = strdup(logpath);
+        job->archive = strdup(archive);
+        job->policy  = *policy;
+
+        if (job->logpath && job->archive) {
+            _sir_aq.count++;
+            queued = true;
+        } else {
+            _sir_handleerr(errno);
+            _sir_archives_freejob(job);
+        }
+    } else {
+        _sir_selflog("error: archive queue full; leaving '%s' as it is", archive);
+    }
+
+    /* started on first use, so that programs that never compress or trim
+     * their archives don't have an idle thread hanging around. */
+    if (queued && !_sir_aq.running) {
+        _sir_aq.stop    = false;
+        _sir_aq.running = _sirthread_create(&_sir_aq.thread, _sir_archives_worker, NULL);
+        if (!_sir_aq.running)
+            _sir_selflog("error: failed to start archive thread");
+    }
+
+    (void)_sirmutex_unlock(&_sir_aq.mutex);
+
+    if (queued)
+        (void)_sirevent_signal(&_sir_aq.wake);
+
+    return queued;
+}
+
+bool _sir_archives_cleanup(void) {
+    if (!_sir_aq.init)
+        return true;
+
+    bool running = false;
+    if (_sirmutex_lock(&_sir_aq.mutex)) {
+        running      = _sir_aq.running;
+        _sir_aq.stop = true;
+        (void)_sirmutex_unlock(&_sir_aq.mutex);
+    }
+
+    /* the worker empties the queue before it exits. */
+    bool joined = true;
+    if (running) {
+        (void)_sirevent_signal(&_sir_aq.wake);
+        joined = _sirthread_join(&_sir_aq.thread);
+        _sir_selflog("archive thread %s", joined ? "stopped" : "failed to stop!");
+    }
+
+    _sir_archives_freequeue();
+    _sir_archives_freeindexes();
+
+    _sir_aq.running = false;
+    _sir_aq.init    = false;
+    (void)_sirevent_destroy(&_sir_aq.wake);
+    (void)_sirmutex_destroy(&_sir_aq.mutex);
+
+    return joined;
+}
+
+void _sir_archives_atfork_child(void) {
+    /* any queued archives are left to the parent. */
+    _sir_archives_freequeue();
+    _sir_aq.running = false;
+}
+
+/** Compresses `path` to `path.gz`, via a temporary file. */
+static
+bool _sir_archives_compress(const char* path, char* gzpath) {
+    char tmppath[SIR_MAXPATH] = {0};
+
+    int print = snprintf(gzpath, SIR_MAXPATH, "%s%s", path, SIR_FGZEXT);
+    if (print <= 0 || print >= SIR_MAXPATH)
+        return false;
+
+    print = snprintf(tmppath, SIR_MAXPATH, "%s%s", gzpath, SIR_FTMPEXT);
+    if (print <= 0 || print >= SIR_MAXPATH)
+        return false;
+
+    if (!_sir_gzip(path, tmppath)) {
+        (void)remove(tmppath);
+        return false;
+    }
+
+    if (0 != rename(tmppath, gzpath)) {
+        _sir_handleerr(errno);
+        (void)remove(tmppath);
+        return false;
+    }
+
+    if (0 != remove(path))
+        _sir_handleerr(errno);
+
+    _sir_selflog("compressed '%s' " SIR_R_ARROW " '%s'", path, gzpath);
+    return true;
+}
+
+/** Works out how the archives of the log file at `logpath` are named. */
+static
+bool _sir_archives_names(const char* logpath, _sir_archivenames* names) {
+    memset(names, 0, sizeof(_sir_archivenames));
+
+    const char* base = logpath;
+    for (const char* p = logpath; *p; p++) {
+#if defined(__WIN__)
+        if ('\\' == *p || '/' == *p)
+#else
+        if ('/' == *p)
+#endif
+            base = p + 1;
+    }
+
+    size_t dirlen = (size_t)(base - logpath);
+    const char* dot = strrchr(base, '.');
+    size_t namelen  = dot ? (size_t)(dot - base) : strlen(base);
+
+    if (dirlen >= SIR_MAXPATH || namelen + 2 > SIR_MAXPATH)
+        return false;
+
+    memcpy(names->dir, logpath, dirlen);
+    memcpy(names->prefix, base, namelen);
+    names->prefix[namelen] = '-';
+    if (dot)
+        _sir_strncpy(names->ext, SIR_MAXPATH, dot, strnlen(dot, SIR_MAXPATH - 1));
+
+    return _sir_formattime(time(NULL), names->sample, SIR_FNAMETIMEFORMAT);
+}
+
+/**
+ * Determines whether `filename` names one of a log file's archives, compressed
+ * or not, and if so, fills in the parts of `entry` that sort it.
+ */
+static
+bool _sir_archives_match(const _sir_archivenames* names, const char* filename,
+    _sir_archiveentry* entry) {
+    size_t prefixlen = strlen(names->prefix);
+    if (0 != strncmp(filename, names->prefix, prefixlen))
+        return false;
+
+    size_t len    = strlen(filename);
+    size_t gzlen  = strlen(SIR_FGZEXT);
+    size_t extlen = strlen(names->ext);
+
+    if (len > gzlen && 0 == strcmp(filename + len - gzlen, SIR_FGZEXT))
+        len -= gzlen;
+
+    if (len < prefixlen + extlen || 0 != strncmp(filename + len - extlen, names->ext, extlen))
+        return false;
+
+    /* what's left is a time stamp, and maybe a sequence number. */
+    const char* stamp = filename + prefixlen;
+    size_t stamplen   = len - extlen - prefixlen;
+    size_t samplelen  = strlen(names->sample);
+
+    if (stamplen < samplelen || samplelen >= SIR_MAXTIME)
+        return false;
+
+    for (size_t n = 0; n < samplelen; n++) {
+        bool digit       = stamp[n] >= '0' && stamp[n] <= '9';
+        bool sampledigit = names->sample[n] >= '0' && names->sample[n] <= '9';
+        if (digit != sampledigit || (!digit && stamp[n] != names->sample[n]))
+            return false;
+    }
+
+    entry->seq = 0;
+    if (stamplen > samplelen) {
+        char seqbuf[SIR_MAXTIME] = {0};
+        size_t seqlen = stamplen - samplelen;
+        if (seqlen >= SIR_MAXTIME)
+            return false;
+        memcpy(seqbuf, stamp + samplelen, seqlen);
+
+        unsigned short seq = 0;
+        int consumed       = 0;
+        if (1 != sscanf(seqbuf, SIR_FNAMESEQFORMAT "%n", &seq, &consumed) ||
+            (size_t)consumed != seqlen)
+            return false;
+        entry->seq = seq;
+    }
+
+    memcpy(entry->stamp, stamp, samplelen);
+    entry->stamp[samplelen] = '\0';
+    return true;
+}
+
+static
+int _sir_archives_compare(const void* a, const void* b) {
+    const _sir_archiveentry* ea = (const _sir_archiveentry*)a;
+    const _sir_archiveentry* eb = (const _sir_archiveentry*)b;
+
+    int cmp = strcmp(ea->stamp, eb->stamp);
+    if (0 != cmp)
+        return cmp;
+
+    return ea->seq < eb->seq ? -1 : ea->seq > eb->seq ? 1 : 0;
+}
+
+/** Adds an archive to an index, keeping it sorted; `entry->path` is taken over. */
+static
+bool _sir_archives_add(_sir_archiveindex* idx, _sir_archiveentry* entry) {
+    struct stat st = {0};
+    if (!_sir_pathgetstat(entry->path, &st, SIR_PATH_REL_TO_CWD) ||
+        SIR_STAT_NONEXISTENT == st.st_size) {
+        _sir_safefree(&entry->path);
+        return false;
+    }
+
+    entry->size  = (uint64_t)st.st_size;
+    entry->mtime = st.st_mtime;
+
+    if (idx->count == idx->capacity) {
+        size_t capacity = idx->capacity > 0 ? idx->capacity * 2 : 16;
+        _sir_archiveentry* entries = (_sir_archiveentry*)realloc(idx->entries,
+            capacity * sizeof(_sir_archiveentry));
+        if (!entries) {
+            _sir_handleerr(errno);
+            _sir_safefree(&entry->path);
+            return false;
+        }
+        idx->entries  = entries;
+        idx->capacity = capacity;
+    }
+
+    /* new archives are the newest, so this is nearly always the end. */
+    size_t pos = idx->count;
+    while (pos > 0 && _sir_archives_compare(&idx->entries[pos - 1], entry) > 0)
+        pos--;
+
+    memmove(&idx->entries[pos + 1], &idx->entries[pos],
+        (idx->count - pos) * sizeof(_sir_archiveentry));
+    idx->entries[pos] = *entry;
+    idx->count++;
+    idx->bytes += entry->size;
+    return true;
+}
+
+static
+void _sir_archives_remove(_sir_archiveindex* idx, size_t pos) {
+    idx->bytes -= idx->entries[pos].size;
+    _sir_safefree(&idx->entries[pos].path);
+    memmove(&idx->entries[pos], &idx->entries[pos + 1],
+        (idx->count - pos - 1) * sizeof(_sir_archiveentry));
+    idx->count--;
+}
+
+/** Adds the archive at `dir` + `filename` to an index, if it is one. */
+static
+void _sir_archives_consider(_sir_archiveindex* idx, const _sir_archivenames* names,
+    const char* filename) {
+    _sir_archiveentry entry = {0};
+    if (!_sir_archives_match(names, filename, &entry))
+        return;
+
+    entry.path = (char*)calloc(SIR_MAXPATH, sizeof(char));
+    if (!entry.path) {
+        _sir_handleerr(errno);
+        return;
+    }
+
+    int print = snprintf(entry.path, SIR_MAXPATH, "%s%s", names->dir, filename);
+    if (print <= 0 || print >= SIR_MAXPATH) {
+        _sir_safefree(&entry.path);
+        return;
+    }
+
+    (void)_sir_archives_add(idx, &entry);
+}
+
+/** Builds an index from a single scan of the log file's directory. */
+static
+bool _sir_archives_scan(_sir_archiveindex* idx, const _sir_archivenames* names) {
+#if !defined(__WIN__)
+    DIR* d = opendir(_sir_validstrnofail(names->dir) ? names->dir : ".");
+    if (!d) {
+        _sir_handleerr(errno);
+        return false;
+    }
+
+    const struct dirent* ent = NULL;
+    while (NULL != (ent = readdir(d)))
+        _sir_archives_consider(idx, names, ent->d_name);
+
+    (void)closedir(d);
+#else /* __WIN__ */
+    char search[SIR_MAXPATH] = {0};
+    int print = snprintf(search, SIR_MAXPATH, "%s*", names->dir);
+    if (print <= 0 || print >= SIR_MAXPATH)
+        return false;
+
+    WIN32_FIND_DATAA fd = {0};
+    HANDLE h = FindFirstFileA(search, &fd);
+    if (INVALID_HANDLE_VALUE == h) {
+        _sir_handlewin32err(GetLastError());
+        return false;
+    }
+
+    do {
+        if (!(fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+            _sir_archives_consider(idx, names, fd.cFileName);
+    } while (FindNextFileA(h, &fd));
+
+    (void)FindClose(h);
+#endif
+
+    _sir_selflog("found %zu archive(s) of '%s' (%" PRIu64 " bytes)", idx->count,
+        idx->logpath, idx->bytes);
+    return true;
+}
+
+/** Finds (or creates) the index of a log file's archives. */
+static
+_sir_archiveindex* _sir_archives_index(const char* logpath, bool* created) {
+    *created = false;
+    for (size_t n = 0; n < _sir_aq.nindexes; n++) {
+        if (0 == strcmp(_sir_aq.indexes[n].logpath, logpath))
+            return &_sir_aq.indexes[n];
+    }
+
+    _sir_archiveindex* indexes = (_sir_archiveindex*)realloc(_sir_aq.indexes,
+        (_sir_aq.nindexes + 1) * sizeof(_sir_archiveindex));
+    if (!indexes) {
+        _sir_handleerr(errno);
+        return NULL;
+    }
+    _sir_aq.indexes = indexes;
+
+    _sir_archiveindex* idx = &_sir_aq.indexes[_sir_aq.nindexes];
+    memset(idx, 0, sizeof(_sir_archiveindex));
+    idx->logpath = strdup(logpath);
+    if (!idx->logpath) {
+        _sir_handleerr(errno);
+        return NULL;
+    }
+
+    _sir_aq.nindexes++;
+    *created = true;
+    return idx;
+}
+
+/** Deletes the oldest archives of a log file until it is within its limits. */
+static
+void _sir_archives_retain(const _sir_archivejob* job, const char* archive) {
+    _sir_archivenames names;
+    if (!_sir_archives_names(job->logpath, &names))
+        return;
+
+    bool created = false;
+    _sir_archiveindex* idx = _sir_archives_index(job->logpath, &created);
+    if (!idx)
+        return;
+
+    if (created) {
+        /* the scan finds the new archive, too. */
+        (void)_sir_archives_scan(idx, &names);
+    } else {
+        /* an earlier scan may have found the archive before it was compressed. */
+        for (size_t n = 0; n < idx->count; n++) {
+            if (0 == strcmp(idx->entries[n].path, job->archive) ||
+                0 == strcmp(idx->entries[n].path, archive)) {
+                _sir_archives_remove(idx, n);
+                break;
+            }
+        }
+
+        const char* filename = archive + strlen(names.dir);
+        _sir_archives_consider(idx, &names, filename);
+    }
+
+    const sir_file_policy* policy = &job->policy;
+    time_t now = time(NULL);
+
+    while (idx->count > 0) {
+        const _sir_archiveentry* oldest = &idx->entries[0];
+        bool over = (policy->max_archives > 0 && idx->count > policy->max_archives) ||
+            (policy->max_archive_bytes > 0 && idx->bytes > policy->max_archive_bytes) ||
+            (policy->max_archive_age > 0 && now - oldest->mtime > (time_t)policy->max_archive_age);
+        if (!over)
+            break;
+
+        /* if it can't be deleted, it's forgotten rather than tried again forever. */
+        if (0 != remove(oldest->path) && ENOENT != errno) {
+            _sir_handleerr(errno);
+            _sir_selflog("error: failed to delete archive '%s'", oldest->path);
+        } else {
+            _sir_selflog("deleted archive '%s' (%" PRIu64 " bytes)", oldest->path,
+                oldest->size);
+        }
+
+        _sir_archives_remove(idx, 0);
+    }
+}
+
+/** Compresses and/or trims the archives of a log file, as its policy says. */
+static
+void _sir_archives_process(const _sir_archivejob* job) {
+    char gzpath[SIR_MAXPATH] = {0};
+    const char* archive      = job->archive;
+
+    if (job->policy.compress && _sir_archives_compress(job->archive, gzpath))
+        archive = gzpath;
+
+    if (job->policy.max_archives > 0 || job->policy.max_archive_bytes > 0 ||
+        job->policy.max_archive_age > 0)
+        _sir_archives_retain(job, archive);
+}
+
+sir_thread_ret SIR_THREAD_CALL _sir_archives_worker(void* arg) {
+    _SIR_UNUSED(arg);
+
+    /* compressing and deleting only ever use time the system has to spare. */
+    (void)_sirthread_setlowpriority();
+
+    for (;;) {
+        _sir_archivejob job = {0};
+        bool stop = false;
+
+        if (_sirmutex_lock(&_sir_aq.mutex)) {
+            if (_sir_aq.count > 0) {
+                job = _sir_aq.jobs[_sir_aq.head];
+                memset(&_sir_aq.jobs[_sir_aq.head], 0, sizeof(_sir_archivejob));
+                _sir_aq.head = (_sir_aq.head + 1) % SIR_ARCHIVE_QUEUE;
+                _sir_aq.count--;
+            }
+            stop = _sir_aq.stop;
+            (void)_sirmutex_unlock(&_sir_aq.mutex);
+        }
+
+        if (job.archive) {
+            _sir_archives_process(&job);
+            _sir_archives_freejob(&job);
+            continue;
+        }
+
+        if (stop)
+            break;
+
+        (void)_sirevent_wait(&_sir_aq.wake, SIR_HNAME_CHK_INTERVAL * 1000);
+    }
+
+    return (sir_thread_ret)0;
+}
@@ -0,0 +1,65 @@
+/*
+ * sirarchive.h
+ *
+ * Author:    Ryan M. Lederman <lederman@gmail.com>
+ * Copyright: Copyright (c) 2018-2023
+ * Version:   2.2.0
+ * License:   The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef _SIR_ARCHIVE_H_INCLUDED
+# define _SIR_ARCHIVE_H_INCLUDED
+
+# include "sirtypes.h"
+
+/**
+ * Prepares the queue of archives waiting for the archive thread. The thread
+ * itself is only started once the first archive is queued.
+ */
+bool _sir_archives_init(void);
+
+/**
+ * Determines whether the archive thread has anything to do with the archives
+ * of a log file that has `policy`.
+ */
+bool _sir_archives_wanted(const sir_file_policy* policy);
+
+/**
+ * Queues a new archive of the log file at `logpath` for the archive thread.
+ * It gzip-compresses the archive (writing `<archive>.gz`, then removing
+ * `archive`) if `policy->compress` is set, and then deletes the oldest of the
+ * log file's archives that exceed the policy's retention limits. Returns
+ * `false` (leaving the archives as they are) if the queue is full.
+ */
+bool _sir_archives_enqueue(const char* logpath, const char* archive,
+    const sir_file_policy* policy);
+
+/** Finishes with any archives still queued, then stops the archive thread. */
+bool _sir_archives_cleanup(void);
+
+/**
+ * Forgets the archive thread, which does not exist in a forked child, and the
+ * archives queued in the parent.
+ */
+void _sir_archives_atfork_child(void);
+
+/** Archive thread: compresses and deletes archives at low priority. */
+sir_thread_ret SIR_THREAD_CALL _sir_archives_worker(void* arg);
+
+#endif /* !_SIR_ARCHIVE_H_INCLUDED */
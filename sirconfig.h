@@ -33,7 +33,7 @@
 
 /**
  * The time stamp format string at the start of log messages–not including
- * milliseconds (as::SIR_MSECFORMAT), which is added separately.
+ * milliseconds (see ::SIR_MSECFORMAT), which are added separately.
  *
  * @remark Only applies if ::SIRO_NOTIME is not set.
  *
@@ -57,6 +57,20 @@
  */
 # define SIR_MSECFORMAT ".%03ld"
 
+/**
+ * The least severe ::sir_level for which the logging macros (::SIR_DEBUG,
+ * ::SIR_INFO, etc.) generate any code. Macro calls for less severe levels are
+ * removed by the compiler, along with the evaluation of their arguments.
+ *
+ * May be defined when compiling code that uses the macros (e.g.
+ * `-DSIR_MIN_LEVEL=SIRL_WARN`); use ::SIRL_NONE to remove them all.
+ *
+ * @remark Does not affect the logging functions (::sir_debug, etc.).
+ */
+# if !defined(SIR_MIN_LEVEL)
+#  define SIR_MIN_LEVEL SIRL_DEBUG
+# endif
+
 /**
  * The string placed directly before the human-readable logging level.
  *
@@ -108,11 +122,72 @@
 # define SIR_FOPENMODE "a"
 
 /**
- * The size, in bytes, at which a log file will be rolled/archived.
+ * The size, in bytes, at which a log file will be rolled/archived, unless its
+ * ::sir_file_policy.roll_size says otherwise.
  * @remark Default = 5 MiB.
  */
 # define SIR_FROLLSIZE (1024 * 1024 * 5)
 
+/**
+ * How many bytes short of its roll size (at most a quarter of it) a log file
+ * may get before the housekeeping thread opens the file that takes over from
+ * it. The log file is then rolled without the logging thread having to wait
+ * for it to be archived and reopened.
+ */
+# define SIR_FROLLPREPSIZE (1024 * 256)
+
+/**
+ * Appended to a log file's path to name the file that takes over from it
+ * when it is rolled, until it has been archived.
+ */
+# define SIR_FNEXTEXT ".next"
+
+/** Appended to an archived log file's path once it has been compressed. */
+# define SIR_FGZEXT ".gz"
+
+/**
+ * Appended to the path of a compressed archive while it is being written. It
+ * is renamed to its final name once complete, so that nothing picks up a
+ * partial file.
+ */
+# define SIR_FTMPEXT ".tmp"
+
+/**
+ * The number of archived log files that may be waiting for the archive thread
+ * at a time, to be compressed or to have the file's retention limits applied
+ * (see ::sir_file_policy). Beyond that, archives are left as-is until the next
+ * one is made.
+ */
+# define SIR_ARCHIVE_QUEUE 32
+
+/**
+ * The number of writes to a log file between checks of its size on disk. libsir
+ * otherwise keeps track of the size itself; the check notices when another
+ * process has truncated the file (e.g. logrotate's `copytruncate`).
+ */
+# define SIR_FSIZE_CHK_WRITES 1024
+
+/** The largest buffer size, in bytes, that may be set for a log file (see ::sir_file_policy). */
+# define SIR_FMAXBUFSIZE (1024 * 1024 * 16)
+
+/**
+ * The number of buffers each log file using ::SIRFB_URING has in flight at
+ * most. Output is collected in one of them while the others are being written.
+ */
+# define SIR_URING_NBUFS 8
+
+/**
+ * The default size, in bytes, of each of a ::SIRFB_URING log file's buffers;
+ * ::sir_file_policy.buffer_size overrides it.
+ */
+# define SIR_URING_BUFSIZE (1024 * 64)
+
+/**
+ * The default number of bytes by which a ::SIRFB_MMAP log file is extended
+ * (and mapped) at a time; ::sir_file_policy.buffer_size overrides it.
+ */
+# define SIR_MMAP_CHUNKSIZE (1024 * 1024 * 64)
+
 /**
  * The time format string used in file headers (see ::SIR_FHFORMAT).
  *
@@ -224,8 +299,24 @@
 /** The human-readable form of the ::SIRL_DEBUG level. */
 # define SIRL_S_DEBUG  "debg"
 
-/** The maximum number of log files that may be registered at one time. */
-# define SIR_MAXFILES 16
+/**
+ * The maximum number of log files that may be registered at one time. The
+ * file cache grows as files are added, so this is only an upper bound.
+ */
+# define SIR_MAXFILES 1024
+
+/** The number of log files the file cache has room for before it first grows. */
+# define SIR_FCACHE_INITSIZE 16
+
+/** The maximum number of custom destinations that may be added at one time. */
+# define SIR_MAXDESTS 16
+
+/**
+ * The number of messages that may wait for a custom destination with
+ * ::SIRO_QUEUED set. When its queue is full, messages for that destination
+ * are dropped, so that it cannot hold up logging threads.
+ */
+# define SIR_DEST_QUEUESIZE 256
 
 /** The size, in characters, of the buffer used to hold file header format strings. */
 # define SIR_MAXFHEADER 128
@@ -281,6 +372,13 @@
     (SIR_MAXMESSAGE + (SIR_MAXSTYLE * 2) + SIR_MAXTIME + SIR_MAXLEVEL + \
         SIR_MAXNAME + (SIR_MAXPID   * 2) + SIR_MAXMISC + 1)
 
+/**
+ * The number of differently formatted copies of a message that are kept while
+ * it is dispatched. Destinations with the same options (and styling) share one
+ * copy, so each distinct combination is only formatted once.
+ */
+# define SIR_MAXFMTCACHE 4
+
 /** The maximum size, in characters, of an error message. */
 # define SIR_MAXERROR 256
 
@@ -311,6 +409,9 @@
 /** System logger destination string. */
 # define SIR_DESTNAME_SYSLOG     "syslog"
 
+/** Remote syslog destination string. */
+# define SIR_DESTNAME_REMOTE     "remote"
+
 /** Fallback system logger identity. */
 # define SIR_FALLBACK_SYSLOG_ID  "libsir"
 
@@ -327,7 +428,7 @@
  * The number of actual options; ::SIRO_ALL, ::SIRO_DEFAULT, and ::SIRO_MSGONLY
  * are pseudo options that end up being mapped (or not) to the others.
  */
-# define SIR_NUMOPTIONS 8
+# define SIR_NUMOPTIONS 9
 
 /**
  * The number of entries in the 4-bit (16-color) map: 3 attributes + 17
@@ -336,11 +437,35 @@
 # define SIR_NUM16_COLOR_MAPPINGS 37
 
 /**
- * The number of seconds to let elapse before checking if the hostname needs
- * refreshing. The default is an eager 1 minute. Better safe than wrong?
+ * The number of seconds between checks (by the libsir housekeeping thread) of
+ * whether the hostname has changed. The default is an eager 1 minute. Better
+ * safe than wrong?
  */
 # define SIR_HNAME_CHK_INTERVAL 60
 
+/**
+ * The number of configuration copies that are kept for logging threads to read
+ * without locking. Changing the configuration waits if every copy other than
+ * the current one is still being read.
+ */
+# define SIR_CFGSNAPSHOTS 4
+
+/**
+ * The default number of messages that the asynchronous delivery queue can hold
+ * (see ::sir_async_cfg).
+ */
+# define SIR_ASYNC_QUEUESIZE 512
+
+/** The maximum value accepted for ::sir_async_cfg.queue_size. */
+# define SIR_ASYNC_MAXQUEUESIZE 65536
+
+/**
+ * The maximum number of milliseconds the asynchronous delivery thread sleeps
+ * while idle before checking the queue again. Logging threads wake it sooner
+ * when they queue a message.
+ */
+# define SIR_ASYNC_WAITMSEC 100
+
 # if defined(SIR_OS_LOG_ENABLED)
 /**
  * The special format specifier to send to os_log. By default, the log will only
@@ -350,4 +475,97 @@
 #  define SIR_OS_LOG_FORMAT "%{public}s"
 # endif
 
+/** The port a remote syslog collector listens on, unless told otherwise (see ::sir_remote_dest). */
+# define SIR_REMOTE_PORT 514
+
+/**
+ * The number of bytes of messages that may wait to be sent to a remote syslog
+ * collector. While the background thread is sending them, up to as many more
+ * can be queued in a second buffer.
+ */
+# define SIR_REMOTE_BUFSIZE 131072
+
+/** The maximum size, in bytes, of a message framed for a remote syslog collector. */
+# define SIR_REMOTE_MAXRECORD \
+    (SIR_MAXMESSAGE + SIR_MAXHOST + SIR_MAX_SYSLOG_ID + SIR_MAXPID + 64)
+
+/**
+ * The number of milliseconds to wait before the first attempt to reconnect to
+ * a remote syslog collector. Each failed attempt doubles the wait, up to
+ * ::SIR_REMOTE_MAXBACKOFF.
+ */
+# define SIR_REMOTE_MINBACKOFF 100
+
+/** The maximum number of milliseconds between attempts to reconnect to a remote syslog collector. */
+# define SIR_REMOTE_MAXBACKOFF 30000
+
+/**
+ * The maximum number of milliseconds to wait for a connection to a remote
+ * syslog collector to be established, or for it to accept more data, before
+ * giving up on the connection.
+ */
+# define SIR_REMOTE_IOMSEC 2000
+
+# if defined(SIR_SYSLOG_ENABLED)
+/** The path of the system logger's local (`AF_UNIX` datagram) socket. */
+#  define SIR_SYSLOG_SOCKET "/dev/log"
+
+/**
+ * The number of messages that can wait to be sent to the system logger. Those
+ * waiting are sent together, in a single system call where possible.
+ */
+#  define SIR_SYSLOG_BATCH 32
+
+/**
+ * The maximum size, in bytes, of a message framed for the system logger
+ * (header, identity, process ID, and message text).
+ */
+#  define SIR_SYSLOG_MAXFRAME (SIR_MAXMESSAGE + SIR_MAX_SYSLOG_ID + SIR_MAXPID + 32)
+
+/**
+ * The maximum number of milliseconds that a logging thread waits for the
+ * system logger to accept messages while it is busy. After that, the message
+ * is dropped.
+ */
+#  define SIR_SYSLOG_WAITMSEC 100
+
+/**
+ * The number of milliseconds between attempts to reconnect to the system
+ * logger when it is unavailable. Messages logged in between are dropped.
+ */
+#  define SIR_SYSLOG_RETRYMSEC 500
+# endif
+
+# if defined(SIR_JOURNAL_ENABLED)
+/**
+ * The path of the socket systemd's journal receives messages on (its native
+ * protocol). Where it exists, the system logger destination sends messages to
+ * the journal, with structured fields, rather than to ::SIR_SYSLOG_SOCKET.
+ */
+#  define SIR_JOURNAL_SOCKET "/run/systemd/journal/socket"
+# endif
+
+/**
+ * The size, in bytes, of the data area of a shared-memory ring created by
+ * ::sir_addshmring (a power of two). A ring that already exists keeps the
+ * size it was created with.
+ */
+# define SIR_SHMRING_SIZE 1048576
+
+/** The permissions a shared-memory ring is created with (before the umask). */
+# define SIR_SHMRING_MODE 0660
+
+/**
+ * The number of milliseconds the consumer of a shared-memory ring waits for a
+ * message that has been reserved, but not written, by a process that is still
+ * running (one that has died is not waited for). After that, the message is
+ * skipped, and those after it are read; the space it was reserved in is not
+ * reused until its writer finds out, or dies. This is many scheduling quanta,
+ * even on a heavily loaded machine.
+ */
+# define SIR_SHMRING_STALLMSEC 30000
+
+/** The number of milliseconds sircollector sleeps when none of its rings have messages. */
+# define SIR_SHMRING_POLLMSEC 10
+
 #endif /* !_SIR_CONFIG_H_INCLUDED */
@@ -120,6 +120,32 @@ static const sir_levels sir_syslog_def_lvls
 static const sir_options sir_syslog_def_opts
     = SIRO_MSGONLY;
 
+/**
+ * Default levels for the remote syslog destination.
+ *
+ * The remote syslog destination is registered for these levels
+ * if ::SIRL_DEFAULT is set on the ::sir_remote_dest when
+ * ::sir_init is called.
+ *
+ * @note Can be modified at runtime by calling ::sir_remotelevels.
+ */
+static const sir_levels sir_remote_def_lvls
+    = SIRL_NOTICE | SIRL_WARN | SIRL_ERROR | SIRL_CRIT |
+      SIRL_ALERT | SIRL_EMERG;
+
+/**
+ * Default options for the remote syslog destination.
+ *
+ * Applied to the remote syslog destination if ::SIRO_DEFAULT
+ * is set on the ::sir_remote_dest when ::sir_init is called.
+ *
+ * @note Can be modified at runtime by calling ::sir_remoteopts.
+ *
+ * @note ::SIRO_ALL sends every header field that RFC 5424 defines.
+ */
+static const sir_options sir_remote_def_opts
+    = SIRO_ALL;
+
 /**
  * Default levels for log files.
  *
@@ -144,6 +170,28 @@ static const sir_levels sir_file_def_lvls
 static const sir_options sir_file_def_opts
     = SIRO_ALL | SIRO_NOHOST;
 
+/**
+ * Default levels for custom destinations.
+ *
+ * Custom destinations are registered for these levels if
+ * ::SIRL_DEFAULT is passed to ::sir_adddest.
+ *
+ * @note Can be modified at runtime by calling ::sir_destlevels.
+ */
+static const sir_levels sir_dest_def_lvls
+    = SIRL_ALL;
+
+/**
+ * Default options for custom destinations.
+ *
+ * Applied to custom destinations if ::SIRO_DEFAULT is
+ * passed to ::sir_adddest.
+ *
+ * @note Can be modified at runtime by calling ::sir_destopts.
+ */
+static const sir_options sir_dest_def_opts
+    = SIRO_ALL | SIRO_NOHOST;
+
 /**
  * Default ::sir_textstyle for ::SIRL_EMERG.
  *
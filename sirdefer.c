@@ -0,0 +1,322 @@
+/*
+ * sirdefer.c
+ *
+ * Author:    Ryan M. Lederman <lederman@gmail.com>
+ * Copyright: Copyright (c) 2018-2023
+ * Version:   2.2.0
+ * License:   The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "sirdefer.h"
+#include "sirinternal.h"
+
+#include <stddef.h>
+
+/** Types of recorded arguments. */
+enum {
+    _SIRARG_NONE = 0, /**< `%%` (no argument). */
+    _SIRARG_INT,
+    _SIRARG_LONG,
+    _SIRARG_LLONG,
+    _SIRARG_INTMAX,
+    _SIRARG_SIZE,
+    _SIRARG_PTRDIFF,
+    _SIRARG_UINT,
+    _SIRARG_ULONG,
+    _SIRARG_ULLONG,
+    _SIRARG_UINTMAX,
+    _SIRARG_DOUBLE,
+    _SIRARG_LDOUBLE,
+    _SIRARG_STR,
+    _SIRARG_PTR
+};
+
+/** A parsed conversion specification. */
+typedef struct {
+    size_t len;     /**< Length, from the '%' through the conversion character. */
+    int type;       /**< _SIRARG_* */
+    bool hasprec;   /**< Whether a precision was given. */
+    size_t prec;    /**< The precision, if given. */
+} sirfmtspec;
+
+static inline
+bool _sir_defer_parsespec(const char* p, sirfmtspec* spec) {
+    const char* start = p++;
+
+    spec->type    = _SIRARG_NONE;
+    spec->hasprec = false;
+    spec->prec    = 0;
+
+    if ('%' == *p) {
+        spec->len = 2;
+        return true;
+    }
+
+    while ('-' == *p || '+' == *p || ' ' == *p || '#' == *p || '0' == *p || '\'' == *p)
+        p++;
+
+    while (*p >= '0' && *p <= '9')
+        p++;
+
+    /* '*' width or positional (n$) arguments. */
+    if ('*' == *p || '$' == *p)
+        return false;
+
+    if ('.' == *p) {
+        p++;
+        if ('*' == *p)
+            return false;
+
+        spec->hasprec = true;
+        while (*p >= '0' && *p <= '9') {
+            if (spec->prec < SIR_MAXMESSAGE)
+                spec->prec = (spec->prec * 10) + (size_t)(*p - '0');
+            p++;
+        }
+    }
+
+    /* length modifier: 0 = none, 'H' = hh, 'l', 'q' = ll, 'L', 'j', 'z', 't', 'h'. */
+    char mod = 0;
+    switch (*p) {
+        case 'h':
+            mod = ('h' == p[1]) ? 'H' : 'h';
+            p += ('H' == mod) ? 2 : 1;
+            break;
+        case 'l':
+            mod = ('l' == p[1]) ? 'q' : 'l';
+            p += ('q' == mod) ? 2 : 1;
+            break;
+        case 'L': case 'j': case 'z': case 't':
+            mod = *p++;
+            break;
+        default:
+            break;
+    }
+
+    switch (*p) {
+        case 'd': case 'i':
+            switch (mod) {
+                case 'l': spec->type = _SIRARG_LONG;    break;
+                case 'q': spec->type = _SIRARG_LLONG;   break;
+                case 'j': spec->type = _SIRARG_INTMAX;  break;
+                case 'z': spec->type = _SIRARG_SIZE;    break;
+                case 't': spec->type = _SIRARG_PTRDIFF; break;
+                case 'L': return false;
+                default:  spec->type = _SIRARG_INT;     break;
+            }
+            break;
+        case 'u': case 'o': case 'x': case 'X':
+            switch (mod) {
+                case 'l': spec->type = _SIRARG_ULONG;   break;
+                case 'q': spec->type = _SIRARG_ULLONG;  break;
+                case 'j': spec->type = _SIRARG_UINTMAX; break;
+                case 'z': spec->type = _SIRARG_SIZE;    break;
+                case 't': spec->type = _SIRARG_PTRDIFF; break;
+                case 'L': return false;
+                default:  spec->type = _SIRARG_UINT;    break;
+            }
+            break;
+        case 'c':
+            if (0 != mod)
+                return false;
+            spec->type = _SIRARG_INT;
+            break;
+        case 'f': case 'F': case 'e': case 'E':
+        case 'g': case 'G': case 'a': case 'A':
+            if ('L' == mod)
+                spec->type = _SIRARG_LDOUBLE;
+            else if (0 == mod || 'l' == mod)
+                spec->type = _SIRARG_DOUBLE;
+            else
+                return false;
+            break;
+        case 's':
+            if (0 != mod)
+                return false;
+            spec->type = _SIRARG_STR;
+            break;
+        case 'p':
+            if (0 != mod)
+                return false;
+            spec->type = _SIRARG_PTR;
+            break;
+        default: /* %n, wide characters, or malformed. */
+            return false;
+    }
+
+    spec->len = (size_t)(p - start) + 1;
+    return spec->len < _SIR_MAXFMTSPEC;
+}
+
+/** Appends the raw bytes of a value to the buffer, if there is room. */
+#define _SIR_DEFER_PUT(ctype, value) \
+    do { \
+        ctype _v = (value); \
+        if (off + sizeof(ctype) > size) \
+            return false; \
+        memcpy(buf + off, &_v, sizeof(ctype)); \
+        off += sizeof(ctype); \
+    } while (false)
+
+bool _sir_defer_encode(char* buf, size_t size, const char* format, va_list args) {
+    size_t off = 0;
+
+    for (const char* p = strchr(format, '%'); NULL != p; p = strchr(p, '%')) {
+        sirfmtspec spec;
+        if (!_sir_defer_parsespec(p, &spec))
+            return false;
+
+        p += spec.len;
+
+        if (_SIRARG_NONE == spec.type)
+            continue;
+
+        if (off >= size)
+            return false;
+
+        buf[off++] = (char)spec.type;
+
+        switch (spec.type) {
+            case _SIRARG_INT:     _SIR_DEFER_PUT(int, va_arg(args, int)); break;
+            case _SIRARG_LONG:    _SIR_DEFER_PUT(long, va_arg(args, long)); break;
+            case _SIRARG_LLONG:   _SIR_DEFER_PUT(long long, va_arg(args, long long)); break;
+            case _SIRARG_INTMAX:  _SIR_DEFER_PUT(intmax_t, va_arg(args, intmax_t)); break;
+            case _SIRARG_SIZE:    _SIR_DEFER_PUT(size_t, va_arg(args, size_t)); break;
+            case _SIRARG_PTRDIFF: _SIR_DEFER_PUT(ptrdiff_t, va_arg(args, ptrdiff_t)); break;
+            case _SIRARG_UINT:    _SIR_DEFER_PUT(unsigned, va_arg(args, unsigned)); break;
+            case _SIRARG_ULONG:   _SIR_DEFER_PUT(unsigned long, va_arg(args, unsigned long)); break;
+            case _SIRARG_ULLONG:
+                _SIR_DEFER_PUT(unsigned long long, va_arg(args, unsigned long long));
+                break;
+            case _SIRARG_UINTMAX: _SIR_DEFER_PUT(uintmax_t, va_arg(args, uintmax_t)); break;
+            case _SIRARG_DOUBLE:  _SIR_DEFER_PUT(double, va_arg(args, double)); break;
+            case _SIRARG_LDOUBLE: _SIR_DEFER_PUT(long double, va_arg(args, long double)); break;
+            case _SIRARG_PTR:     _SIR_DEFER_PUT(void*, va_arg(args, void*)); break;
+            case _SIRARG_STR: {
+                const char* str = va_arg(args, const char*);
+                if (NULL == str)
+                    str = "(null)";
+
+                /* room for at least one character and the terminator. */
+                if (off + 1 >= size)
+                    return false;
+
+                /* with a precision, the string need not be terminated. */
+                size_t room  = size - off - 1;
+                size_t limit = (spec.hasprec && spec.prec < room) ? spec.prec : room;
+                size_t len   = strnlen(str, limit);
+
+                if (len == room && (!spec.hasprec || spec.prec > room))
+                    return false;
+
+                memcpy(buf + off, str, len);
+                buf[off + len] = '\0';
+                off += len + 1;
+                break;
+            }
+            default: /* this should never happen. */
+                SIR_ASSERT(!"invalid argument type");
+                return false;
+        }
+    }
+
+    return true;
+}
+
+/** Reads the raw bytes of a value recorded by _SIR_DEFER_PUT, and formats it. */
+#define _SIR_DEFER_GET(ctype) \
+    do { \
+        ctype _v; \
+        memcpy(&_v, buf + off, sizeof(ctype)); \
+        off += sizeof(ctype); \
+        written = snprintf(out + len, size - len, spec, _v); \
+    } while (false)
+
+void _sir_defer_format(char* out, size_t size, const char* format, const char* buf) {
+    size_t len = 0;
+    size_t off = 0;
+    const char* p = format;
+
+    while ('\0' != *p && len < size - 1) {
+        const char* pct = strchr(p, '%');
+        size_t literal  = (NULL != pct) ? (size_t)(pct - p) : strlen(p);
+
+        if (literal > 0) {
+            size_t count = (literal < size - 1 - len) ? literal : size - 1 - len;
+            memcpy(out + len, p, count);
+            len += count;
+            p   += literal;
+            continue;
+        }
+
+        sirfmtspec parsed;
+        bool valid = _sir_defer_parsespec(p, &parsed);
+        SIR_ASSERT(valid);
+        if (!valid)
+            break;
+
+        if (_SIRARG_NONE == parsed.type) {
+            out[len++] = '%';
+            p += parsed.len;
+            continue;
+        }
+
+        char spec[_SIR_MAXFMTSPEC];
+        memcpy(spec, p, parsed.len);
+        spec[parsed.len] = '\0';
+        p += parsed.len;
+
+        int type    = buf[off++];
+        int written = 0;
+        SIR_ASSERT(type == parsed.type);
+
+        switch (type) {
+            case _SIRARG_INT:     _SIR_DEFER_GET(int); break;
+            case _SIRARG_LONG:    _SIR_DEFER_GET(long); break;
+            case _SIRARG_LLONG:   _SIR_DEFER_GET(long long); break;
+            case _SIRARG_INTMAX:  _SIR_DEFER_GET(intmax_t); break;
+            case _SIRARG_SIZE:    _SIR_DEFER_GET(size_t); break;
+            case _SIRARG_PTRDIFF: _SIR_DEFER_GET(ptrdiff_t); break;
+            case _SIRARG_UINT:    _SIR_DEFER_GET(unsigned); break;
+            case _SIRARG_ULONG:   _SIR_DEFER_GET(unsigned long); break;
+            case _SIRARG_ULLONG:  _SIR_DEFER_GET(unsigned long long); break;
+            case _SIRARG_UINTMAX: _SIR_DEFER_GET(uintmax_t); break;
+            case _SIRARG_DOUBLE:  _SIR_DEFER_GET(double); break;
+            case _SIRARG_LDOUBLE: _SIR_DEFER_GET(long double); break;
+            case _SIRARG_PTR:     _SIR_DEFER_GET(void*); break;
+            case _SIRARG_STR:
+                written = snprintf(out + len, size - len, spec, buf + off);
+                off += strlen(buf + off) + 1;
+                break;
+            default: /* this should never happen. */
+                SIR_ASSERT(!"invalid argument type");
+                written = -1;
+                break;
+        }
+
+        if (written < 0) {
+            _sir_handleerr(errno);
+            break;
+        }
+
+        len += ((size_t)written < size - len) ? (size_t)written : size - 1 - len;
+    }
+
+    out[len] = '\0';
+}
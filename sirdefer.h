@@ -0,0 +1,58 @@
+/*
+ * sirdefer.h
+ *
+ * Author:    Ryan M. Lederman <lederman@gmail.com>
+ * Copyright: Copyright (c) 2018-2023
+ * Version:   2.2.0
+ * License:   The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef _SIR_DEFER_H_INCLUDED
+# define _SIR_DEFER_H_INCLUDED
+
+# include "sirtypes.h"
+
+/**
+ * Deferred formatting: the logging thread records a message's arguments in a
+ * compact binary form (integers and floating-point values as-is, `%%s` strings
+ * copied), and the thread that delivers the message later produces the same
+ * text `vsnprintf` would have, one conversion at a time.
+ *
+ * Format strings that use `*` for width or precision, positional arguments,
+ * `%%n`, or wide characters/strings are not supported; callers should format
+ * those immediately.
+ */
+
+/** The longest single conversion specification that is supported (e.g. `%-08.3lld`). */
+# define _SIR_MAXFMTSPEC 32
+
+/**
+ * Records the arguments referenced by `format` into `buf`. Returns `false` if
+ * the format string is not supported or the arguments do not fit, in which
+ * case the contents of `buf` are undefined.
+ */
+bool _sir_defer_encode(char* buf, size_t size, const char* format, va_list args);
+
+/**
+ * Writes the text described by `format` and the arguments recorded in `buf`
+ * by ::_sir_defer_encode to `out` (truncated to `size` - 1 characters).
+ */
+void _sir_defer_format(char* out, size_t size, const char* format, const char* buf);
+
+#endif /* !_SIR_DEFER_H_INCLUDED */
@@ -0,0 +1,464 @@
+/*
+ * sirdest.c
+ *
+ * Author:    Ryan M. Lederman <lederman@gmail.com>
+ * Copyright: Copyright (c) 2018-2023
+ * Version:   2.2.0
+ * License:   The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "sirdest.h"
+#include "sirinternal.h"
+#include "sirdefaults.h"
+#include "sirhelpers.h"
+#include "sirthread.h"
+#include "sirqueue.h"
+
+/** A formatted message waiting in a queued destination's queue. */
+typedef struct {
+    sir_level level;
+    size_t len;
+    char line[SIR_MAXOUTPUT];
+} sirdestline;
+
+struct sirdest {
+    sirdestid id;
+    sir_dest_ops ops;
+    void* ctx;
+    sir_levels levels;
+    sir_options opts;
+    bool queued; /**< ::SIRO_QUEUED was set when the destination was added. */
+    sirqueue queue;
+    sir_thread thread;
+    sir_event wake;
+#if defined(__HAVE_ATOMIC_H__)
+    atomic_bool running;
+    atomic_bool stop;
+    atomic_bool idle;
+    atomic_size_t dropped;
+#else
+    volatile bool running;
+    volatile bool stop;
+    volatile bool idle;
+    volatile size_t dropped;
+#endif
+};
+
+sirdestid _sir_adddest(const sir_dest_ops* ops, void* ctx, sir_levels levels,
+    sir_options opts) {
+    _sir_seterror(_SIR_E_NOERROR);
+
+    if (!_sir_sanity())
+        return 0;
+
+    _sir_defaultlevels(&levels, sir_dest_def_lvls);
+
+    /* SIRO_QUEUED may accompany SIRO_DEFAULT. */
+    if (SIRO_DEFAULT == (opts & ~SIRO_QUEUED))
+        opts = sir_dest_def_opts | (opts & SIRO_QUEUED);
+
+    sirdcache* sdc = _sir_locksection(SIRMI_DESTCACHE);
+    if (!sdc) {
+        _sir_seterror(_SIR_E_INTERNAL);
+        return 0;
+    }
+
+    sirdestid retval = _sir_dcache_add(sdc, ops, ctx, levels, opts);
+    _sir_unlocksection(SIRMI_DESTCACHE);
+
+    return retval;
+}
+
+bool _sir_updatedest(sirdestid id, sir_update_config_data* data) {
+    _sir_seterror(_SIR_E_NOERROR);
+
+    if (!_sir_sanity() || !_sir_validdestid(id) || !_sir_validupdatedata(data))
+        return false;
+
+    sirdcache* sdc = _sir_locksection(SIRMI_DESTCACHE);
+    if (!sdc) {
+        _sir_seterror(_SIR_E_INTERNAL);
+        return false;
+    }
+
+    bool retval = _sir_dcache_update(sdc, id, data);
+    _sir_unlocksection(SIRMI_DESTCACHE);
+
+    return retval;
+}
+
+bool _sir_remdest(sirdestid id) {
+    _sir_seterror(_SIR_E_NOERROR);
+
+    if (!_sir_sanity() || !_sir_validdestid(id))
+        return false;
+
+    sirdcache* sdc = _sir_locksection(SIRMI_DESTCACHE);
+    if (!sdc) {
+        _sir_seterror(_SIR_E_INTERNAL);
+        return false;
+    }
+
+    sirdest* sd = _sir_dcache_detach(sdc, id);
+    _sir_unlocksection(SIRMI_DESTCACHE);
+
+    return NULL != sd && _sirdest_destroy(&sd);
+}
+
+bool _sir_remdests(void) {
+    sirdcache* sdc = _sir_locksection(SIRMI_DESTCACHE);
+    if (!sdc) {
+        _sir_seterror(_SIR_E_INTERNAL);
+        return false;
+    }
+
+    sirdest* dests[SIR_MAXDESTS];
+    size_t count = sdc->count;
+    memcpy(dests, sdc->dests, count * sizeof(sirdest*));
+    memset(sdc->dests, 0, sizeof(sdc->dests));
+    sdc->count = 0; /* nextid is kept, so ids from before this stay stale. */
+    _sir_dcache_reroute(sdc);
+    _sir_unlocksection(SIRMI_DESTCACHE);
+
+    bool retval = true;
+    for (size_t n = 0; n < count; n++)
+        retval &= _sirdest_destroy(&dests[n]);
+
+    return retval;
+}
+
+sirdest* _sirdest_create(const sir_dest_ops* ops, void* ctx, sir_levels levels,
+    sir_options opts) {
+    if (!_sir_validptr(ops) || !_sir_validfnptr(ops->write) ||
+        !_sir_validlevels(levels) || !_sir_validopts(opts))
+        return NULL;
+
+    sirdest* sd = (sirdest*)calloc(1, sizeof(sirdest));
+    if (!sd) {
+        _sir_handleerr(errno);
+        return NULL;
+    }
+
+    sd->ops    = *ops;
+    sd->ctx    = ctx;
+    sd->levels = levels;
+    sd->opts   = opts;
+    sd->queued = _sir_bittest(opts, SIRO_QUEUED);
+
+    if (!sd->queued)
+        return sd;
+
+    if (!_sir_queue_create(&sd->queue, SIR_DEST_QUEUESIZE, sizeof(sirdestline))) {
+        _sir_safefree(&sd);
+        return NULL;
+    }
+
+    if (!_sirevent_create(&sd->wake)) {
+        _sir_queue_destroy(&sd->queue);
+        _sir_safefree(&sd);
+        return NULL;
+    }
+
+#if defined(__HAVE_ATOMIC_H__)
+    atomic_init(&sd->stop, false);
+    atomic_init(&sd->idle, false);
+    atomic_init(&sd->dropped, 0);
+#endif
+
+    if (!_sirthread_create(&sd->thread, _sirdest_worker, sd)) {
+        (void)_sirevent_destroy(&sd->wake);
+        _sir_queue_destroy(&sd->queue);
+        _sir_safefree(&sd);
+        return NULL;
+    }
+
+#if defined(__HAVE_ATOMIC_H__)
+    atomic_store(&sd->running, true);
+#else
+    sd->running = true;
+#endif
+
+    return sd;
+}
+
+bool _sirdest_destroy(sirdest** sd) {
+    if (!_sir_validptrptr(sd) || !_sir_validptr(*sd))
+        return false;
+
+    sirdest* dest = *sd;
+    bool joined   = true;
+
+    if (dest->queued) {
+#if defined(__HAVE_ATOMIC_H__)
+        bool running = atomic_exchange(&dest->running, false);
+        atomic_store(&dest->stop, true);
+        size_t dropped = atomic_load(&dest->dropped);
+#else
+        bool running   = dest->running;
+        dest->running  = false;
+        dest->stop     = true;
+        size_t dropped = dest->dropped;
+#endif
+
+        /* the thread writes everything still queued before it exits. */
+        if (running) {
+            (void)_sirevent_signal(&dest->wake);
+            joined = _sirthread_join(&dest->thread);
+        }
+
+        if (0 != dropped)
+            _sir_selflog("custom destination %" PRIu32 ": %zu message(s) were dropped;"
+                " the queue was full", dest->id, dropped);
+
+        (void)_sirevent_destroy(&dest->wake);
+        _sir_queue_destroy(&dest->queue);
+    }
+
+    if (dest->ops.flush)
+        dest->ops.flush(dest->ctx);
+
+    if (dest->ops.close)
+        dest->ops.close(dest->ctx);
+
+    if (!joined)
+        _sir_selflog("error: thread of custom destination %" PRIu32 " failed to stop!", dest->id);
+
+    _sir_selflog("closed custom destination %" PRIu32, dest->id);
+    _sir_safefree(sd);
+
+    return joined;
+}
+
+sir_thread_ret SIR_THREAD_CALL _sirdest_worker(void* arg) {
+    sirdest* sd = (sirdest*)arg;
+    bool wrote  = false;
+
+    for (;;) {
+        sirdestline* dl = NULL;
+        while (NULL != (dl = (sirdestline*)_sir_queue_peek(&sd->queue))) {
+            if (!sd->ops.write(sd->ctx, dl->line, dl->len, dl->level))
+                _sir_selflog("error: write to custom destination %" PRIu32 " failed!", sd->id);
+            _sir_queue_release(&sd->queue);
+            wrote = true;
+        }
+
+        if (!_sir_queue_empty(&sd->queue)) {
+            /* a logging thread has reserved a slot, but not yet committed it. */
+            _sirthread_yield();
+            continue;
+        }
+
+        /* caught up; let the destination push out what it has buffered. */
+        if (wrote && sd->ops.flush)
+            sd->ops.flush(sd->ctx);
+        wrote = false;
+
+#if defined(__HAVE_ATOMIC_H__)
+        if (atomic_load(&sd->stop))
+            break;
+
+        atomic_store(&sd->idle, true);
+        if (_sir_queue_empty(&sd->queue) && !atomic_load(&sd->stop))
+            (void)_sirevent_wait(&sd->wake, SIR_ASYNC_WAITMSEC);
+        atomic_store(&sd->idle, false);
+#else
+        if (sd->stop)
+            break;
+
+        sd->idle = true;
+        if (_sir_queue_empty(&sd->queue) && !sd->stop)
+            (void)_sirevent_wait(&sd->wake, SIR_ASYNC_WAITMSEC);
+        sd->idle = false;
+#endif
+    }
+
+    return (sir_thread_ret)0;
+}
+
+/** Queues a message for a destination's thread; returns false if the queue is full. */
+static
+bool _sirdest_enqueue(sirdest* sd, sir_level level, const char* line, size_t len) {
+    size_t pos      = 0;
+    sirdestline* dl = (sirdestline*)_sir_queue_reserve(&sd->queue, &pos);
+    if (!dl) {
+#if defined(__HAVE_ATOMIC_H__)
+        atomic_fetch_add(&sd->dropped, 1);
+#else
+        sd->dropped++;
+#endif
+        return false;
+    }
+
+    dl->level = level;
+    dl->len   = len;
+    memcpy(dl->line, line, len + 1);
+    _sir_queue_commit(&sd->queue, pos);
+
+#if defined(__HAVE_ATOMIC_H__)
+    /* only the first logging thread to find the thread idle needs to wake it. */
+    if (atomic_load(&sd->idle) && atomic_exchange(&sd->idle, false))
+        (void)_sirevent_signal(&sd->wake);
+#else
+    if (sd->idle)
+        (void)_sirevent_signal(&sd->wake);
+#endif
+
+    return true;
+}
+
+/** Returns the position of the destination identified by `id`, or `sdc->count`. */
+static
+size_t _sir_dcache_find(const sirdcache* sdc, sirdestid id) {
+    size_t n = 0;
+    while (n < sdc->count && sdc->dests[n]->id != id)
+        n++;
+    return n;
+}
+
+sirdestid _sir_dcache_add(sirdcache* sdc, const sir_dest_ops* ops, void* ctx,
+    sir_levels levels, sir_options opts) {
+    if (!_sir_validptr(sdc))
+        return 0;
+
+    if (sdc->count >= SIR_MAXDESTS) {
+        _sir_seterror(_SIR_E_DCFULL);
+        return 0;
+    }
+
+    sirdest* sd = _sirdest_create(ops, ctx, levels, opts);
+    if (!sd)
+        return 0;
+
+    /* identifiers are never reused (0 is reserved for failure). */
+    if (0 == ++sdc->nextid)
+        ++sdc->nextid;
+    sd->id = sdc->nextid;
+    sdc->dests[sdc->count++] = sd;
+    _sir_dcache_reroute(sdc);
+
+    _sir_selflog("added custom destination %" PRIu32 " (levels: %04" PRIx16 ", options: %08"
+        PRIx32 ")", sd->id, levels, opts);
+    return sd->id;
+}
+
+bool _sir_dcache_update(sirdcache* sdc, sirdestid id, sir_update_config_data* data) {
+    if (!_sir_validptr(sdc) || !_sir_validdestid(id) || !_sir_validupdatedata(data))
+        return false;
+
+    size_t pos = _sir_dcache_find(sdc, id);
+    if (pos == sdc->count) {
+        _sir_seterror(_SIR_E_INVALID);
+        return false;
+    }
+
+    sirdest* sd = sdc->dests[pos];
+
+    if (_sir_bittest(data->fields, SIRU_LEVELS)) {
+        _sir_selflog("updating custom destination %" PRIu32 " levels from %04" PRIx16 " to %04"
+            PRIx16, sd->id, sd->levels, *data->levels);
+        sd->levels = *data->levels;
+    }
+
+    if (_sir_bittest(data->fields, SIRU_OPTIONS)) {
+        /* a destination's thread is only started when it is added. */
+        sir_options opts = (*data->opts & ~SIRO_QUEUED) | (sd->queued ? SIRO_QUEUED : 0);
+        _sir_selflog("updating custom destination %" PRIu32 " options from %08" PRIx32 " to %08"
+            PRIx32, sd->id, sd->opts, opts);
+        sd->opts = opts;
+    }
+
+    _sir_dcache_reroute(sdc);
+    return true;
+}
+
+sirdest* _sir_dcache_detach(sirdcache* sdc, sirdestid id) {
+    if (!_sir_validptr(sdc) || !_sir_validdestid(id))
+        return NULL;
+
+    size_t pos = _sir_dcache_find(sdc, id);
+    if (pos == sdc->count) {
+        _sir_seterror(_SIR_E_INVALID);
+        return NULL;
+    }
+
+    sirdest* sd = sdc->dests[pos];
+
+    /* the rest keep their order, so they are written to in the order they were added. */
+    memmove(&sdc->dests[pos], &sdc->dests[pos + 1], (sdc->count - pos - 1) * sizeof(sirdest*));
+    sdc->dests[--sdc->count] = NULL;
+    _sir_dcache_reroute(sdc);
+
+    return sd;
+}
+
+void _sir_dcache_reroute(sirdcache* sdc) {
+    sir_levels levels = SIRL_NONE;
+    for (size_t n = 0; n < sdc->count; n++)
+        levels |= sdc->dests[n]->levels;
+
+    _sir_setlevelmask(SIRMI_DESTCACHE, levels);
+}
+
+bool _sir_dcache_dispatch(sirdcache* sdc, sir_level level, sirbuf* buf,
+    size_t* dispatched, size_t* wanted) {
+    if (!_sir_validptr(sdc) || !_sir_validlevel(level) || !_sir_validptr(buf) ||
+        !_sir_validptr(dispatched) || !_sir_validptr(wanted))
+        return false;
+
+    *dispatched = 0;
+    *wanted = 0;
+
+    for (size_t n = 0; n < sdc->count; n++) {
+        sirdest* sd = sdc->dests[n];
+        if (!_sir_bittest(sd->levels, level))
+            continue;
+
+        (*wanted)++;
+
+        /* formatted once per distinct set of options. */
+        const char* line = _sir_format(false, sd->opts, buf);
+        SIR_ASSERT(line);
+        if (!line)
+            continue;
+
+#if defined(__HAVE_ATOMIC_H__)
+        bool queue = atomic_load(&sd->running);
+#else
+        bool queue = sd->running;
+#endif
+
+        if (queue ? _sirdest_enqueue(sd, level, line, buf->output_len)
+                  : sd->ops.write(sd->ctx, line, buf->output_len, level))
+            (*dispatched)++;
+        else if (!queue)
+            _sir_selflog("error: write to custom destination %" PRIu32 " failed!", sd->id);
+    }
+
+    return *dispatched == *wanted;
+}
+
+void _sir_dcache_atfork_child(sirdcache* sdc) {
+    for (size_t n = 0; n < sdc->count; n++) {
+#if defined(__HAVE_ATOMIC_H__)
+        atomic_store(&sdc->dests[n]->running, false);
+#else
+        sdc->dests[n]->running = false;
+#endif
+    }
+}
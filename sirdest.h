@@ -0,0 +1,88 @@
+/*
+ * sirdest.h
+ *
+ * Author:    Ryan M. Lederman <lederman@gmail.com>
+ * Copyright: Copyright (c) 2018-2023
+ * Version:   2.2.0
+ * License:   The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef _SIR_DEST_H_INCLUDED
+# define _SIR_DEST_H_INCLUDED
+
+# include "sirtypes.h"
+
+/** Adds a custom destination to the cache (see ::sir_adddest). */
+sirdestid _sir_adddest(const sir_dest_ops* ops, void* ctx, sir_levels levels,
+    sir_options opts);
+
+/** Updates the levels or options of a custom destination. */
+bool _sir_updatedest(sirdestid id, sir_update_config_data* data);
+
+/**
+ * Removes a custom destination from the cache, then (with the cache unlocked,
+ * so that logging threads are not held up) writes what is queued for it,
+ * flushes, and closes it.
+ */
+bool _sir_remdest(sirdestid id);
+
+/** Removes and closes every custom destination, as ::_sir_remdest does. */
+bool _sir_remdests(void);
+
+/**
+ * Allocates a custom destination and, if ::SIRO_QUEUED is set in `opts`,
+ * its queue and the thread that drains it.
+ */
+sirdest* _sirdest_create(const sir_dest_ops* ops, void* ctx, sir_levels levels,
+    sir_options opts);
+
+/**
+ * Stops the destination's thread once it has written every queued message,
+ * then flushes and closes the destination, and frees it.
+ */
+bool _sirdest_destroy(sirdest** sd);
+
+/** Queued destination thread: writes messages in the order they were queued. */
+sir_thread_ret SIR_THREAD_CALL _sirdest_worker(void* arg);
+
+sirdestid _sir_dcache_add(sirdcache* sdc, const sir_dest_ops* ops, void* ctx,
+    sir_levels levels, sir_options opts);
+bool _sir_dcache_update(sirdcache* sdc, sirdestid id, sir_update_config_data* data);
+
+/** Takes a destination out of the cache, leaving it to the caller to destroy. */
+sirdest* _sir_dcache_detach(sirdcache* sdc, sirdestid id);
+
+/** Publishes the union of the destinations' levels in the global level mask. */
+void _sir_dcache_reroute(sirdcache* sdc);
+
+/**
+ * Writes to (or queues for) each destination registered for `level`. A queued
+ * destination whose queue is full misses the message, rather than making the
+ * logging thread wait.
+ */
+bool _sir_dcache_dispatch(sirdcache* sdc, sir_level level, sirbuf* buf,
+    size_t* dispatched, size_t* wanted);
+
+/**
+ * Forgets the threads of queued destinations, which do not exist in a forked
+ * child; the child writes to those destinations from its logging threads.
+ */
+void _sir_dcache_atfork_child(sirdcache* sdc);
+
+#endif /* !_SIR_DEST_H_INCLUDED */
@@ -51,6 +51,7 @@ enum sir_errorcode {
     SIR_E_UNAVAIL   = 13,   /**< Feature is disabled or unavailable */
     SIR_E_INTERNAL  = 14,   /**< An internal error has occurred */
     SIR_E_PLATFORM  = 15,   /**< Platform error code %%d: %%s */
+    SIR_E_DCFULL    = 16,   /**< Maximum number of custom destinations already added */
     SIR_E_UNKNOWN   = 4095, /**< Unknown error */
 };
 
@@ -72,6 +73,7 @@ enum sir_errorcode {
 # define _SIR_E_UNAVAIL   _sir_mkerror(SIR_E_UNAVAIL)
 # define _SIR_E_INTERNAL  _sir_mkerror(SIR_E_INTERNAL)
 # define _SIR_E_PLATFORM  _sir_mkerror(SIR_E_PLATFORM)
+# define _SIR_E_DCFULL    _sir_mkerror(SIR_E_DCFULL)
 # define _SIR_E_UNKNOWN   _sir_mkerror(SIR_E_UNKNOWN)
 
 static const struct {
@@ -94,6 +96,7 @@ static const struct {
     {_SIR_E_UNAVAIL,   "Feature is disabled or unavailable"},
     {_SIR_E_INTERNAL,  "An internal error has occurred"},
     {_SIR_E_PLATFORM,  "Platform error code %d: %s"},
+    {_SIR_E_DCFULL,    "Maximum number of custom destinations already added"},
     {_SIR_E_UNKNOWN,   "Unknown error"},
 };
 
@@ -27,6 +27,10 @@
 #include "sirfilesystem.h"
 #include "sirinternal.h"
 #include "sirdefaults.h"
+#include "sirmutex.h"
+#include "siruring.h"
+#include "sirfilemap.h"
+#include "sirarchive.h"
 
 sirfileid _sir_addfile(const char* path, sir_levels levels, sir_options opts) {
     _sir_seterror(_SIR_E_NOERROR);
@@ -96,11 +100,16 @@ sirfile* _sirfile_create(const char* path, sir_levels levels, sir_options opts)
         return NULL;
     }
 
+    if (!_sirmutex_create(&sf->mutex)) {
+        _sir_safefree(&sf);
+        return NULL;
+    }
+
     size_t pathLen = strnlen(path, SIR_MAXPATH);
     sf->path       = (char*)calloc(pathLen + 1, sizeof(char));
     if (!sf->path) {
         _sir_handleerr(errno);
-        _sir_safefree(&sf);
+        _sirfile_destroy(&sf);
         return NULL;
     }
 
@@ -117,23 +126,164 @@ sirfile* _sirfile_create(const char* path, sir_levels levels, sir_options opts)
     return sf;
 }
 
-bool _sirfile_open(sirfile* sf) {
-    if (!_sir_validptr(sf) && !_sir_validstr(sf->path))
-        return false;
-
+/** Opens a stream for a log file, with the buffer its policy calls for. */
+static
+bool _sirfile_openstream(const sir_file_policy* policy, const char* path, const char* mode,
+    sirfilestream* stream) {
     FILE* f  = NULL;
-    int open = _sir_fopen(&f, sf->path, SIR_FOPENMODE);
+    int open = _sir_fopen(&f, path, mode);
     if (0 != open || !f)
         return false;
 
-    int fd = fileno(f);
-    if (!_sir_validfd(fd))
+    if (!_sir_validfd(fileno(f))) {
+        _sir_safefclose(&f);
+        return false;
+    }
+
+    /* the buffer must be set before the stream is used. */
+    char* vbuf = NULL;
+    if (policy->buffer_size > 0 && SIRFB_STDIO == policy->backend) {
+        vbuf = (char*)malloc(policy->buffer_size);
+        if (!vbuf) {
+            _sir_handleerr(errno);
+            _sir_safefclose(&f);
+            return false;
+        }
+
+        if (0 != setvbuf(f, vbuf, _IOFBF, policy->buffer_size)) {
+            _sir_handleerr(errno);
+            _sir_safefree(&vbuf);
+        }
+    }
+
+    stream->f    = f;
+    stream->vbuf = vbuf;
+    return true;
+}
+
+/** Closes a stream opened by ::_sirfile_openstream. */
+static
+void _sirfile_closestream(sirfilestream* stream) {
+    _sir_safefclose(&stream->f);
+    _sir_safefree(&stream->vbuf);
+    _sir_safefree(&stream->archive);
+}
+
+/** Builds the path of the file that takes over from a log file when it is rolled. */
+static
+bool _sirfile_nextpath(const sirfile* sf, char* nextpath) {
+    int print = snprintf(nextpath, SIR_MAXPATH, "%s%s", sf->path, SIR_FNEXTEXT);
+    return print > 0 && print < SIR_MAXPATH;
+}
+
+/** Closes and deletes a `next` stream, opened at `nextpath`, that is no longer needed. */
+static
+void _sirfile_discardnext(sirfilestream* next, const char* nextpath) {
+    if (!next->f)
+        return;
+
+    _sirfile_closestream(next);
+
+    if (0 != remove(nextpath))
+        _sir_handleerr(errno);
+}
+
+/**
+ * Hands a new archive to the archive thread, if the file's policy has it
+ * compress or trim the file's archives.
+ */
+static
+void _sirfile_archived(const sirfile* sf, const char* archive) {
+    _sir_selflog("archived '%s' " SIR_R_ARROW " '%s'", sf->path, archive);
+
+    if (_sir_archives_wanted(&sf->policy))
+        (void)_sir_archives_enqueue(sf->path, archive, &sf->policy);
+}
+
+/**
+ * Determines whether an archive path is taken, either by an archive or, for a
+ * file whose archives are compressed, by the compressed archive.
+ */
+static
+bool _sirfile_archiveexists(const sirfile* sf, const char* path, bool* exists) {
+    if (!_sir_pathexists(path, exists, SIR_PATH_REL_TO_CWD))
+        return false;
+
+    if (*exists || !sf->policy.compress)
+        return true;
+
+    char gzpath[SIR_MAXPATH] = {0};
+    int print = snprintf(gzpath, SIR_MAXPATH, "%s%s", path, SIR_FGZEXT);
+    if (print <= 0 || print >= SIR_MAXPATH)
+        return false;
+
+    return _sir_pathexists(gzpath, exists, SIR_PATH_REL_TO_CWD);
+}
+
+/** Renames a log file to its archive path and puts `next` in its place. */
+static
+void _sirfile_archiverolled(const sirfile* sf, sirfilestream* rolled) {
+    char nextpath[SIR_MAXPATH] = {0};
+    if (!_sirfile_nextpath(sf, nextpath))
+        return;
+
+    if (0 != rename(sf->path, rolled->archive)) {
+        _sir_handleerr(errno);
+        _sir_selflog("error: failed to archive '%s' as '%s'!", sf->path, rolled->archive);
+    } else if (0 != rename(nextpath, sf->path)) {
+        _sir_handleerr(errno);
+        _sir_selflog("error: failed to rename '%s' to '%s'!", nextpath, sf->path);
+    } else {
+        _sirfile_archived(sf, rolled->archive);
+    }
+
+    _sirfile_closestream(rolled);
+}
+
+/** Finishes archiving the file that `next` took over from. */
+static
+void _sirfile_finishroll(sirfile* sf) {
+    _sirfile_archiverolled(sf, &sf->rolled);
+    memset(&sf->rolled, 0, sizeof(sirfilestream));
+    sf->roll = SIRFR_NONE;
+}
+
+bool _sirfile_open(sirfile* sf) {
+    if (!_sir_validptr(sf) && !_sir_validstr(sf->path))
+        return false;
+
+    sirfilestream stream = {0};
+    if (!_sirfile_openstream(&sf->policy, sf->path, SIR_FOPENMODE, &stream))
         return false;
 
     _sirfile_close(sf);
 
-    sf->f  = f;
-    sf->id = fd;
+    sf->f      = stream.f;
+    sf->vbuf   = stream.vbuf;
+    sf->id     = fileno(stream.f);
+    sf->size   = 0;
+    sf->writes = 0;
+
+    /* from here on, the size is tracked as it is written. */
+    if (!_sirfile_syncsize(sf))
+        _sir_selflog("error: failed to get size of file %d (path: '%s')!", sf->id, sf->path);
+
+    _sirfile_schedroll(sf, -1);
+
+    if (SIRFB_URING == sf->policy.backend) {
+        sf->uring = _sir_uring_create(sf->path, sf->policy.buffer_size > 0 ?
+            sf->policy.buffer_size : SIR_URING_BUFSIZE, (uint64_t)sf->size);
+        if (!sf->uring)
+            _sir_selflog("io_uring is unavailable for file %d (path: '%s'); using stdio",
+                sf->id, sf->path);
+    } else if (SIRFB_MMAP == sf->policy.backend) {
+        sf->map = _sir_filemap_create(sf->path, sf->policy.buffer_size > 0 ?
+            sf->policy.buffer_size : SIR_MMAP_CHUNKSIZE, (uint64_t)sf->size);
+        if (sf->map)
+            sf->size = (long)_sir_filemap_size(sf->map);
+        else
+            _sir_selflog("unable to map file %d (path: '%s'); using stdio", sf->id, sf->path);
+    }
 
     return true;
 }
@@ -142,23 +292,78 @@ void _sirfile_close(sirfile* sf) {
     if (!_sir_validptrnofail(sf) || !_sir_validptrnofail(sf->f))
         return;
 
+    /* a roll in progress is finished first; the file that would have taken
+     * over from this one is no longer needed. */
+    if (SIRFR_ARCHIVING == sf->roll)
+        _sirfile_finishroll(sf);
+
+    char nextpath[SIR_MAXPATH] = {0};
+    if (_sirfile_nextpath(sf, nextpath))
+        _sirfile_discardnext(&sf->next, nextpath);
+    _sirfile_closestream(&sf->next);
+    sf->roll = SIRFR_NONE;
+
+    /* everything in flight lands before the stream goes away. */
+    _sir_uring_destroy(&sf->uring);
+    _sir_filemap_destroy(&sf->map);
     _sir_safefclose(&sf->f);
+    _sir_safefree(&sf->vbuf);
+    sf->dirty = 0;
+}
+
+void _sirfile_flush(sirfile* sf) {
+    if (sf->uring)
+        (void)_sir_uring_flush(sf->uring);
+    else if (sf->map)
+        (void)_sir_filemap_flush(sf->map);
+    else
+        _sir_fflush(sf->f);
+    sf->dirty = 0;
+}
+
+void _sirfile_applypolicy(sirfile* sf, sir_level level) {
+    if (_sir_bittest(sf->policy.flush_levels, level)) {
+        _sirfile_flush(sf);
+    } else if (sf->policy.flush_msec > 0 && 0 == sf->dirty) {
+        /* the housekeeping thread flushes it when the time comes. */
+        sf->dirty = _sir_msectime();
+        _sir_housekeeping_wake();
+    }
 }
 
-bool _sirfile_write(sirfile* sf, const char* output) {
+bool _sirfile_write(sirfile* sf, const char* output, time_t now) {
     if (!_sirfile_validate(sf) || !_sir_validstr(output))
         return false;
 
-    if (_sirfile_needsroll(sf)) {
+    size_t writeLen = strnlen(output, SIR_MAXOUTPUT);
+
+    if (_sirfile_needsroll(sf, writeLen, now)) {
         bool rolled   = false;
         char* newpath = NULL;
 
-        _sir_selflog("file %d (path: '%s') reached ~%ld bytes in size; rolling...",
-            sf->id, sf->path, SIR_FROLLSIZE);
+        _sir_selflog("file %d (path: '%s') reached ~%" PRIu64 " bytes in size or its"
+            " roll time; rolling...", sf->id, sf->path, _sirfile_rollsize(sf));
 
-        _sir_fflush(sf->f);
+        /* the housekeeping thread hasn't archived the last roll yet; rather
+         * than let the file grow past its roll size, that's done here, and
+         * the file is rolled in place. */
+        if (SIRFR_ARCHIVING == sf->roll) {
+            _sir_selflog("file %d (path: '%s') is still being archived; finishing",
+                sf->id, sf->path);
+            _sirfile_finishroll(sf);
+        }
+
+        /* whether or not it works out, the next time-based roll is the next one due. */
+        _sirfile_schedroll(sf, now);
+
+        if (SIRFR_READY == sf->roll) {
+            rolled = _sirfile_switch(sf, &newpath);
+        } else {
+            _sirfile_flush(sf);
+            rolled = _sirfile_roll(sf, &newpath);
+        }
 
-        if (_sirfile_roll(sf, &newpath)) {
+        if (rolled) {
             char header[SIR_MAXFHEADER] = {0};
             snprintf(header, SIR_MAXFHEADER, SIR_FHROLLED, newpath);
             rolled = _sirfile_writeheader(sf, header);
@@ -170,8 +375,14 @@ bool _sirfile_write(sirfile* sf, const char* output) {
                 sf->id, sf->path);
     }
 
-    size_t writeLen = strnlen(output, SIR_MAXFHEADER);
-    size_t write    = fwrite(output, sizeof(char), writeLen, sf->f);
+    size_t write = 0;
+    if (sf->uring)
+        write = _sir_uring_write(sf->uring, output, writeLen) ? writeLen : 0;
+    else if (sf->map)
+        write = _sir_filemap_write(sf->map, output, writeLen) ? writeLen : 0;
+    else
+        write = fwrite(output, sizeof(char), writeLen, sf->f);
+    sf->size += (long)write;
 
     SIR_ASSERT(write == writeLen);
 
@@ -204,25 +415,170 @@ bool _sirfile_writeheader(sirfile* sf, const char* msg) {
         return false;
     }
 
-    return 0 <= fmt && _sirfile_write(sf, header);
+    return 0 <= fmt && _sirfile_write(sf, header, -1);
 }
 
-bool _sirfile_needsroll(sirfile* sf) {
+bool _sirfile_needsroll(sirfile* sf, size_t towrite, time_t now) {
     if (!_sirfile_validate(sf))
         return false;
 
-    struct stat st = {0};
-    int getstat    = fstat(sf->id, &st);
+    if (++sf->writes >= SIR_FSIZE_CHK_WRITES)
+        (void)_sirfile_syncsize(sf);
+
+    uint64_t size     = (uint64_t)sf->size + towrite;
+    uint64_t rollsize = _sirfile_rollsize(sf);
+    uint64_t prepsize = rollsize / 4 < SIR_FROLLPREPSIZE ? rollsize / 4 : SIR_FROLLPREPSIZE;
+
+    if (SIRFR_NONE == sf->roll && size > rollsize - prepsize && _sirfile_canrollbg(sf)) {
+        /* have the file that takes over ready by the time it's needed. */
+        sf->roll = SIRFR_WANTNEXT;
+        _sir_housekeeping_wake();
+    }
+
+    if (size > rollsize)
+        return true;
+
+    /* the time the message was logged at is used; there's no clock to read. */
+    if (0 != sf->rollat && -1 != now && now >= sf->rollat) {
+        if (sf->size > 0)
+            return true;
+        _sirfile_schedroll(sf, now); /* nothing to archive yet. */
+    }
+
+    return false;
+}
+
+uint64_t _sirfile_rollsize(const sirfile* sf) {
+    return sf->policy.roll_size > 0 ? sf->policy.roll_size : (uint64_t)SIR_FROLLSIZE;
+}
+
+void _sirfile_schedroll(sirfile* sf, time_t now) {
+    sf->rollat = 0;
+    if (SIRRI_NONE == sf->policy.roll_interval)
+        return;
+
+    if (-1 == now)
+        now = time(NULL);
+
+    /* the next boundary in local time, as the archives' time stamps are. */
+    struct tm timebuf = {0};
+    struct tm* tm     = _sir_localtime(&now, &timebuf);
+    if (!tm)
+        return;
+
+    struct tm next = *tm;
+    next.tm_sec    = 0;
+    next.tm_min    = 0;
+    next.tm_isdst  = -1;
+
+    if (SIRRI_DAILY == sf->policy.roll_interval) {
+        next.tm_hour = 0;
+        next.tm_mday++;
+    } else {
+        next.tm_hour++;
+    }
+
+    time_t rollat = mktime(&next);
+    if (-1 != rollat && rollat > now) {
+        sf->rollat = rollat;
+    } else {
+        /* shouldn't happen, but never roll on every write if it does. */
+        sf->rollat = now + 3600;
+    }
+}
+
+bool _sirfile_canrollbg(const sirfile* sf) {
+#if !defined(__WIN__)
+    /* io_uring and mapped files are tied to the path they were opened with. */
+    return !sf->uring && !sf->map;
+#else /* __WIN__ */
+    /* open files can't be renamed. */
+    _SIR_UNUSED(sf);
+    return false;
+#endif
+}
+
+bool _sirfile_switch(sirfile* sf, char** newpath) {
+    if (!_sirfile_validate(sf) || !_sir_validptrptr(newpath) || SIRFR_READY != sf->roll)
+        return false;
 
-    if (0 != getstat) {
+    /* named for when the roll happens, not for when `next` was opened. */
+    if (!_sirfile_archivepath(sf, newpath))
+        return false;
+
+    char* archive = strdup(*newpath);
+    if (!archive) {
         _sir_handleerr(errno);
         return false;
     }
 
-    return st.st_size + BUFSIZ >= SIR_FROLLSIZE || SIR_FROLLSIZE - (st.st_size + BUFSIZ) <= BUFSIZ;
+    sf->rolled.f       = sf->f;
+    sf->rolled.vbuf    = sf->vbuf;
+    sf->rolled.archive = archive;
+
+    sf->f      = sf->next.f;
+    sf->vbuf   = sf->next.vbuf;
+    sf->id     = fileno(sf->f);
+    sf->size   = 0;
+    sf->writes = 0;
+    sf->dirty  = 0;
+    sf->roll   = SIRFR_ARCHIVING;
+    memset(&sf->next, 0, sizeof(sirfilestream));
+
+    /* the old stream is flushed, closed and archived in the background. */
+    _sir_selflog("file %d (path: '%s') switched to next; archiving as '%s'", sf->id,
+        sf->path, *newpath);
+    _sir_housekeeping_wake();
+    return true;
+}
+
+bool _sirfile_syncsize(sirfile* sf) {
+    if (!_sirfile_validate(sf))
+        return false;
+
+    sf->writes = 0;
+
+    /* a mapped file's size on disk includes the space preallocated for it,
+     * and io_uring writes go to offsets libsir keeps track of itself; waiting
+     * on the ones in flight would only stall the logging thread. */
+    if (sf->map || sf->uring)
+        return true;
+
+    /* what is still buffered is not yet on disk, but it is counted rather
+     * than flushed, which is up to the file's policy: the stream's position
+     * is ahead of the file descriptor's by as much. */
+    long buffered = 0;
+    long streampos = ftell(sf->f);
+#if !defined(__WIN__)
+    long fdpos = (long)lseek(sf->id, 0, SEEK_CUR);
+#else /* __WIN__ */
+    long fdpos = _lseek(sf->id, 0, SEEK_CUR);
+#endif
+    if (-1 != streampos && -1 != fdpos && streampos > fdpos)
+        buffered = streampos - fdpos;
+
+    struct stat st = {0};
+    if (0 != fstat(sf->id, &st)) {
+        _sir_handleerr(errno);
+        return false;
+    }
+
+    long size = (long)st.st_size + buffered;
+    if (size != sf->size) {
+        if (0 != sf->size)
+            _sir_selflog("file %d (path: '%s') is %ld bytes on disk (+%ld buffered), not"
+                " %ld; resynced", sf->id, sf->path, (long)st.st_size, buffered, sf->size);
+        sf->size = size;
+    }
+
+    return true;
 }
 
 bool _sirfile_roll(sirfile* sf, char** newpath) {
+    return _sirfile_archivepath(sf, newpath) && _sirfile_archive(sf, *newpath);
+}
+
+bool _sirfile_archivepath(sirfile* sf, char** newpath) {
     if (!_sirfile_validate(sf) || !_sir_validptrptr(newpath))
         return false;
 
@@ -267,7 +623,7 @@ bool _sirfile_roll(sirfile* sf, char** newpath) {
                             * operation, then we'll overwrite the last rolled log file,
                             * and that = data loss. make sure the target path does not
                             * already exist. */
-                        if (!_sir_pathexists(*newpath, &exists, SIR_PATH_REL_TO_CWD)) {
+                        if (!_sirfile_archiveexists(sf, *newpath, &exists)) {
                             /* failed to determine if the file already exists; it is better
                                 * to continue logging to the same file than to possibly overwrite
                                 * another (if it failed this time, it will again, so there's no
@@ -300,7 +656,7 @@ bool _sirfile_roll(sirfile* sf, char** newpath) {
                         _sir_selflog("error: unable to determine suitable path for '%s';"
                                         " not rolling!", sf->path);
 
-                    retval = resolved && _sirfile_archive(sf, *newpath);
+                    retval = resolved;
                 }
             }
         }
@@ -328,7 +684,7 @@ bool _sirfile_archive(sirfile* sf, const char* newpath) {
     }
 
     if (_sirfile_open(sf)) {
-        _sir_selflog("archived '%s' " SIR_R_ARROW " '%s'", sf->path, newpath);
+        _sirfile_archived(sf, newpath);
         return true;
     }
 
@@ -368,6 +724,7 @@ void _sirfile_destroy(sirfile** sf) {
 
     _sirfile_close(*sf);
     _sir_safefree(&(*sf)->path);
+    _sirmutex_destroy(&(*sf)->mutex);
     _sir_safefree(sf);
 }
 
@@ -393,6 +750,16 @@ bool _sirfile_update(sirfile* sf, sir_update_config_data* data) {
         return true;
     }
 
+    if (_sir_bittest(data->fields, SIRU_POLICY)) {
+        _sir_selflog("updating file %d policy: buffer: %" PRIu32 ", flush: %" PRIu32
+                     "ms, flush levels: %04" PRIx16, sf->id, data->policy->buffer_size,
+            data->policy->flush_msec, data->policy->flush_levels);
+
+        /* the new buffer can only be set up on a new stream. */
+        sf->policy = *data->policy;
+        return _sirfile_open(sf);
+    }
+
     if (_sir_bittest(data->fields, SIRU_OPTIONS)) {
         if (sf->opts != *data->opts) {
             _sir_selflog("updating file %d options from %08" PRIx32 " to %08" PRIx32, sf->id,
@@ -409,6 +776,161 @@ bool _sirfile_update(sirfile* sf, sir_update_config_data* data) {
     return false;
 }
 
+/** FNV-1a hash of a path (case-insensitive on Windows, as paths are there). */
+static
+uint32_t _sir_fcache_hashpath(const char* path) {
+    uint32_t hash = 2166136261U;
+    for (const char* p = path; *p && p < path + SIR_MAXPATH; p++) {
+        unsigned char c = (unsigned char)*p;
+#if defined(__WIN__)
+        if (c >= 'A' && c <= 'Z')
+            c = (unsigned char)(c + ('a' - 'A'));
+#endif
+        hash = (hash ^ c) * 16777619U;
+    }
+    return hash;
+}
+
+/** Hash of a ::sirfileid, which points into its file and never moves. */
+static
+uint32_t _sir_fcache_hashid(sirfileid id) {
+    uint64_t x = (uint64_t)(uintptr_t)id;
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return (uint32_t)x;
+}
+
+/** Finds the slot for `match` in an index, or the empty slot where it would go. */
+static
+size_t _sir_fcache_probe(const sirfcache* sfc, const sir_fcache_slot* index, uint32_t hash,
+    const void* match, sir_fcache_pred pred) {
+    size_t mask = sfc->slots - 1;
+    size_t slot = hash & mask;
+
+    while (0 != index[slot].pos) {
+        if (index[slot].hash == hash && pred(match, sfc->files[index[slot].pos - 1]))
+            break;
+        slot = (slot + 1) & mask;
+    }
+
+    return slot;
+}
+
+/** Finds the slot in an index that refers to position `pos` in `files`. */
+static
+size_t _sir_fcache_probepos(const sirfcache* sfc, const sir_fcache_slot* index, uint32_t hash,
+    size_t pos) {
+    size_t mask = sfc->slots - 1;
+    size_t slot = hash & mask;
+
+    while (0 != index[slot].pos && index[slot].pos != pos + 1)
+        slot = (slot + 1) & mask;
+
+    return slot;
+}
+
+/** Finds the first empty slot in an index for a key with `hash`. */
+static
+size_t _sir_fcache_freeslot(const sirfcache* sfc, const sir_fcache_slot* index, uint32_t hash) {
+    size_t mask = sfc->slots - 1;
+    size_t slot = hash & mask;
+
+    while (0 != index[slot].pos)
+        slot = (slot + 1) & mask;
+
+    return slot;
+}
+
+/** Empties a slot, moving later entries back so that no probe sequence is broken. */
+static
+void _sir_fcache_unslot(const sirfcache* sfc, sir_fcache_slot* index, size_t slot) {
+    size_t mask = sfc->slots - 1;
+    size_t next = slot;
+
+    for (;;) {
+        next = (next + 1) & mask;
+        if (0 == index[next].pos)
+            break;
+
+        /* an entry can move back to `slot` unless its home lies between them. */
+        size_t home = index[next].hash & mask;
+        bool stays  = (slot <= next) ? (slot < home && home <= next)
+                                     : (slot < home || home <= next);
+        if (!stays) {
+            index[slot] = index[next];
+            slot        = next;
+        }
+    }
+
+    index[slot].pos  = 0;
+    index[slot].hash = 0;
+}
+
+/** Enters the file at position `pos` in `files` into both indexes. */
+static
+void _sir_fcache_index(sirfcache* sfc, size_t pos) {
+    sirfile* sf = sfc->files[pos];
+
+    uint32_t hash = _sir_fcache_hashpath(sf->path);
+    size_t slot   = _sir_fcache_freeslot(sfc, sfc->bypath, hash);
+    sfc->bypath[slot].hash = hash;
+    sfc->bypath[slot].pos  = (uint32_t)(pos + 1);
+
+    hash = _sir_fcache_hashid(&sf->id);
+    slot = _sir_fcache_freeslot(sfc, sfc->byid, hash);
+    sfc->byid[slot].hash = hash;
+    sfc->byid[slot].pos  = (uint32_t)(pos + 1);
+}
+
+/** Makes room for at least one more file, rebuilding the indexes if they grow. */
+static
+bool _sir_fcache_reserve(sirfcache* sfc) {
+    if (sfc->count < sfc->capacity)
+        return true;
+
+    size_t capacity = sfc->capacity > 0 ? sfc->capacity * 2 : SIR_FCACHE_INITSIZE;
+    size_t slots    = sfc->slots > 0 ? sfc->slots : 2;
+    while (slots <= capacity * 2)
+        slots *= 2;
+
+    sirfile** files = (sirfile**)realloc(sfc->files, capacity * sizeof(sirfile*));
+    if (!files) {
+        _sir_handleerr(errno);
+        return false;
+    }
+    sfc->files = files;
+
+    sirfile** routed = (sirfile**)realloc(sfc->routed,
+        capacity * SIR_NUMLEVELS * sizeof(sirfile*));
+    if (!routed) {
+        _sir_handleerr(errno);
+        return false;
+    }
+    sfc->routed = routed;
+
+    sir_fcache_slot* bypath = (sir_fcache_slot*)calloc(slots, sizeof(sir_fcache_slot));
+    sir_fcache_slot* byid   = (sir_fcache_slot*)calloc(slots, sizeof(sir_fcache_slot));
+    if (!bypath || !byid) {
+        _sir_handleerr(errno);
+        _sir_safefree(&bypath);
+        _sir_safefree(&byid);
+        return false;
+    }
+
+    _sir_safefree(&sfc->bypath);
+    _sir_safefree(&sfc->byid);
+    sfc->bypath   = bypath;
+    sfc->byid     = byid;
+    sfc->slots    = slots;
+    sfc->capacity = capacity;
+
+    for (size_t n = 0; n < sfc->count; n++)
+        _sir_fcache_index(sfc, n);
+
+    return true;
+}
+
 sirfileid _sir_fcache_add(sirfcache* sfc, const char* path, sir_levels levels,
     sir_options opts) {
     if (!_sir_validptr(sfc) || !_sir_validstr(path) || !_sir_validlevels(levels) ||
@@ -427,9 +949,14 @@ sirfileid _sir_fcache_add(sirfcache* sfc, const char* path, sir_levels levels,
         return NULL;
     }
 
+    if (!_sir_fcache_reserve(sfc))
+        return NULL;
+
     sirfile* sf = _sirfile_create(path, levels, opts);
     if (_sirfile_validate(sf)) {
-        sfc->files[sfc->count++] = sf;
+        sfc->files[sfc->count] = sf;
+        _sir_fcache_index(sfc, sfc->count++);
+        _sir_fcache_reroute(sfc);
 
         if (!_sir_bittest(sf->opts, SIRO_NOHDR))
             _sirfile_writeheader(sf, SIR_FHBEGIN);
@@ -437,7 +964,7 @@ sirfileid _sir_fcache_add(sirfcache* sfc, const char* path, sir_levels levels,
         return &sf->id;
     }
 
-    _sir_safefree(&sf);
+    _sirfile_destroy(&sf);
 
     return NULL;
 }
@@ -453,31 +980,54 @@ bool _sir_fcache_update(sirfcache* sfc, sirfileid id, sir_update_config_data* da
         return false;
     }
 
-    return _sirfile_update(found, data);
+    bool updated = _sirfile_update(found, data);
+    if (updated)
+        _sir_fcache_reroute(sfc);
+
+    return updated;
 }
 
 bool _sir_fcache_rem(sirfcache* sfc, sirfileid id) {
     if (!_sir_validptr(sfc) || !_sir_validptr(id) || !_sir_validfd(*id))
         return false;
 
-    for (size_t n = 0; n < sfc->count; n++) {
-        SIR_ASSERT(_sirfile_validate(sfc->files[n]));
-
-        if (sfc->files[n]->id == *id) {
-            _sirfile_destroy(&sfc->files[n]);
+    if (0 == sfc->count) {
+        _sir_seterror(_SIR_E_NOFILE);
+        return false;
+    }
 
-            for (size_t i = n; i < sfc->count - 1; i++) {
-                sfc->files[i] = sfc->files[i + 1];
-                sfc->files[i + 1] = NULL;
-            }
+    uint32_t idhash = _sir_fcache_hashid(id);
+    size_t idslot   = _sir_fcache_probe(sfc, sfc->byid, idhash, id, _sir_fcache_pred_id);
+    if (0 == sfc->byid[idslot].pos) {
+        _sir_seterror(_SIR_E_NOFILE);
+        return false;
+    }
 
-            sfc->count--;
-            return true;
-        }
+    size_t pos  = sfc->byid[idslot].pos - 1;
+    size_t last = sfc->count - 1;
+    sirfile* sf = sfc->files[pos];
+    SIR_ASSERT(_sirfile_validate(sf));
+
+    _sir_fcache_unslot(sfc, sfc->byid, idslot);
+    _sir_fcache_unslot(sfc, sfc->bypath, _sir_fcache_probepos(sfc, sfc->bypath,
+        _sir_fcache_hashpath(sf->path), pos));
+
+    /* the last file takes the removed one's place, so the array stays compact. */
+    if (pos != last) {
+        sirfile* moved = sfc->files[last];
+        sfc->bypath[_sir_fcache_probepos(sfc, sfc->bypath, _sir_fcache_hashpath(moved->path),
+            last)].pos = (uint32_t)(pos + 1);
+        sfc->byid[_sir_fcache_probepos(sfc, sfc->byid, _sir_fcache_hashid(&moved->id),
+            last)].pos = (uint32_t)(pos + 1);
+        sfc->files[pos] = moved;
     }
 
-    _sir_seterror(_SIR_E_NOFILE);
-    return false;
+    sfc->files[last] = NULL;
+    sfc->count--;
+
+    _sirfile_destroy(&sf);
+    _sir_fcache_reroute(sfc);
+    return true;
 }
 
 bool _sir_fcache_pred_path(const void* match, sirfile* iter) {
@@ -491,14 +1041,34 @@ bool _sir_fcache_pred_path(const void* match, sirfile* iter) {
 }
 
 bool _sir_fcache_pred_id(const void* match, sirfile* iter) {
-    sirfileid id = (sirfileid)match;
-    return iter->id == *id;
+    /* the identifier handed out is the address of the file's descriptor. */
+    return (sirfileid)match == &iter->id;
 }
 
 sirfile* _sir_fcache_find(sirfcache* sfc, const void* match, sir_fcache_pred pred) {
     if (!_sir_validptr(sfc) || !_sir_validptr(match) || !_sir_validfnptr(pred))
         return NULL;
 
+    if (0 == sfc->count)
+        return NULL;
+
+    /* the indexed keys are looked up directly; anything else is searched for. */
+    const sir_fcache_slot* index = NULL;
+    uint32_t hash = 0;
+
+    if (_sir_fcache_pred_path == pred) {
+        index = sfc->bypath;
+        hash  = _sir_fcache_hashpath((const char*)match);
+    } else if (_sir_fcache_pred_id == pred) {
+        index = sfc->byid;
+        hash  = _sir_fcache_hashid((sirfileid)match);
+    }
+
+    if (index) {
+        size_t slot = _sir_fcache_probe(sfc, index, hash, match, pred);
+        return 0 != index[slot].pos ? sfc->files[index[slot].pos - 1] : NULL;
+    }
+
     for (size_t n = 0; n < sfc->count; n++) {
         if (pred(match, sfc->files[n]))
             return sfc->files[n];
@@ -514,14 +1084,114 @@ bool _sir_fcache_destroy(sirfcache* sfc) {
     for (size_t n = 0; n < sfc->count; n++) {
         SIR_ASSERT(_sirfile_validate(sfc->files[n]));
         _sirfile_destroy(&sfc->files[n]);
-        sfc->files[n] = NULL;
-        sfc->count--;
     }
 
+    _sir_safefree(&sfc->files);
+    _sir_safefree(&sfc->routed);
+    _sir_safefree(&sfc->bypath);
+    _sir_safefree(&sfc->byid);
     memset(sfc, 0, sizeof(sirfcache));
+    _sir_setlevelmask(SIRMI_FILECACHE, SIRL_NONE);
     return true;
 }
 
+uint32_t _sir_fcache_flushdue(sirfcache* sfc, uint64_t now) {
+    uint32_t next = UINT32_MAX;
+
+    for (size_t n = 0; n < sfc->count; n++) {
+        sirfile* sf = sfc->files[n];
+        if ((0 == sf->policy.flush_msec && !sf->uring) || !_sirmutex_lock(&sf->mutex))
+            continue;
+
+        /* frees up buffers that have been written in the meantime. */
+        _sir_uring_reap(sf->uring);
+
+        if (0 != sf->dirty) {
+            uint64_t due = sf->dirty + sf->policy.flush_msec;
+            if (now >= due) {
+                _sirfile_flush(sf);
+            } else if (due - now < next) {
+                next = (uint32_t)(due - now);
+            }
+        }
+
+        _sirmutex_unlock(&sf->mutex);
+    }
+
+    return next;
+}
+
+void _sir_fcache_rollpending(sirfcache* sfc) {
+    for (size_t n = 0; n < sfc->count; n++) {
+        sirfile* sf = sfc->files[n];
+        if (!_sirmutex_lock(&sf->mutex))
+            continue;
+
+        /* archived with the file locked: a logging thread that would take
+         * the file past its roll size finishes the job itself. */
+        sir_fileroll roll = sf->roll;
+        if (SIRFR_ARCHIVING == roll)
+            _sirfile_finishroll(sf);
+
+        char nextpath[SIR_MAXPATH] = {0};
+        sir_file_policy policy     = sf->policy;
+        if (SIRFR_WANTNEXT == roll && !_sirfile_nextpath(sf, nextpath)) {
+            sf->roll = SIRFR_SYNC;
+            roll     = SIRFR_SYNC;
+        }
+        _sirmutex_unlock(&sf->mutex);
+
+        /* the file can't go away meanwhile: the file cache is locked. what
+         * else is needed of it is copied while it's locked, too. */
+        if (SIRFR_WANTNEXT == roll) {
+            sirfilestream next = {0};
+
+            bool ready = _sirfile_openstream(&policy, nextpath, "w", &next);
+
+            bool attached = false;
+            if (_sirmutex_lock(&sf->mutex)) {
+                if (SIRFR_WANTNEXT == sf->roll) {
+                    sf->roll = ready ? SIRFR_READY : SIRFR_SYNC;
+                    if (ready) {
+                        sf->next = next;
+                        attached = true;
+                    }
+                }
+                _sirmutex_unlock(&sf->mutex);
+            }
+
+            if (!ready)
+                _sir_selflog("error: failed to prepare '%s'; will roll in place", nextpath);
+
+            if (!attached)
+                _sirfile_discardnext(&next, nextpath);
+        }
+    }
+}
+
+void _sir_fcache_reroute(sirfcache* sfc) {
+    sir_levels levels = SIRL_NONE;
+    size_t off        = 0;
+
+    for (size_t idx = 0; idx < SIR_NUMLEVELS; idx++) {
+        sir_level level = (sir_level)(1U << idx);
+        sfc->routeoff[idx] = off;
+
+        for (size_t n = 0; n < sfc->count; n++) {
+            if (_sir_bittest(sfc->files[n]->levels, level))
+                sfc->routed[off++] = sfc->files[n];
+        }
+
+        if (off > sfc->routeoff[idx])
+            levels |= level;
+    }
+
+    sfc->routeoff[SIR_NUMLEVELS] = off;
+    SIR_ASSERT(off <= sfc->capacity * SIR_NUMLEVELS);
+
+    _sir_setlevelmask(SIRMI_FILECACHE, levels);
+}
+
 bool _sir_fcache_dispatch(sirfcache* sfc, sir_level level, sirbuf* buf,
     size_t* dispatched, size_t* wanted) {
     if (!_sir_validptr(sfc) || !_sir_validlevel(level) || !_sir_validptr(buf) ||
@@ -529,36 +1199,37 @@ bool _sir_fcache_dispatch(sirfcache* sfc, sir_level level, sirbuf* buf,
         return false;
 
     bool retval = true;
-    const char* write = NULL;
-    sir_options lastopts = 0;
 
     *dispatched = 0;
     *wanted = 0;
 
-    for (size_t n = 0; n < sfc->count; n++) {
-        SIR_ASSERT(_sirfile_validate(sfc->files[n]));
-
-        if (!_sir_bittest(sfc->files[n]->levels, level)) {
-            _sir_selflog("level %04" PRIx16 " not set in level mask (%04" PRIx16
-                         ") for file %d (path: '%s'); skipping",
-                level, sfc->files[n]->levels, sfc->files[n]->id, sfc->files[n]->path);
-            continue;
-        }
+    /* only the files that want this level are visited. */
+    size_t idx = _sir_levelindex(level);
+    for (size_t n = sfc->routeoff[idx]; n < sfc->routeoff[idx + 1]; n++) {
+        sirfile* sf = sfc->routed[n];
+        SIR_ASSERT(_sirfile_validate(sf));
 
         (*wanted)++;
 
-        if (!write || sfc->files[n]->opts != lastopts) {
-            write = _sir_format(false, sfc->files[n]->opts, buf);
-            SIR_ASSERT(write);
-            lastopts = sfc->files[n]->opts;
+        /* formatted once per distinct set of options. */
+        const char* write = _sir_format(false, sf->opts, buf);
+        SIR_ASSERT(write);
+
+        /* the cache is shared with other dispatching threads; only those
+         * writing to this same file need to wait. */
+        bool wrote = false;
+        if (write && _sirmutex_lock(&sf->mutex)) {
+            wrote = _sirfile_write(sf, write, buf->now);
+            if (wrote)
+                _sirfile_applypolicy(sf, level);
+            _sirmutex_unlock(&sf->mutex);
         }
 
-        if (write && _sirfile_write(sfc->files[n], write)) {
+        if (wrote) {
             retval &= true;
             (*dispatched)++;
         } else {
-            _sir_selflog("error: write to file %d (path: '%s') failed!", sfc->files[n]->id,
-                sfc->files[n]->path);
+            _sir_selflog("error: write to file %d (path: '%s') failed!", sf->id, sf->path);
         }
     }
 
@@ -38,10 +38,18 @@ bool _sir_remfile(sirfileid id);
 sirfile* _sirfile_create(const char* path, sir_levels levels, sir_options opts);
 bool _sirfile_open(sirfile* sf);
 void _sirfile_close(sirfile* sf);
-bool _sir_write(sirfile* sf, const char* output);
+bool _sirfile_write(sirfile* sf, const char* output, time_t now);
 bool _sirfile_writeheader(sirfile* sf, const char* msg);
-bool _sirfile_needsroll(sirfile* sf);
+bool _sirfile_needsroll(sirfile* sf, size_t towrite, time_t now);
+uint64_t _sirfile_rollsize(const sirfile* sf);
+void _sirfile_schedroll(sirfile* sf, time_t now);
+bool _sirfile_syncsize(sirfile* sf);
+void _sirfile_flush(sirfile* sf);
+void _sirfile_applypolicy(sirfile* sf, sir_level level);
 bool _sirfile_roll(sirfile* sf, char** newpath);
+bool _sirfile_archivepath(sirfile* sf, char** newpath);
+bool _sirfile_canrollbg(const sirfile* sf);
+bool _sirfile_switch(sirfile* sf, char** newpath);
 bool _sirfile_archive(sirfile* sf, const char* newpath);
 bool _sirfile_splitpath(sirfile* sf, char** name, char** ext);
 void _sirfile_destroy(sirfile** sf);
@@ -58,6 +66,23 @@ bool _sir_fcache_pred_id(const void* match, sirfile* iter);
 sirfile* _sir_fcache_find(sirfcache* sfc, const void* match, sir_fcache_pred pred);
 
 bool _sir_fcache_destroy(sirfcache* sfc);
+
+/**
+ * Rebuilds the per-level routing table (see ::sirfcache) and the file cache's
+ * level mask. Must be called, with the file cache locked exclusively, whenever
+ * a file is added, removed, or has its levels changed.
+ */
+void _sir_fcache_reroute(sirfcache* sfc);
+
+/**
+ * Opens the files that take over from log files that are about to be rolled,
+ * and archives those that have been.
+ */
+void _sir_fcache_rollpending(sirfcache* sfc);
+
+/** Flushes files whose buffered data is due; returns msec until the next is due. */
+uint32_t _sir_fcache_flushdue(sirfcache* sfc, uint64_t now);
+
 bool _sir_fcache_dispatch(sirfcache* sfc, sir_level level, sirbuf* buf,
     size_t* dispatched, size_t* wanted);
 
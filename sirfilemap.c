@@ -0,0 +1,250 @@
+/*
+ * sirfilemap.c
+ *
+ * Author:    Ryan M. Lederman <lederman@gmail.com>
+ * Copyright: Copyright (c) 2018-2023
+ * Version:   2.2.0
+ * License:   The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "sirfilemap.h"
+#include "sirinternal.h"
+
+#if !defined(__WIN__)
+# include <sys/mman.h>
+
+struct sir_filemap {
+    int fd;          /**< The log file, opened for reading and writing. */
+    char* map;       /**< The current window. */
+    size_t chunk;    /**< The size of the window, and of each preallocation. */
+    uint64_t base;   /**< File offset of the window; a multiple of the page size. */
+    uint64_t pos;    /**< File offset of the next write (the file's actual size). */
+};
+
+/** Extends the file so that the window at `base` is backed by it. */
+static
+bool _sir_filemap_reserve(sir_filemap* fm, uint64_t base) {
+    off_t end = (off_t)(base + fm->chunk);
+
+# if defined(__linux__) || defined(__FreeBSD__)
+    /* actual extents; not every file system supports it, though. when it fails
+     * for any other reason (e.g., the disk is full), a sparse window would only
+     * turn that into SIGBUS on the first write to it. */
+    int err = posix_fallocate(fm->fd, (off_t)base, (off_t)fm->chunk);
+    if (0 == err)
+        return true;
+
+    if (EOPNOTSUPP != err && EINVAL != err) {
+        _sir_handleerr(err);
+        return false;
+    }
+# endif
+
+    struct stat st = {0};
+    if (0 != fstat(fm->fd, &st)) {
+        _sir_handleerr(errno);
+        return false;
+    }
+
+    if (st.st_size < end && 0 != ftruncate(fm->fd, end)) {
+        _sir_handleerr(errno);
+        return false;
+    }
+
+    return true;
+}
+
+/** Replaces the current window with one that contains `pos`. */
+static
+bool _sir_filemap_remap(sir_filemap* fm, uint64_t pos) {
+    if (fm->map) {
+        (void)munmap(fm->map, fm->chunk);
+        fm->map = NULL;
+    }
+
+    uint64_t base = pos - (pos % fm->chunk);
+    if (!_sir_filemap_reserve(fm, base))
+        return false;
+
+    void* map = mmap(NULL, fm->chunk, PROT_READ | PROT_WRITE, MAP_SHARED, fm->fd, (off_t)base);
+    if (MAP_FAILED == map) {
+        _sir_handleerr(errno);
+        return false;
+    }
+
+    fm->map  = (char*)map;
+    fm->base = base;
+    return true;
+}
+
+/**
+ * Returns the size of the file, less any zeros left preallocated at its end
+ * (never more than one chunk's worth).
+ */
+static
+uint64_t _sir_filemap_trimmedsize(int fd, uint64_t size, size_t chunk) {
+    char block[4096];
+    uint64_t end   = size;
+    uint64_t limit = size > chunk ? size - chunk : 0;
+
+    while (end > limit) {
+        size_t len    = end - limit < sizeof(block) ? (size_t)(end - limit) : sizeof(block);
+        ssize_t nread = pread(fd, block, len, (off_t)(end - len));
+        if (nread != (ssize_t)len) {
+            if (-1 == nread)
+                _sir_handleerr(errno);
+            return size;
+        }
+
+        for (size_t n = len; n > 0; n--) {
+            if ('\0' != block[n - 1])
+                return end - (len - n);
+        }
+
+        end -= len;
+    }
+
+    return end;
+}
+
+sir_filemap* _sir_filemap_create(const char* path, uint32_t chunksize, uint64_t offset) {
+    if (!_sir_validstr(path))
+        return NULL;
+
+    sir_filemap* fm = (sir_filemap*)calloc(1, sizeof(sir_filemap));
+    if (!fm) {
+        _sir_handleerr(errno);
+        return NULL;
+    }
+
+    long pagesize = sysconf(_SC_PAGESIZE);
+    if (pagesize <= 0)
+        pagesize = 4096;
+
+    fm->chunk = (((size_t)chunksize + (size_t)pagesize - 1) / (size_t)pagesize) * (size_t)pagesize;
+    fm->fd    = open(path, O_RDWR | O_CLOEXEC);
+
+    if (-1 == fm->fd) {
+        _sir_handleerr(errno);
+        _sir_safefree(&fm);
+        return NULL;
+    }
+
+    fm->pos = _sir_filemap_trimmedsize(fm->fd, offset, fm->chunk);
+    if (fm->pos != offset)
+        _sir_selflog("trimmed '%s' from %" PRIu64 " to %" PRIu64 " bytes", path, offset, fm->pos);
+
+    if (!_sir_filemap_remap(fm, fm->pos)) {
+        _sir_selflog("error: failed to map '%s'!", path);
+        if (0 != ftruncate(fm->fd, (off_t)fm->pos))
+            _sir_handleerr(errno);
+        _sir_safeclose(&fm->fd);
+        _sir_safefree(&fm);
+        return NULL;
+    }
+
+    _sir_selflog("mapped '%s' at %" PRIu64 " (window: %zu bytes)", path, fm->pos, fm->chunk);
+    return fm;
+}
+
+bool _sir_filemap_write(sir_filemap* fm, const char* data, size_t len) {
+    if (!_sir_validptr(fm) || !_sir_validptr(data))
+        return false;
+
+    while (len > 0) {
+        if (fm->pos >= fm->base + fm->chunk && !_sir_filemap_remap(fm, fm->pos))
+            return false;
+
+        size_t room = (size_t)(fm->base + fm->chunk - fm->pos);
+        size_t copy = len < room ? len : room;
+
+        memcpy(fm->map + (fm->pos - fm->base), data, copy);
+        fm->pos += copy;
+        data    += copy;
+        len     -= copy;
+    }
+
+    return true;
+}
+
+bool _sir_filemap_flush(sir_filemap* fm) {
+    if (!_sir_validptr(fm))
+        return false;
+
+    /* the data is already in the page cache; this only starts writing it out. */
+    size_t used = (size_t)(fm->pos - fm->base);
+    if (fm->map && used > 0 && 0 != msync(fm->map, used, MS_ASYNC)) {
+        _sir_handleerr(errno);
+        return false;
+    }
+
+    return true;
+}
+
+uint64_t _sir_filemap_size(const sir_filemap* fm) {
+    return _sir_validptr(fm) ? fm->pos : 0;
+}
+
+void _sir_filemap_destroy(sir_filemap** fm) {
+    if (!fm || !*fm)
+        return;
+
+    if ((*fm)->map)
+        (void)munmap((*fm)->map, (*fm)->chunk);
+
+    /* give back what was preallocated but not written. */
+    if (0 != ftruncate((*fm)->fd, (off_t)(*fm)->pos))
+        _sir_handleerr(errno);
+
+    _sir_safeclose(&(*fm)->fd);
+    _sir_safefree(fm);
+}
+
+#else /* __WIN__ */
+
+sir_filemap* _sir_filemap_create(const char* path, uint32_t chunksize, uint64_t offset) {
+    _SIR_UNUSED(path);
+    _SIR_UNUSED(chunksize);
+    _SIR_UNUSED(offset);
+    _sir_selflog("memory-mapped log files are not supported on this platform");
+    return NULL;
+}
+
+bool _sir_filemap_write(sir_filemap* fm, const char* data, size_t len) {
+    _SIR_UNUSED(fm);
+    _SIR_UNUSED(data);
+    _SIR_UNUSED(len);
+    return false;
+}
+
+bool _sir_filemap_flush(sir_filemap* fm) {
+    _SIR_UNUSED(fm);
+    return false;
+}
+
+uint64_t _sir_filemap_size(const sir_filemap* fm) {
+    _SIR_UNUSED(fm);
+    return 0;
+}
+
+void _sir_filemap_destroy(sir_filemap** fm) {
+    _SIR_UNUSED(fm);
+}
+
+#endif /* !__WIN__ */
@@ -0,0 +1,53 @@
+/*
+ * sirfilemap.h
+ *
+ * Author:    Ryan M. Lederman <lederman@gmail.com>
+ * Copyright: Copyright (c) 2018-2023
+ * Version:   2.2.0
+ * License:   The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef _SIR_FILEMAP_H_INCLUDED
+# define _SIR_FILEMAP_H_INCLUDED
+
+# include "sirtypes.h"
+
+/**
+ * Maps the file at `path` for appending at `offset`, preallocating it in chunks
+ * of `chunksize` bytes (rounded up to the page size). Zeros preallocated by an
+ * earlier run that ended without truncating the file are trimmed first; use
+ * ::_sir_filemap_size to learn the resulting size. Returns NULL if the file
+ * cannot be mapped, or on platforms without support; the caller then falls
+ * back to stdio.
+ */
+sir_filemap* _sir_filemap_create(const char* path, uint32_t chunksize, uint64_t offset);
+
+/** Copies `len` bytes into the mapping, moving the window along as needed. */
+bool _sir_filemap_write(sir_filemap* fm, const char* data, size_t len);
+
+/** Initiates writeback of everything written so far (`msync(MS_ASYNC)`). */
+bool _sir_filemap_flush(sir_filemap* fm);
+
+/** Returns the number of bytes of actual data in the file. */
+uint64_t _sir_filemap_size(const sir_filemap* fm);
+
+/** Unmaps the file and truncates it to its actual size. */
+void _sir_filemap_destroy(sir_filemap** fm);
+
+#endif /* !_SIR_FILEMAP_H_INCLUDED */
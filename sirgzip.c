@@ -0,0 +1,432 @@
+/*
+ * sirgzip.c
+ *
+ * Author:    Ryan M. Lederman <lederman@gmail.com>
+ * Copyright: Copyright (c) 2018-2023
+ * Version:   2.2.0
+ * License:   The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "sirgzip.h"
+#include "sirinternal.h"
+
+#if defined(SIR_ZLIB)
+# include <zlib.h>
+
+bool _sir_gzip(const char* src, const char* dst) {
+    if (!_sir_validstr(src) || !_sir_validstr(dst))
+        return false;
+
+    FILE* in  = NULL;
+    FILE* out = NULL;
+
+    if (0 != _sir_fopen(&in, src, "rb"))
+        return false;
+
+    if (0 != _sir_fopen(&out, dst, "wb")) {
+        _sir_safefclose(&in);
+        return false;
+    }
+
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+
+    /* 16 + the window size: a gzip header and trailer instead of zlib's. */
+    int z = deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 8,
+        Z_DEFAULT_STRATEGY);
+    bool ok = Z_OK == z;
+
+    unsigned char ibuf[16384];
+    unsigned char obuf[16384];
+    int flush = Z_NO_FLUSH;
+
+    while (ok && Z_FINISH != flush) {
+        zs.avail_in = (uInt)fread(ibuf, 1, sizeof(ibuf), in);
+        zs.next_in  = ibuf;
+
+        if (ferror(in)) {
+            _sir_handleerr(errno);
+            ok = false;
+            break;
+        }
+
+        flush = feof(in) ? Z_FINISH : Z_NO_FLUSH;
+
+        do {
+            zs.avail_out = sizeof(obuf);
+            zs.next_out  = obuf;
+            z = deflate(&zs, flush);
+            if (Z_STREAM_ERROR == z) {
+                ok = false;
+                break;
+            }
+
+            size_t have = sizeof(obuf) - zs.avail_out;
+            if (have != fwrite(obuf, 1, have, out)) {
+                _sir_handleerr(errno);
+                ok = false;
+                break;
+            }
+        } while (0 == zs.avail_out);
+    }
+
+    if (!ok)
+        _sir_selflog("error: failed to compress '%s' (zlib: %d)", src, z);
+
+    (void)deflateEnd(&zs);
+    _sir_safefclose(&in);
+    ok &= 0 == fflush(out);
+    _sir_safefclose(&out);
+
+    return ok;
+}
+
+#else /* !SIR_ZLIB */
+
+/** The deflate window, and the longest distance a match may reach back. */
+# define _SIR_GZ_WSIZE 32768U
+
+/** Size of the hash table used to find matches (3-byte prefixes). */
+# define _SIR_GZ_HBITS 15U
+# define _SIR_GZ_HSIZE (1U << _SIR_GZ_HBITS)
+
+/** The number of earlier positions examined for each match. */
+# define _SIR_GZ_MAXCHAIN 32U
+
+# define _SIR_GZ_MINMATCH 3U
+# define _SIR_GZ_MAXMATCH 258U
+
+/** How much of the file is read at a time (a multiple of the window size). */
+# define _SIR_GZ_BUFSIZE (1024U * 1024U)
+
+static const uint16_t _sir_gz_lbase[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115,
+    131, 163, 195, 227, 258
+};
+
+static const uint8_t _sir_gz_lextra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+static const uint16_t _sir_gz_dbase[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537,
+    2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+
+static const uint8_t _sir_gz_dextra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12,
+    13, 13
+};
+
+/** Output of the encoder: bits are packed LSB-first, as deflate requires. */
+typedef struct {
+    FILE* f;
+    uint64_t bits;
+    uint32_t nbits;
+    uint8_t buf[16384];
+    size_t len;
+    bool ok;
+} _sir_gz_out;
+
+static
+void _sir_gz_flushbytes(_sir_gz_out* o) {
+    if (o->len > 0 && o->ok && o->len != fwrite(o->buf, 1, o->len, o->f)) {
+        _sir_handleerr(errno);
+        o->ok = false;
+    }
+    o->len = 0;
+}
+
+static inline
+void _sir_gz_putbyte(_sir_gz_out* o, uint8_t b) {
+    if (o->len == sizeof(o->buf))
+        _sir_gz_flushbytes(o);
+    o->buf[o->len++] = b;
+}
+
+static inline
+void _sir_gz_putbits(_sir_gz_out* o, uint32_t value, uint32_t count) {
+    o->bits  |= (uint64_t)value << o->nbits;
+    o->nbits += count;
+    while (o->nbits >= 8) {
+        _sir_gz_putbyte(o, (uint8_t)o->bits);
+        o->bits  >>= 8;
+        o->nbits -= 8;
+    }
+}
+
+/** Huffman codes are sent most significant bit first. */
+static inline
+void _sir_gz_putcode(_sir_gz_out* o, uint32_t code, uint32_t len) {
+    uint32_t rev = 0;
+    for (uint32_t n = 0; n < len; n++)
+        rev |= ((code >> n) & 1U) << (len - 1 - n);
+    _sir_gz_putbits(o, rev, len);
+}
+
+/** Sends a literal/length symbol using the fixed Huffman code (RFC 1951, 3.2.6). */
+static inline
+void _sir_gz_putsym(_sir_gz_out* o, uint32_t sym) {
+    if (sym <= 143)
+        _sir_gz_putcode(o, 0x30 + sym, 8);
+    else if (sym <= 255)
+        _sir_gz_putcode(o, 0x190 + (sym - 144), 9);
+    else if (sym <= 279)
+        _sir_gz_putcode(o, sym - 256, 7);
+    else
+        _sir_gz_putcode(o, 0xc0 + (sym - 280), 8);
+}
+
+static
+void _sir_gz_putmatch(_sir_gz_out* o, uint32_t len, uint32_t dist) {
+    uint32_t l = 28;
+    while (_sir_gz_lbase[l] > len)
+        l--;
+    _sir_gz_putsym(o, 257 + l);
+    _sir_gz_putbits(o, len - _sir_gz_lbase[l], _sir_gz_lextra[l]);
+
+    uint32_t d = 29;
+    while (_sir_gz_dbase[d] > dist)
+        d--;
+    _sir_gz_putcode(o, d, 5);
+    _sir_gz_putbits(o, dist - _sir_gz_dbase[d], _sir_gz_dextra[d]);
+}
+
+static inline
+uint32_t _sir_gz_hash(const uint8_t* p) {
+    uint32_t v = ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+    return (v * 2654435761U) >> (32 - _SIR_GZ_HBITS);
+}
+
+static
+uint32_t _sir_gz_crc32(uint32_t crc, const uint8_t* data, size_t len) {
+    static uint32_t table[256];
+    static bool built = false;
+
+    /* only ever built on the archive thread. */
+    if (!built) {
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1U) ? 0xedb88320U ^ (c >> 1) : c >> 1;
+            table[n] = c;
+        }
+        built = true;
+    }
+
+    crc = ~crc;
+    for (size_t n = 0; n < len; n++)
+        crc = table[(crc ^ data[n]) & 0xff] ^ (crc >> 8);
+
+    return ~crc;
+}
+
+/** Input to the encoder: the part of the file around the current position. */
+typedef struct {
+    FILE* f;
+    uint8_t* data;
+    size_t filled;
+    bool eof;
+    uint32_t crc;
+    uint32_t isize;
+} _sir_gz_in;
+
+/**
+ * Makes sure there are enough bytes after `*pos` to find the longest match,
+ * unless the end of the file has been reached. Everything that is more than a
+ * window's worth behind `*pos` is dropped from the buffer to make room, and
+ * the positions in the hash chains are moved along with it.
+ */
+static
+bool _sir_gz_fill(_sir_gz_in* in, size_t* pos, int32_t* head, int32_t* prev) {
+    if (in->eof || in->filled - *pos >= _SIR_GZ_MAXMATCH + _SIR_GZ_MINMATCH)
+        return true;
+
+    /* by whole windows, so that positions keep their slots in `prev`. */
+    size_t shift = *pos >= _SIR_GZ_WSIZE ? ((*pos - _SIR_GZ_WSIZE) / _SIR_GZ_WSIZE) *
+        _SIR_GZ_WSIZE : 0;
+
+    if (shift > 0) {
+        memmove(in->data, in->data + shift, in->filled - shift);
+        in->filled -= shift;
+        *pos       -= shift;
+
+        for (size_t n = 0; n < _SIR_GZ_HSIZE; n++)
+            head[n] = head[n] >= (int32_t)shift ? head[n] - (int32_t)shift : -1;
+        for (size_t n = 0; n < _SIR_GZ_WSIZE; n++)
+            prev[n] = prev[n] >= (int32_t)shift ? prev[n] - (int32_t)shift : -1;
+    }
+
+    while (!in->eof && in->filled < _SIR_GZ_BUFSIZE) {
+        size_t read = fread(in->data + in->filled, 1, _SIR_GZ_BUFSIZE - in->filled, in->f);
+        if (0 == read) {
+            if (ferror(in->f)) {
+                _sir_handleerr(errno);
+                return false;
+            }
+            in->eof = true;
+            break;
+        }
+
+        in->crc    = _sir_gz_crc32(in->crc, in->data + in->filled, read);
+        in->isize += (uint32_t)read;
+        in->filled += read;
+    }
+
+    return true;
+}
+
+/**
+ * Compresses the rest of the input into a single fixed-Huffman deflate block,
+ * a buffer's worth at a time.
+ */
+static
+bool _sir_gz_deflate(_sir_gz_out* o, _sir_gz_in* in) {
+    int32_t* head = (int32_t*)malloc(_SIR_GZ_HSIZE * sizeof(int32_t));
+    int32_t* prev = (int32_t*)malloc(_SIR_GZ_WSIZE * sizeof(int32_t));
+    if (!head || !prev) {
+        _sir_handleerr(errno);
+        _sir_safefree(&head);
+        _sir_safefree(&prev);
+        return false;
+    }
+
+    for (size_t n = 0; n < _SIR_GZ_HSIZE; n++)
+        head[n] = -1;
+    for (size_t n = 0; n < _SIR_GZ_WSIZE; n++)
+        prev[n] = -1;
+
+    /* BFINAL = 1, BTYPE = 01 (fixed Huffman codes). */
+    _sir_gz_putbits(o, 1, 1);
+    _sir_gz_putbits(o, 1, 2);
+
+    size_t pos = 0;
+    bool ok    = _sir_gz_fill(in, &pos, head, prev);
+
+    while (ok && o->ok && pos < in->filled) {
+        const uint8_t* data = in->data;
+        size_t size         = in->filled;
+        uint32_t bestlen    = 0;
+        uint32_t bestdist   = 0;
+
+        if (size - pos >= _SIR_GZ_MINMATCH) {
+            uint32_t h      = _sir_gz_hash(data + pos);
+            int32_t cand    = head[h];
+            size_t maxlen   = size - pos < _SIR_GZ_MAXMATCH ? size - pos : _SIR_GZ_MAXMATCH;
+            uint32_t chains = _SIR_GZ_MAXCHAIN;
+
+            while (cand >= 0 && pos - (size_t)cand <= _SIR_GZ_WSIZE && chains-- > 0) {
+                const uint8_t* a = data + cand;
+                const uint8_t* b = data + pos;
+                size_t len = 0;
+                while (len < maxlen && a[len] == b[len])
+                    len++;
+
+                if (len > bestlen) {
+                    bestlen  = (uint32_t)len;
+                    bestdist = (uint32_t)(pos - (size_t)cand);
+                    if (len == maxlen)
+                        break;
+                }
+
+                int32_t next = prev[(size_t)cand % _SIR_GZ_WSIZE];
+                if (next >= cand)
+                    break;
+                cand = next;
+            }
+        }
+
+        size_t advance = bestlen >= _SIR_GZ_MINMATCH ? bestlen : 1;
+        if (bestlen >= _SIR_GZ_MINMATCH)
+            _sir_gz_putmatch(o, bestlen, bestdist);
+        else
+            _sir_gz_putsym(o, data[pos]);
+
+        /* every position covered is entered into the hash chains. */
+        for (size_t end = pos + advance; pos < end; pos++) {
+            if (size - pos >= _SIR_GZ_MINMATCH) {
+                uint32_t h = _sir_gz_hash(data + pos);
+                prev[pos % _SIR_GZ_WSIZE] = head[h];
+                head[h] = (int32_t)pos;
+            }
+        }
+
+        ok = _sir_gz_fill(in, &pos, head, prev);
+    }
+
+    _sir_gz_putsym(o, 256); /* end of block. */
+    if (o->nbits > 0)
+        _sir_gz_putbits(o, 0, 8 - o->nbits);
+
+    _sir_safefree(&head);
+    _sir_safefree(&prev);
+    return ok && o->ok;
+}
+
+bool _sir_gzip(const char* src, const char* dst) {
+    if (!_sir_validstr(src) || !_sir_validstr(dst))
+        return false;
+
+    _sir_gz_in in   = {0};
+    _sir_gz_out* o  = NULL;
+    bool ok         = 0 == _sir_fopen(&in.f, src, "rb");
+
+    if (ok) {
+        in.data = (uint8_t*)malloc(_SIR_GZ_BUFSIZE);
+        o       = (_sir_gz_out*)calloc(1, sizeof(_sir_gz_out));
+        if (!in.data || !o) {
+            _sir_handleerr(errno);
+            ok = false;
+        }
+    }
+
+    if (ok && 0 != _sir_fopen(&o->f, dst, "wb"))
+        ok = false;
+
+    if (ok) {
+        o->ok = true;
+
+        /* RFC 1952: magic, deflate, no flags, no mtime, no extra flags, unknown OS. */
+        static const uint8_t header[10] = {0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 0xff};
+        for (size_t n = 0; n < sizeof(header); n++)
+            _sir_gz_putbyte(o, header[n]);
+
+        ok = _sir_gz_deflate(o, &in);
+
+        /* the size is only kept modulo 2^32, as the format says. */
+        for (int n = 0; n < 4; n++)
+            _sir_gz_putbyte(o, (uint8_t)(in.crc >> (8 * n)));
+        for (int n = 0; n < 4; n++)
+            _sir_gz_putbyte(o, (uint8_t)(in.isize >> (8 * n)));
+
+        _sir_gz_flushbytes(o);
+        ok &= o->ok && 0 == fflush(o->f);
+        _sir_safefclose(&o->f);
+    }
+
+    if (!ok)
+        _sir_selflog("error: failed to compress '%s'", src);
+
+    _sir_safefclose(&in.f);
+    _sir_safefree(&o);
+    _sir_safefree(&in.data);
+    return ok;
+}
+
+#endif /* SIR_ZLIB */
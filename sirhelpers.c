@@ -78,6 +78,14 @@ bool _sir_validfd(int fd) {
     return valid;
 }
 
+bool _sir_validdestid(sirdestid id) {
+    if (0 == id) {
+        _sir_seterror(_SIR_E_INVALID);
+        return false;
+    }
+    return true;
+}
+
 /** Validates a sir_update_config_data structure. */
 bool _sir_validupdatedata(sir_update_config_data* data) {
     if (!_sir_validptr(data))
@@ -101,6 +109,17 @@ bool _sir_validupdatedata(sir_update_config_data* data) {
     if (valid && _sir_bittest(data->fields, SIRU_SYSLOG_CAT))
         valid &= _sir_validstrnofail(data->sl_category);
 
+    if (valid && _sir_bittest(data->fields, SIRU_POLICY))
+        valid &= (_sir_validptrnofail(data->policy) &&
+            data->policy->buffer_size <= SIR_FMAXBUFSIZE &&
+            _sir_validlevels(data->policy->flush_levels) &&
+            (SIRFB_STDIO == data->policy->backend || SIRFB_URING == data->policy->backend ||
+             SIRFB_MMAP == data->policy->backend) &&
+            (0 == data->policy->roll_size || data->policy->roll_size >= SIR_MAXOUTPUT) &&
+            (SIRRI_NONE == data->policy->roll_interval ||
+             SIRRI_HOURLY == data->policy->roll_interval ||
+             SIRRI_DAILY == data->policy->roll_interval));
+
     if (!valid) {
         _sir_seterror(_SIR_E_INVALID);
         SIR_ASSERT("!invalid sir_update_config_data");
@@ -149,8 +168,9 @@ bool _sir_validopts(sir_options opts) {
          _sir_bittest(opts, SIRO_NOMSEC)           ||
          _sir_bittest(opts, SIRO_NOPID)            ||
          _sir_bittest(opts, SIRO_NOTID)            ||
-         _sir_bittest(opts, SIRO_NOHDR))           &&
-         ((opts & ~(SIRO_MSGONLY | SIRO_NOHDR)) == 0)))
+         _sir_bittest(opts, SIRO_NOHDR)            ||
+         _sir_bittest(opts, SIRO_QUEUED))          &&
+         ((opts & ~(SIRO_MSGONLY | SIRO_NOHDR | SIRO_QUEUED)) == 0)))
          return true;
 
     _sir_selflog("invalid options: %08" PRIx32, opts);
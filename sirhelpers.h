@@ -101,6 +101,18 @@ bool _sir_bittest(uint32_t flags, uint32_t test) {
     return (flags & test) == test;
 }
 
+/**
+ * Maps a single ::sir_level to its position among the levels, from 0
+ * (::SIRL_EMERG) to ::SIR_NUMLEVELS - 1 (::SIRL_DEBUG).
+ */
+static inline
+size_t _sir_levelindex(sir_level level) {
+    size_t idx = 0;
+    while (idx < SIR_NUMLEVELS - 1 && 0 == ((uint32_t)level & (1U << idx)))
+        idx++;
+    return idx;
+}
+
 /** Sets a specific set of bits high in a bitmask. */
 static inline
 bool _sir_setbitshigh(uint32_t* flags, uint32_t set) {
@@ -136,6 +148,9 @@ void _sir_safefclose(FILE* restrict* restrict f);
 /** Validates a log file descriptor. */
 bool _sir_validfd(int fd);
 
+/** Validates a custom destination identifier. */
+bool _sir_validdestid(sirdestid id);
+
 /** Validates a sir_update_config_data structure. */
 bool _sir_validupdatedata(sir_update_config_data* data);
 
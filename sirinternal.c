@@ -30,6 +30,14 @@
 #include "sirtextstyle.h"
 #include "sirfilesystem.h"
 #include "sirmutex.h"
+#include "sirthread.h"
+#include "sirqueue.h"
+#include "sirdefer.h"
+#include "sirarchive.h"
+#include "sirsyslog.h"
+#include "sirremote.h"
+#include "sirjournal.h"
+#include "sirdest.h"
 
 #if defined(__WIN__)
 # pragma comment(lib, "ws2_32.lib")
@@ -37,13 +45,17 @@
 
 static sirconfig _sir_cfg = {0};
 static sirfcache _sir_fc  = {0};
+static sirdcache _sir_dc  = {0};
 
 static sir_mutex cfg_mutex;
 static sir_once cfg_once = SIR_ONCE_INIT;
 
-static sir_mutex fc_mutex;
+static sir_rwlock fc_rwlock;
 static sir_once fc_once = SIR_ONCE_INIT;
 
+static sir_rwlock dc_rwlock;
+static sir_once dc_once = SIR_ONCE_INIT;
+
 static sir_mutex ts_mutex;
 static sir_once ts_once = SIR_ONCE_INIT;
 
@@ -55,6 +67,95 @@ static atomic_uint_fast32_t _sir_magic;
 static volatile uint32_t _sir_magic;
 #endif
 
+#if defined(__HAVE_ATOMIC_H__)
+/**
+ * Union of the levels registered for any destination: stdio and the system
+ * logger in the lowest 8 bits, log files in the next 8, and custom
+ * destinations in the 8 above those (see ::_sir_lvlmaskshift).
+ */
+static atomic_uint_fast32_t _sir_lvlmask;
+#else
+static volatile sir_levels _sir_lvlmask[3];
+#endif
+
+#if defined(__HAVE_ATOMIC_H__)
+/**
+ * Read-only copies of _sir_cfg published for logging threads, which pick up
+ * the current one without locking. A copy is only overwritten once it is no
+ * longer current and has no readers.
+ */
+static struct {
+    struct {
+        sirconfig cfg;
+        atomic_uint_fast32_t readers;
+    } slots[SIR_CFGSNAPSHOTS];
+    atomic_uint_fast32_t current;
+} _sir_cfgsnap;
+#endif
+
+/** State of the asynchronous delivery worker. */
+static struct {
+    sirqueue queue;
+    sir_thread thread;
+    sir_event wake;
+    bool deferred;
+    bool init; /**< Whether `queue` and `wake` have been created. */
+#if defined(__HAVE_ATOMIC_H__)
+    atomic_bool running;
+    atomic_bool stop;
+    atomic_bool idle;
+    atomic_uint_fast32_t producers;
+#else
+    volatile bool running;
+    volatile bool stop;
+    volatile bool idle;
+    volatile uint32_t producers;
+#endif
+} _sir_async;
+
+/** State of the housekeeping thread, which keeps the host name current and
+ * flushes buffered log files on time. */
+static struct {
+    sir_thread thread;
+    sir_event wake;
+#if defined(__HAVE_ATOMIC_H__)
+    atomic_bool running;
+    atomic_bool stop;
+#else
+    volatile bool running;
+    volatile bool stop;
+#endif
+} _sir_hk;
+
+/** Set in the child after fork(); the PID in the config is the parent's. */
+#if defined(__HAVE_ATOMIC_H__)
+static atomic_bool _sir_pidstale;
+#else
+static volatile bool _sir_pidstale;
+#endif
+
+/** Per-thread identity data. */
+static _sir_thread_local sir_thread_info sir_ti = {0, false, {0}};
+
+/**
+ * How this thread holds the file cache's (0) and custom destination cache's
+ * (1) locks. A thread that logs from within a custom destination's `write`
+ * already holds the latter, shared; locking it again would wait behind any
+ * thread waiting to lock it exclusively (they are preferred), which in turn
+ * would wait on this one. So it is only locked again in name.
+ */
+static _sir_thread_local struct {
+    uint32_t shared; /**< Times it has been locked shared, nested ones included. */
+    bool exclusive;
+} sir_rwheld[2];
+
+/** Per-thread copy of the last formatted time stamp, and the second it represents. */
+static _sir_thread_local struct {
+    time_t when;
+    size_t len;
+    char timestamp[SIR_MAXTIME];
+} sir_tsc = {-1, 0, {0}};
+
 bool _sir_makeinit(sirinit* si) {
     if (!_sir_validptr(si))
         return false;
@@ -75,6 +176,9 @@ bool _sir_makeinit(sirinit* si) {
     si->d_syslog.levels = SIRL_NONE;
 #endif
 
+    si->d_remote.opts   = SIRO_DEFAULT;
+    si->d_remote.levels = SIRL_DEFAULT;
+
     return true;
 }
 
@@ -105,6 +209,9 @@ bool _sir_init(sirinit* si) {
     _sir_defaultopts(&si->d_syslog.opts, sir_syslog_def_opts);
 #endif
 
+    _sir_defaultlevels(&si->d_remote.levels, sir_remote_def_lvls);
+    _sir_defaultopts(&si->d_remote.opts, sir_remote_def_opts);
+
     if (!_sir_init_sanity(si))
         return false;
 
@@ -137,14 +244,15 @@ bool _sir_init(sirinit* si) {
     _cfg->si.name[SIR_MAXNAME - 1] = '\0';
 
     /* Store host name and PID. */
-    if (!_sir_gethostname(_cfg->state.hostname)) {
+    if (!_sir_gethostname(_cfg->state.hostname))
         _sir_selflog("error: failed to get hostname!");
-    } else {
-        time_t now;
-        _cfg->state.last_hname_chk = -1 != time(&now) ? now : 1;
-    }
 
     _cfg->state.pid = _sir_getpid();
+#if defined(__HAVE_ATOMIC_H__)
+    atomic_store(&_sir_pidstale, false);
+#else
+    _sir_pidstale = false;
+#endif
 
     if (0 > snprintf(_cfg->state.pidbuf, SIR_MAXPID, SIR_PIDFORMAT,
                      PID_CAST _cfg->state.pid))
@@ -160,7 +268,24 @@ bool _sir_init(sirinit* si) {
     }
 #endif
 
+    /* start sending to a remote syslog collector, if there is one. */
+    if (_sir_validstrnofail(_cfg->si.d_remote.host) &&
+        !_sir_remote_start(&_cfg->si.d_remote, _cfg->si.name))
+        _sir_selflog("error: failed to start remote syslog; messages will not be sent to %s",
+            _cfg->si.d_remote.host);
+
+    _sir_publishconfig(_cfg);
     _sir_unlocksection(SIRMI_CONFIG);
+
+    if (!_sir_archives_init())
+        _sir_selflog("error: failed to initialize archive queue; archives will not be compressed or trimmed");
+
+    if (!_sir_housekeeping_start())
+        _sir_selflog("error: failed to start housekeeping thread; hostname will not be refreshed");
+
+    if (si->async.enabled && !_sir_async_start(&si->async))
+        _sir_selflog("error: failed to start async worker; delivering synchronously");
+
     return true;
 }
 
@@ -168,19 +293,39 @@ bool _sir_cleanup(void) {
     if (!_sir_sanity())
         return false;
 
+    /* deliver anything still queued while the destinations are intact. */
+    bool stopasync = _sir_async_stop();
+    SIR_ASSERT(stopasync);
+
+    bool stopremote = _sir_remote_stop();
+    SIR_ASSERT(stopremote);
+
+    bool stophk = _sir_housekeeping_stop();
+    SIR_ASSERT(stophk);
+
     sirfcache* sfc = _sir_locksection(SIRMI_FILECACHE);
     if (!_sir_validptr(sfc)) {
         _sir_seterror(_SIR_E_INTERNAL);
         return false;
     }
 
-    bool cleanup   = true;
+    bool cleanup   = stopasync && stopremote && stophk;
     bool destroyfc = _sir_fcache_destroy(sfc);
     SIR_ASSERT(destroyfc);
 
     _sir_unlocksection(SIRMI_FILECACHE);
     cleanup &= destroyfc;
 
+    /* custom destinations write what is queued for them, and are closed. */
+    bool destroydc = _sir_remdests();
+    SIR_ASSERT(destroydc);
+    cleanup &= destroydc;
+
+    /* archives made while closing the files are taken care of before returning. */
+    bool stoparchives = _sir_archives_cleanup();
+    SIR_ASSERT(stoparchives);
+    cleanup &= stoparchives;
+
     sirconfig* _cfg = _sir_locksection(SIRMI_CONFIG);
     if (!_sir_validptr(_cfg)) {
         _sir_seterror(_SIR_E_INTERNAL);
@@ -208,6 +353,7 @@ bool _sir_cleanup(void) {
 #endif
 
     memset(_cfg, 0, sizeof(sirconfig));
+    _sir_publishconfig(_cfg);
     _sir_unlocksection(SIRMI_CONFIG);
 
     _sir_selflog("cleanup: %s", (cleanup ? "successful" : "with errors"));
@@ -241,6 +387,8 @@ bool _sir_init_sanity(const sirinit* si) {
     levelcheck &= _sir_validlevels(si->d_syslog.levels);
 #endif
 
+    levelcheck &= _sir_validlevels(si->d_remote.levels);
+
     bool optscheck = true;
     optscheck &= _sir_validopts(si->d_stdout.opts);
     optscheck &= _sir_validopts(si->d_stderr.opts);
@@ -249,6 +397,21 @@ bool _sir_init_sanity(const sirinit* si) {
     optscheck &= _sir_validopts(si->d_syslog.opts);
 #endif
 
+    optscheck &= _sir_validopts(si->d_remote.opts);
+
+    if (levelcheck && optscheck && si->d_remote.transport > SIRRT_TCP) {
+        _sir_selflog("error: invalid remote syslog transport: %d", (int)si->d_remote.transport);
+        _sir_seterror(_SIR_E_INVALID);
+        return false;
+    }
+
+    if (levelcheck && optscheck && si->async.queue_size > SIR_ASYNC_MAXQUEUESIZE) {
+        _sir_selflog("error: async queue size %" PRIu32 " exceeds %d", si->async.queue_size,
+            SIR_ASYNC_MAXQUEUESIZE);
+        _sir_seterror(_SIR_E_INVALID);
+        return false;
+    }
+
     return levelcheck && optscheck;
 }
 
@@ -310,6 +473,14 @@ bool _sir_syslogopts(sirinit* si, sir_update_config_data* data) {
     return updated;
 }
 
+bool _sir_remotelevels(sirinit* si, sir_update_config_data* data) {
+    return _sir_updatelevels(SIR_DESTNAME_REMOTE, &si->d_remote.levels, data->levels);
+}
+
+bool _sir_remoteopts(sirinit* si, sir_update_config_data* data) {
+    return _sir_updateopts(SIR_DESTNAME_REMOTE, &si->d_remote.opts, data->opts);
+}
+
 bool _sir_syslogid(sirinit* si, sir_update_config_data* data) {
     bool cur_valid = _sir_validstrnofail(si->d_syslog.identity);
     if (!cur_valid || 0 != strncmp(si->d_syslog.identity, data->sl_identity, SIR_MAX_SYSLOG_ID)) {
@@ -363,19 +534,349 @@ bool _sir_writeinit(sir_update_config_data* data, sirinit_update update) {
     }
 
     bool updated = update(&_cfg->si, data);
-    if (!updated)
+    if (updated)
+        _sir_publishconfig(_cfg);
+    else
         _sir_selflog("error: update routine failed!");
 
     _sir_unlocksection(SIRMI_CONFIG);
     return updated;
 }
 
-void* _sir_locksection(sir_mutex_id mid) {
+void _sir_publishconfig(sirconfig* cfg) {
+    sir_levels levels = SIRL_NONE;
+
+    for (size_t idx = 0; idx < SIR_NUMLEVELS; idx++) {
+        sir_level level = (sir_level)(1U << idx);
+        uint8_t routes  = 0;
+
+        if (_sir_bittest(cfg->si.d_stdout.levels, level))
+            routes |= _SIR_ROUTE_STDOUT;
+        if (_sir_bittest(cfg->si.d_stderr.levels, level))
+            routes |= _SIR_ROUTE_STDERR;
+        if (_sir_bittest(cfg->si.d_syslog.levels, level))
+            routes |= _SIR_ROUTE_SYSLOG;
+        if ('\0' != cfg->si.d_remote.host[0] && _sir_bittest(cfg->si.d_remote.levels, level))
+            routes |= _SIR_ROUTE_REMOTE;
+
+        cfg->state.routes[idx] = routes;
+        if (0 != routes)
+            levels |= level;
+    }
+
+    _sir_setlevelmask(SIRMI_CONFIG, levels);
+
+#if defined(__HAVE_ATOMIC_H__)
+    uint_fast32_t cur = atomic_load(&_sir_cfgsnap.current);
+
+    for (;;) {
+        for (uint_fast32_t n = 1; n < SIR_CFGSNAPSHOTS; n++) {
+            uint_fast32_t next = (cur + n) % SIR_CFGSNAPSHOTS;
+            if (0 == atomic_load(&_sir_cfgsnap.slots[next].readers)) {
+                memcpy(&_sir_cfgsnap.slots[next].cfg, cfg, sizeof(sirconfig));
+                atomic_store(&_sir_cfgsnap.current, next);
+                return;
+            }
+        }
+
+        /* every other copy is still being read; wait for one to be released. */
+        _sirthread_yield();
+    }
+#else
+    _SIR_UNUSED(cfg);
+#endif
+}
+
+const sirconfig* _sir_acquireconfig(sirconfig* copy) {
+#if defined(__HAVE_ATOMIC_H__)
+    _SIR_UNUSED(copy);
+
+    for (;;) {
+        uint_fast32_t cur = atomic_load(&_sir_cfgsnap.current);
+        atomic_fetch_add(&_sir_cfgsnap.slots[cur].readers, 1);
+
+        /* if it is still current, the writer will not reuse it until released. */
+        if (cur == atomic_load(&_sir_cfgsnap.current))
+            return &_sir_cfgsnap.slots[cur].cfg;
+
+        atomic_fetch_sub(&_sir_cfgsnap.slots[cur].readers, 1);
+    }
+#else
+    sirconfig* _cfg = _sir_locksection(SIRMI_CONFIG);
+    if (!_sir_validptr(_cfg)) {
+        _sir_seterror(_SIR_E_INTERNAL);
+        return NULL;
+    }
+
+    memcpy(copy, _cfg, sizeof(sirconfig));
+    _sir_unlocksection(SIRMI_CONFIG);
+
+    return copy;
+#endif
+}
+
+void _sir_releaseconfig(const sirconfig* cfg) {
+#if defined(__HAVE_ATOMIC_H__)
+    for (size_t n = 0; n < SIR_CFGSNAPSHOTS; n++) {
+        if (&_sir_cfgsnap.slots[n].cfg == cfg) {
+            atomic_fetch_sub(&_sir_cfgsnap.slots[n].readers, 1);
+            return;
+        }
+    }
+
+    SIR_ASSERT(!"not a config snapshot");
+#else
+    _SIR_UNUSED(cfg);
+#endif
+}
+
+/** Returns the position of a section's levels in the global level mask. */
+static inline
+unsigned _sir_lvlmaskshift(sir_mutex_id section) {
+    switch (section) {
+        case SIRMI_FILECACHE: return 8;
+        case SIRMI_DESTCACHE: return 16;
+        default:              return 0;
+    }
+}
+
+void _sir_setlevelmask(sir_mutex_id section, sir_levels levels) {
+    unsigned shift = _sir_lvlmaskshift(section);
+#if defined(__HAVE_ATOMIC_H__)
+    /* only the lowest 8 bits hold levels (see SIRL_ALL). */
+    uint_fast32_t mask = atomic_load(&_sir_lvlmask);
+    uint_fast32_t newmask;
+
+    do {
+        newmask = (mask & ~((uint_fast32_t)SIRL_ALL << shift)) |
+            ((uint_fast32_t)(levels & SIRL_ALL) << shift);
+    } while (!atomic_compare_exchange_weak(&_sir_lvlmask, &mask, newmask));
+#else
+    _sir_lvlmask[shift / 8] = levels;
+#endif
+}
+
+bool _sir_levelenabled(sir_level level) {
+#if defined(__HAVE_ATOMIC_H__)
+    uint_fast32_t mask = atomic_load_explicit(&_sir_lvlmask, memory_order_relaxed);
+    return _sir_bittest((uint32_t)(mask | (mask >> 8) | (mask >> 16)) & SIRL_ALL, level);
+#else
+    return _sir_bittest(_sir_lvlmask[0] | _sir_lvlmask[1] | _sir_lvlmask[2], level);
+#endif
+}
+
+bool _sir_levelenabledfor(sir_mutex_id section, sir_level level) {
+    unsigned shift = _sir_lvlmaskshift(section);
+#if defined(__HAVE_ATOMIC_H__)
+    uint_fast32_t mask = atomic_load_explicit(&_sir_lvlmask, memory_order_relaxed);
+    return _sir_bittest((uint32_t)(mask >> shift) & SIRL_ALL, level);
+#else
+    return _sir_bittest(_sir_lvlmask[shift / 8], level);
+#endif
+}
+
+void _sir_updatehostname(void) {
+    /* the lookup may be slow; don't hold the lock while it happens. */
+    char hostname[SIR_MAXHOST] = {0};
+    if (!_sir_gethostname(hostname)) {
+        _sir_selflog("error: failed to get hostname!");
+        return;
+    }
+
+    sirconfig* _cfg = _sir_locksection(SIRMI_CONFIG);
+    if (!_sir_validptr(_cfg)) {
+        _sir_seterror(_SIR_E_INTERNAL);
+        return;
+    }
+
+    if (0 != strncmp(_cfg->state.hostname, hostname, SIR_MAXHOST)) {
+        _sir_selflog("hostname changed: '%s' -> '%s'", _cfg->state.hostname, hostname);
+        _sir_strncpy(_cfg->state.hostname, SIR_MAXHOST, hostname, SIR_MAXHOST);
+        _sir_publishconfig(_cfg);
+    }
+
+    _sir_unlocksection(SIRMI_CONFIG);
+}
+
+void _sir_updatepid(void) {
+    sirconfig* _cfg = _sir_locksection(SIRMI_CONFIG);
+    if (!_sir_validptr(_cfg)) {
+        _sir_seterror(_SIR_E_INTERNAL);
+        return;
+    }
+
+    _cfg->state.pid = _sir_getpid();
+
+    if (0 > snprintf(_cfg->state.pidbuf, SIR_MAXPID, SIR_PIDFORMAT,
+                     PID_CAST _cfg->state.pid))
+        _sir_handleerr(errno);
+
+    _sir_selflog("PID changed: %s", _cfg->state.pidbuf);
+
+    _sir_publishconfig(_cfg);
+    _sir_unlocksection(SIRMI_CONFIG);
+}
+
+bool _sir_housekeeping_start(void) {
+    if (!_sirevent_create(&_sir_hk.wake))
+        return false;
+
+#if defined(__HAVE_ATOMIC_H__)
+    atomic_store(&_sir_hk.stop, false);
+#else
+    _sir_hk.stop = false;
+#endif
+
+    if (!_sirthread_create(&_sir_hk.thread, _sir_housekeeping_worker, NULL)) {
+        _sirevent_destroy(&_sir_hk.wake);
+        return false;
+    }
+
+#if defined(__HAVE_ATOMIC_H__)
+    atomic_store(&_sir_hk.running, true);
+#else
+    _sir_hk.running = true;
+#endif
+
+    return true;
+}
+
+bool _sir_housekeeping_stop(void) {
+#if defined(__HAVE_ATOMIC_H__)
+    if (!atomic_exchange(&_sir_hk.running, false))
+        return true;
+
+    atomic_store(&_sir_hk.stop, true);
+#else
+    if (!_sir_hk.running)
+        return true;
+
+    _sir_hk.running = false;
+    _sir_hk.stop    = true;
+#endif
+
+    (void)_sirevent_signal(&_sir_hk.wake);
+    bool joined = _sirthread_join(&_sir_hk.thread);
+
+    _sirevent_destroy(&_sir_hk.wake);
+
+    _sir_selflog("housekeeping thread %s", joined ? "stopped" : "failed to stop!");
+    return joined;
+}
+
+void _sir_housekeeping_wake(void) {
+#if defined(__HAVE_ATOMIC_H__)
+    if (atomic_load(&_sir_hk.running))
+#else
+    if (_sir_hk.running)
+#endif
+        (void)_sirevent_signal(&_sir_hk.wake);
+}
+
+sir_thread_ret SIR_THREAD_CALL _sir_housekeeping_worker(void* arg) {
+    _SIR_UNUSED(arg);
+
+    static const uint64_t hname_interval = (uint64_t)SIR_HNAME_CHK_INTERVAL * 1000;
+    uint64_t next_hname = _sir_msectime() + hname_interval;
+    uint32_t wait       = (uint32_t)hname_interval;
+
+    for (;;) {
+        /* returns early when signaled to stop, or when a file has become dirty. */
+        (void)_sirevent_wait(&_sir_hk.wake, wait);
+
+#if defined(__HAVE_ATOMIC_H__)
+        if (atomic_load(&_sir_hk.stop))
+#else
+        if (_sir_hk.stop)
+#endif
+            break;
+
+        uint64_t now = _sir_msectime();
+        if (now >= next_hname) {
+            _sir_updatehostname();
+            next_hname = now + hname_interval;
+        }
+
+        wait = (uint32_t)(next_hname - now);
+
+        sirfcache* sfc = _sir_locksection_shared(SIRMI_FILECACHE);
+        if (sfc) {
+            _sir_fcache_rollpending(sfc);
+            uint32_t next_flush = _sir_fcache_flushdue(sfc, now);
+            _sir_unlocksection_shared(SIRMI_FILECACHE);
+
+            if (next_flush < wait)
+                wait = next_flush;
+        }
+    }
+
+    return (sir_thread_ret)0;
+}
+
+/** Locks a file or custom destination cache's lock, unless this thread already holds it. */
+static
+bool _sir_lockrw(sir_rwlock* rwlock, size_t which, bool exclusive) {
+    bool held = sir_rwheld[which].exclusive || 0 < sir_rwheld[which].shared;
+
+    if (!exclusive && held) {
+        sir_rwheld[which].shared++;
+        return true;
+    }
+
+    if (held) {
+        /* it can't be upgraded (or locked exclusively twice) without deadlocking. */
+        _sir_selflog("error: lock is already held by this thread; can't lock exclusively");
+        return false;
+    }
+
+    bool locked = _sirrwlock_lock(rwlock, exclusive);
+    SIR_ASSERT(locked);
+
+    if (!locked)
+        return false;
+
+    if (exclusive)
+        sir_rwheld[which].exclusive = true;
+    else
+        sir_rwheld[which].shared = 1;
+
+    return true;
+}
+
+/** Unlocks a lock locked by ::_sir_lockrw in the same mode. */
+static
+bool _sir_unlockrw(sir_rwlock* rwlock, size_t which, bool exclusive) {
+    if (exclusive) {
+        sir_rwheld[which].exclusive = false;
+    } else if (0 < sir_rwheld[which].shared) {
+        if (0 < --sir_rwheld[which].shared || sir_rwheld[which].exclusive)
+            return true;
+    }
+
+    return _sirrwlock_unlock(rwlock, exclusive);
+}
+
+/** Locks a protected section, shared with other readers if `exclusive` is false. */
+static
+void* _sir_locksectionex(sir_mutex_id mid, bool exclusive) {
     sir_mutex* m  = NULL;
     void* sec     = NULL;
-
-    bool enter = _sir_mapmutexid(mid, &m, &sec) && _sirmutex_lock(m);
-    SIR_ASSERT(enter);
+    bool enter    = false;
+
+    if (SIRMI_FILECACHE == mid) {
+        /* the file cache is read-mostly; threads dispatching to files share it. */
+        _sir_once(&fc_once, _sir_initmutex_fc_once);
+        enter = _sir_lockrw(&fc_rwlock, 0, exclusive);
+        sec   = &_sir_fc;
+    } else if (SIRMI_DESTCACHE == mid) {
+        /* likewise, custom destinations are only changed when added or removed. */
+        _sir_once(&dc_once, _sir_initmutex_dc_once);
+        enter = _sir_lockrw(&dc_rwlock, 1, exclusive);
+        sec   = &_sir_dc;
+    } else {
+        enter = _sir_mapmutexid(mid, &m, &sec) && _sirmutex_lock(m);
+        SIR_ASSERT(enter);
+    }
 
     if (!enter)
         _sir_selflog("error: failed to lock mutex!");
@@ -383,17 +884,42 @@ void* _sir_locksection(sir_mutex_id mid) {
     return enter ? sec : NULL;
 }
 
-void _sir_unlocksection(sir_mutex_id mid) {
+/** Unlocks a protected section locked by ::_sir_locksectionex in the same mode. */
+static
+void _sir_unlocksectionex(sir_mutex_id mid, bool exclusive) {
     sir_mutex* m  = NULL;
     void* sec     = NULL;
+    bool leave    = false;
+
+    if (SIRMI_FILECACHE == mid)
+        leave = _sir_unlockrw(&fc_rwlock, 0, exclusive);
+    else if (SIRMI_DESTCACHE == mid)
+        leave = _sir_unlockrw(&dc_rwlock, 1, exclusive);
+    else
+        leave = _sir_mapmutexid(mid, &m, &sec) && _sirmutex_unlock(m);
 
-    bool leave = _sir_mapmutexid(mid, &m, &sec) && _sirmutex_unlock(m);
     SIR_ASSERT(leave);
 
     if (!leave)
         _sir_selflog("error: failed to unlock mutex!");
 }
 
+void* _sir_locksection(sir_mutex_id mid) {
+    return _sir_locksectionex(mid, true);
+}
+
+void _sir_unlocksection(sir_mutex_id mid) {
+    _sir_unlocksectionex(mid, true);
+}
+
+void* _sir_locksection_shared(sir_mutex_id mid) {
+    return _sir_locksectionex(mid, false);
+}
+
+void _sir_unlocksection_shared(sir_mutex_id mid) {
+    _sir_unlocksectionex(mid, false);
+}
+
 bool _sir_mapmutexid(sir_mutex_id mid, sir_mutex** m, void** section) {
     sir_mutex* tmpm;
     void* tmpsec;
@@ -404,11 +930,6 @@ bool _sir_mapmutexid(sir_mutex_id mid, sir_mutex** m, void** section) {
             tmpm   = &cfg_mutex;
             tmpsec = &_sir_cfg;
             break;
-        case SIRMI_FILECACHE:
-            _sir_once(&fc_once, _sir_initmutex_fc_once);
-            tmpm   = &fc_mutex;
-            tmpsec = &_sir_fc;
-            break;
         case SIRMI_TEXTSTYLE:
             _sir_once(&ts_once, _sir_initmutex_ts_once);
             tmpm   = &ts_mutex;
@@ -434,6 +955,41 @@ void _sir_initialize_once(void) {
 # if defined(__HAVE_ATOMIC_H__)
     atomic_init(&_sir_magic, 0);
 # endif
+    int atfork = pthread_atfork(NULL, NULL, _sir_atfork_child);
+    if (0 != atfork)
+        _sir_selflog("error: pthread_atfork failed (%d)!", atfork);
+}
+
+void _sir_atfork_child(void) {
+    /* the forking thread is the only one in the child, and its identifier
+     * has changed. */
+    sir_ti.cached = false;
+
+    /* libsir's threads were not copied to the child. */
+#if defined(__HAVE_ATOMIC_H__)
+    atomic_store(&_sir_pidstale, true);
+    atomic_store(&_sir_async.running, false);
+    atomic_store(&_sir_hk.running, false);
+#else
+    _sir_pidstale      = true;
+    _sir_async.running = false;
+    _sir_hk.running    = false;
+#endif
+
+    /* what's queued is the parent's to deliver, and the child logs
+     * synchronously. the event may have been in use by the parent's worker,
+     * so it is created anew rather than destroyed. */
+    if (_sir_async.init) {
+        _sir_queue_destroy(&_sir_async.queue);
+        (void)_sirevent_create(&_sir_async.wake);
+    }
+
+    _sir_archives_atfork_child();
+    _sir_remote_atfork_child();
+    _sir_dcache_atfork_child(&_sir_dc);
+#if defined(SIR_SYSLOG_ENABLED)
+    _sir_syslogsock_atfork_child();
+#endif
 }
 
 void _sir_initmutex_cfg_once(void) {
@@ -442,8 +998,13 @@ void _sir_initmutex_cfg_once(void) {
 }
 
 void _sir_initmutex_fc_once(void) {
-    if (!_sirmutex_create(&fc_mutex))
-        _sir_selflog("error: failed to create mutex!");
+    if (!_sirrwlock_create(&fc_rwlock))
+        _sir_selflog("error: failed to create rwlock!");
+}
+
+void _sir_initmutex_dc_once(void) {
+    if (!_sirrwlock_create(&dc_rwlock))
+        _sir_selflog("error: failed to create rwlock!");
 }
 
 void _sir_initmutex_ts_once(void) {
@@ -476,8 +1037,21 @@ BOOL CALLBACK _sir_initmutex_fc_once(PINIT_ONCE ponce, PVOID param, PVOID* ctx)
     _SIR_UNUSED(param);
     _SIR_UNUSED(ctx)
 
-    if (!_sirmutex_create(&fc_mutex)) {
-        _sir_selflog("error: failed to create mutex!");
+    if (!_sirrwlock_create(&fc_rwlock)) {
+        _sir_selflog("error: failed to create rwlock!");
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+BOOL CALLBACK _sir_initmutex_dc_once(PINIT_ONCE ponce, PVOID param, PVOID* ctx) {
+    _SIR_UNUSED(ponce);
+    _SIR_UNUSED(param);
+    _SIR_UNUSED(ctx)
+
+    if (!_sirrwlock_create(&dc_rwlock)) {
+        _sir_selflog("error: failed to create rwlock!");
         return FALSE;
     }
 
@@ -516,51 +1090,114 @@ bool _sir_once(sir_once* once, sir_once_fn func) {
 #endif
 }
 
-bool _sir_logv(sir_level level, const char* format, va_list args) {
+bool _sir_logv(sir_level level, const sirsrcloc* loc, const char* format, va_list args) {
     if (!_sir_sanity() || !_sir_validlevel(level) || !_sir_validstr(format))
         return false;
 
-    _sir_seterror(_SIR_E_NOERROR);
-
-    sirconfig* _cfg = _sir_locksection(SIRMI_CONFIG);
-    if (!_sir_validptr(_cfg)) {
-        _sir_seterror(_SIR_E_INTERNAL);
+    /* nobody wants it; don't bother formatting it. */
+    if (!_sir_levelenabled(level)) {
+        _sir_seterror(_SIR_E_NODEST);
         return false;
     }
 
-    /* from time to time, update the host name in the config, just in case. */
-    time_t now = -1;
-    if (-1 != time(&now) &&
-        (now - _cfg->state.last_hname_chk) > SIR_HNAME_CHK_INTERVAL) {
-        _sir_selflog("updating hostname...");
-        if (!_sir_gethostname(_cfg->state.hostname)) {
-            _sir_selflog("error: failed to get hostname!");
-        } else {
-            _cfg->state.last_hname_chk = now;
-            _sir_selflog("hostname: '%s'", _cfg->state.hostname);
+    _sir_seterror(_SIR_E_NOERROR);
+
+#if defined(__HAVE_ATOMIC_H__)
+    if (atomic_load(&_sir_async.running))
+#else
+    if (_sir_async.running)
+#endif
+        return _sir_async_logv(level, loc, format, args);
+
+    sirmsg msg;
+    _sir_capture(&msg, level, loc, format, args, false);
+
+    return _sir_deliver(&msg);
+}
+
+void _sir_capture(sirmsg* msg, sir_level level, const sirsrcloc* loc, const char* format,
+    va_list args, bool defer) {
+    msg->level  = level;
+    msg->format = NULL;
+    msg->now   = -1;
+    msg->msec  = 0;
+
+    /* file and function names are string literals; the pointers stay valid. */
+    if (NULL != loc)
+        msg->loc = *loc;
+    else
+        memset(&msg->loc, 0, sizeof(sirsrcloc));
+
+    bool gettime = _sir_clock_gettime(&msg->now, &msg->msec);
+    SIR_ASSERT(gettime);
+    _SIR_UNUSED(gettime);
+
+    const sir_thread_info* ti = _sir_getthreadinfo();
+    msg->tid = ti->tid;
+    memcpy(msg->tname, ti->name, SIR_MAXPID);
+
+    if (defer) {
+        va_list copy;
+        va_copy(copy, args);
+        bool encoded = _sir_defer_encode(msg->message, SIR_MAXMESSAGE, format, copy);
+        va_end(copy);
+
+        if (encoded) {
+            msg->format = format;
+            return;
         }
     }
 
-    sirconfig tmpcfg;
-    memcpy(&tmpcfg, _cfg, sizeof(sirconfig));
-    _sir_unlocksection(SIRMI_CONFIG);
+    if (0 > vsnprintf(msg->message, SIR_MAXMESSAGE, format, args))
+        _sir_handleerr(errno);
+}
+
+bool _sir_deliver(const sirmsg* msg) {
+    sirconfig copy;
+    const sirconfig* cfg = _sir_acquireconfig(&copy);
+    if (!cfg)
+        return false;
+
+    /* this is a forked child, and the config still has the parent's PID. */
+#if defined(__HAVE_ATOMIC_H__)
+    if (atomic_load_explicit(&_sir_pidstale, memory_order_relaxed) &&
+        atomic_exchange(&_sir_pidstale, false)) {
+#else
+    if (_sir_pidstale) {
+        _sir_pidstale = false;
+#endif
+        _sir_releaseconfig(cfg);
+        _sir_updatepid();
+
+        cfg = _sir_acquireconfig(&copy);
+        if (!cfg)
+            return false;
+    }
 
-    sirbuf buf = {
-        {0},
-        {0},
-        {0},
-        tmpcfg.state.hostname,
-        tmpcfg.state.pidbuf,
-        NULL,
-        tmpcfg.si.name,
-        {0},
-        {0},
-        {0},
-         0
-    };
+    /* the arguments were recorded by the logging thread; format them now. */
+    char text[SIR_MAXMESSAGE];
+    if (NULL != msg->format)
+        _sir_defer_format(text, SIR_MAXMESSAGE, msg->format, msg->message);
+
+    /* the output buffers are large; only initialize what is needed. */
+    sirbuf buf;
+    _sir_resetstr(buf.style);
+    _sir_resetstr(buf.timestamp);
+    _sir_resetstr(buf.msec);
+    _sir_resetstr(buf.tid);
+
+    buf.hostname   = cfg->state.hostname;
+    buf.pid        = cfg->state.pidbuf;
+    buf.level      = NULL;
+    buf.name       = cfg->si.name;
+    buf.message    = (NULL != msg->format) ? text : msg->message;
+    buf.now        = msg->now;
+    buf.src        = msg;
+    buf.nfmt       = 0;
+    buf.output_len = 0;
 
     bool fmt = false;
-    const char* style_str = _sir_gettextstyle(level);
+    const char* style_str = _sir_gettextstyle(msg->level);
 
     SIR_ASSERT(NULL != style_str);
     if (NULL != style_str)
@@ -568,42 +1205,211 @@ bool _sir_logv(sir_level level, const char* format, va_list args) {
     _SIR_UNUSED(fmt);
     SIR_ASSERT(fmt);
 
-    now          = -1;
-    long nowmsec = 0;
-    bool gettime = _sir_clock_gettime(&now, &nowmsec);
-    SIR_ASSERT(gettime);
-
-    if (gettime) {
-        fmt = _sir_formattime(now, buf.timestamp, SIR_TIMEFORMAT);
+    if (-1 != msg->now) {
+        fmt = _sir_formattimestamp(msg->now, buf.timestamp);
         SIR_ASSERT(fmt);
         _SIR_UNUSED(fmt);
 
-        if (0 > snprintf(buf.msec, SIR_MAXMSEC, SIR_MSECFORMAT, nowmsec))
-            _sir_handleerr(errno);
+        _sir_formatmsec(msg->msec, buf.msec);
     }
 
-    buf.level = _sir_formattedlevelstr(level);
+    buf.level = _sir_formattedlevelstr(msg->level);
 
-    pid_t tid = _sir_gettid();
-    if (tid != tmpcfg.state.pid) {
-        if (!_sir_getthreadname(buf.tid)) {
-            if (0 > snprintf(buf.tid, SIR_MAXPID, SIR_PIDFORMAT, PID_CAST tid))
+    if (msg->tid != cfg->state.pid) {
+        if (_sir_validstrnofail(msg->tname)) {
+            _sir_strncpy(buf.tid, SIR_MAXPID, msg->tname, SIR_MAXPID);
+        } else {
+            if (0 > snprintf(buf.tid, SIR_MAXPID, SIR_PIDFORMAT, PID_CAST msg->tid))
                 _sir_handleerr(errno);
         }
     }
 
-    if (0 > vsnprintf(buf.message, SIR_MAXMESSAGE, format, args))
-        _sir_handleerr(errno);
+    bool dispatched = _sir_dispatch(cfg, msg->level, &buf);
+    _sir_releaseconfig(cfg);
+
+    return dispatched;
+}
+
+bool _sir_async_start(const sir_async_cfg* cfg) {
+    if (!_sir_validptr(cfg))
+        return false;
+
+    size_t capacity = cfg->queue_size > 0 ? cfg->queue_size : SIR_ASYNC_QUEUESIZE;
+    if (!_sir_queue_create(&_sir_async.queue, capacity, sizeof(sirmsg)))
+        return false;
+
+    if (!_sirevent_create(&_sir_async.wake)) {
+        _sir_queue_destroy(&_sir_async.queue);
+        return false;
+    }
+
+    _sir_async.deferred = cfg->deferred;
+
+#if defined(__HAVE_ATOMIC_H__)
+    atomic_store(&_sir_async.stop, false);
+    atomic_store(&_sir_async.idle, false);
+    atomic_store(&_sir_async.producers, 0);
+#else
+    _sir_async.stop      = false;
+    _sir_async.idle      = false;
+    _sir_async.producers = 0;
+#endif
+
+    if (!_sirthread_create(&_sir_async.thread, _sir_async_worker, NULL)) {
+        _sirevent_destroy(&_sir_async.wake);
+        _sir_queue_destroy(&_sir_async.queue);
+        return false;
+    }
+
+    _sir_async.init = true;
+#if defined(__HAVE_ATOMIC_H__)
+    atomic_store(&_sir_async.running, true);
+#else
+    _sir_async.running = true;
+#endif
+
+    _sir_selflog("async worker started (queue: %zu slots, deferred formatting: %s)",
+        _sir_queue_capacity(&_sir_async.queue), _sir_async.deferred ? "on" : "off");
+    return true;
+}
+
+bool _sir_async_stop(void) {
+    if (!_sir_async.init)
+        return true;
+
+    /* in a child process, there is no worker, but still the queue and event
+     * to clean up. */
+#if defined(__HAVE_ATOMIC_H__)
+    bool running = atomic_exchange(&_sir_async.running, false);
+#else
+    bool running       = _sir_async.running;
+    _sir_async.running = false;
+#endif
+
+    bool joined = true;
+    if (running) {
+        /* wait for threads that are in the middle of queueing a message. */
+#if defined(__HAVE_ATOMIC_H__)
+        while (0 < atomic_load(&_sir_async.producers))
+            _sirthread_yield();
+
+        atomic_store(&_sir_async.stop, true);
+#else
+        while (0 < _sir_async.producers)
+            _sirthread_yield();
+
+        _sir_async.stop = true;
+#endif
+
+        (void)_sirevent_signal(&_sir_async.wake);
+        joined = _sirthread_join(&_sir_async.thread);
+        _sir_selflog("async worker %s", joined ? "stopped" : "failed to stop!");
+    }
+
+    _sirevent_destroy(&_sir_async.wake);
+    _sir_queue_destroy(&_sir_async.queue);
+    _sir_async.init = false;
+
+    return joined;
+}
+
+bool _sir_async_logv(sir_level level, const sirsrcloc* loc, const char* format,
+    va_list args) {
+#if defined(__HAVE_ATOMIC_H__)
+    atomic_fetch_add(&_sir_async.producers, 1);
+    if (!atomic_load(&_sir_async.running)) {
+        atomic_fetch_sub(&_sir_async.producers, 1);
+#else
+    _sir_async.producers++;
+    if (!_sir_async.running) {
+        _sir_async.producers--;
+#endif
+        /* shutting down; the worker may already be gone. */
+        sirmsg msg;
+        _sir_capture(&msg, level, loc, format, args, false);
+        return _sir_deliver(&msg);
+    }
+
+    size_t pos   = 0;
+    uint32_t spins = 0;
+    sirmsg* msg  = NULL;
+
+    while (NULL == (msg = (sirmsg*)_sir_queue_reserve(&_sir_async.queue, &pos))) {
+        /* full; make sure the worker is awake, and wait for it to make room. */
+        (void)_sirevent_signal(&_sir_async.wake);
+        if (++spins < 64)
+            _sirthread_yield();
+        else
+            _sirthread_sleep(1);
+    }
+
+    _sir_capture(msg, level, loc, format, args, _sir_async.deferred);
+    _sir_queue_commit(&_sir_async.queue, pos);
+
+#if defined(__HAVE_ATOMIC_H__)
+    /* only the first producer to find the worker idle needs to wake it. */
+    if (atomic_load(&_sir_async.idle) && atomic_exchange(&_sir_async.idle, false))
+        (void)_sirevent_signal(&_sir_async.wake);
 
-    return _sir_dispatch(&tmpcfg.si, level, &buf);
+    atomic_fetch_sub(&_sir_async.producers, 1);
+#else
+    if (_sir_async.idle)
+        (void)_sirevent_signal(&_sir_async.wake);
+
+    _sir_async.producers--;
+#endif
+
+    return true;
 }
 
-bool _sir_dispatch(sirinit* si, sir_level level, sirbuf* buf) {
+sir_thread_ret SIR_THREAD_CALL _sir_async_worker(void* arg) {
+    _SIR_UNUSED(arg);
+
+    for (;;) {
+        sirmsg* msg = NULL;
+        while (NULL != (msg = (sirmsg*)_sir_queue_peek(&_sir_async.queue))) {
+            if (!_sir_deliver(msg))
+                _sir_selflog("error: failed to deliver queued message!");
+            _sir_queue_release(&_sir_async.queue);
+        }
+
+        if (!_sir_queue_empty(&_sir_async.queue)) {
+            /* a producer has reserved a slot, but not yet committed it. */
+            _sirthread_yield();
+            continue;
+        }
+
+#if defined(__HAVE_ATOMIC_H__)
+        if (atomic_load(&_sir_async.stop))
+            break;
+
+        atomic_store(&_sir_async.idle, true);
+        if (_sir_queue_empty(&_sir_async.queue) && !atomic_load(&_sir_async.stop))
+            (void)_sirevent_wait(&_sir_async.wake, SIR_ASYNC_WAITMSEC);
+        atomic_store(&_sir_async.idle, false);
+#else
+        if (_sir_async.stop)
+            break;
+
+        _sir_async.idle = true;
+        if (_sir_queue_empty(&_sir_async.queue) && !_sir_async.stop)
+            (void)_sirevent_wait(&_sir_async.wake, SIR_ASYNC_WAITMSEC);
+        _sir_async.idle = false;
+#endif
+    }
+
+    return (sir_thread_ret)0;
+}
+
+bool _sir_dispatch(const sirconfig* cfg, sir_level level, sirbuf* buf) {
     bool retval       = true;
     size_t dispatched = 0;
     size_t wanted     = 0;
 
-    if (_sir_bittest(si->d_stdout.levels, level)) {
+    const sirinit* si = &cfg->si;
+    uint8_t routes    = cfg->state.routes[_sir_levelindex(level)];
+
+    if (_sir_bittest(routes, _SIR_ROUTE_STDOUT)) {
         const char* write = _sir_format(true, si->d_stdout.opts, buf);
         bool wrote = _sir_validstrnofail(write) &&
             _sir_write_stdout(write, buf->output_len);
@@ -614,7 +1420,7 @@ bool _sir_dispatch(sirinit* si, sir_level level, sirbuf* buf) {
         wanted++;
     }
 
-    if (_sir_bittest(si->d_stderr.levels, level)) {
+    if (_sir_bittest(routes, _SIR_ROUTE_STDERR)) {
         const char* write = _sir_format(true, si->d_stderr.opts, buf);
         bool wrote = _sir_validstrnofail(write) &&
             _sir_write_stderr(write, buf->output_len);
@@ -625,13 +1431,21 @@ bool _sir_dispatch(sirinit* si, sir_level level, sirbuf* buf) {
         wanted++;
     }
 
-    if (_sir_bittest(si->d_syslog.levels, level)) {
+    if (_sir_bittest(routes, _SIR_ROUTE_SYSLOG)) {
         if (_sir_syslog_write(level, buf, &si->d_syslog))
             dispatched++;
         wanted++;
     }
 
-    sirfcache* sfc = _sir_locksection(SIRMI_FILECACHE);
+    if (_sir_bittest(routes, _SIR_ROUTE_REMOTE)) {
+        if (_sir_remote_write(level, buf, &si->d_remote))
+            dispatched++;
+        wanted++;
+    }
+
+    /* shared: files are locked individually, so threads writing to different
+     * files do not wait on each other. */
+    sirfcache* sfc = _sir_locksection_shared(SIRMI_FILECACHE);
     if (!_sir_validptr(sfc)) {
         _sir_seterror(_SIR_E_INTERNAL);
         return false;
@@ -640,11 +1454,28 @@ bool _sir_dispatch(sirinit* si, sir_level level, sirbuf* buf) {
     size_t fdispatched = 0;
     size_t fwanted = 0;
     retval &= _sir_fcache_dispatch(sfc, level, buf, &fdispatched, &fwanted);
-    _sir_unlocksection(SIRMI_FILECACHE);
+    _sir_unlocksection_shared(SIRMI_FILECACHE);
 
     dispatched += fdispatched;
     wanted += fwanted;
 
+    /* custom destinations are rare; don't touch their lock unless one wants the level. */
+    if (_sir_levelenabledfor(SIRMI_DESTCACHE, level)) {
+        sirdcache* sdc = _sir_locksection_shared(SIRMI_DESTCACHE);
+        if (!_sir_validptr(sdc)) {
+            _sir_seterror(_SIR_E_INTERNAL);
+            return false;
+        }
+
+        size_t ddispatched = 0;
+        size_t dwanted = 0;
+        retval &= _sir_dcache_dispatch(sdc, level, buf, &ddispatched, &dwanted);
+        _sir_unlocksection_shared(SIRMI_DESTCACHE);
+
+        dispatched += ddispatched;
+        wanted += dwanted;
+    }
+
     if (0 == wanted) {
         _sir_seterror(_SIR_E_NODEST);
         _sir_selflog("error: no destinations registered for level %04" PRIx16, level);
@@ -654,89 +1485,116 @@ bool _sir_dispatch(sirinit* si, sir_level level, sirbuf* buf) {
     return retval && (dispatched == wanted);
 }
 
+/** Appends up to `max` characters of `str` to `out` at `*len`, and advances `*len`. */
+static inline
+void _sir_appendstr(char* restrict out, size_t* restrict len, const char* restrict str,
+    size_t max) {
+    size_t avail = SIR_MAXOUTPUT - 1 - *len;
+    size_t count = strnlen(str, max < avail ? max : avail);
+
+    memcpy(out + *len, str, count);
+    *len += count;
+    out[*len] = '\0';
+}
+
 const char* _sir_format(bool styling, sir_options opts, sirbuf* buf) {
-    if (_sir_validptr(buf)) {
-        bool first = true;
+    if (!_sir_validptr(buf))
+        return NULL;
+
+    /* SIRO_NOHDR and SIRO_QUEUED have no bearing on the output of a message. */
+    opts &= ~(SIRO_NOHDR | SIRO_QUEUED);
+
+    /* destinations with the same styling and options share the output. */
+    size_t cached = buf->nfmt < SIR_MAXFMTCACHE ? buf->nfmt : SIR_MAXFMTCACHE;
+    for (size_t n = 0; n < cached; n++) {
+        if (buf->fmt[n].styling == styling && buf->fmt[n].opts == opts) {
+            buf->output_len = buf->fmt[n].len;
+            return buf->fmt[n].output;
+        }
+    }
 
-        _sir_resetstr(buf->output);
+    size_t slot = buf->nfmt++ % SIR_MAXFMTCACHE;
+    char* out   = buf->fmt[slot].output;
+    size_t len  = 0;
+    bool first  = true;
 
-        if (styling)
-            _sir_strncat(buf->output, SIR_MAXOUTPUT, buf->style, SIR_MAXSTYLE);
+    if (styling)
+        _sir_appendstr(out, &len, buf->style, SIR_MAXSTYLE);
 
-        if (!_sir_bittest(opts, SIRO_NOTIME)) {
-            _sir_strncat(buf->output, SIR_MAXOUTPUT, buf->timestamp, SIR_MAXTIME);
-            first = false;
+    if (!_sir_bittest(opts, SIRO_NOTIME)) {
+        _sir_appendstr(out, &len, buf->timestamp, SIR_MAXTIME);
+        first = false;
 
 #if defined(SIR_MSEC_TIMER)
-            if (!_sir_bittest(opts, SIRO_NOMSEC))
-                _sir_strncat(buf->output, SIR_MAXOUTPUT, buf->msec, SIR_MAXMSEC);
+        if (!_sir_bittest(opts, SIRO_NOMSEC))
+            _sir_appendstr(out, &len, buf->msec, SIR_MAXMSEC);
 #endif
-        }
-
-        if (!_sir_bittest(opts, SIRO_NOHOST) && _sir_validstrnofail(buf->hostname)) {
-            if (!first)
-                _sir_strncat(buf->output, SIR_MAXOUTPUT, " ", 1);
-            _sir_strncat(buf->output, SIR_MAXOUTPUT, buf->hostname, SIR_MAXHOST);
-            first = false;
-        }
-
-        if (!_sir_bittest(opts, SIRO_NOLEVEL)) {
-            if (!first)
-                _sir_strncat(buf->output, SIR_MAXOUTPUT, " ", 1);
-            _sir_strncat(buf->output, SIR_MAXOUTPUT, buf->level, SIR_MAXLEVEL);
-            first = false;
-        }
+    }
 
-        bool name = false;
-        if (!_sir_bittest(opts, SIRO_NONAME) && _sir_validstrnofail(buf->name)) {
-            if (!first)
-                _sir_strncat(buf->output, SIR_MAXOUTPUT, " ", 1);
-            _sir_strncat(buf->output, SIR_MAXOUTPUT, buf->name, SIR_MAXNAME);
-            first = false;
-            name  = true;
-        }
+    if (!_sir_bittest(opts, SIRO_NOHOST) && _sir_validstrnofail(buf->hostname)) {
+        if (!first)
+            _sir_appendstr(out, &len, " ", 1);
+        _sir_appendstr(out, &len, buf->hostname, SIR_MAXHOST);
+        first = false;
+    }
 
-        bool wantpid = !_sir_bittest(opts, SIRO_NOPID) && _sir_validstrnofail(buf->pid);
-        bool wanttid = !_sir_bittest(opts, SIRO_NOTID) && _sir_validstrnofail(buf->tid);
+    if (!_sir_bittest(opts, SIRO_NOLEVEL)) {
+        if (!first)
+            _sir_appendstr(out, &len, " ", 1);
+        _sir_appendstr(out, &len, buf->level, SIR_MAXLEVEL);
+        first = false;
+    }
 
-        if (wantpid || wanttid) {
-            if (name)
-                _sir_strncat(buf->output, SIR_MAXOUTPUT, SIR_PIDPREFIX, 1);
-            else if (!first)
-                _sir_strncat(buf->output, SIR_MAXOUTPUT, " ", 1);
+    bool name = false;
+    if (!_sir_bittest(opts, SIRO_NONAME) && _sir_validstrnofail(buf->name)) {
+        if (!first)
+            _sir_appendstr(out, &len, " ", 1);
+        _sir_appendstr(out, &len, buf->name, SIR_MAXNAME);
+        first = false;
+        name  = true;
+    }
 
-            if (wantpid)
-                _sir_strncat(buf->output, SIR_MAXOUTPUT, buf->pid, SIR_MAXPID);
+    bool wantpid = !_sir_bittest(opts, SIRO_NOPID) && _sir_validstrnofail(buf->pid);
+    bool wanttid = !_sir_bittest(opts, SIRO_NOTID) && _sir_validstrnofail(buf->tid);
 
-            if (wanttid) {
-                if (wantpid)
-                    _sir_strncat(buf->output, SIR_MAXOUTPUT, SIR_PIDSEPARATOR, 1);
-                _sir_strncat(buf->output, SIR_MAXOUTPUT, buf->tid, SIR_MAXPID);
-            }
+    if (wantpid || wanttid) {
+        if (name)
+            _sir_appendstr(out, &len, SIR_PIDPREFIX, 1);
+        else if (!first)
+            _sir_appendstr(out, &len, " ", 1);
 
-            if (name)
-                _sir_strncat(buf->output, SIR_MAXOUTPUT, SIR_PIDSUFFIX, 1);
+        if (wantpid)
+            _sir_appendstr(out, &len, buf->pid, SIR_MAXPID);
 
-            if (first)
-                first = false;
+        if (wanttid) {
+            if (wantpid)
+                _sir_appendstr(out, &len, SIR_PIDSEPARATOR, 1);
+            _sir_appendstr(out, &len, buf->tid, SIR_MAXPID);
         }
 
-        if (!first)
-            _sir_strncat(buf->output, SIR_MAXOUTPUT, ": ", 2);
+        if (name)
+            _sir_appendstr(out, &len, SIR_PIDSUFFIX, 1);
+
+        if (first)
+            first = false;
+    }
 
-        _sir_strncat(buf->output, SIR_MAXOUTPUT, buf->message, SIR_MAXMESSAGE);
+    if (!first)
+        _sir_appendstr(out, &len, ": ", 2);
 
-        if (styling)
-            _sir_strncat(buf->output, SIR_MAXOUTPUT, SIR_ESC_RST, SIR_MAXSTYLE);
+    _sir_appendstr(out, &len, buf->message, SIR_MAXMESSAGE);
 
-        _sir_strncat(buf->output, SIR_MAXOUTPUT, "\n", 1);
+    if (styling)
+        _sir_appendstr(out, &len, SIR_ESC_RST, SIR_MAXSTYLE);
 
-        buf->output_len = strnlen(buf->output, SIR_MAXOUTPUT);
+    _sir_appendstr(out, &len, "\n", 1);
 
-        return buf->output;
-    }
+    buf->fmt[slot].styling = styling;
+    buf->fmt[slot].opts    = opts;
+    buf->fmt[slot].len     = len;
+    buf->output_len        = len;
 
-    return NULL;
+    return out;
 }
 
 #if !defined(SIR_NO_SYSTEM_LOGGERS)
@@ -803,18 +1661,27 @@ bool _sir_syslog_open(sir_syslog_dest* ctx) {
     ctx->_state.logger = (void*)os_log_create(ctx->identity, ctx->category);
     _sir_selflog("opened os_log ('%s', '%s')", ctx->identity, ctx->category);
 # elif defined(SIR_SYSLOG_ENABLED)
-    int logopt = LOG_NDELAY | (_sir_bittest(ctx->opts, SIRO_NOPID) ? 0 : LOG_PID);
-    int facility = LOG_USER;
-
-    openlog(ctx->identity, logopt, facility);
-    _sir_selflog("opened syslog('%s', %x, %x)", ctx->identity, logopt, facility);
+    bool journal = false;
+#  if defined(SIR_JOURNAL_ENABLED)
+    /* where systemd's journal is listening, it gets structured entries directly. */
+    journal = _sir_journal_open();
+#  endif
+    if (journal) {
+        _sir_setbitshigh(&ctx->_state.mask, SIRSL_JOURNAL);
+        _sir_selflog("opened journal ('%s')", ctx->identity);
+    } else {
+        /* the identity and options are read from `ctx` as each message is framed. */
+        if (!_sir_syslogsock_open())
+            return false;
+        _sir_selflog("opened syslog socket ('%s')", ctx->identity);
+    }
 # endif
 
     _sir_setbitshigh(&ctx->_state.mask, SIRSL_IS_OPEN);
     return true;
 }
 
-bool _sir_syslog_write(sir_level level, const sirbuf* buf, sir_syslog_dest* ctx) {
+bool _sir_syslog_write(sir_level level, const sirbuf* buf, const sir_syslog_dest* ctx) {
     if (!_sir_bittest(ctx->_state.mask, SIRSL_IS_INIT)) {
         _sir_seterror(_SIR_E_INVALID);
         _sir_selflog("not initialized; ignoring");
@@ -855,8 +1722,12 @@ bool _sir_syslog_write(sir_level level, const sirbuf* buf, sir_syslog_dest* ctx)
             syslog_level = LOG_DEBUG;
     }
 
-    syslog(syslog_level, "%s", buf->message);
-    return true;
+#  if defined(SIR_JOURNAL_ENABLED)
+    if (_sir_bittest(ctx->_state.mask, SIRSL_JOURNAL))
+        return _sir_journal_write(syslog_level, buf, ctx);
+#  endif
+
+    return _sir_syslogsock_write(syslog_level, buf, ctx);
 # endif
 }
 
@@ -886,10 +1757,10 @@ bool _sir_syslog_updated(sirinit* si, sir_update_config_data* data) {
         must_init = (!is_init || !is_open) || (identity || category);
 # elif defined(SIR_SYSLOG_ENABLED)
         /*
-         * for os_log, if initialized and open already, only need to reconfigure
-         * if identity or options changed.
+         * for syslog, the identity and options are read as each message is
+         * framed; only need to reconfigure if not initialized and open yet.
          */
-        must_init = (!is_init || !is_open) || (identity || options);
+        must_init = !is_init || !is_open;
 # endif
         bool init = true;
         if (must_init) {
@@ -924,10 +1795,17 @@ bool _sir_syslog_close(sir_syslog_dest* ctx) {
     _sir_selflog("log closure not necessary");
     return true;
 # elif defined(SIR_SYSLOG_ENABLED)
-    closelog();
-    _sir_setbitslow(&ctx->_state.mask, SIRSL_IS_OPEN);
+    bool journal = _sir_bittest(ctx->_state.mask, SIRSL_JOURNAL);
+    bool closed  = false;
+#  if defined(SIR_JOURNAL_ENABLED)
+    if (journal)
+        closed = _sir_journal_close();
+#  endif
+    if (!journal)
+        closed = _sir_syslogsock_close();
+    _sir_setbitslow(&ctx->_state.mask, SIRSL_IS_OPEN | SIRSL_JOURNAL);
     _sir_selflog("closed log");
-    return true;
+    return closed;
 # endif
 }
 
@@ -952,7 +1830,7 @@ bool _sir_syslog_open(sir_syslog_dest* ctx) {
     return false;
 }
 
-bool _sir_syslog_write(sir_level level, const sirbuf* buf, sir_syslog_dest* ctx) {
+bool _sir_syslog_write(sir_level level, const sirbuf* buf, const sir_syslog_dest* ctx) {
     _SIR_UNUSED(level);
     _SIR_UNUSED(buf);
     _SIR_UNUSED(ctx);
@@ -1008,44 +1886,50 @@ bool _sir_formattime(time_t now, char* buffer, const char* format) {
     return 0 != fmttime;
 }
 
-bool _sir_clock_gettime(time_t* tbuf, long* msecbuf) {
-    if (tbuf) {
-        time_t ret = time(tbuf);
-        if ((time_t)-1 == ret) {
-            if (msecbuf)
-                *msecbuf = 0;
-            _sir_handleerr(errno);
+bool _sir_formattimestamp(time_t now, char buffer[SIR_MAXTIME]) {
+    /* the formatted value only changes once per second, so it is cached. */
+    if (now != sir_tsc.when) {
+        if (!_sir_formattime(now, sir_tsc.timestamp, SIR_TIMEFORMAT)) {
+            sir_tsc.when = -1;
             return false;
         }
+
+        sir_tsc.when = now;
+        sir_tsc.len  = strnlen(sir_tsc.timestamp, SIR_MAXTIME - 1);
+    }
+
+    memcpy(buffer, sir_tsc.timestamp, sir_tsc.len + 1);
+    return true;
+}
+
+uint64_t _sir_msectime(void) {
+    time_t now = 0;
+    long msec  = 0;
+
+    if (!_sir_clock_gettime(&now, &msec))
+        return 0;
+
+    return ((uint64_t)now * 1000) + (uint64_t)msec;
+}
+
+bool _sir_clock_gettime(time_t* tbuf, long* msecbuf) {
+    if (tbuf) {
 #if defined(SIR_MSEC_POSIX)
+        /* a single read of the clock yields both seconds and milliseconds. */
         struct timespec ts = {0};
         int clock          = clock_gettime(SIR_MSECCLOCK, &ts);
         SIR_ASSERT(0 == clock);
 
         if (0 == clock) {
+            *tbuf = ts.tv_sec;
             if (msecbuf)
-                *msecbuf = (ts.tv_nsec / 1e6);
+                *msecbuf = ts.tv_nsec / 1000000L;
         } else {
-            if (msecbuf)
-                *msecbuf = 0;
             _sir_handleerr(errno);
-        }
-#elif defined(SIR_MSEC_MACH)
-        kern_return_t retval = KERN_SUCCESS;
-        mach_timespec_t mts  = {0};
-        clock_serv_t clock;
-
-        host_get_clock_service(mach_host_self(), SIR_MSECCLOCK, &clock);
-        retval = clock_get_time(clock, &mts);
-        mach_port_deallocate(mach_task_self(), clock);
-
-        if (KERN_SUCCESS == retval) {
-            if (msecbuf)
-                *msecbuf = (mts.tv_nsec / 1e6);
-        } else {
             if (msecbuf)
                 *msecbuf = 0;
-            _sir_handleerr(retval);
+            if ((time_t)-1 == time(tbuf))
+                return false;
         }
 #elif defined(SIR_MSEC__WIN__)
         static const ULONGLONG uepoch = (ULONGLONG)116444736e9;
@@ -1056,24 +1940,42 @@ bool _sir_clock_gettime(time_t* tbuf, long* msecbuf) {
         ULARGE_INTEGER ftnow = {0};
         ftnow.HighPart = ftutc.dwHighDateTime;
         ftnow.LowPart  = ftutc.dwLowDateTime;
-        ftnow.QuadPart = (ULONGLONG)((ftnow.QuadPart - uepoch) / 1e7);
 
-        *tbuf = (time_t)ftnow.QuadPart;
+        /* 100-nanosecond intervals since the Unix epoch. */
+        ULONGLONG hns = ftnow.QuadPart - uepoch;
 
-        SYSTEMTIME st = {0};
-        if (FileTimeToSystemTime(&ftutc, &st)) {
+        *tbuf = (time_t)(hns / 10000000ULL);
+        if (msecbuf)
+            *msecbuf = (long)((hns / 10000ULL) % 1000ULL);
+#else
+        time_t ret = time(tbuf);
+        if ((time_t)-1 == ret) {
             if (msecbuf)
-                *msecbuf = st.wMilliseconds;
+                *msecbuf = 0;
+            _sir_handleerr(errno);
+            return false;
+        }
+# if defined(SIR_MSEC_MACH)
+        kern_return_t retval = KERN_SUCCESS;
+        mach_timespec_t mts  = {0};
+        clock_serv_t clock;
+
+        host_get_clock_service(mach_host_self(), SIR_MSECCLOCK, &clock);
+        retval = clock_get_time(clock, &mts);
+        mach_port_deallocate(mach_task_self(), clock);
+
+        if (KERN_SUCCESS == retval) {
+            if (msecbuf)
+                *msecbuf = (mts.tv_nsec / 1e6);
         } else {
             if (msecbuf)
                 *msecbuf = 0;
-            _sir_handlewin32err(GetLastError());
+            _sir_handleerr(retval);
         }
-
-#else
-        time(tbuf);
+# else
         if (msecbuf)
             *msecbuf = 0;
+# endif
 #endif
         return true;
     }
@@ -1137,6 +2039,52 @@ bool _sir_getthreadname(char name[SIR_MAXPID]) {
 #endif
 }
 
+const sir_thread_info* _sir_getthreadinfo(void) {
+    if (!sir_ti.cached) {
+        sir_ti.tid = _sir_gettid();
+
+        /* the main thread is not identified in output; skip the name lookup. */
+        if (sir_ti.tid == _sir_getpid() || !_sir_getthreadname(sir_ti.name))
+            _sir_resetstr(sir_ti.name);
+
+        sir_ti.cached = true;
+    }
+
+    return &sir_ti;
+}
+
+bool _sir_setthreadname(const char* name) {
+    if (!_sir_validstr(name))
+        return false;
+
+    if (strnlen(name, SIR_MAXPID) >= SIR_MAXPID) {
+        _sir_seterror(_SIR_E_INVALID);
+        return false;
+    }
+
+#if defined(__MACOS__)
+    int ret = pthread_setname_np(name);
+#elif defined(__NetBSD__)
+    int ret = pthread_setname_np(pthread_self(), "%s", (void*)name);
+#elif (defined(__BSD__) && defined(__FreeBSD_PTHREAD_NP_12_2__)) || \
+       (defined(__GLIBC__) && defined(_GNU_SOURCE)) || defined(USE_PTHREAD_GETNAME_NP)
+    int ret = pthread_setname_np(pthread_self(), name);
+#elif defined(__BSD__) && defined(__FreeBSD_PTHREAD_NP_11_3__)
+    pthread_set_name_np(pthread_self(), name);
+    int ret = 0;
+#else
+    /* no portable way to set it; libsir output will still use it. */
+    int ret = 0;
+#endif
+    if (0 != ret) {
+        _sir_handleerr(ret);
+        return false;
+    }
+
+    (void)_sir_getthreadinfo();
+    return 0 == _sir_strncpy(sir_ti.name, SIR_MAXPID, name, SIR_MAXPID);
+}
+
 bool _sir_gethostname(char name[SIR_MAXHOST]) {
 #if !defined(__WIN__)
     if (-1 == gethostname(name, SIR_MAXHOST - 1)) {
@@ -66,6 +66,12 @@ bool _sir_sysloglevels(sirinit* si, sir_update_config_data* data);
 /** Updates options for the system logger. */
 bool _sir_syslogopts(sirinit* si, sir_update_config_data* data);
 
+/** Updates levels for the remote syslog destination. */
+bool _sir_remotelevels(sirinit* si, sir_update_config_data* data);
+
+/** Updates options for the remote syslog destination. */
+bool _sir_remoteopts(sirinit* si, sir_update_config_data* data);
+
 /** Updates the identity for the system logger.*/
 bool _sir_syslogid(sirinit* si, sir_update_config_data* data);
 
@@ -78,23 +84,77 @@ typedef bool (*sirinit_update)(sirinit*, sir_update_config_data*);
 /** Updates values in the global config. */
 bool _sir_writeinit(sir_update_config_data* data, sirinit_update update);
 
+/**
+ * Rebuilds the per-level routes of the configuration, and publishes a copy
+ * of it for logging threads to read without locking. Must be called while
+ * ::SIRMI_CONFIG is locked, after any change.
+ */
+void _sir_publishconfig(sirconfig* cfg);
+
+/**
+ * Returns the most recently published configuration, which must be passed to
+ * ::_sir_releaseconfig when no longer needed. Without atomics, the config is
+ * copied into `copy` under lock, and `copy` is returned.
+ */
+const sirconfig* _sir_acquireconfig(sirconfig* copy);
+
+/** Releases a configuration obtained from ::_sir_acquireconfig. */
+void _sir_releaseconfig(const sirconfig* cfg);
+
+/**
+ * Replaces the levels registered by the destinations in a section (the
+ * stdio/system logger config, the file cache, or the custom destination
+ * cache) in the global level mask.
+ */
+void _sir_setlevelmask(sir_mutex_id section, sir_levels levels);
+
+/** Returns true if any destination is registered for the level. */
+bool _sir_levelenabled(sir_level level);
+
+/** Returns true if any destination in the section is registered for the level. */
+bool _sir_levelenabledfor(sir_mutex_id section, sir_level level);
+
+/** Refreshes the hostname in the configuration, if it has changed. */
+void _sir_updatehostname(void);
+
+/** Refreshes the PID in the configuration (e.g., in the child after fork()). */
+void _sir_updatepid(void);
+
 /** Locks a protected section. */
 void* _sir_locksection(sir_mutex_id mid);
 
 /** Unlocks a protected section. */
 void _sir_unlocksection(sir_mutex_id mid);
 
-/** Maps a ::sir_mutex_id to a ::sir_mutex and protected section. */
+/**
+ * Locks a protected section for reading, shared with other readers. Only the
+ * file and custom destination caches support this; other sections are locked
+ * exclusively.
+ */
+void* _sir_locksection_shared(sir_mutex_id mid);
+
+/** Unlocks a protected section locked by ::_sir_locksection_shared. */
+void _sir_unlocksection_shared(sir_mutex_id mid);
+
+/**
+ * Maps a ::sir_mutex_id to a ::sir_mutex and protected section. The file and
+ * custom destination caches are guarded by a ::sir_rwlock instead, and are not
+ * mapped.
+ */
 bool _sir_mapmutexid(sir_mutex_id mid, sir_mutex** m, void** section);
 
 # if !defined(__WIN__)
 /** General initialization procedure. */
 void _sir_initialize_once(void);
+/** Resets per-thread state, and forgets libsir's threads, in the child after fork(). */
+void _sir_atfork_child(void);
 /** Initializes a specific mutex. */
 void _sir_initmutex_cfg_once(void);
 /** Initializes a specific mutex. */
 void _sir_initmutex_fc_once(void);
 /** Initializes a specific mutex. */
+void _sir_initmutex_dc_once(void);
+/** Initializes a specific mutex. */
 void _sir_initmutex_ts_once(void);
 # else /* __WIN__ */
 /** General initialization procedure. */
@@ -104,19 +164,64 @@ BOOL CALLBACK _sir_initmutex_cfg_once(PINIT_ONCE ponce, PVOID param, PVOID* ctx)
 /** Initializes a specific mutex. */
 BOOL CALLBACK _sir_initmutex_fc_once(PINIT_ONCE ponce, PVOID param, PVOID* ctx);
 /** Initializes a specific mutex. */
+BOOL CALLBACK _sir_initmutex_dc_once(PINIT_ONCE ponce, PVOID param, PVOID* ctx);
+/** Initializes a specific mutex. */
 BOOL CALLBACK _sir_initmutex_ts_once(PINIT_ONCE ponce, PVOID param, PVOID* ctx);
 # endif
 
 /** Executes only one time. */
 bool _sir_once(sir_once* once, sir_once_fn func);
 
-/** Core output formatting. */
-bool _sir_logv(sir_level level, const char* format, va_list args);
+/** Core output formatting. `loc` is where the message was logged from, or NULL. */
+bool _sir_logv(sir_level level, const sirsrcloc* loc, const char* format, va_list args);
 
-/** Output dispatching. */
-bool _sir_dispatch(sirinit* si, sir_level level, sirbuf* buf);
+/**
+ * Captures the time, thread identifier, and formatted message on the calling
+ * thread. If `defer` is `true`, only the arguments are recorded when possible,
+ * and formatting is left to ::_sir_deliver.
+ */
+void _sir_capture(sirmsg* msg, sir_level level, const sirsrcloc* loc, const char* format,
+    va_list args, bool defer);
 
-/** Specific destination formatting. */
+/** Formats and dispatches a captured message to all destinations. */
+bool _sir_deliver(const sirmsg* msg);
+
+/** Starts the asynchronous delivery worker thread. */
+bool _sir_async_start(const sir_async_cfg* cfg);
+
+/** Stops the asynchronous delivery worker after draining its queue. */
+bool _sir_async_stop(void);
+
+/** Queues a message for asynchronous delivery. */
+bool _sir_async_logv(sir_level level, const sirsrcloc* loc, const char* format,
+    va_list args);
+
+/** Asynchronous delivery worker thread entry point. */
+sir_thread_ret SIR_THREAD_CALL _sir_async_worker(void* arg);
+
+/** Starts the housekeeping thread, which periodically refreshes the hostname
+ * and flushes log files whose ::sir_file_policy calls for it. */
+bool _sir_housekeeping_start(void);
+
+/** Stops the housekeeping thread. */
+bool _sir_housekeeping_stop(void);
+
+/** Wakes the housekeeping thread so that it reschedules its next run. */
+void _sir_housekeeping_wake(void);
+
+/** Housekeeping thread entry point. */
+sir_thread_ret SIR_THREAD_CALL _sir_housekeeping_worker(void* arg);
+
+/**
+ * Output dispatching: writes to the destinations that the routing tables of
+ * `cfg` (see ::_sir_publishconfig) and the file cache list for `level`.
+ */
+bool _sir_dispatch(const sirconfig* cfg, sir_level level, sirbuf* buf);
+
+/**
+ * Specific destination formatting. Output is only built once per distinct
+ * combination of styling and options for each ::sirbuf.
+ */
 const char* _sir_format(bool styling, sir_options opts, sirbuf* buf);
 
 /** Initializes a ::sir_syslog_dest. */
@@ -135,7 +240,7 @@ bool _sir_syslog_open(sir_syslog_dest* ctx);
  * Abstraction for writing to platform-specific implementations of
  * system logger facilities.
  */
-bool _sir_syslog_write(sir_level level, const sirbuf* buf, sir_syslog_dest* ctx);
+bool _sir_syslog_write(sir_level level, const sirbuf* buf, const sir_syslog_dest* ctx);
 
 /**
  * Called after updates to the global config that may require reconfiguration
@@ -158,12 +263,38 @@ void _sir_syslog_reset(sir_syslog_dest* ctx);
 /** Returns the formatted, human-readable form of a ::sir_level. */
 const char* _sir_formattedlevelstr(sir_level level);
 
+/** Retrieves the current time in milliseconds since the epoch. */
+uint64_t _sir_msectime(void);
+
 /** Retrieves the current time w/ optional milliseconds. */
 bool _sir_clock_gettime(time_t* tbuf, long* msecbuf);
 
 /** Formats the current time as a string. */
 bool _sir_formattime(time_t now, char* buffer, const char* format);
 
+/**
+ * Formats the time as ::SIR_TIMEFORMAT, reusing the calling thread's previous
+ * result if `now` is the same second.
+ */
+bool _sir_formattimestamp(time_t now, char buffer[SIR_MAXTIME]);
+
+/**
+ * Formats milliseconds (0-999) as ::SIR_MSECFORMAT. The default format is
+ * written out digit by digit; the comparison is made at compile time.
+ */
+static inline
+void _sir_formatmsec(long msec, char buffer[SIR_MAXMSEC]) {
+    if (0 == strcmp(SIR_MSECFORMAT, ".%03ld")) {
+        buffer[0] = '.';
+        buffer[1] = (char)('0' + ((msec / 100) % 10));
+        buffer[2] = (char)('0' + ((msec / 10) % 10));
+        buffer[3] = (char)('0' + (msec % 10));
+        buffer[4] = '\0';
+    } else {
+        (void)snprintf(buffer, SIR_MAXMSEC, SIR_MSECFORMAT, msec);
+    }
+}
+
 /** Returns the current process identifier. */
 pid_t _sir_getpid(void);
 
@@ -173,6 +304,15 @@ pid_t _sir_gettid(void);
 /** Retrieves the current thread's name. */
 bool _sir_getthreadname(char name[SIR_MAXPID]);
 
+/**
+ * Returns the current thread's identifier and name, querying the OS only the
+ * first time it is called on each thread.
+ */
+const sir_thread_info* _sir_getthreadinfo(void);
+
+/** Sets the current thread's name in the OS and in libsir's per-thread cache. */
+bool _sir_setthreadname(const char* name);
+
 /** Retrieves the hostname of this machine. */
 bool _sir_gethostname(char name[SIR_MAXHOST]);
 
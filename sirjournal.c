@@ -0,0 +1,284 @@
+/*
+ * sirjournal.c
+ *
+ * Author:    Ryan M. Lederman <lederman@gmail.com>
+ * Copyright: Copyright (c) 2018-2023
+ * Version:   2.2.0
+ * License:   The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "sirjournal.h"
+#include "sirinternal.h"
+#include "sirhelpers.h"
+
+#if defined(SIR_JOURNAL_ENABLED)
+# include <sys/mman.h>
+# include <sys/uio.h>
+
+/** The most fields an entry has. */
+# define _SIR_JOURNAL_MAXFIELDS 8
+
+/** The most parts a field is made of: `NAME`, `\n`, length, value, `\n`. */
+# define _SIR_JOURNAL_FIELDPARTS 5
+
+/**
+ * An entry in the journal's native format, as parts that point at the values
+ * rather than copies of them. Values without newlines are sent as `NAME=value`
+ * lines; others as `NAME`, a newline, their little-endian 64-bit length, and
+ * the value, followed by a newline.
+ */
+typedef struct {
+    struct iovec parts[_SIR_JOURNAL_MAXFIELDS * _SIR_JOURNAL_FIELDPARTS];
+    size_t count;
+    uint8_t lengths[_SIR_JOURNAL_MAXFIELDS][sizeof(uint64_t)];
+    size_t nlengths;
+} _sir_journalentry;
+
+/**
+ * The socket messages are sent to the journal with. It isn't connected: each
+ * message is addressed to the journal, so that nothing needs to be done when
+ * the journal restarts.
+ */
+static struct {
+    int fd;
+    struct sockaddr_un addr;
+    char path[SIR_MAXPATH];
+} _sir_jn = {.fd = -1};
+
+static inline
+void _sir_journal_part(_sir_journalentry* entry, const void* data, size_t len) {
+    entry->parts[entry->count].iov_base = (void*)data;
+    entry->parts[entry->count].iov_len  = len;
+    entry->count++;
+}
+
+static
+void _sir_journal_field(_sir_journalentry* entry, const char* name, const char* value,
+    size_t len) {
+    _sir_journal_part(entry, name, strlen(name));
+
+    if (NULL == memchr(value, '\n', len)) {
+        _sir_journal_part(entry, "=", 1);
+    } else {
+        uint8_t* length = entry->lengths[entry->nlengths++];
+        for (size_t n = 0; n < sizeof(uint64_t); n++)
+            length[n] = (uint8_t)((uint64_t)len >> (n * 8));
+
+        _sir_journal_part(entry, "\n", 1);
+        _sir_journal_part(entry, length, sizeof(uint64_t));
+    }
+
+    _sir_journal_part(entry, value, len);
+    _sir_journal_part(entry, "\n", 1);
+}
+
+/**
+ * Sends an entry too large for a datagram: it is written to a memfd, sealed so
+ * that it can't change under the journal, and the descriptor is sent instead.
+ */
+static
+bool _sir_journal_sendmemfd(const _sir_journalentry* entry) {
+# if defined(MFD_ALLOW_SEALING) && defined(F_ADD_SEALS)
+    int memfd = memfd_create("libsir-journal", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (-1 == memfd) {
+        _sir_handleerr(errno);
+        return false;
+    }
+
+    bool written = true;
+    for (size_t n = 0; written && n < entry->count; n++) {
+        const char* data = (const char*)entry->parts[n].iov_base;
+        size_t left      = entry->parts[n].iov_len;
+
+        while (written && left > 0) {
+            ssize_t ret = write(memfd, data, left);
+            if (-1 == ret && EINTR == errno)
+                continue;
+
+            written = ret > 0;
+            if (written) {
+                data += ret;
+                left -= (size_t)ret;
+            }
+        }
+    }
+
+    if (!written || -1 == fcntl(memfd, F_ADD_SEALS,
+        F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL)) {
+        _sir_handleerr(errno);
+        (void)close(memfd);
+        return false;
+    }
+
+    union {
+        struct cmsghdr hdr;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } control;
+    memset(&control, 0, sizeof(control));
+
+    struct msghdr mh   = {0};
+    mh.msg_name        = &_sir_jn.addr;
+    mh.msg_namelen     = sizeof(_sir_jn.addr);
+    mh.msg_control     = control.buf;
+    mh.msg_controllen  = sizeof(control.buf);
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&mh);
+    cmsg->cmsg_level     = SOL_SOCKET;
+    cmsg->cmsg_type      = SCM_RIGHTS;
+    cmsg->cmsg_len       = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &memfd, sizeof(int));
+
+    bool sent = -1 != sendmsg(_sir_jn.fd, &mh, MSG_NOSIGNAL);
+    if (!sent)
+        _sir_selflog("failed to send memfd to the journal (%d); dropping", errno);
+
+    (void)close(memfd);
+    return true;
+# else
+    _SIR_UNUSED(entry);
+    _sir_seterror(_SIR_E_UNAVAIL);
+    return false;
+# endif
+}
+
+bool _sir_journal_open(void) {
+    const char* path = '\0' != _sir_jn.path[0] ? _sir_jn.path : SIR_JOURNAL_SOCKET;
+
+    struct stat st = {0};
+    if (0 != stat(path, &st) || !S_ISSOCK(st.st_mode)) {
+        _sir_selflog("no journal socket at '%s'", path);
+        return false;
+    }
+
+    size_t len = strnlen(path, SIR_MAXPATH);
+    if (len >= sizeof(_sir_jn.addr.sun_path)) {
+        _sir_handleerr(ENAMETOOLONG);
+        return false;
+    }
+
+    memset(&_sir_jn.addr, 0, sizeof(_sir_jn.addr));
+    _sir_jn.addr.sun_family = AF_UNIX;
+    memcpy(_sir_jn.addr.sun_path, path, len);
+
+    if (-1 == _sir_jn.fd) {
+        _sir_jn.fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+        if (-1 == _sir_jn.fd) {
+            _sir_handleerr(errno);
+            return false;
+        }
+    }
+
+    _sir_selflog("sending to the journal at '%s' (fd: %d)", path, _sir_jn.fd);
+    return true;
+}
+
+bool _sir_journal_write(int severity, const sirbuf* buf, const sir_syslog_dest* ctx) {
+    if (!_sir_validptr(buf) || !_sir_validptr(ctx))
+        return false;
+
+    if (-1 == _sir_jn.fd) {
+        _sir_seterror(_SIR_E_INVALID);
+        return false;
+    }
+
+    _sir_journalentry entry;
+    entry.count    = 0;
+    entry.nlengths = 0;
+
+    char priority[4] = {0};
+    char line[16]    = {0};
+    char tid[SIR_MAXPID] = {0};
+    (void)snprintf(priority, sizeof(priority), "%d", severity);
+
+    _sir_journal_field(&entry, "MESSAGE", buf->message, strlen(buf->message));
+    _sir_journal_field(&entry, "PRIORITY", priority, strlen(priority));
+
+    if (_sir_validstrnofail(ctx->identity))
+        _sir_journal_field(&entry, "SYSLOG_IDENTIFIER", ctx->identity,
+            strnlen(ctx->identity, SIR_MAX_SYSLOG_ID));
+
+    const sirmsg* src = buf->src;
+    if (NULL != src && NULL != src->loc.file) {
+        (void)snprintf(line, sizeof(line), "%" PRIu32, src->loc.line);
+        _sir_journal_field(&entry, "CODE_FILE", src->loc.file, strlen(src->loc.file));
+        _sir_journal_field(&entry, "CODE_LINE", line, strlen(line));
+    }
+
+    if (NULL != src && NULL != src->loc.func)
+        _sir_journal_field(&entry, "CODE_FUNC", src->loc.func, strlen(src->loc.func));
+
+    if (NULL != src) {
+        (void)snprintf(tid, sizeof(tid), SIR_PIDFORMAT, PID_CAST src->tid);
+        _sir_journal_field(&entry, "TID", tid, strlen(tid));
+
+        if (_sir_validstrnofail(src->tname))
+            _sir_journal_field(&entry, "SIR_THREAD_NAME", src->tname,
+                strnlen(src->tname, SIR_MAXPID));
+    }
+
+    struct msghdr mh = {0};
+    mh.msg_name      = &_sir_jn.addr;
+    mh.msg_namelen   = sizeof(_sir_jn.addr);
+    mh.msg_iov       = entry.parts;
+    mh.msg_iovlen    = entry.count;
+
+    for (;;) {
+        if (-1 != sendmsg(_sir_jn.fd, &mh, MSG_NOSIGNAL))
+            return true;
+
+        if (EINTR == errno)
+            continue;
+
+        if (EAGAIN == errno || EWOULDBLOCK == errno) {
+            /* the journal is busy; wait a little for it, as for the system logger. */
+            struct pollfd pfd = {_sir_jn.fd, POLLOUT, 0};
+            if (poll(&pfd, 1, SIR_SYSLOG_WAITMSEC) > 0)
+                continue;
+        }
+
+        break;
+    }
+
+    if (EMSGSIZE == errno || ENOBUFS == errno)
+        return _sir_journal_sendmemfd(&entry);
+
+    /* e.g. the journal is restarting; like syslog(3), the message is dropped. */
+    _sir_selflog("failed to send to the journal (%d); dropping", errno);
+    return true;
+}
+
+bool _sir_journal_close(void) {
+    if (-1 != _sir_jn.fd) {
+        (void)close(_sir_jn.fd);
+        _sir_jn.fd = -1;
+    }
+
+    return true;
+}
+
+void _sir_journal_setpath(const char* path) {
+    if (!path) {
+        _sir_jn.path[0] = '\0';
+    } else {
+        size_t len = strnlen(path, SIR_MAXPATH - 1);
+        memcpy(_sir_jn.path, path, len);
+        _sir_jn.path[len] = '\0';
+    }
+}
+#endif /* SIR_JOURNAL_ENABLED */
@@ -0,0 +1,62 @@
+/*
+ * sirjournal.h
+ *
+ * Author:    Ryan M. Lederman <lederman@gmail.com>
+ * Copyright: Copyright (c) 2018-2023
+ * Version:   2.2.0
+ * License:   The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef _SIR_JOURNAL_H_INCLUDED
+# define _SIR_JOURNAL_H_INCLUDED
+
+# include "sirtypes.h"
+
+# if defined(SIR_JOURNAL_ENABLED)
+/**
+ * Prepares to send messages to systemd's journal over its native protocol, if
+ * it is listening on ::SIR_JOURNAL_SOCKET (unless changed with
+ * ::_sir_journal_setpath). Returns `false` if it isn't, in which case the
+ * system logger's socket is used instead.
+ */
+bool _sir_journal_open(void);
+
+/**
+ * Sends a message to the journal as a single entry: `MESSAGE`, `PRIORITY`
+ * (the `severity` of its level, `LOG_*`), `SYSLOG_IDENTIFIER`, the location it
+ * was logged from (`CODE_FILE`, `CODE_LINE`, `CODE_FUNC`) if known, and the
+ * thread (`TID`, and `SIR_THREAD_NAME` if it has a name).
+ *
+ * Entries too large for a datagram are written to a sealed memfd, which is
+ * passed to the journal instead. Like syslog(3), messages the journal is not
+ * there to receive are dropped without an error.
+ */
+bool _sir_journal_write(int severity, const sirbuf* buf, const sir_syslog_dest* ctx);
+
+/** Closes the socket used to send messages to the journal. */
+bool _sir_journal_close(void);
+
+/**
+ * Sets the path of the journal's socket from the next ::_sir_journal_open
+ * on, e.g. a stand-in for it. `NULL` restores ::SIR_JOURNAL_SOCKET.
+ */
+void _sir_journal_setpath(const char* path);
+# endif
+
+#endif /* !_SIR_JOURNAL_H_INCLUDED */
@@ -98,6 +98,69 @@ bool _sirmutex_destroy(sir_mutex* mutex) {
     return false;
 }
 
+bool _sirrwlock_create(sir_rwlock* rwlock) {
+    if (_sir_validptr(rwlock)) {
+        pthread_rwlockattr_t attr;
+
+        int op = pthread_rwlockattr_init(&attr);
+        if (0 != op)
+            _sir_handleerr(op);
+
+        if (0 == op) {
+# if defined(__GLIBC__)
+            /* by default, a steady stream of readers starves writers. */
+            op = pthread_rwlockattr_setkind_np(&attr,
+                PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+            if (0 != op)
+                _sir_handleerr(op);
+# endif
+            op = pthread_rwlock_init(rwlock, &attr);
+            if (0 != op)
+                _sir_handleerr(op);
+
+            (void)pthread_rwlockattr_destroy(&attr);
+            return 0 == op;
+        }
+    }
+
+    return false;
+}
+
+bool _sirrwlock_lock(sir_rwlock* rwlock, bool exclusive) {
+    if (_sir_validptr(rwlock)) {
+        int op = exclusive ? pthread_rwlock_wrlock(rwlock) : pthread_rwlock_rdlock(rwlock);
+        if (0 != op)
+            _sir_handleerr(op);
+        return 0 == op;
+    }
+
+    return false;
+}
+
+bool _sirrwlock_unlock(sir_rwlock* rwlock, bool exclusive) {
+    _SIR_UNUSED(exclusive);
+
+    if (_sir_validptr(rwlock)) {
+        int op = pthread_rwlock_unlock(rwlock);
+        if (0 != op)
+            _sir_handleerr(op);
+        return 0 == op;
+    }
+
+    return false;
+}
+
+bool _sirrwlock_destroy(sir_rwlock* rwlock) {
+    if (_sir_validptr(rwlock)) {
+        int op = pthread_rwlock_destroy(rwlock);
+        if (0 != op)
+            _sir_handleerr(op);
+        return 0 == op;
+    }
+
+    return false;
+}
+
 #else /* __WIN__ */
 
 static bool _sirmutex_waitwin32(sir_mutex mutex, DWORD msec);
@@ -152,6 +215,44 @@ bool _sirmutex_destroy(sir_mutex* mutex) {
     return false;
 }
 
+bool _sirrwlock_create(sir_rwlock* rwlock) {
+    if (_sir_validptr(rwlock)) {
+        InitializeSRWLock(rwlock);
+        return true;
+    }
+
+    return false;
+}
+
+bool _sirrwlock_lock(sir_rwlock* rwlock, bool exclusive) {
+    if (_sir_validptr(rwlock)) {
+        if (exclusive)
+            AcquireSRWLockExclusive(rwlock);
+        else
+            AcquireSRWLockShared(rwlock);
+        return true;
+    }
+
+    return false;
+}
+
+bool _sirrwlock_unlock(sir_rwlock* rwlock, bool exclusive) {
+    if (_sir_validptr(rwlock)) {
+        if (exclusive)
+            ReleaseSRWLockExclusive(rwlock);
+        else
+            ReleaseSRWLockShared(rwlock);
+        return true;
+    }
+
+    return false;
+}
+
+bool _sirrwlock_destroy(sir_rwlock* rwlock) {
+    /* slim reader/writer locks have nothing to free. */
+    return _sir_validptr(rwlock);
+}
+
 static bool _sirmutex_waitwin32(sir_mutex mutex, DWORD msec) {
     if (_sir_validptr(mutex)) {
         DWORD wait = WaitForSingleObject(mutex, msec);
@@ -43,4 +43,19 @@ bool _sirmutex_unlock(sir_mutex* mutex);
 /** Destroys a mutex. */
 bool _sirmutex_destroy(sir_mutex* mutex);
 
+/** Creates/initializes a new reader/writer lock. Waiting writers take precedence where possible. */
+bool _sirrwlock_create(sir_rwlock* rwlock);
+
+/**
+ * Locks a reader/writer lock, either exclusively (for writing) or shared with
+ * other readers, and waits indefinitely.
+ */
+bool _sirrwlock_lock(sir_rwlock* rwlock, bool exclusive);
+
+/** Unlocks a reader/writer lock previously locked in the same mode. */
+bool _sirrwlock_unlock(sir_rwlock* rwlock, bool exclusive);
+
+/** Destroys a reader/writer lock. */
+bool _sirrwlock_destroy(sir_rwlock* rwlock);
+
 #endif /* !_SIR_MUTEX_H_INCLUDED */
@@ -199,6 +199,7 @@ _set_thread_local_invalid_parameter_handler(
 # include <errno.h>
 # include <stdarg.h>
 # include <stdbool.h>
+# include <stddef.h>
 # include <stdint.h>
 # include <inttypes.h>
 # include <stdio.h>
@@ -221,10 +222,35 @@ _set_thread_local_invalid_parameter_handler(
 #  undef SIR_SYSLOG_ENABLED
 # endif
 
+# if defined(SIR_SYSLOG_ENABLED) && defined(__linux__) && !defined(SIR_NO_JOURNAL)
+#  define SIR_JOURNAL_ENABLED
+# else
+#  undef SIR_JOURNAL_ENABLED
+# endif
+
+# if defined(__linux__) || defined(__FreeBSD__) || defined(__NetBSD__)
+#  define SIR_SENDMMSG
+# else
+#  undef SIR_SENDMMSG
+# endif
+
+# if !defined(__WIN__) && defined(__HAVE_ATOMIC_H__)
+#  define SIR_SHMRING_ENABLED
+# else
+#  undef SIR_SHMRING_ENABLED
+# endif
+
+# if defined(SIR_IOURING) && defined(__linux__)
+#  define SIR_IOURING_ENABLED
+# else
+#  undef SIR_IOURING_ENABLED
+# endif
+
 # define SIR_MAXHOST 256
 
 # if !defined(__WIN__)
 #  include <pthread.h>
+#  include <sched.h>
 #  if defined(__illumos__)
 #   include <sys/fcntl.h>
 #  endif
@@ -251,6 +277,11 @@ _set_thread_local_invalid_parameter_handler(
 #  if defined(SIR_SYSLOG_ENABLED)
 #   include <syslog.h>
 #  endif
+#  include <poll.h>
+#  include <netdb.h>
+#  include <netinet/in.h>
+#  include <sys/socket.h>
+#  include <sys/un.h>
 #  if defined(__BSD__)
 #   if !defined(__NetBSD__)
 #    include <pthread_np.h>
@@ -298,6 +329,25 @@ _set_thread_local_invalid_parameter_handler(
 /** The mutex type. */
 typedef pthread_mutex_t sir_mutex;
 
+/** The reader/writer lock type. */
+typedef pthread_rwlock_t sir_rwlock;
+
+/** The thread handle type. */
+typedef pthread_t sir_thread;
+
+/** The return type of a thread entry point. */
+typedef void* sir_thread_ret;
+
+/** The calling convention of a thread entry point. */
+#  define SIR_THREAD_CALL
+
+/** The event type (auto-reset; see ::_sirevent_wait). */
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    bool signaled;
+} sir_event;
+
 /** The one-time type. */
 typedef pthread_once_t sir_once;
 
@@ -317,6 +367,21 @@ typedef void (*sir_once_fn)(void);
 /** The mutex type. */
 typedef HANDLE sir_mutex;
 
+/** The reader/writer lock type. */
+typedef SRWLOCK sir_rwlock;
+
+/** The thread handle type. */
+typedef uintptr_t sir_thread;
+
+/** The return type of a thread entry point. */
+typedef unsigned sir_thread_ret;
+
+/** The calling convention of a thread entry point. */
+#  define SIR_THREAD_CALL __stdcall
+
+/** The event type (auto-reset; see ::_sirevent_wait). */
+typedef HANDLE sir_event;
+
 /** The one-time type. */
 typedef INIT_ONCE sir_once;
 
@@ -333,6 +398,9 @@ typedef BOOL(CALLBACK* sir_once_fn)(PINIT_ONCE, PVOID, PVOID*);
 
 # endif // !__WIN__
 
+/** The thread entry point type. */
+typedef sir_thread_ret (SIR_THREAD_CALL* sir_thread_fn)(void*);
+
 # if (__STDC_VERSION__ >= 201112 && !defined(__STDC_NO_THREADS__)) || \
      (defined(__SUNPRO_C) || defined(__SUNPRO_CC))
 #  define _sir_thread_local _Thread_local
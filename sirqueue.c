@@ -0,0 +1,200 @@
+/*
+ * sirqueue.c
+ *
+ * Author:    Ryan M. Lederman <lederman@gmail.com>
+ * Copyright: Copyright (c) 2018-2023
+ * Version:   2.2.0
+ * License:   The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "sirqueue.h"
+#include "sirinternal.h"
+#include "sirmutex.h"
+
+#include <stddef.h>
+
+/** Per-slot header; the slot's storage immediately follows it. */
+typedef struct {
+#if defined(__HAVE_ATOMIC_H__)
+    atomic_size_t seq;
+#else
+    size_t seq;
+#endif
+} sirqueue_hdr;
+
+/** Offset of a slot's storage from the start of the slot. */
+#define _SIR_QUEUE_HDRSIZE \
+    ((sizeof(sirqueue_hdr) + _Alignof(max_align_t) - 1) & ~(_Alignof(max_align_t) - 1))
+
+static inline
+sirqueue_hdr* _sir_queue_slot(const sirqueue* q, size_t pos) {
+    return (sirqueue_hdr*)(q->slots + ((pos & q->mask) * q->stride));
+}
+
+static inline
+void* _sir_queue_data(sirqueue_hdr* hdr) {
+    return (unsigned char*)hdr + _SIR_QUEUE_HDRSIZE;
+}
+
+bool _sir_queue_create(sirqueue* q, size_t capacity, size_t elemsize) {
+    if (!_sir_validptr(q))
+        return false;
+
+    if (0 == capacity || 0 == elemsize || capacity > (SIZE_MAX >> 1)) {
+        _sir_seterror(_SIR_E_INVALID);
+        return false;
+    }
+
+    size_t slots = 1;
+    while (slots < capacity)
+        slots <<= 1;
+
+    size_t stride = _SIR_QUEUE_HDRSIZE + elemsize;
+    stride = (stride + _Alignof(max_align_t) - 1) & ~(_Alignof(max_align_t) - 1);
+
+    memset(q, 0, sizeof(sirqueue));
+    q->slots = (unsigned char*)calloc(slots, stride);
+    if (!q->slots) {
+        _sir_handleerr(errno);
+        return false;
+    }
+
+    q->stride = stride;
+    q->mask   = slots - 1;
+
+#if defined(__HAVE_ATOMIC_H__)
+    for (size_t n = 0; n < slots; n++)
+        atomic_init(&_sir_queue_slot(q, n)->seq, n);
+    atomic_init(&q->head, 0);
+#else
+    for (size_t n = 0; n < slots; n++)
+        _sir_queue_slot(q, n)->seq = n;
+
+    if (!_sirmutex_create(&q->mutex)) {
+        _sir_safefree(&q->slots);
+        return false;
+    }
+#endif
+
+    return true;
+}
+
+#if defined(__HAVE_ATOMIC_H__)
+
+void* _sir_queue_reserve(sirqueue* q, size_t* pos) {
+    size_t cur = atomic_load_explicit(&q->head, memory_order_relaxed);
+
+    for (;;) {
+        sirqueue_hdr* hdr = _sir_queue_slot(q, cur);
+        size_t seq        = atomic_load_explicit(&hdr->seq, memory_order_acquire);
+        intptr_t diff     = (intptr_t)seq - (intptr_t)cur;
+
+        if (0 == diff) {
+            if (atomic_compare_exchange_weak_explicit(&q->head, &cur, cur + 1,
+                memory_order_relaxed, memory_order_relaxed)) {
+                *pos = cur;
+                return _sir_queue_data(hdr);
+            }
+        } else if (diff < 0) {
+            return NULL; /* full: the consumer hasn't released this slot yet. */
+        } else {
+            cur = atomic_load_explicit(&q->head, memory_order_relaxed);
+        }
+    }
+}
+
+void _sir_queue_commit(sirqueue* q, size_t pos) {
+    atomic_store_explicit(&_sir_queue_slot(q, pos)->seq, pos + 1, memory_order_release);
+}
+
+void* _sir_queue_peek(sirqueue* q) {
+    sirqueue_hdr* hdr = _sir_queue_slot(q, q->tail);
+    size_t seq        = atomic_load_explicit(&hdr->seq, memory_order_acquire);
+
+    return seq == q->tail + 1 ? _sir_queue_data(hdr) : NULL;
+}
+
+void _sir_queue_release(sirqueue* q) {
+    atomic_store_explicit(&_sir_queue_slot(q, q->tail)->seq, q->tail + q->mask + 1,
+        memory_order_release);
+    q->tail++;
+}
+
+bool _sir_queue_empty(sirqueue* q) {
+    return atomic_load(&q->head) == q->tail;
+}
+
+#else /* !__HAVE_ATOMIC_H__ */
+
+void* _sir_queue_reserve(sirqueue* q, size_t* pos) {
+    void* data = NULL;
+    _sirmutex_lock(&q->mutex);
+
+    sirqueue_hdr* hdr = _sir_queue_slot(q, q->head);
+    if (hdr->seq == q->head) {
+        *pos = q->head++;
+        data = _sir_queue_data(hdr);
+    }
+
+    _sirmutex_unlock(&q->mutex);
+    return data;
+}
+
+void _sir_queue_commit(sirqueue* q, size_t pos) {
+    _sirmutex_lock(&q->mutex);
+    _sir_queue_slot(q, pos)->seq = pos + 1;
+    _sirmutex_unlock(&q->mutex);
+}
+
+void* _sir_queue_peek(sirqueue* q) {
+    _sirmutex_lock(&q->mutex);
+    sirqueue_hdr* hdr = _sir_queue_slot(q, q->tail);
+    void* data = hdr->seq == q->tail + 1 ? _sir_queue_data(hdr) : NULL;
+    _sirmutex_unlock(&q->mutex);
+    return data;
+}
+
+void _sir_queue_release(sirqueue* q) {
+    _sirmutex_lock(&q->mutex);
+    _sir_queue_slot(q, q->tail)->seq = q->tail + q->mask + 1;
+    q->tail++;
+    _sirmutex_unlock(&q->mutex);
+}
+
+bool _sir_queue_empty(sirqueue* q) {
+    _sirmutex_lock(&q->mutex);
+    bool empty = q->head == q->tail;
+    _sirmutex_unlock(&q->mutex);
+    return empty;
+}
+
+#endif // __HAVE_ATOMIC_H__
+
+void _sir_queue_destroy(sirqueue* q) {
+    if (!_sir_validptrnofail(q) || !q->slots)
+        return;
+
+#if !defined(__HAVE_ATOMIC_H__)
+    _sirmutex_destroy(&q->mutex);
+#endif
+
+    _sir_safefree(&q->slots);
+    q->stride = 0;
+    q->mask   = 0;
+}
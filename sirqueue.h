@@ -0,0 +1,93 @@
+/*
+ * sirqueue.h
+ *
+ * Author:    Ryan M. Lederman <lederman@gmail.com>
+ * Copyright: Copyright (c) 2018-2023
+ * Version:   2.2.0
+ * License:   The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef _SIR_QUEUE_H_INCLUDED
+# define _SIR_QUEUE_H_INCLUDED
+
+# include "sirtypes.h"
+
+/**
+ * Bounded multi-producer, single-consumer queue of fixed-size slots.
+ *
+ * Producers reserve a slot, fill it in place, and then commit it; the consumer
+ * peeks at the oldest committed slot, processes it in place, and releases it.
+ * Nothing is copied in or out of the queue by the queue itself.
+ *
+ * When C11 atomics are available, each slot carries a sequence number and
+ * producers claim slots with a single compare-and-swap on the enqueue
+ * position (the bounded queue design popularized by D. Vyukov). Otherwise, a
+ * mutex guards the positions and sequence numbers.
+ */
+typedef struct {
+    unsigned char* slots; /**< Slot storage (capacity * stride bytes). */
+    size_t stride;        /**< Size of one slot, including its header. */
+    size_t mask;          /**< capacity - 1 (capacity is a power of two). */
+# if defined(__HAVE_ATOMIC_H__)
+    atomic_size_t head;   /**< Next position to be reserved by a producer. */
+    char _pad[64];        /**< Keeps producers and the consumer off one cache line. */
+# else
+    size_t head;
+    sir_mutex mutex;
+# endif
+    size_t tail;          /**< Next position to be consumed (consumer only). */
+} sirqueue;
+
+/** Allocates a queue of at least `capacity` slots, each `elemsize` bytes. */
+bool _sir_queue_create(sirqueue* q, size_t capacity, size_t elemsize);
+
+/** Returns the number of slots in the queue. */
+static inline
+size_t _sir_queue_capacity(const sirqueue* q) {
+    return q->mask + 1;
+}
+
+/**
+ * Reserves the next slot for writing. Returns a pointer to the slot's storage
+ * and stores its position in `pos`, or returns `NULL` if the queue is full.
+ */
+void* _sir_queue_reserve(sirqueue* q, size_t* pos);
+
+/** Publishes a slot previously obtained from ::_sir_queue_reserve. */
+void _sir_queue_commit(sirqueue* q, size_t pos);
+
+/**
+ * Returns a pointer to the oldest committed slot, or `NULL` if there is none.
+ * Only the consumer thread may call this.
+ */
+void* _sir_queue_peek(sirqueue* q);
+
+/** Hands the slot returned by ::_sir_queue_peek back to producers. */
+void _sir_queue_release(sirqueue* q);
+
+/**
+ * Determines whether any slots are reserved or committed but not yet released.
+ * Only the consumer thread may call this.
+ */
+bool _sir_queue_empty(sirqueue* q);
+
+/** Frees a queue's storage. */
+void _sir_queue_destroy(sirqueue* q);
+
+#endif /* !_SIR_QUEUE_H_INCLUDED */
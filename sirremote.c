@@ -0,0 +1,580 @@
+/*
+ * sirremote.c
+ *
+ * Author:    Ryan M. Lederman <lederman@gmail.com>
+ * Copyright: Copyright (c) 2018-2023
+ * Version:   2.2.0
+ * License:   The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "sirremote.h"
+#include "sirinternal.h"
+#include "sirhelpers.h"
+#include "sirfilesystem.h"
+#include "sirmutex.h"
+#include "sirthread.h"
+
+#if !defined(__WIN__)
+
+# if defined(MSG_NOSIGNAL)
+#  define _SIR_REMOTE_SENDFLAGS MSG_NOSIGNAL
+# else
+#  define _SIR_REMOTE_SENDFLAGS 0 /* SO_NOSIGPIPE is set on the socket instead. */
+# endif
+
+/** The number of datagrams handed to the kernel in one call. */
+# define _SIR_REMOTE_DGRAMBATCH 32
+
+/** Room left in front of a message for its length (RFC 6587 octet counting). */
+# define _SIR_REMOTE_COUNTROOM 12
+
+/**
+ * Messages waiting for the remote syslog thread, and the thread itself. Each
+ * message is stored preceded by its length and a space, which is how it's
+ * sent over TCP; over UDP, only the message itself is sent.
+ */
+static struct {
+    sir_mutex mutex;
+    sir_event wake;
+    sir_thread thread;
+    bool init;    /**< Started by ::_sir_remote_start, and not stopped since. */
+    bool running; /**< The thread exists (in this process). */
+    bool stop;
+    int fd;       /**< The connection to the collector; only used by the thread. */
+    sir_remote_transport transport;
+    char host[SIR_MAXHOST];
+    char port[SIR_MAXPID];
+    char* queued; /**< Messages waiting to be sent. */
+    size_t queuedlen;
+    char* sending; /**< Messages being sent; only used by the thread. */
+    size_t dropped;
+} _sir_rs = {.fd = -1};
+
+/** Makes a socket non-blocking, and keeps it from child processes. */
+static
+bool _sir_remote_setflags(int fd) {
+    int flags = fcntl(fd, F_GETFL);
+    if (-1 == flags || -1 == fcntl(fd, F_SETFL, flags | O_NONBLOCK) ||
+        -1 == fcntl(fd, F_SETFD, FD_CLOEXEC)) {
+        _sir_handleerr(errno);
+        return false;
+    }
+
+# if !defined(MSG_NOSIGNAL) && defined(SO_NOSIGPIPE)
+    int on = 1;
+    (void)setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+# endif
+
+    return true;
+}
+
+/** Waits up to ::SIR_REMOTE_IOMSEC for the connection to be ready for `events`. */
+static
+bool _sir_remote_waitfd(short events) {
+    struct pollfd pfd = {_sir_rs.fd, events, 0};
+
+    for (;;) {
+        int ready = poll(&pfd, 1, SIR_REMOTE_IOMSEC);
+        if (-1 == ready && EINTR == errno)
+            continue;
+        return ready > 0 && 0 == (pfd.revents & (POLLERR | POLLNVAL));
+    }
+}
+
+/**
+ * Looks up the collector's address(es), and connects to the first that it can
+ * within ::SIR_REMOTE_IOMSEC.
+ */
+static
+bool _sir_remote_connect(void) {
+    struct addrinfo hints = {0};
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SIRRT_TCP == _sir_rs.transport ? SOCK_STREAM : SOCK_DGRAM;
+
+    struct addrinfo* addrs = NULL;
+    int gai = getaddrinfo(_sir_rs.host, _sir_rs.port, &hints, &addrs);
+    if (0 != gai) {
+        _sir_selflog("error: failed to look up '%s' (%s)", _sir_rs.host, gai_strerror(gai));
+        return false;
+    }
+
+    for (const struct addrinfo* ai = addrs; ai && -1 == _sir_rs.fd; ai = ai->ai_next) {
+        _sir_rs.fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (-1 == _sir_rs.fd)
+            continue;
+
+        bool connected = _sir_remote_setflags(_sir_rs.fd);
+        if (connected && 0 != connect(_sir_rs.fd, ai->ai_addr, ai->ai_addrlen)) {
+            int err = 0;
+            socklen_t errlen = sizeof(err);
+            connected = EINPROGRESS == errno && _sir_remote_waitfd(POLLOUT) &&
+                0 == getsockopt(_sir_rs.fd, SOL_SOCKET, SO_ERROR, &err, &errlen) && 0 == err;
+        }
+
+        if (!connected) {
+            (void)close(_sir_rs.fd);
+            _sir_rs.fd = -1;
+        }
+    }
+
+    freeaddrinfo(addrs);
+
+    if (-1 == _sir_rs.fd) {
+        _sir_selflog("failed to connect to %s:%s", _sir_rs.host, _sir_rs.port);
+        return false;
+    }
+
+    _sir_selflog("connected to %s:%s (fd: %d)", _sir_rs.host, _sir_rs.port, _sir_rs.fd);
+    return true;
+}
+
+/** Parses the length in front of a queued message; returns where the message starts. */
+static inline
+size_t _sir_remote_parsecount(const char* record, size_t* msglen) {
+    size_t pos = 0;
+    *msglen = 0;
+
+    while (' ' != record[pos])
+        *msglen = (*msglen * 10) + (size_t)(record[pos++] - '0');
+
+    return pos + 1;
+}
+
+/** Returns where the message that contains offset `at` of `data` starts. */
+static
+size_t _sir_remote_recordstart(const char* data, size_t at) {
+    size_t pos = 0;
+
+    for (;;) {
+        size_t msglen = 0;
+        size_t next   = pos + _sir_remote_parsecount(data + pos, &msglen) + msglen;
+        if (next > at)
+            return pos;
+        pos = next;
+    }
+}
+
+/**
+ * Determines whether the collector has closed the TCP connection. Checked
+ * before sending, since whatever is sent into a closed connection is lost.
+ */
+static
+bool _sir_remote_peerclosed(void) {
+    struct pollfd pfd = {_sir_rs.fd, POLLIN, 0};
+    if (poll(&pfd, 1, 0) <= 0)
+        return false;
+
+    if (0 != (pfd.revents & (POLLERR | POLLHUP | POLLNVAL)))
+        return true;
+
+    char peek = 0;
+    ssize_t ret = recv(_sir_rs.fd, &peek, 1, MSG_PEEK);
+    return 0 == ret || (-1 == ret && EAGAIN != errno && EWOULDBLOCK != errno);
+}
+
+/** Sends `data` over TCP, from offset `*sent` on, in as few calls as it takes. */
+static
+bool _sir_remote_sendstream(const char* data, size_t len, size_t* sent) {
+    if (_sir_remote_peerclosed()) {
+        _sir_selflog("connection closed by %s:%s", _sir_rs.host, _sir_rs.port);
+        return false;
+    }
+
+    while (*sent < len) {
+        ssize_t ret = send(_sir_rs.fd, data + *sent, len - *sent, _SIR_REMOTE_SENDFLAGS);
+        if (-1 == ret) {
+            if (EINTR == errno)
+                continue;
+            if ((EAGAIN == errno || EWOULDBLOCK == errno) && _sir_remote_waitfd(POLLOUT))
+                continue;
+
+            _sir_selflog("error: failed to send to %s:%s (%d)", _sir_rs.host, _sir_rs.port, errno);
+            return false;
+        }
+
+        *sent += (size_t)ret;
+    }
+
+    return true;
+}
+
+/** Sends the messages in `data`, from offset `*sent` on, over UDP: one datagram each. */
+static
+bool _sir_remote_senddgrams(const char* data, size_t len, size_t* sent) {
+    while (*sent < len) {
+        struct iovec iov[_SIR_REMOTE_DGRAMBATCH];
+        size_t ends[_SIR_REMOTE_DGRAMBATCH];
+        size_t count = 0;
+
+        for (size_t pos = *sent; pos < len && count < _SIR_REMOTE_DGRAMBATCH; count++) {
+            size_t msglen = 0;
+            pos += _sir_remote_parsecount(data + pos, &msglen);
+            iov[count].iov_base = (void*)(data + pos);
+            iov[count].iov_len  = msglen;
+            pos += msglen;
+            ends[count] = pos;
+        }
+
+# if defined(SIR_SENDMMSG)
+        struct mmsghdr msgs[_SIR_REMOTE_DGRAMBATCH];
+        memset(msgs, 0, sizeof(struct mmsghdr) * count);
+        for (size_t n = 0; n < count; n++) {
+            msgs[n].msg_hdr.msg_iov    = &iov[n];
+            msgs[n].msg_hdr.msg_iovlen = 1;
+        }
+
+        int ret = sendmmsg(_sir_rs.fd, msgs, (unsigned int)count, _SIR_REMOTE_SENDFLAGS);
+# else
+        int ret = -1 == send(_sir_rs.fd, iov[0].iov_base, iov[0].iov_len,
+            _SIR_REMOTE_SENDFLAGS) ? -1 : 1;
+# endif
+        if (ret > 0) {
+            *sent = ends[ret - 1];
+            continue;
+        }
+
+        if (EINTR == errno)
+            continue;
+        if ((EAGAIN == errno || EWOULDBLOCK == errno || ENOBUFS == errno) &&
+            _sir_remote_waitfd(POLLOUT))
+            continue;
+        if (EAGAIN == errno || EWOULDBLOCK == errno || ENOBUFS == errno)
+            return false;
+
+        /* e.g. ECONNREFUSED, left behind by an earlier datagram that nobody was
+         * listening for. the datagram is dropped, as it might have been anyway. */
+        _sir_selflog("failed to send datagram to %s:%s (%d); dropping it", _sir_rs.host,
+            _sir_rs.port, errno);
+        *sent = ends[0];
+    }
+
+    return true;
+}
+
+/**
+ * Formats an RFC 5424 message, preceded by its length and a space, somewhere
+ * in `out`. Returns where it starts in `*record`, and the length of the whole.
+ */
+static
+size_t _sir_remote_frame(char* out, const char** record, sir_level level,
+    const sirbuf* buf, const sir_remote_dest* ctx) {
+    char stamp[SIR_MAXTIME] = "-";
+
+    if (!_sir_bittest(ctx->opts, SIRO_NOTIME)) {
+        time_t now = -1 != buf->now ? buf->now : time(NULL);
+        struct tm tm = {0};
+        if (!gmtime_r(&now, &tm))
+            return 0;
+
+        size_t len = strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%S", &tm);
+        if (0 == len)
+            return 0;
+
+        /* buf->msec is the separator, then three digits. */
+        if (!_sir_bittest(ctx->opts, SIRO_NOMSEC) && '\0' != buf->msec[0])
+            (void)snprintf(stamp + len, sizeof(stamp) - len, ".%sZ", buf->msec + 1);
+        else
+            (void)snprintf(stamp + len, sizeof(stamp) - len, "Z");
+    }
+
+    const char* host = !_sir_bittest(ctx->opts, SIRO_NOHOST) &&
+        _sir_validstrnofail(buf->hostname) ? buf->hostname : "-";
+    const char* app = !_sir_bittest(ctx->opts, SIRO_NONAME) &&
+        _sir_validstrnofail(ctx->identity) ? ctx->identity : "-";
+    const char* pid = !_sir_bittest(ctx->opts, SIRO_NOPID) &&
+        _sir_validstrnofail(buf->pid) ? buf->pid : "-";
+
+    /* facility 1 (user); severities count up from 0 (emergency), as levels do.
+     * there's no MSGID or STRUCTURED-DATA. */
+    char* msg = out + _SIR_REMOTE_COUNTROOM;
+    size_t room = SIR_REMOTE_MAXRECORD - _SIR_REMOTE_COUNTROOM;
+    int print = snprintf(msg, room, "<%zu>1 %s %s %s %s - - %s",
+        8 + _sir_levelindex(level), stamp, host, app, pid, buf->message);
+    if (print <= 0)
+        return 0;
+
+    size_t msglen = (size_t)print < room ? (size_t)print : room - 1;
+    char count[_SIR_REMOTE_COUNTROOM + 1] = {0};
+    int countlen = snprintf(count, sizeof(count), "%zu ", msglen);
+    if (countlen <= 0 || countlen > _SIR_REMOTE_COUNTROOM)
+        return 0;
+
+    memcpy(msg - countlen, count, (size_t)countlen);
+    *record = msg - countlen;
+    return (size_t)countlen + msglen;
+}
+
+bool _sir_remote_start(sir_remote_dest* dest, const char* name) {
+    if (!_sir_validptr(dest) || !_sir_validstr(dest->host))
+        return false;
+
+    if (_sir_rs.init) {
+        _sir_seterror(_SIR_E_ALREADY);
+        return false;
+    }
+
+    if (!_sir_validstrnofail(dest->identity)) {
+        if (_sir_validstrnofail(name)) {
+            _sir_strncpy(dest->identity, SIR_MAX_SYSLOG_ID, name, strnlen(name, SIR_MAX_SYSLOG_ID));
+        } else {
+            char* appbasename = _sir_getappbasename();
+            const char* ident = _sir_validstrnofail(appbasename) ? appbasename
+                : SIR_FALLBACK_SYSLOG_ID;
+            _sir_strncpy(dest->identity, SIR_MAX_SYSLOG_ID, ident, strnlen(ident, SIR_MAX_SYSLOG_ID));
+            _sir_safefree(&appbasename);
+        }
+    }
+
+    _sir_rs.queued  = (char*)malloc(SIR_REMOTE_BUFSIZE);
+    _sir_rs.sending = (char*)malloc(SIR_REMOTE_BUFSIZE);
+    if (!_sir_rs.queued || !_sir_rs.sending) {
+        _sir_handleerr(errno);
+        _sir_safefree(&_sir_rs.queued);
+        _sir_safefree(&_sir_rs.sending);
+        return false;
+    }
+
+    if (!_sirmutex_create(&_sir_rs.mutex) || !_sirevent_create(&_sir_rs.wake)) {
+        _sir_safefree(&_sir_rs.queued);
+        _sir_safefree(&_sir_rs.sending);
+        return false;
+    }
+
+    dest->host[SIR_MAXHOST - 1] = '\0';
+    memcpy(_sir_rs.host, dest->host, SIR_MAXHOST);
+    (void)snprintf(_sir_rs.port, SIR_MAXPID, "%u",
+        0 != dest->port ? (unsigned int)dest->port : (unsigned int)SIR_REMOTE_PORT);
+
+    _sir_rs.transport = dest->transport;
+    _sir_rs.fd        = -1;
+    _sir_rs.queuedlen = 0;
+    _sir_rs.dropped   = 0;
+    _sir_rs.stop      = false;
+    _sir_rs.init      = true;
+
+    _sir_rs.running = _sirthread_create(&_sir_rs.thread, _sir_remote_worker, NULL);
+    if (!_sir_rs.running) {
+        (void)_sir_remote_stop();
+        return false;
+    }
+
+    _sir_selflog("sending to %s:%s over %s as '%s'", _sir_rs.host, _sir_rs.port,
+        SIRRT_TCP == _sir_rs.transport ? "TCP" : "UDP", dest->identity);
+    return true;
+}
+
+bool _sir_remote_write(sir_level level, const sirbuf* buf, const sir_remote_dest* ctx) {
+    if (!_sir_validptr(buf) || !_sir_validptr(ctx))
+        return false;
+
+    char out[SIR_REMOTE_MAXRECORD];
+    const char* record = NULL;
+    size_t len = _sir_remote_frame(out, &record, level, buf, ctx);
+    if (0 == len) {
+        _sir_seterror(_SIR_E_INTERNAL);
+        return false;
+    }
+
+    if (!_sir_rs.init || !_sirmutex_lock(&_sir_rs.mutex)) {
+        _sir_seterror(_SIR_E_INVALID);
+        return false;
+    }
+
+    /* in a forked child, the thread has to be started again. */
+    if (!_sir_rs.running && !_sir_rs.stop)
+        _sir_rs.running = _sirthread_create(&_sir_rs.thread, _sir_remote_worker, NULL);
+
+    bool wake = 0 == _sir_rs.queuedlen;
+    if (_sir_rs.queuedlen + len <= SIR_REMOTE_BUFSIZE) {
+        memcpy(_sir_rs.queued + _sir_rs.queuedlen, record, len);
+        _sir_rs.queuedlen += len;
+    } else {
+        wake = false;
+        _sir_rs.dropped++;
+    }
+
+    (void)_sirmutex_unlock(&_sir_rs.mutex);
+
+    if (wake)
+        (void)_sirevent_signal(&_sir_rs.wake);
+
+    return true;
+}
+
+bool _sir_remote_stop(void) {
+    if (!_sir_rs.init)
+        return true;
+
+    bool running = false;
+    if (_sirmutex_lock(&_sir_rs.mutex)) {
+        _sir_rs.stop = true;
+        running      = _sir_rs.running;
+        (void)_sirmutex_unlock(&_sir_rs.mutex);
+    }
+
+    bool joined = true;
+    if (running) {
+        (void)_sirevent_signal(&_sir_rs.wake);
+        joined = _sirthread_join(&_sir_rs.thread);
+        _sir_selflog("remote syslog thread %s", joined ? "stopped" : "failed to stop!");
+    }
+
+    if (0 != _sir_rs.dropped)
+        _sir_selflog("%zu message(s) were dropped; the buffer was full", _sir_rs.dropped);
+
+    _sir_safefree(&_sir_rs.queued);
+    _sir_safefree(&_sir_rs.sending);
+    (void)_sirevent_destroy(&_sir_rs.wake);
+    (void)_sirmutex_destroy(&_sir_rs.mutex);
+
+    _sir_rs.running = false;
+    _sir_rs.stop    = false;
+    _sir_rs.init    = false;
+    return joined;
+}
+
+void _sir_remote_atfork_child(void) {
+    if (!_sir_rs.init)
+        return;
+
+    /* the connection is the parent's to use; the child makes its own. */
+    if (-1 != _sir_rs.fd) {
+        (void)close(_sir_rs.fd);
+        _sir_rs.fd = -1;
+    }
+
+    (void)_sirmutex_create(&_sir_rs.mutex);
+    (void)_sirevent_create(&_sir_rs.wake);
+    _sir_rs.running   = false;
+    _sir_rs.queuedlen = 0;
+}
+
+sir_thread_ret SIR_THREAD_CALL _sir_remote_worker(void* arg) {
+    _SIR_UNUSED(arg);
+
+    uint32_t backoff = SIR_REMOTE_MINBACKOFF;
+    uint64_t retryat = 0;
+    size_t len       = 0; /* bytes in `sending`. */
+    size_t sent      = 0; /* of those, bytes that have been sent. */
+
+    for (;;) {
+        bool stop = true;
+        if (_sirmutex_lock(&_sir_rs.mutex)) {
+            /* take everything queued so far, to send in as few calls as possible;
+             * logging threads carry on queueing in the other buffer meanwhile. */
+            if (0 == len && 0 != _sir_rs.queuedlen) {
+                char* swap        = _sir_rs.sending;
+                _sir_rs.sending   = _sir_rs.queued;
+                _sir_rs.queued    = swap;
+                len               = _sir_rs.queuedlen;
+                sent              = 0;
+                _sir_rs.queuedlen = 0;
+            }
+
+            stop = _sir_rs.stop;
+            (void)_sirmutex_unlock(&_sir_rs.mutex);
+        }
+
+        if (0 == len) {
+            if (stop)
+                break;
+            (void)_sirevent_wait(&_sir_rs.wake, SIR_REMOTE_MAXBACKOFF);
+            continue;
+        }
+
+        if (-1 == _sir_rs.fd) {
+            /* when stopping, there's one last attempt, right away. */
+            uint64_t now = _sir_msectime();
+            if (!stop && now < retryat) {
+                (void)_sirevent_wait(&_sir_rs.wake, (uint32_t)(retryat - now));
+                continue;
+            }
+
+            if (!_sir_remote_connect()) {
+                if (stop)
+                    break;
+
+                retryat = _sir_msectime() + backoff;
+                _sir_selflog("retrying in %" PRIu32 " msec", backoff);
+                backoff = backoff < SIR_REMOTE_MAXBACKOFF / 2 ? backoff * 2 : SIR_REMOTE_MAXBACKOFF;
+                continue;
+            }
+
+            backoff = SIR_REMOTE_MINBACKOFF;
+        }
+
+        bool delivered = SIRRT_TCP == _sir_rs.transport
+            ? _sir_remote_sendstream(_sir_rs.sending, len, &sent)
+            : _sir_remote_senddgrams(_sir_rs.sending, len, &sent);
+
+        if (delivered) {
+            len = 0;
+            continue;
+        }
+
+        /* the connection was lost, or stalled. reconnect right away (backing off
+         * if that fails), and send again any message that only got out in part. */
+        (void)close(_sir_rs.fd);
+        _sir_rs.fd = -1;
+        retryat    = 0;
+        sent       = _sir_remote_recordstart(_sir_rs.sending, sent);
+
+        if (stop)
+            break;
+    }
+
+    if (len > sent)
+        _sir_selflog("%zu byte(s) of messages could not be sent", len - sent);
+
+    if (-1 != _sir_rs.fd) {
+        (void)close(_sir_rs.fd);
+        _sir_rs.fd = -1;
+    }
+
+    return (sir_thread_ret)0;
+}
+
+#else /* __WIN__ */
+bool _sir_remote_start(sir_remote_dest* dest, const char* name) {
+    _SIR_UNUSED(dest);
+    _SIR_UNUSED(name);
+    _sir_seterror(_SIR_E_UNAVAIL);
+    return false;
+}
+
+bool _sir_remote_write(sir_level level, const sirbuf* buf, const sir_remote_dest* ctx) {
+    _SIR_UNUSED(level);
+    _SIR_UNUSED(buf);
+    _SIR_UNUSED(ctx);
+    _sir_seterror(_SIR_E_UNAVAIL);
+    return false;
+}
+
+bool _sir_remote_stop(void) {
+    return true;
+}
+
+void _sir_remote_atfork_child(void) {
+}
+
+sir_thread_ret SIR_THREAD_CALL _sir_remote_worker(void* arg) {
+    _SIR_UNUSED(arg);
+    return (sir_thread_ret)0;
+}
+#endif /* !__WIN__ */
@@ -0,0 +1,63 @@
+/*
+ * sirremote.h
+ *
+ * Author:    Ryan M. Lederman <lederman@gmail.com>
+ * Copyright: Copyright (c) 2018-2023
+ * Version:   2.2.0
+ * License:   The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef _SIR_REMOTE_H_INCLUDED
+# define _SIR_REMOTE_H_INCLUDED
+
+# include "sirtypes.h"
+
+/**
+ * Resolves the identity of the remote syslog destination `dest` (falling back
+ * to `name`, then the file name of the application), and starts the thread
+ * that connects and sends messages to its collector. Connecting (and looking
+ * up the collector's address) is left to that thread.
+ */
+bool _sir_remote_start(sir_remote_dest* dest, const char* name);
+
+/**
+ * Formats a message as RFC 5424 specifies, and queues it for the remote syslog
+ * thread. Never waits on the network: if the collector can't keep up, or
+ * can't be reached, messages that don't fit in ::SIR_REMOTE_BUFSIZE bytes are
+ * dropped.
+ */
+bool _sir_remote_write(sir_level level, const sirbuf* buf, const sir_remote_dest* ctx);
+
+/**
+ * Stops the remote syslog thread, after it has made one last attempt to send
+ * the messages still queued.
+ */
+bool _sir_remote_stop(void);
+
+/**
+ * Forgets the remote syslog thread, which does not exist in a forked child,
+ * and the messages queued in the parent. A new thread, with a connection of
+ * its own, is started when the child logs its first message.
+ */
+void _sir_remote_atfork_child(void);
+
+/** Remote syslog thread: connects to the collector, and sends queued messages. */
+sir_thread_ret SIR_THREAD_CALL _sir_remote_worker(void* arg);
+
+#endif /* !_SIR_REMOTE_H_INCLUDED */
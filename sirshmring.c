@@ -0,0 +1,639 @@
+/*
+ * sirshmring.c
+ *
+ * Author:    Ryan M. Lederman <lederman@gmail.com>
+ * Copyright: Copyright (c) 2018-2023
+ * Version:   2.2.0
+ * License:   The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "sirshmring.h"
+#include "sirdest.h"
+#include "sirinternal.h"
+#include "sirhelpers.h"
+#include "sirthread.h"
+
+#if defined(SIR_SHMRING_ENABLED)
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <sys/file.h>
+# include <signal.h>
+
+/** Set in a ring's header ("sirR") once the process that created it has set it up. */
+# define _SIR_SHMRING_MAGIC 0x73697252U
+
+/** A record's header is one 64-bit word; records start on multiples of its size. */
+# define _SIR_SHMREC_HDRSIZE 8
+
+/** The longest message a record can hold (its length has 24 bits). */
+# define _SIR_SHMREC_MAXLEN 0xffffffU
+
+/** A message follows the record's header. */
+# define _SIR_SHMREC_MSG 0x01
+
+/** The record is unused space, up to the end of the ring. */
+# define _SIR_SHMREC_PAD 0x02
+
+/** The record's space is reserved, but its message is not yet written. */
+# define _SIR_SHMREC_RESERVED 0x04
+
+/** The consumer gave up on a reserved record; its writer may still write to it. */
+# define _SIR_SHMREC_SKIPPED 0x08
+
+/** The writer of a skipped record has found out, and no longer writes to it. */
+# define _SIR_SHMREC_ABANDONED 0x10
+
+/**
+ * The start of a ring's mapping; the messages follow it. Positions only ever
+ * increase; a position's offset in the ring is the position modulo its size.
+ *
+ * Each word of free space says which lap of the ring it is free for. A writer
+ * reserves space by swapping the word at `head` for the record's header, which
+ * says how long the record is and which process reserved it, and then moves
+ * `head` past the record (any other writer, or the consumer, does that for it
+ * if it doesn't get to it). Once it has copied the message in, it swaps the
+ * header for the final one, which is the only sign to the consumer that the
+ * message is complete.
+ *
+ * The consumer reads records in order from `read`. A record whose writer has
+ * died, or that has been reserved for too long, is marked as skipped, and the
+ * records after it are read. Behind it, `tail` follows, marking the space of
+ * each record as free for the next lap; that is the only sign to writers that
+ * the space may be reused. It stops at a skipped record until the writer has
+ * found out (or has died), so that a writer that was only stopped never writes
+ * to space that has been reused.
+ */
+typedef struct {
+    atomic_uint_fast32_t magic;
+    uint32_t size;                /**< Size of the message area; a power of two. */
+    atomic_uint_fast64_t head;    /**< Next position to be reserved by a writer. */
+    char _pad0[64];               /**< Keeps writers and the consumer off one cache line. */
+    atomic_uint_fast64_t tail;    /**< Start of the space that isn't free yet. */
+    atomic_uint_fast64_t read;    /**< Next position to be read by the consumer. */
+    atomic_uint_fast64_t dropped; /**< Messages dropped because the ring was full. */
+    char _pad1[64];
+} sir_shmring_hdr;
+
+/** The size of a ring's header, rounded up so that its messages start on a cache line. */
+# define _SIR_SHMRING_HDRSIZE ((sizeof(sir_shmring_hdr) + 63) & ~(size_t)63)
+
+struct sir_shmring {
+    sir_shmring_hdr* hdr;
+    unsigned char* data;
+    size_t mapsize;
+    uint64_t mask;
+    int fd;              /**< Kept open (and locked) by the consumer. */
+    uint64_t stallpos;   /**< Where the consumer found a record reserved, but not written. */
+    uint64_t stallsince; /**< When it did (0 if it didn't). */
+};
+
+/** Returns the header of the record at `pos`. */
+static inline
+atomic_uint_fast64_t* _sir_shmrec_hdr(const sir_shmring* ring, uint64_t pos) {
+    return (atomic_uint_fast64_t*)(ring->data + (pos & ring->mask));
+}
+
+/**
+ * Makes a record's header: its flags in the low byte, then the length of its
+ * message, and in the high half, the message's level (once it is written), or
+ * the ID of the process that reserved it (until then).
+ */
+static inline
+uint64_t _sir_shmrec_make(size_t len, uint32_t high, uint8_t flags) {
+    return ((uint64_t)high << 32) | ((uint64_t)len << 8) | flags;
+}
+
+static inline
+uint8_t _sir_shmrec_flags(uint64_t rec) {
+    return (uint8_t)(rec & 0xff);
+}
+
+static inline
+size_t _sir_shmrec_len(uint64_t rec) {
+    return (size_t)((rec >> 8) & _SIR_SHMREC_MAXLEN);
+}
+
+static inline
+uint32_t _sir_shmrec_high(uint64_t rec) {
+    return (uint32_t)(rec >> 32);
+}
+
+/**
+ * Returns what a word of free space at `pos` holds. Neither a record's header
+ * (whose flags are never 0) nor any word of a message (whose first byte is
+ * never 0) can be mistaken for it, so a writer that is behind the times can't
+ * reserve space at a position `head` has moved past.
+ */
+static inline
+uint64_t _sir_shmrec_free(const sir_shmring* ring, uint64_t pos) {
+    return ((pos / (ring->mask + 1)) & 0xffffffffffffULL) << 8;
+}
+
+/** Returns the space taken up by a record holding a message of `len` bytes. */
+static inline
+uint64_t _sir_shmrec_size(size_t len) {
+    return (_SIR_SHMREC_HDRSIZE + len + (_SIR_SHMREC_HDRSIZE - 1)) &
+        ~(uint64_t)(_SIR_SHMREC_HDRSIZE - 1);
+}
+
+/** Makes a POSIX shared memory object name ("/name") from a ring name. */
+static
+bool _sir_shmring_path(const char* name, char* path) {
+    if (!_sir_validstr(name))
+        return false;
+
+    const char* base = '/' == *name ? name + 1 : name;
+    if ('\0' == *base || NULL != strchr(base, '/')) {
+        _sir_seterror(_SIR_E_INVALID);
+        return false;
+    }
+
+    int len = snprintf(path, SIR_MAXPATH, "/%s", base);
+    if (len < 0 || len >= SIR_MAXPATH) {
+        _sir_handleerr(ENAMETOOLONG);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Waits for the process that created a ring to size it and set up its
+ * header; on return, `*mapsize` is the size of the whole mapping.
+ */
+static
+bool _sir_shmring_waitsize(int fd, size_t* mapsize) {
+    for (uint32_t waited = 0; waited < SIR_SHMRING_STALLMSEC; waited++) {
+        struct stat st;
+        if (0 != fstat(fd, &st)) {
+            _sir_handleerr(errno);
+            return false;
+        }
+
+        if ((size_t)st.st_size > _SIR_SHMRING_HDRSIZE) {
+            *mapsize = (size_t)st.st_size;
+            return true;
+        }
+
+        _sirthread_sleep(1);
+    }
+
+    _sir_selflog("error: shared-memory ring was never set up by its creator");
+    _sir_seterror(_SIR_E_UNAVAIL);
+    return false;
+}
+
+sir_shmring* _sir_shmring_open(const char* name, bool consumer) {
+    char path[SIR_MAXPATH] = {0};
+    if (!_sir_shmring_path(name, path))
+        return NULL;
+
+    /* the ring is shared with other processes, so its atomics mustn't be locks. */
+    atomic_uint_fast64_t probe;
+    atomic_init(&probe, 0);
+    if (!atomic_is_lock_free(&probe)) {
+        _sir_seterror(_SIR_E_UNAVAIL);
+        return NULL;
+    }
+
+    bool created = true;
+    int fd       = shm_open(path, O_RDWR | O_CREAT | O_EXCL, SIR_SHMRING_MODE);
+    if (-1 == fd && EEXIST == errno) {
+        created = false;
+        fd      = shm_open(path, O_RDWR, 0);
+    }
+
+    if (-1 == fd) {
+        _sir_handleerr(errno);
+        return NULL;
+    }
+
+    /* where flock() works on shared memory, it keeps a second consumer out. */
+    if (consumer && -1 == flock(fd, LOCK_EX | LOCK_NB) && EWOULDBLOCK == errno) {
+        _sir_selflog("error: shared-memory ring '%s' already has a consumer", path);
+        _sir_handleerr(errno);
+        (void)close(fd);
+        return NULL;
+    }
+
+    size_t mapsize = _SIR_SHMRING_HDRSIZE + SIR_SHMRING_SIZE;
+    if (created && 0 != ftruncate(fd, (off_t)mapsize)) {
+        _sir_handleerr(errno);
+        (void)close(fd);
+        (void)shm_unlink(path);
+        return NULL;
+    }
+
+    if (!created && !_sir_shmring_waitsize(fd, &mapsize)) {
+        (void)close(fd);
+        return NULL;
+    }
+
+    void* map = mmap(NULL, mapsize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (MAP_FAILED == map) {
+        _sir_handleerr(errno);
+        (void)close(fd);
+        if (created)
+            (void)shm_unlink(path);
+        return NULL;
+    }
+
+    sir_shmring_hdr* hdr = (sir_shmring_hdr*)map;
+    if (created) {
+        /* ftruncate() zeroed the rest. */
+        hdr->size = SIR_SHMRING_SIZE;
+        atomic_store(&hdr->magic, _SIR_SHMRING_MAGIC);
+    } else {
+        uint32_t waited = 0;
+        while (_SIR_SHMRING_MAGIC != atomic_load(&hdr->magic) && waited++ < SIR_SHMRING_STALLMSEC)
+            _sirthread_sleep(1);
+
+        if (_SIR_SHMRING_MAGIC != atomic_load(&hdr->magic) || 0 == hdr->size ||
+            0 != (hdr->size & (hdr->size - 1)) || _SIR_SHMRING_HDRSIZE + hdr->size != mapsize) {
+            _sir_selflog("error: '%s' is not a shared-memory ring (or was never set up)", path);
+            _sir_seterror(_SIR_E_INVALID);
+            (void)munmap(map, mapsize);
+            (void)close(fd);
+            return NULL;
+        }
+    }
+
+    sir_shmring* ring = (sir_shmring*)calloc(1, sizeof(sir_shmring));
+    if (!ring) {
+        _sir_handleerr(errno);
+        (void)munmap(map, mapsize);
+        (void)close(fd);
+        return NULL;
+    }
+
+    ring->hdr     = hdr;
+    ring->data    = (unsigned char*)map + _SIR_SHMRING_HDRSIZE;
+    ring->mapsize = mapsize;
+    ring->mask    = (uint64_t)hdr->size - 1;
+    ring->fd      = -1;
+
+    /* writers don't need the descriptor once it's mapped. */
+    if (consumer)
+        ring->fd = fd;
+    else
+        (void)close(fd);
+
+    _sir_selflog("%s shared-memory ring '%s' (%" PRIu32 " bytes) as %s", created ? "created" : "opened",
+        path, hdr->size, consumer ? "consumer" : "writer");
+    return ring;
+}
+
+/**
+ * Moves `head` past the record reserved at `pos`, whose header is `rec`, if
+ * the writer that reserved it hasn't already (it may have died in between).
+ */
+static inline
+void _sir_shmring_pass(sir_shmring* ring, uint64_t pos, uint64_t rec) {
+    uint64_t expected = pos;
+    (void)atomic_compare_exchange_strong_explicit(&ring->hdr->head, &expected,
+        pos + _sir_shmrec_size(_sir_shmrec_len(rec)), memory_order_release, memory_order_relaxed);
+}
+
+char* _sir_shmring_reserve(sir_shmring* ring, size_t len, uint64_t* pos) {
+    uint64_t size = ring->mask + 1;
+    uint64_t need = _sir_shmrec_size(len);
+    if (len > _SIR_SHMREC_MAXLEN || need > size / 2) {
+        _sir_seterror(_SIR_E_INVALID);
+        return NULL;
+    }
+
+    sir_shmring_hdr* hdr = ring->hdr;
+    uint32_t pid         = (uint32_t)_sir_getpid();
+
+    for (;;) {
+        uint64_t head = atomic_load_explicit(&hdr->head, memory_order_acquire);
+        uint64_t tail = atomic_load_explicit(&hdr->tail, memory_order_acquire);
+        if (tail > head)
+            continue; /* other writers have moved on since `head` was read. */
+
+        /* a record doesn't wrap around; the space left at the end is padding. */
+        uint64_t off = head & ring->mask;
+        uint64_t pad = off + need > size ? size - off : 0;
+
+        if (head + pad + need - tail > size) {
+            atomic_fetch_add_explicit(&hdr->dropped, 1, memory_order_relaxed);
+            return NULL;
+        }
+
+        uint64_t rec = 0 != pad
+            ? _sir_shmrec_make((size_t)(pad - _SIR_SHMREC_HDRSIZE), 0, _SIR_SHMREC_PAD)
+            : _sir_shmrec_make(len, pid, _SIR_SHMREC_RESERVED);
+
+        uint64_t expected = _sir_shmrec_free(ring, head);
+        if (atomic_compare_exchange_strong_explicit(_sir_shmrec_hdr(ring, head), &expected, rec,
+            memory_order_acq_rel, memory_order_acquire)) {
+            _sir_shmring_pass(ring, head, rec);
+            if (0 != pad)
+                continue;
+
+            *pos = head;
+            return (char*)ring->data + off + _SIR_SHMREC_HDRSIZE;
+        }
+
+        /* another writer got there first, but may not have moved `head` on. */
+        if (_sir_bittest(_sir_shmrec_flags(expected), _SIR_SHMREC_RESERVED) ||
+            _sir_bittest(_sir_shmrec_flags(expected), _SIR_SHMREC_PAD))
+            _sir_shmring_pass(ring, head, expected);
+    }
+}
+
+bool _sir_shmring_commit(sir_shmring* ring, uint64_t pos, sir_level level) {
+    atomic_uint_fast64_t* hdr = _sir_shmrec_hdr(ring, pos);
+
+    /* the consumer only changes it meanwhile if it gives up on the message. */
+    uint64_t rec = atomic_load_explicit(hdr, memory_order_relaxed);
+    rec = _sir_shmrec_make(_sir_shmrec_len(rec), _sir_shmrec_high(rec), _SIR_SHMREC_RESERVED);
+    if (atomic_compare_exchange_strong_explicit(hdr, &rec,
+        _sir_shmrec_make(_sir_shmrec_len(rec), (uint32_t)level, _SIR_SHMREC_MSG),
+        memory_order_release, memory_order_relaxed))
+        return true;
+
+    /* the space can be reused now; it was counted as dropped when it was skipped. */
+    atomic_store_explicit(hdr, _sir_shmrec_make(_sir_shmrec_len(rec), _sir_shmrec_high(rec),
+        _SIR_SHMREC_ABANDONED), memory_order_release);
+    return false;
+}
+
+bool _sir_shmring_write(sir_shmring* ring, sir_level level, const char* msg, size_t len) {
+    SIR_ASSERT(NULL == memchr(msg, '\0', len));
+
+    uint64_t pos = 0;
+    char* data   = _sir_shmring_reserve(ring, len, &pos);
+    if (!data)
+        return false;
+
+    memcpy(data, msg, len);
+    return _sir_shmring_commit(ring, pos, level);
+}
+
+/** Determines whether the process that reserved a record might still write to it. */
+static inline
+bool _sir_shmring_writeralive(uint64_t rec) {
+    pid_t pid = (pid_t)_sir_shmrec_high(rec);
+    return 0 == kill(pid, 0) || EPERM == errno;
+}
+
+/** Marks the ring as free for the next lap from `tail` up to `end`, and moves `tail` there. */
+static
+void _sir_shmring_free(sir_shmring* ring, uint64_t tail, uint64_t end) {
+    uint64_t next = _sir_shmrec_free(ring, tail + ring->mask + 1);
+    for (uint64_t pos = tail; pos < end; pos += _SIR_SHMREC_HDRSIZE) {
+        if (0 == (pos & ring->mask) && pos != tail)
+            next = _sir_shmrec_free(ring, pos + ring->mask + 1);
+        atomic_store_explicit(_sir_shmrec_hdr(ring, pos), next, memory_order_relaxed);
+    }
+
+    atomic_store_explicit(&ring->hdr->tail, end, memory_order_release);
+}
+
+/**
+ * Frees the space of the records the consumer is done with, up to the first
+ * one that was skipped, but may still be written to.
+ */
+static
+void _sir_shmring_release(sir_shmring* ring, uint64_t read) {
+    uint64_t size = ring->mask + 1;
+    uint64_t tail = atomic_load_explicit(&ring->hdr->tail, memory_order_relaxed);
+
+    while (tail < read) {
+        uint64_t rec     = atomic_load_explicit(_sir_shmrec_hdr(ring, tail), memory_order_acquire);
+        uint8_t flags    = _sir_shmrec_flags(rec);
+        uint64_t recsize = _sir_shmrec_size(_sir_shmrec_len(rec));
+
+        bool valid = (_SIR_SHMREC_MSG == flags || _SIR_SHMREC_PAD == flags ||
+            _SIR_SHMREC_SKIPPED == flags || _SIR_SHMREC_ABANDONED == flags) &&
+            recsize <= read - tail && (tail & ring->mask) + recsize <= size;
+        if (!valid) {
+            /* the consumer already discarded what follows (see below). */
+            _sir_shmring_free(ring, tail, read);
+            return;
+        }
+
+        if (_SIR_SHMREC_SKIPPED == flags && _sir_shmring_writeralive(rec))
+            return;
+
+        _sir_shmring_free(ring, tail, tail + recsize);
+        tail += recsize;
+    }
+}
+
+size_t _sir_shmring_drain(sir_shmring* ring, sir_shmring_reader reader, void* ctx) {
+    sir_shmring_hdr* hdr = ring->hdr;
+    uint64_t size  = ring->mask + 1;
+    uint64_t tail  = atomic_load_explicit(&hdr->tail, memory_order_relaxed);
+    uint64_t read  = atomic_load_explicit(&hdr->read, memory_order_relaxed);
+    uint64_t head  = atomic_load_explicit(&hdr->head, memory_order_acquire);
+    size_t count   = 0;
+    bool stalled   = false;
+
+    /* a writer may have died before moving `head` past what it reserved; the
+     * space at `head` is only free for this lap once `tail` is past it. */
+    if (head - tail < size) {
+        uint64_t rec = atomic_load_explicit(_sir_shmrec_hdr(ring, head), memory_order_acquire);
+        if (_SIR_SHMREC_RESERVED == _sir_shmrec_flags(rec) ||
+            _SIR_SHMREC_PAD == _sir_shmrec_flags(rec)) {
+            _sir_shmring_pass(ring, head, rec);
+            head = atomic_load_explicit(&hdr->head, memory_order_acquire);
+        }
+    }
+
+    while (read < head) {
+        uint64_t off     = read & ring->mask;
+        uint64_t rec     = atomic_load_explicit(_sir_shmrec_hdr(ring, read), memory_order_acquire);
+        uint8_t flags    = _sir_shmrec_flags(rec);
+        size_t len       = _sir_shmrec_len(rec);
+        uint64_t recsize = _sir_shmrec_size(len);
+
+        bool valid = (_SIR_SHMREC_MSG == flags || _SIR_SHMREC_PAD == flags ||
+            _SIR_SHMREC_RESERVED == flags) && recsize <= head - read && off + recsize <= size;
+        if (!valid) {
+            /* can only be the work of something other than libsir. */
+            _sir_selflog("error: discarded %" PRIu64 " bytes of shared-memory ring", head - read);
+            atomic_fetch_add_explicit(&hdr->dropped, 1, memory_order_relaxed);
+            read = head;
+            break;
+        }
+
+        if (_SIR_SHMREC_RESERVED == flags) {
+            /* reserved, but not yet written. a writer that has died never
+             * will; one that is still alive is given some time. */
+            if (_sir_shmring_writeralive(rec)) {
+                if (0 == ring->stallsince || ring->stallpos != read) {
+                    ring->stallpos   = read;
+                    ring->stallsince = _sir_msectime();
+                }
+
+                if (_sir_msectime() - ring->stallsince < SIR_SHMRING_STALLMSEC) {
+                    stalled = true;
+                    break;
+                }
+            }
+
+            uint64_t expected = rec;
+            if (!atomic_compare_exchange_strong_explicit(_sir_shmrec_hdr(ring, read), &expected,
+                _sir_shmrec_make(len, _sir_shmrec_high(rec), _SIR_SHMREC_SKIPPED),
+                memory_order_acquire, memory_order_acquire))
+                continue; /* written after all. */
+
+            atomic_fetch_add_explicit(&hdr->dropped, 1, memory_order_relaxed);
+            _sir_selflog("error: skipped a message of %zu bytes that process %" PRIu32
+                " reserved in shared-memory ring, but never wrote", len, _sir_shmrec_high(rec));
+        } else if (_SIR_SHMREC_MSG == flags) {
+            reader(ctx, (sir_level)_sir_shmrec_high(rec),
+                (const char*)ring->data + off + _SIR_SHMREC_HDRSIZE, len);
+            count++;
+        }
+
+        read += recsize;
+    }
+
+    if (!stalled)
+        ring->stallsince = 0;
+
+    atomic_store_explicit(&hdr->read, read, memory_order_relaxed);
+    _sir_shmring_release(ring, read);
+
+    return count;
+}
+
+uint64_t _sir_shmring_dropped(const sir_shmring* ring) {
+    return atomic_load_explicit(&ring->hdr->dropped, memory_order_relaxed);
+}
+
+void _sir_shmring_close(sir_shmring** ring) {
+    if (!_sir_validptrptr(ring) || !_sir_validptrnofail(*ring))
+        return;
+
+    (void)munmap((*ring)->hdr, (*ring)->mapsize);
+    if (-1 != (*ring)->fd)
+        (void)close((*ring)->fd);
+
+    _sir_safefree(ring);
+}
+
+bool _sir_shmring_unlink(const char* name) {
+    char path[SIR_MAXPATH] = {0};
+    if (!_sir_shmring_path(name, path))
+        return false;
+
+    if (0 != shm_unlink(path)) {
+        _sir_handleerr(errno);
+        return false;
+    }
+
+    return true;
+}
+
+static
+bool _sir_shmring_destwrite(void* ctx, const char* line, size_t len, sir_level level) {
+    return _sir_shmring_write((sir_shmring*)ctx, level, line, len);
+}
+
+static
+void _sir_shmring_destclose(void* ctx) {
+    sir_shmring* ring = (sir_shmring*)ctx;
+    _sir_shmring_close(&ring);
+}
+
+sirdestid _sir_addshmring(const char* name, sir_levels levels, sir_options opts) {
+    _sir_seterror(_SIR_E_NOERROR);
+
+    if (!_sir_sanity())
+        return 0;
+
+    sir_shmring* ring = _sir_shmring_open(name, false);
+    if (!ring)
+        return 0;
+
+    static const sir_dest_ops ops = {_sir_shmring_destwrite, NULL, _sir_shmring_destclose};
+
+    sirdestid id = _sir_adddest(&ops, ring, levels, opts);
+    if (!id)
+        _sir_shmring_close(&ring);
+
+    return id;
+}
+#else /* !SIR_SHMRING_ENABLED */
+sirdestid _sir_addshmring(const char* name, sir_levels levels, sir_options opts) {
+    _SIR_UNUSED(name);
+    _SIR_UNUSED(levels);
+    _SIR_UNUSED(opts);
+    _sir_seterror(_SIR_E_UNAVAIL);
+    return 0;
+}
+
+sir_shmring* _sir_shmring_open(const char* name, bool consumer) {
+    _SIR_UNUSED(name);
+    _SIR_UNUSED(consumer);
+    _sir_seterror(_SIR_E_UNAVAIL);
+    return NULL;
+}
+
+bool _sir_shmring_write(sir_shmring* ring, sir_level level, const char* msg, size_t len) {
+    _SIR_UNUSED(ring);
+    _SIR_UNUSED(level);
+    _SIR_UNUSED(msg);
+    _SIR_UNUSED(len);
+    _sir_seterror(_SIR_E_UNAVAIL);
+    return false;
+}
+
+char* _sir_shmring_reserve(sir_shmring* ring, size_t len, uint64_t* pos) {
+    _SIR_UNUSED(ring);
+    _SIR_UNUSED(len);
+    _SIR_UNUSED(pos);
+    _sir_seterror(_SIR_E_UNAVAIL);
+    return NULL;
+}
+
+bool _sir_shmring_commit(sir_shmring* ring, uint64_t pos, sir_level level) {
+    _SIR_UNUSED(ring);
+    _SIR_UNUSED(pos);
+    _SIR_UNUSED(level);
+    _sir_seterror(_SIR_E_UNAVAIL);
+    return false;
+}
+
+size_t _sir_shmring_drain(sir_shmring* ring, sir_shmring_reader reader, void* ctx) {
+    _SIR_UNUSED(ring);
+    _SIR_UNUSED(reader);
+    _SIR_UNUSED(ctx);
+    return 0;
+}
+
+uint64_t _sir_shmring_dropped(const sir_shmring* ring) {
+    _SIR_UNUSED(ring);
+    return 0;
+}
+
+void _sir_shmring_close(sir_shmring** ring) {
+    _SIR_UNUSED(ring);
+}
+
+bool _sir_shmring_unlink(const char* name) {
+    _SIR_UNUSED(name);
+    _sir_seterror(_SIR_E_UNAVAIL);
+    return false;
+}
+#endif
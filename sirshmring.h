@@ -0,0 +1,84 @@
+/*
+ * sirshmring.h
+ *
+ * Author:    Ryan M. Lederman <lederman@gmail.com>
+ * Copyright: Copyright (c) 2018-2023
+ * Version:   2.2.0
+ * License:   The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef _SIR_SHMRING_H_INCLUDED
+# define _SIR_SHMRING_H_INCLUDED
+
+# include "sirtypes.h"
+
+/** A shared-memory ring mapped into this process (see sirshmring.c). */
+typedef struct sir_shmring sir_shmring;
+
+/** Receives each message read from a ring by ::_sir_shmring_drain. */
+typedef void (*sir_shmring_reader)(void* ctx, sir_level level, const char* msg, size_t len);
+
+/** Opens a ring, and adds a custom destination that writes to it (see ::sir_addshmring). */
+sirdestid _sir_addshmring(const char* name, sir_levels levels, sir_options opts);
+
+/**
+ * Maps the shared-memory ring `name`, creating it (with room for
+ * ::SIR_SHMRING_SIZE bytes of messages) if it doesn't exist. A ring has any
+ * number of writers, in any number of processes, but only one consumer: with
+ * `consumer` set, this fails if another process is consuming the ring.
+ */
+sir_shmring* _sir_shmring_open(const char* name, bool consumer);
+
+/**
+ * Reserves room for a message of `len` bytes (none of them `'\0'`) in the
+ * ring, without locking, and returns where to write it; `*pos` identifies it
+ * to ::_sir_shmring_commit. Never waits: if the ring is full, returns `NULL`,
+ * and the message is counted as dropped (see ::_sir_shmring_dropped).
+ */
+char* _sir_shmring_reserve(sir_shmring* ring, size_t len, uint64_t* pos);
+
+/**
+ * Marks the message reserved at `pos` as written. Fails if this process took
+ * so long that the consumer gave up on it (see ::SIR_SHMRING_STALLMSEC); it is
+ * then dropped, and its space is no longer this process's to write to.
+ */
+bool _sir_shmring_commit(sir_shmring* ring, uint64_t pos, sir_level level);
+
+/** Reserves room for a message, copies it there, and commits it. */
+bool _sir_shmring_write(sir_shmring* ring, sir_level level, const char* msg, size_t len);
+
+/**
+ * Passes each message written to the ring since the last call to `reader`, in
+ * the order they were reserved, and frees the space they took up. A message
+ * whose writer has died, or that has been reserved for longer than
+ * ::SIR_SHMRING_STALLMSEC, is skipped. Returns the number of messages read.
+ * Only the consumer may call this.
+ */
+size_t _sir_shmring_drain(sir_shmring* ring, sir_shmring_reader reader, void* ctx);
+
+/** Returns the number of messages dropped since the ring was created. */
+uint64_t _sir_shmring_dropped(const sir_shmring* ring);
+
+/** Unmaps a ring. The ring itself, and its contents, remain until it is unlinked. */
+void _sir_shmring_close(sir_shmring** ring);
+
+/** Removes the name of a ring; it is destroyed once no process has it mapped. */
+bool _sir_shmring_unlink(const char* name);
+
+#endif /* !_SIR_SHMRING_H_INCLUDED */
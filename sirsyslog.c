@@ -0,0 +1,437 @@
+/*
+ * sirsyslog.c
+ *
+ * Author:    Ryan M. Lederman <lederman@gmail.com>
+ * Copyright: Copyright (c) 2018-2023
+ * Version:   2.2.0
+ * License:   The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "sirsyslog.h"
+#include "sirinternal.h"
+#include "sirhelpers.h"
+#include "sirmutex.h"
+#include "sirthread.h"
+
+#if defined(SIR_SYSLOG_ENABLED)
+
+/** A message framed for the system logger. */
+typedef struct {
+    size_t len;
+    char data[SIR_SYSLOG_MAXFRAME];
+} _sir_syslogframe;
+
+/**
+ * The connection to the system logger, and the messages waiting to be sent
+ * over it (a ring of `count` frames, starting at `head`). Whichever logging
+ * thread finds nobody else sending becomes the sender, and sends everything
+ * queued in the meantime, so that threads logging at the same time share
+ * system calls. Only the sender touches queued frames and the socket, and it
+ * does so without holding the mutex.
+ */
+static struct {
+    sir_mutex mutex;
+    sir_event space; /**< Signaled when the sender has made room in the queue. */
+    bool init;
+    bool open;
+    bool sending;
+    int fd;
+    uint64_t retryat; /**< When to next try to reconnect (see ::_sir_msectime). */
+    size_t head;
+    size_t count;
+    size_t waiting; /**< Threads waiting for room in the queue. */
+    size_t dropped;
+    char path[SIR_MAXPATH];
+    _sir_syslogframe frames[SIR_SYSLOG_BATCH];
+} _sir_sl = {.fd = -1};
+
+/** Connects to the system logger's socket without blocking; the mutex must be held. */
+static
+bool _sir_syslogsock_connect(void) {
+    if (-1 != _sir_sl.fd) {
+        (void)close(_sir_sl.fd);
+        _sir_sl.fd = -1;
+    }
+
+    const char* path = '\0' != _sir_sl.path[0] ? _sir_sl.path : SIR_SYSLOG_SOCKET;
+    struct sockaddr_un addr = {0};
+    size_t pathlen = strnlen(path, SIR_MAXPATH);
+    if (pathlen >= sizeof(addr.sun_path)) {
+        _sir_seterror(_SIR_E_STRING);
+        return false;
+    }
+
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, path, pathlen);
+
+    int fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+    if (-1 == fd) {
+        _sir_handleerr(errno);
+        return false;
+    }
+
+    int flags = fcntl(fd, F_GETFL);
+    if (-1 == flags || -1 == fcntl(fd, F_SETFL, flags | O_NONBLOCK) ||
+        -1 == fcntl(fd, F_SETFD, FD_CLOEXEC)) {
+        _sir_handleerr(errno);
+        (void)close(fd);
+        return false;
+    }
+
+    /* connecting a datagram socket only sets its destination; it doesn't block. */
+    if (0 != connect(fd, (const struct sockaddr*)&addr, sizeof(addr))) {
+        _sir_selflog("failed to connect to '%s' (%d); retrying in %d msec", path,
+            errno, SIR_SYSLOG_RETRYMSEC);
+        (void)close(fd);
+        _sir_sl.retryat = _sir_msectime() + SIR_SYSLOG_RETRYMSEC;
+        return false;
+    }
+
+    _sir_selflog("connected to '%s' (fd: %d)", path, fd);
+    _sir_sl.fd = fd;
+    return true;
+}
+
+/**
+ * Frames a message the way syslog(3) does:
+ * `<PRI>Mmm dd hh:mm:ss identity[pid]: message`. Returns its length, or zero
+ * upon error.
+ */
+static
+size_t _sir_syslogsock_frame(char* out, int severity, const sirbuf* buf,
+    const sir_syslog_dest* ctx) {
+    /* the month isn't localized, so strftime's %b won't do. */
+    static const char* months[] = {
+        "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+        "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+    };
+
+    time_t now = -1 != buf->now ? buf->now : time(NULL);
+    struct tm timebuf = {0};
+    const struct tm* tm = _sir_localtime(&now, &timebuf);
+    if (!tm || tm->tm_mon < 0 || tm->tm_mon > 11)
+        return 0;
+
+    bool nopid = _sir_bittest(ctx->opts, SIRO_NOPID);
+    int len = snprintf(out, SIR_SYSLOG_MAXFRAME, "<%d>%s %2d %02d:%02d:%02d %s%s%s%s: %s",
+        LOG_USER | severity, months[tm->tm_mon], tm->tm_mday, tm->tm_hour, tm->tm_min,
+        tm->tm_sec, ctx->identity, nopid ? "" : "[", nopid ? "" : buf->pid,
+        nopid ? "" : "]", buf->message);
+    if (len <= 0)
+        return 0;
+
+    /* too long for a frame: truncated, as syslog(3) would. */
+    return (size_t)len < SIR_SYSLOG_MAXFRAME ? (size_t)len : SIR_SYSLOG_MAXFRAME - 1;
+}
+
+/**
+ * Sends up to `n` queued frames, starting at `first`, and returns how many
+ * were sent. If not all of them were, `*err` is set to the reason.
+ */
+static
+size_t _sir_syslogsock_send(int fd, size_t first, size_t n, int* err) {
+    size_t sent = 0;
+
+#if defined(SIR_SENDMMSG)
+    struct mmsghdr msgs[SIR_SYSLOG_BATCH];
+    struct iovec iov[SIR_SYSLOG_BATCH];
+    memset(msgs, 0, sizeof(struct mmsghdr) * n);
+
+    for (size_t i = 0; i < n; i++) {
+        iov[i].iov_base = _sir_sl.frames[first + i].data;
+        iov[i].iov_len  = _sir_sl.frames[first + i].len;
+        msgs[i].msg_hdr.msg_iov    = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    while (sent < n) {
+        int ret = sendmmsg(fd, &msgs[sent], (unsigned int)(n - sent), 0);
+        if (-1 == ret) {
+            if (EINTR == errno)
+                continue;
+            *err = errno;
+            break;
+        }
+        sent += (size_t)ret;
+    }
+#else
+    while (sent < n) {
+        const _sir_syslogframe* frame = &_sir_sl.frames[first + sent];
+        if (-1 == send(fd, frame->data, frame->len, 0)) {
+            if (EINTR == errno)
+                continue;
+            *err = errno;
+            break;
+        }
+        sent++;
+    }
+#endif
+
+    return sent;
+}
+
+/** Discards the first `n` queued frames; the mutex must be held. */
+static inline
+void _sir_syslogsock_dequeue(size_t n, bool dropped) {
+    _sir_sl.head   = (_sir_sl.head + n) % SIR_SYSLOG_BATCH;
+    _sir_sl.count -= n;
+
+    if (dropped)
+        _sir_sl.dropped += n;
+
+    if (n > 0 && _sir_sl.waiting > 0)
+        (void)_sirevent_signal(&_sir_sl.space);
+}
+
+/**
+ * Sends queued frames until there are none left, or the system logger stays
+ * busy for ::SIR_SYSLOG_WAITMSEC. Called by the sender with the mutex held;
+ * it is released while sending.
+ */
+static
+void _sir_syslogsock_drain(void) {
+    bool reconnected = false;
+    uint64_t deadline = _sir_msectime() + SIR_SYSLOG_WAITMSEC;
+
+    while (_sir_sl.count > 0) {
+        if (-1 == _sir_sl.fd) {
+            /* reconnected once already, or waiting to retry: nobody to send to. */
+            if (reconnected || _sir_msectime() < _sir_sl.retryat ||
+                !_sir_syslogsock_connect()) {
+                _sir_selflog("dropping %zu message(s); system logger unavailable",
+                    _sir_sl.count);
+                _sir_syslogsock_dequeue(_sir_sl.count, true);
+                break;
+            }
+            reconnected = true;
+        }
+
+        /* the frames up to the end of the ring, in one go. */
+        int fd       = _sir_sl.fd;
+        size_t first = _sir_sl.head;
+        size_t n     = _sir_sl.count < SIR_SYSLOG_BATCH - first ? _sir_sl.count
+            : SIR_SYSLOG_BATCH - first;
+        int err      = 0;
+
+        (void)_sirmutex_unlock(&_sir_sl.mutex);
+        size_t sent = _sir_syslogsock_send(fd, first, n, &err);
+        (void)_sirmutex_lock(&_sir_sl.mutex);
+
+        _sir_syslogsock_dequeue(sent, false);
+        if (sent == n)
+            continue;
+
+        if (EAGAIN == err || EWOULDBLOCK == err || ENOBUFS == err) {
+            /* the system logger is busy; wait for it to catch up, but not forever.
+             * anything left is sent along with the next message. */
+            uint64_t now = _sir_msectime();
+            if (now >= deadline)
+                break;
+
+            struct pollfd pfd = {fd, POLLOUT, 0};
+            (void)_sirmutex_unlock(&_sir_sl.mutex);
+            int ready = poll(&pfd, 1, (int)(deadline - now));
+            (void)_sirmutex_lock(&_sir_sl.mutex);
+
+            if (ready <= 0)
+                break;
+        } else if (ECONNREFUSED == err || ENOTCONN == err || ECONNRESET == err ||
+                   EPIPE == err || ENOENT == err || EDESTADDRREQ == err) {
+            /* the system logger went away, and perhaps has already come back
+             * (e.g. it was restarted); reconnect right away. */
+            _sir_selflog("lost connection to system logger (%d); reconnecting", err);
+            (void)close(_sir_sl.fd);
+            _sir_sl.fd      = -1;
+            _sir_sl.retryat = 0;
+        } else {
+            _sir_selflog("error: failed to send message to system logger (%d); dropping it", err);
+            _sir_syslogsock_dequeue(1, true);
+        }
+    }
+}
+
+bool _sir_syslogsock_open(void) {
+    if (!_sir_sl.init) {
+        if (!_sirmutex_create(&_sir_sl.mutex))
+            return false;
+        if (!_sirevent_create(&_sir_sl.space)) {
+            (void)_sirmutex_destroy(&_sir_sl.mutex);
+            return false;
+        }
+        _sir_sl.init = true;
+    }
+
+    if (!_sirmutex_lock(&_sir_sl.mutex))
+        return false;
+
+    if (!_sir_sl.open) {
+        _sir_sl.head    = 0;
+        _sir_sl.count   = 0;
+        _sir_sl.dropped = 0;
+        _sir_sl.retryat = 0;
+        _sir_sl.open    = true;
+
+        /* if nothing is listening yet, that's retried when there is something to send. */
+        (void)_sir_syslogsock_connect();
+    }
+
+    (void)_sirmutex_unlock(&_sir_sl.mutex);
+    return true;
+}
+
+bool _sir_syslogsock_write(int severity, const sirbuf* buf, const sir_syslog_dest* ctx) {
+    if (!_sir_validptr(buf) || !_sir_validptr(ctx))
+        return false;
+
+    char data[SIR_SYSLOG_MAXFRAME];
+    size_t len = _sir_syslogsock_frame(data, severity, buf, ctx);
+    if (0 == len) {
+        _sir_seterror(_SIR_E_INTERNAL);
+        return false;
+    }
+
+    if (!_sir_sl.init || !_sirmutex_lock(&_sir_sl.mutex)) {
+        _sir_seterror(_SIR_E_INVALID);
+        return false;
+    }
+
+    if (!_sir_sl.open) {
+        (void)_sirmutex_unlock(&_sir_sl.mutex);
+        _sir_seterror(_SIR_E_INVALID);
+        _sir_selflog("not open; ignoring");
+        return false;
+    }
+
+    bool sender = !_sir_sl.sending;
+    _sir_sl.sending = true;
+
+    /* the queue is full: either make room by sending, or wait for the sender to. */
+    uint64_t deadline = _sir_msectime() + SIR_SYSLOG_WAITMSEC;
+    while (SIR_SYSLOG_BATCH == _sir_sl.count) {
+        if (sender) {
+            _sir_syslogsock_drain();
+            break;
+        }
+
+        uint64_t now = _sir_msectime();
+        if (now >= deadline)
+            break;
+
+        _sir_sl.waiting++;
+        (void)_sirmutex_unlock(&_sir_sl.mutex);
+        (void)_sirevent_wait(&_sir_sl.space, (uint32_t)(deadline - now));
+        (void)_sirmutex_lock(&_sir_sl.mutex);
+        _sir_sl.waiting--;
+
+        /* the sender may have finished meanwhile. */
+        if (!_sir_sl.sending) {
+            sender = true;
+            _sir_sl.sending = true;
+        }
+    }
+
+    if (_sir_sl.count < SIR_SYSLOG_BATCH) {
+        _sir_syslogframe* frame = &_sir_sl.frames[(_sir_sl.head + _sir_sl.count) %
+            SIR_SYSLOG_BATCH];
+        memcpy(frame->data, data, len);
+        frame->len = len;
+        _sir_sl.count++;
+
+        /* let the next waiting thread in, if there's still room. */
+        if (_sir_sl.waiting > 0 && _sir_sl.count < SIR_SYSLOG_BATCH)
+            (void)_sirevent_signal(&_sir_sl.space);
+    } else {
+        _sir_sl.dropped++;
+        _sir_selflog("queue full; dropping message");
+    }
+
+    if (sender) {
+        _sir_syslogsock_drain();
+        _sir_sl.sending = false;
+    }
+
+    (void)_sirmutex_unlock(&_sir_sl.mutex);
+    return true;
+}
+
+bool _sir_syslogsock_close(void) {
+    if (!_sir_sl.init)
+        return true;
+
+    if (!_sirmutex_lock(&_sir_sl.mutex))
+        return false;
+
+    /* wait for a sender that is still at it. */
+    while (_sir_sl.sending) {
+        (void)_sirmutex_unlock(&_sir_sl.mutex);
+        _sirthread_yield();
+        (void)_sirmutex_lock(&_sir_sl.mutex);
+    }
+
+    if (_sir_sl.open) {
+        _sir_sl.sending = true;
+        _sir_syslogsock_drain();
+        _sir_sl.sending = false;
+
+        if (_sir_sl.count > 0 || _sir_sl.dropped > 0)
+            _sir_selflog("%zu message(s) were not delivered to the system logger",
+                _sir_sl.count + _sir_sl.dropped);
+    }
+
+    if (-1 != _sir_sl.fd) {
+        (void)close(_sir_sl.fd);
+        _sir_sl.fd = -1;
+    }
+
+    _sir_sl.open  = false;
+    _sir_sl.head  = 0;
+    _sir_sl.count = 0;
+    (void)_sirmutex_unlock(&_sir_sl.mutex);
+
+    _sir_sl.init = false;
+    (void)_sirevent_destroy(&_sir_sl.space);
+    (void)_sirmutex_destroy(&_sir_sl.mutex);
+
+    return true;
+}
+
+void _sir_syslogsock_setpath(const char* path) {
+    if (!path) {
+        _sir_sl.path[0] = '\0';
+    } else {
+        size_t len = strnlen(path, SIR_MAXPATH - 1);
+        memcpy(_sir_sl.path, path, len);
+        _sir_sl.path[len] = '\0';
+    }
+}
+
+void _sir_syslogsock_atfork_child(void) {
+    if (!_sir_sl.init)
+        return;
+
+    /* the parent sends what it queued; the socket itself is shared. */
+    (void)_sirmutex_create(&_sir_sl.mutex);
+    (void)_sirevent_create(&_sir_sl.space);
+    _sir_sl.sending = false;
+    _sir_sl.waiting = 0;
+    _sir_sl.head    = 0;
+    _sir_sl.count   = 0;
+}
+
+#endif /* SIR_SYSLOG_ENABLED */
@@ -0,0 +1,66 @@
+/*
+ * sirsyslog.h
+ *
+ * Author:    Ryan M. Lederman <lederman@gmail.com>
+ * Copyright: Copyright (c) 2018-2023
+ * Version:   2.2.0
+ * License:   The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef _SIR_SYSLOG_H_INCLUDED
+# define _SIR_SYSLOG_H_INCLUDED
+
+# include "sirtypes.h"
+
+# if defined(SIR_SYSLOG_ENABLED)
+/**
+ * Connects to the system logger's socket (::SIR_SYSLOG_SOCKET, unless changed
+ * with ::_sir_syslogsock_setpath). If nothing is listening yet, messages are
+ * dropped until a later attempt to reconnect succeeds.
+ */
+bool _sir_syslogsock_open(void);
+
+/**
+ * Frames a message for the system logger (RFC 3164, as syslog(3) does) with
+ * the `severity` (`LOG_*`) of its level, and queues it to be sent. If no other
+ * thread is sending, the calling thread sends everything queued so far (its
+ * own message included) in batches of up to ::SIR_SYSLOG_BATCH.
+ *
+ * Never waits on a reconnect; like syslog(3), messages that the system logger
+ * is not there to receive are dropped without an error.
+ */
+bool _sir_syslogsock_write(int severity, const sirbuf* buf, const sir_syslog_dest* ctx);
+
+/** Makes a last attempt to send anything still queued, then disconnects. */
+bool _sir_syslogsock_close(void);
+
+/**
+ * Sets the path of the socket to connect to from the next (re)connect on, e.g.
+ * a stand-in for the system logger. `NULL` restores ::SIR_SYSLOG_SOCKET.
+ */
+void _sir_syslogsock_setpath(const char* path);
+
+/**
+ * Forgets messages queued in the parent, and whether a thread that does not
+ * exist in a forked child was sending them.
+ */
+void _sir_syslogsock_atfork_child(void);
+# endif
+
+#endif /* !_SIR_SYSLOG_H_INCLUDED */
@@ -0,0 +1,264 @@
+/*
+ * sirthread.c
+ *
+ * Author:    Ryan M. Lederman <lederman@gmail.com>
+ * Copyright: Copyright (c) 2018-2023
+ * Version:   2.2.0
+ * License:   The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "sirthread.h"
+#include "sirinternal.h"
+
+#if !defined(__WIN__) /* pthread implementation */
+
+bool _sirthread_create(sir_thread* thread, sir_thread_fn fn, void* arg) {
+    if (!_sir_validptr(thread) || !_sir_validfnptr(fn))
+        return false;
+
+    int op = pthread_create(thread, NULL, fn, arg);
+    if (0 != op)
+        _sir_handleerr(op);
+
+    return 0 == op;
+}
+
+bool _sirthread_join(sir_thread* thread) {
+    if (!_sir_validptr(thread))
+        return false;
+
+    int op = pthread_join(*thread, NULL);
+    if (0 != op)
+        _sir_handleerr(op);
+
+    return 0 == op;
+}
+
+void _sirthread_yield(void) {
+    (void)sched_yield();
+}
+
+void _sirthread_sleep(uint32_t msec) {
+    struct timespec ts = { (time_t)(msec / 1000), (long)((msec % 1000) * 1000000L) };
+    while (0 != nanosleep(&ts, &ts) && EINTR == errno)
+        ;
+}
+
+bool _sirthread_setlowpriority(void) {
+# if defined(SCHED_IDLE)
+    struct sched_param param = {0};
+    int op = pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+    if (0 != op)
+        _sir_selflog("warning: failed to set SCHED_IDLE (%d)", op);
+
+    return 0 == op;
+# else
+    return false;
+# endif
+}
+
+bool _sirevent_create(sir_event* ev) {
+    if (!_sir_validptr(ev))
+        return false;
+
+    int op = pthread_mutex_init(&ev->mutex, NULL);
+    if (0 != op) {
+        _sir_handleerr(op);
+        return false;
+    }
+
+    op = pthread_cond_init(&ev->cond, NULL);
+    if (0 != op) {
+        _sir_handleerr(op);
+        (void)pthread_mutex_destroy(&ev->mutex);
+        return false;
+    }
+
+    ev->signaled = false;
+    return true;
+}
+
+bool _sirevent_signal(sir_event* ev) {
+    if (!_sir_validptr(ev))
+        return false;
+
+    int op = pthread_mutex_lock(&ev->mutex);
+    if (0 != op) {
+        _sir_handleerr(op);
+        return false;
+    }
+
+    ev->signaled = true;
+    op = pthread_cond_signal(&ev->cond);
+    if (0 != op)
+        _sir_handleerr(op);
+
+    (void)pthread_mutex_unlock(&ev->mutex);
+    return 0 == op;
+}
+
+bool _sirevent_wait(sir_event* ev, uint32_t msec) {
+    if (!_sir_validptr(ev))
+        return false;
+
+    struct timespec abstime = {0};
+    if (0 != clock_gettime(CLOCK_REALTIME, &abstime)) {
+        _sir_handleerr(errno);
+        return false;
+    }
+
+    abstime.tv_sec  += (time_t)(msec / 1000);
+    abstime.tv_nsec += (long)((msec % 1000) * 1000000L);
+    if (abstime.tv_nsec >= 1000000000L) {
+        abstime.tv_sec++;
+        abstime.tv_nsec -= 1000000000L;
+    }
+
+    int op = pthread_mutex_lock(&ev->mutex);
+    if (0 != op) {
+        _sir_handleerr(op);
+        return false;
+    }
+
+    while (!ev->signaled) {
+        op = pthread_cond_timedwait(&ev->cond, &ev->mutex, &abstime);
+        if (0 != op) {
+            if (ETIMEDOUT != op)
+                _sir_handleerr(op);
+            break;
+        }
+    }
+
+    bool signaled = ev->signaled;
+    ev->signaled  = false;
+
+    (void)pthread_mutex_unlock(&ev->mutex);
+    return signaled;
+}
+
+bool _sirevent_destroy(sir_event* ev) {
+    if (!_sir_validptr(ev))
+        return false;
+
+    int op = pthread_cond_destroy(&ev->cond);
+    if (0 != op)
+        _sir_handleerr(op);
+
+    int op2 = pthread_mutex_destroy(&ev->mutex);
+    if (0 != op2)
+        _sir_handleerr(op2);
+
+    return 0 == op && 0 == op2;
+}
+
+#else /* __WIN__ */
+
+bool _sirthread_create(sir_thread* thread, sir_thread_fn fn, void* arg) {
+    if (!_sir_validptr(thread) || !_sir_validfnptr(fn))
+        return false;
+
+    *thread = _beginthreadex(NULL, 0, fn, arg, 0, NULL);
+    if (0 == *thread) {
+        _sir_handleerr(errno);
+        return false;
+    }
+
+    return true;
+}
+
+bool _sirthread_join(sir_thread* thread) {
+    if (!_sir_validptr(thread))
+        return false;
+
+    DWORD wait = WaitForSingleObject((HANDLE)*thread, INFINITE);
+    if (WAIT_OBJECT_0 != wait)
+        _sir_handlewin32err(GetLastError());
+
+    (void)CloseHandle((HANDLE)*thread);
+    *thread = 0;
+
+    return WAIT_OBJECT_0 == wait;
+}
+
+void _sirthread_yield(void) {
+    (void)SwitchToThread();
+}
+
+void _sirthread_sleep(uint32_t msec) {
+    Sleep((DWORD)msec);
+}
+
+bool _sirthread_setlowpriority(void) {
+    if (!SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST)) {
+        _sir_selflog("warning: failed to set THREAD_PRIORITY_LOWEST (%lu)",
+            GetLastError());
+        return false;
+    }
+
+    return true;
+}
+
+bool _sirevent_create(sir_event* ev) {
+    if (!_sir_validptr(ev))
+        return false;
+
+    sir_event tmp = CreateEvent(NULL, FALSE, FALSE, NULL);
+    if (!tmp) {
+        _sir_handlewin32err(GetLastError());
+        return false;
+    }
+
+    *ev = tmp;
+    return true;
+}
+
+bool _sirevent_signal(sir_event* ev) {
+    if (!_sir_validptr(ev))
+        return false;
+
+    BOOL set = SetEvent(*ev);
+    if (!set)
+        _sir_handlewin32err(GetLastError());
+
+    return FALSE != set;
+}
+
+bool _sirevent_wait(sir_event* ev, uint32_t msec) {
+    if (!_sir_validptr(ev))
+        return false;
+
+    DWORD wait = WaitForSingleObject(*ev, (DWORD)msec);
+    if (WAIT_FAILED == wait)
+        _sir_handlewin32err(GetLastError());
+
+    return WAIT_OBJECT_0 == wait;
+}
+
+bool _sirevent_destroy(sir_event* ev) {
+    if (!_sir_validptr(ev))
+        return false;
+
+    BOOL close = CloseHandle(*ev);
+    if (!close)
+        _sir_handlewin32err(GetLastError());
+
+    return FALSE != close;
+}
+
+#endif // !__WIN__
@@ -0,0 +1,65 @@
+/*
+ * sirthread.h
+ *
+ * Author:    Ryan M. Lederman <lederman@gmail.com>
+ * Copyright: Copyright (c) 2018-2023
+ * Version:   2.2.0
+ * License:   The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef _SIR_THREAD_H_INCLUDED
+# define _SIR_THREAD_H_INCLUDED
+
+# include "sirtypes.h"
+
+/** Creates and starts a new thread executing `fn(arg)`. */
+bool _sirthread_create(sir_thread* thread, sir_thread_fn fn, void* arg);
+
+/** Waits indefinitely for a thread to exit, then releases its resources. */
+bool _sirthread_join(sir_thread* thread);
+
+/** Relinquishes the remainder of the calling thread's time slice. */
+void _sirthread_yield(void);
+
+/** Suspends the calling thread for at least `msec` milliseconds. */
+void _sirthread_sleep(uint32_t msec);
+
+/**
+ * Lowers the scheduling priority of the calling thread so that it only runs
+ * when the system is otherwise idle (where supported). Returns `true` if the
+ * priority was changed.
+ */
+bool _sirthread_setlowpriority(void);
+
+/** Creates/initializes a new auto-reset event in the non-signaled state. */
+bool _sirevent_create(sir_event* ev);
+
+/** Signals an event, releasing one waiting thread (or the next one to wait). */
+bool _sirevent_signal(sir_event* ev);
+
+/**
+ * Waits up to `msec` milliseconds for an event to become signaled, and resets it.
+ * Returns `true` if the event was signaled, `false` upon timeout or error.
+ */
+bool _sirevent_wait(sir_event* ev, uint32_t msec);
+
+/** Destroys an event. */
+bool _sirevent_destroy(sir_event* ev);
+
+#endif /* !_SIR_THREAD_H_INCLUDED */
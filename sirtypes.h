@@ -41,6 +41,9 @@
 /** Log file identifier type. */
 typedef const int* sirfileid;
 
+/** Custom destination identifier type (`0` is never a valid identifier). */
+typedef uint32_t sirdestid;
+
 /** Defines the available levels (severity/priority) of logging output. */
 typedef enum {
     SIRL_NONE    = 0x0000, /**< No output. */
@@ -70,7 +73,8 @@ typedef enum {
     SIRO_NOPID   = 0x00002000, /**< Exclude process ID. */
     SIRO_NOTID   = 0x00004000, /**< Exclude thread ID/name. */
     SIRO_NOHDR   = 0x00010000, /**< Don't write header messages to log files. */
-    SIRO_MSGONLY = 0x00007f00, /**< Sets all other options except ::SIRO_NOHDR. */
+    SIRO_QUEUED  = 0x00020000, /**< Write to a custom destination from a libsir thread. */
+    SIRO_MSGONLY = 0x00007f00, /**< Sets all formatting options (not ::SIRO_NOHDR or ::SIRO_QUEUED). */
     SIRO_DEFAULT = 0x00100000  /**< Default options for this type of destination. */
 } sir_option;
 
@@ -180,6 +184,229 @@ typedef struct {
     char category[SIR_MAX_SYSLOG_CAT];
 } sir_syslog_dest;
 
+/** How messages reach a remote syslog collector (see ::sir_remote_dest). */
+typedef enum {
+    SIRRT_UDP = 0, /**< One message per datagram (RFC 5426). */
+    SIRRT_TCP = 1  /**< A stream of octet-counted messages (RFC 6587). */
+} sir_remote_transport;
+
+/**
+ * @struct sir_remote_dest
+ * @brief Configuration for the remote syslog destination.
+ *
+ * Messages are formatted as RFC 5424 specifies, and sent to a syslog collector
+ * by a background thread; logging threads only copy them into a buffer of up
+ * to ::SIR_REMOTE_BUFSIZE bytes. If the collector can't keep up, or can't be
+ * reached, messages that do not fit in the buffer are dropped.
+ *
+ * @see ::sir_remotelevels
+ * @see ::sir_remoteopts
+ */
+typedef struct {
+    sir_levels levels; /**< ::sir_level bitmask defining levels to register for. */
+
+    /**
+     * ::sir_option bitmask. ::SIRO_NOTIME, ::SIRO_NOHOST, ::SIRO_NONAME, and
+     * ::SIRO_NOPID leave the corresponding header fields out (replacing them
+     * with "-"), and ::SIRO_NOMSEC the fraction of a second from the time
+     * stamp. Other options have no effect.
+     */
+    sir_options opts;
+
+    /** Whether to send messages over UDP or TCP. */
+    sir_remote_transport transport;
+
+    /** The port the collector listens on. If zero, ::SIR_REMOTE_PORT. */
+    uint16_t port;
+
+    /**
+     * The host name or address of the collector. If empty, the destination is
+     * disabled. Only read by ::sir_init.
+     */
+    char host[SIR_MAXHOST];
+
+    /**
+     * The APP-NAME to send. If empty, ::sirinit.name is used, or failing that,
+     * the file name of the application.
+     */
+    char identity[SIR_MAX_SYSLOG_ID];
+} sir_remote_dest;
+
+/** The means by which libsir writes to a log file (see ::sir_file_policy). */
+typedef enum {
+    SIRFB_STDIO = 0, /**< C library streams (the default). */
+    SIRFB_URING = 1, /**< Linux io_uring, if libsir was built with `SIR_IOURING=1`.
+                          Falls back to ::SIRFB_STDIO if io_uring is unavailable. */
+    SIRFB_MMAP  = 2  /**< Memory-mapped, preallocated file (not on Windows). Falls
+                          back to ::SIRFB_STDIO if the file can't be mapped. */
+} sir_file_backend;
+
+/** Wall-clock boundaries at which a log file is rolled (see ::sir_file_policy). */
+typedef enum {
+    SIRRI_NONE   = 0, /**< Only rolled when it gets too large (the default). */
+    SIRRI_HOURLY = 1, /**< Also at the start of every hour (local time). */
+    SIRRI_DAILY  = 2  /**< Also at midnight (local time). */
+} sir_roll_interval;
+
+/**
+ * @struct sir_file_policy
+ * @brief Buffering and flushing policy for a log file.
+ *
+ * By default, log files are buffered by the C library (typically in `BUFSIZ`
+ * bytes), and written whenever the buffer fills up. Data still in the buffer
+ * is lost if the process crashes.
+ *
+ * @see ::sir_filepolicy
+ */
+typedef struct {
+    /**
+     * The number of bytes to collect before writing them to the file in a
+     * single call. If zero, the C library's default buffer is used. May not
+     * exceed ::SIR_FMAXBUFSIZE.
+     */
+    uint32_t buffer_size;
+
+    /**
+     * If non-zero, buffered data is written no later than this many
+     * milliseconds after it was logged, even if the buffer is not full.
+     */
+    uint32_t flush_msec;
+
+    /**
+     * ::sir_level bitmask of levels that are written to the file immediately,
+     * along with anything buffered before them (e.g. ::SIRL_ERROR and above).
+     */
+    sir_levels flush_levels;
+
+    /**
+     * How the file is written. With ::SIRFB_URING, buffers of `buffer_size`
+     * bytes (or ::SIR_URING_BUFSIZE) are handed to the kernel as they fill up,
+     * and up to ::SIR_URING_NBUFS of them may be written at once without the
+     * logging thread waiting for any of them.
+     *
+     * With ::SIRFB_MMAP, the file is preallocated `buffer_size` bytes (or
+     * ::SIR_MMAP_CHUNKSIZE) at a time, and messages are copied straight into a
+     * mapping of it, without a system call. Flushing starts writing the data
+     * back to disk. Until the file is closed or rolled, its size includes the
+     * preallocated space, so readers see zeros after the last message. The
+     * file must not be truncated by another process while it is mapped.
+     */
+    sir_file_backend backend;
+
+    /**
+     * The size, in bytes, at which the file is rolled/archived. If zero,
+     * ::SIR_FROLLSIZE. Otherwise, it must be at least ::SIR_MAXOUTPUT.
+     */
+    uint64_t roll_size;
+
+    /**
+     * If not ::SIRRI_NONE, the file is also rolled when the first message
+     * after an hour or day boundary is written to it.
+     */
+    sir_roll_interval roll_interval;
+
+    /**
+     * If true, each archive made when the file is rolled is gzip-compressed
+     * (to `<archive>.gz`) by a low-priority background thread, and the
+     * uncompressed archive is then removed.
+     */
+    bool compress;
+
+    /**
+     * If non-zero, at most this many of the file's archives are kept; the
+     * oldest are deleted after each roll.
+     */
+    uint32_t max_archives;
+
+    /**
+     * If non-zero, the oldest of the file's archives are deleted after each
+     * roll until all of them together take up no more than this many bytes.
+     */
+    uint64_t max_archive_bytes;
+
+    /**
+     * If non-zero, archives last modified more than this many seconds before a
+     * roll are deleted.
+     */
+    uint32_t max_archive_age;
+} sir_file_policy;
+
+/**
+ * @struct sir_async_cfg
+ * @brief Configuration for asynchronous (queued) message delivery.
+ *
+ * @see ::sirinit
+ */
+typedef struct {
+    /**
+     * If `true`, the calling thread only captures the time stamp, thread
+     * identifier, and formatted message, and places them in a bounded
+     * lock-free queue. A dedicated libsir thread drains the queue, and
+     * formats and writes to all destinations.
+     *
+     * @note In this mode, a `true` return value from a logging function means
+     * the message was queued, not that it has been delivered. Call
+     * ::sir_cleanup to drain the queue.
+     */
+    bool enabled;
+
+    /**
+     * The number of messages the queue can hold (rounded up to the next power
+     * of two). If zero, ::SIR_ASYNC_QUEUESIZE is used. When the queue is full,
+     * logging threads wait for the worker to free up space rather than drop
+     * messages.
+     */
+    uint32_t queue_size;
+
+    /**
+     * If `true` (and `enabled` is `true`), the calling thread does not format
+     * the message either: it records the format string pointer and a compact
+     * copy of the arguments, and the worker thread produces the text.
+     *
+     * @attention The format string must remain valid until the message has
+     * been delivered; string literals are always safe. Arguments for `%s` are
+     * copied, so they need not outlive the call.
+     *
+     * @note Messages whose format strings use `*` for width or precision,
+     * positional arguments, or wide characters/strings (or whose arguments do
+     * not fit in ::SIR_MAXMESSAGE bytes) are formatted by the calling thread.
+     */
+    bool deferred;
+} sir_async_cfg;
+
+/**
+ * @struct sir_dest_ops
+ * @brief The functions libsir calls to deliver output to a custom destination.
+ *
+ * Each function is passed the `ctx` pointer given to ::sir_adddest.
+ *
+ * @see ::sir_adddest
+ */
+typedef struct {
+    /**
+     * Writes one formatted message. `line` is terminated by a newline (which
+     * `len` includes) and a null character, as written to log files. Return
+     * `false` if the message could not be written.
+     *
+     * @note Called by logging threads, possibly by several at once, unless
+     * ::SIRO_QUEUED is set, in which case it is only called by the
+     * destination's own libsir thread.
+     */
+    bool (*write)(void* ctx, const char* line, size_t len, sir_level level);
+
+    /**
+     * Optional. Called after a queued destination's thread has written every
+     * message waiting for it, and before the destination is closed.
+     */
+    void (*flush)(void* ctx);
+
+    /**
+     * Optional. Called once, when the destination is removed (or by
+     * ::sir_cleanup), after its last message has been written.
+     */
+    void (*close)(void* ctx);
+} sir_dest_ops;
+
 /**
  * @struct sirinit
  * @brief libsir initialization and configuration data.
@@ -190,11 +417,14 @@ typedef struct {
  * @see ::sir_makeinit
  * @see ::sir_stdio_dest
  * @see ::sir_syslog_dest
+ * @see ::sir_remote_dest
+ * @see ::sir_async_cfg
  */
 typedef struct {
     sir_stdio_dest d_stdout;  /**< stdout configuration. */
     sir_stdio_dest d_stderr;  /**< stderr configuration. */
     sir_syslog_dest d_syslog; /**< System logger configuration. */
+    sir_remote_dest d_remote; /**< Remote syslog configuration (disabled by default). */
 
     /**
      * If set, defines the name that will appear in messages sent to stdio and
@@ -204,6 +434,9 @@ typedef struct {
      * log messages.
      */
     char name[SIR_MAXNAME];
+
+    /** Asynchronous delivery configuration (disabled by default). */
+    sir_async_cfg async;
 } sirinit;
 
 /**
@@ -231,14 +464,21 @@ typedef void (*invalparamfn)(const wchar_t*, const wchar_t*, const wchar_t*,
     unsigned int, uintptr_t);
 # endif
 
+/** Routing bits for the destinations configured by ::sirinit (see ::sirconfig). */
+# define _SIR_ROUTE_STDOUT 0x01
+# define _SIR_ROUTE_STDERR 0x02
+# define _SIR_ROUTE_SYSLOG 0x04
+# define _SIR_ROUTE_REMOTE 0x08
+
 /** Internally-used global config container. */
 typedef struct {
     sirinit si;
     struct {
         char hostname[SIR_MAXHOST];
-        time_t last_hname_chk;
         char pidbuf[SIR_MAXPID];
         pid_t pid;
+        /** For each level, the `_SIR_ROUTE_*` destinations that want it. */
+        uint8_t routes[SIR_NUMLEVELS];
     } state;
 } sirconfig;
 
@@ -248,6 +488,38 @@ typedef struct {
     const char* const message;
 } sirerror;
 
+/** A stream the housekeeping thread opens or closes on behalf of a log file. */
+typedef struct {
+    FILE* f;
+    char* vbuf;    /**< The stdio buffer, if any. */
+    char* archive; /**< What the log file is archived as, once this stream is taken over from. */
+} sirfilestream;
+
+/** Progress of rolling a log file in the background. */
+typedef enum {
+    SIRFR_NONE = 0,  /**< Not yet close to the roll size. */
+    SIRFR_WANTNEXT,  /**< Close to it; the housekeeping thread is to open `next`. */
+    SIRFR_READY,     /**< `next` is ready to take over. */
+    SIRFR_SYNC,      /**< `next` could not be opened; the logging thread rolls the file. */
+    SIRFR_ARCHIVING  /**< `next` has taken over; the housekeeping thread archives `rolled`. */
+} sir_fileroll;
+
+/** An io_uring instance writing to a log file (see siruring.h). */
+typedef struct sir_uring sir_uring;
+
+/** A memory-mapped window into a log file (see sirfilemap.h). */
+typedef struct sir_filemap sir_filemap;
+
+/** A custom destination (see sirdest.h). */
+typedef struct sirdest sirdest;
+
+/** Custom destination cache. */
+typedef struct {
+    sirdest* dests[SIR_MAXDESTS]; /**< Contiguous, in the order they were added. */
+    size_t count;
+    sirdestid nextid; /**< Never reused, so a stale ::sirdestid matches nothing. */
+} sirdcache;
+
 /** Log file data. */
 typedef struct {
     char* path;
@@ -255,14 +527,63 @@ typedef struct {
     sir_options opts;
     FILE* f;
     int id;
+    long size;       /**< Bytes written to the file, including those still buffered. */
+    uint32_t writes; /**< Writes since `size` was last checked against the file system. */
+    sir_mutex mutex; /**< Serializes writing (and rolling) among dispatching threads. */
+    sir_file_policy policy; /**< Buffering and flushing policy. */
+    char* vbuf;      /**< The stdio buffer, if `policy.buffer_size` is non-zero. */
+    uint64_t dirty;  /**< When unflushed data was first written (msec since the epoch), or 0. */
+    sir_uring* uring; /**< Writes the file instead of `f` if `policy.backend` is ::SIRFB_URING. */
+    sir_filemap* map; /**< Writes the file instead of `f` if `policy.backend` is ::SIRFB_MMAP. */
+    sir_fileroll roll;    /**< Progress of rolling in the background. */
+    time_t rollat;        /**< When `policy.roll_interval` next rolls the file, or 0. */
+    sirfilestream next;   /**< Opened at `path` + ::SIR_FNEXTEXT to take over when rolling. */
+    sirfilestream rolled; /**< What `next` took over from, until it is archived. */
 } sirfile;
 
+/** An entry in one of the file cache's hash indexes. */
+typedef struct {
+    uint32_t hash; /**< Hash of the key, so that entries can be moved without rehashing. */
+    uint32_t pos;  /**< Position of the file in `files`, plus one; 0 if the slot is empty. */
+} sir_fcache_slot;
+
 /** Log file cache. */
 typedef struct {
-    sirfile* files[SIR_MAXFILES];
+    sirfile** files;  /**< Contiguous, so that dispatching iterates over as little as possible. */
     size_t count;
+    size_t capacity;
+    sir_fcache_slot* bypath; /**< Open-addressed (linear probing) index on path. */
+    sir_fcache_slot* byid;   /**< Open-addressed (linear probing) index on ::sirfileid. */
+    size_t slots;            /**< Size of each index; a power of two, > 2 * `capacity`. */
+    /**
+     * For each level, the files that want it: those for the level at index
+     * `n` (see ::_sir_levelindex) are `routed[routeoff[n]]` up to (not
+     * including) `routed[routeoff[n + 1]]`. Room for `capacity` *
+     * ::SIR_NUMLEVELS entries is kept, so rebuilding the table never fails.
+     */
+    sirfile** routed;
+    size_t routeoff[SIR_NUMLEVELS + 1];
 } sirfcache;
 
+/** Where in the source a message was logged from (see ::sir_logat). */
+typedef struct {
+    const char* file; /**< NULL if unknown. */
+    const char* func; /**< NULL if unknown. */
+    uint32_t line;
+} sirsrcloc;
+
+/** A message captured by a logging thread, prior to formatting. */
+typedef struct {
+    sir_level level;
+    time_t now;
+    long msec;
+    pid_t tid;
+    char tname[SIR_MAXPID];
+    sirsrcloc loc;
+    const char* format; /**< If non-NULL, `message` holds recorded arguments. */
+    char message[SIR_MAXMESSAGE];
+} sirmsg;
+
 /** Formatted output container. */
 typedef struct {
     char style[SIR_MAXSTYLE];
@@ -273,9 +594,20 @@ typedef struct {
     const char* level;
     const char* name;
     char tid[SIR_MAXPID];
-    char message[SIR_MAXMESSAGE];
-    char output[SIR_MAXOUTPUT];
-    size_t output_len;
+    const char* message;
+    time_t now; /**< When the message was logged (-1 if unknown). */
+    const sirmsg* src; /**< The captured message this output is formatted from. */
+
+    /** Output for each distinct combination of styling and options. */
+    struct {
+        bool styling;
+        sir_options opts;
+        size_t len;
+        char output[SIR_MAXOUTPUT];
+    } fmt[SIR_MAXFMTCACHE];
+
+    size_t nfmt;       /**< Number of times output has been formatted. */
+    size_t output_len; /**< Length of the output last returned by _sir_format. */
 } sirbuf;
 
 /** ::sir_level <-> ::sir_textstyle mapping. */
@@ -302,6 +634,7 @@ typedef enum {
     SIRMI_CONFIG = 0, /**< The ::sirconfig section. */
     SIRMI_FILECACHE,  /**< The ::sirfcache section. */
     SIRMI_TEXTSTYLE,  /**< The ::sir_level_style_tuple section. */
+    SIRMI_DESTCACHE,  /**< The ::sirdcache section. */
 } sir_mutex_id;
 
 /** Error type. */
@@ -317,13 +650,21 @@ typedef struct {
     } loc;
 } sir_thread_err;
 
+/** Per-thread identity data, cached so that it is not queried for every message. */
+typedef struct {
+    pid_t tid;
+    bool cached;
+    char name[SIR_MAXPID];
+} sir_thread_info;
+
 /** Bitmask defining which values are to be updated in the global config. */
 typedef enum {
     SIRU_LEVELS     = 0x00000001, /**< Update level registrations. */
     SIRU_OPTIONS    = 0x00000002, /**< Update formatting options. */
     SIRU_SYSLOG_ID  = 0x00000004, /**< Update system logger identity. */
     SIRU_SYSLOG_CAT = 0x00000008, /**< Update system logger category. */
-    SIRU_ALL        = 0x0000000f  /**< Update all available fields. */
+    SIRU_POLICY     = 0x00000010, /**< Update log file buffering/flushing policy. */
+    SIRU_ALL        = 0x0000001f  /**< Update all available fields. */
 } sir_config_data_field;
 
 /** Encapsulates dynamic updating of current configuration. */
@@ -333,6 +674,7 @@ typedef struct {
     sir_options* opts;       /**< Formatting options. */
     const char* sl_identity; /**< System logger identity. */
     const char* sl_category; /**< System logger category. */
+    const sir_file_policy* policy; /**< Log file buffering/flushing policy. */
 } sir_update_config_data;
 
 /** Bitmask defining the state of a system logger facility. */
@@ -343,7 +685,8 @@ typedef enum {
     SIRSL_CATEGORY = 0x00000008, /**< Category. */
     SIRSL_IDENTITY = 0x00000010, /**< Identity. */
     SIRSL_UPDATED  = 0x00000020, /**< Config has been updated. */
-    SIRSL_IS_INIT  = 0x00000040  /**< Subsystem is initialized. */
+    SIRSL_IS_INIT  = 0x00000040, /**< Subsystem is initialized. */
+    SIRSL_JOURNAL  = 0x00000080  /**< Messages go to systemd's journal. */
 } sir_syslog_state;
 
 #endif /* !_SIR_TYPES_H_INCLUDED */
@@ -0,0 +1,408 @@
+/*
+ * siruring.c
+ *
+ * Author:    Ryan M. Lederman <lederman@gmail.com>
+ * Copyright: Copyright (c) 2018-2023
+ * Version:   2.2.0
+ * License:   The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "siruring.h"
+#include "sirinternal.h"
+
+#if defined(SIR_IOURING_ENABLED)
+# include <linux/io_uring.h>
+# include <sys/mman.h>
+# include <sys/uio.h>
+
+/** Submission queue size; there is never more than one entry per buffer. */
+# define _SIR_URING_ENTRIES (SIR_URING_NBUFS * 2)
+
+struct sir_uring {
+    int ring;          /**< The io_uring instance. */
+    int fd;            /**< The log file (not `O_APPEND`; writes go to explicit offsets). */
+    bool fixedfile;    /**< Whether `fd` is registered with the ring. */
+    bool fixedbufs;    /**< Whether the buffers are registered with the ring. */
+
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned* sq_array;
+    struct io_uring_sqe* sqes;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    struct io_uring_cqe* cqes;
+
+    void* sq_map;
+    size_t sq_maplen;
+    void* cq_map;
+    size_t cq_maplen;
+    size_t sqes_len;
+
+    char* mem;         /**< ::SIR_URING_NBUFS contiguous buffers. */
+    uint32_t bufsize;
+    struct {
+        uint64_t offset;
+        uint32_t len;
+        bool busy;
+    } bufs[SIR_URING_NBUFS];
+
+    uint32_t cur;         /**< The buffer being filled. */
+    uint32_t fill;        /**< Bytes in the current buffer. */
+    uint64_t offset;      /**< Where the current buffer goes in the file. */
+    uint32_t inflight;    /**< Buffers handed to the kernel and not yet reaped. */
+    uint32_t unsubmitted; /**< Entries queued that the kernel has not yet taken. */
+};
+
+static inline
+int _sir_uring_enter(sir_uring* ur, unsigned wait) {
+    int enter = -1;
+    do {
+        enter = (int)syscall(__NR_io_uring_enter, ur->ring, ur->unsubmitted, wait,
+            wait > 0 ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+    } while (-1 == enter && EINTR == errno);
+
+    if (enter > 0)
+        ur->unsubmitted -= (uint32_t)enter;
+
+    return enter;
+}
+
+static
+bool _sir_uring_setup(sir_uring* ur, const char* path) {
+    ur->fd = open(path, O_WRONLY | O_CLOEXEC);
+    if (-1 == ur->fd) {
+        _sir_handleerr(errno);
+        return false;
+    }
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    ur->ring = (int)syscall(__NR_io_uring_setup, _SIR_URING_ENTRIES, &params);
+    if (-1 == ur->ring) {
+        _sir_handleerr(errno);
+        return false;
+    }
+
+    ur->sq_maplen = params.sq_off.array + (params.sq_entries * sizeof(unsigned));
+    ur->cq_maplen = params.cq_off.cqes + (params.cq_entries * sizeof(struct io_uring_cqe));
+
+    bool single = _sir_bittest(params.features, IORING_FEAT_SINGLE_MMAP);
+    if (single) {
+        if (ur->cq_maplen > ur->sq_maplen)
+            ur->sq_maplen = ur->cq_maplen;
+        ur->cq_maplen = ur->sq_maplen;
+    }
+
+    ur->sq_map = mmap(NULL, ur->sq_maplen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+        ur->ring, IORING_OFF_SQ_RING);
+    if (MAP_FAILED == ur->sq_map) {
+        ur->sq_map = NULL;
+        _sir_handleerr(errno);
+        return false;
+    }
+
+    if (single) {
+        ur->cq_map = ur->sq_map;
+    } else {
+        ur->cq_map = mmap(NULL, ur->cq_maplen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+            ur->ring, IORING_OFF_CQ_RING);
+        if (MAP_FAILED == ur->cq_map) {
+            ur->cq_map = NULL;
+            _sir_handleerr(errno);
+            return false;
+        }
+    }
+
+    ur->sqes_len = params.sq_entries * sizeof(struct io_uring_sqe);
+    ur->sqes     = (struct io_uring_sqe*)mmap(NULL, ur->sqes_len, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, ur->ring, IORING_OFF_SQES);
+    if (MAP_FAILED == ur->sqes) {
+        ur->sqes = NULL;
+        _sir_handleerr(errno);
+        return false;
+    }
+
+    char* sq     = (char*)ur->sq_map;
+    ur->sq_head  = (unsigned*)(sq + params.sq_off.head);
+    ur->sq_tail  = (unsigned*)(sq + params.sq_off.tail);
+    ur->sq_mask  = (unsigned*)(sq + params.sq_off.ring_mask);
+    ur->sq_array = (unsigned*)(sq + params.sq_off.array);
+
+    char* cq    = (char*)ur->cq_map;
+    ur->cq_head = (unsigned*)(cq + params.cq_off.head);
+    ur->cq_tail = (unsigned*)(cq + params.cq_off.tail);
+    ur->cq_mask = (unsigned*)(cq + params.cq_off.ring_mask);
+    ur->cqes    = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+
+    ur->mem = (char*)mmap(NULL, (size_t)ur->bufsize * SIR_URING_NBUFS, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (MAP_FAILED == ur->mem) {
+        ur->mem = NULL;
+        _sir_handleerr(errno);
+        return false;
+    }
+
+    /* registration saves the kernel mapping the buffers and looking up the file
+     * on every write; without it (e.g. RLIMIT_MEMLOCK), io_uring still works. */
+    struct iovec iov[SIR_URING_NBUFS];
+    for (size_t n = 0; n < SIR_URING_NBUFS; n++) {
+        iov[n].iov_base = ur->mem + (n * ur->bufsize);
+        iov[n].iov_len  = ur->bufsize;
+    }
+
+    ur->fixedbufs = 0 == syscall(__NR_io_uring_register, ur->ring, IORING_REGISTER_BUFFERS,
+        iov, SIR_URING_NBUFS);
+    if (!ur->fixedbufs)
+        _sir_selflog("warning: failed to register buffers (%d); not using fixed buffers", errno);
+
+    ur->fixedfile = 0 == syscall(__NR_io_uring_register, ur->ring, IORING_REGISTER_FILES,
+        &ur->fd, 1);
+    if (!ur->fixedfile)
+        _sir_selflog("warning: failed to register file (%d); not using a fixed file", errno);
+
+    return true;
+}
+
+static
+void _sir_uring_teardown(sir_uring* ur) {
+    if (ur->mem)
+        (void)munmap(ur->mem, (size_t)ur->bufsize * SIR_URING_NBUFS);
+    if (ur->sqes)
+        (void)munmap(ur->sqes, ur->sqes_len);
+    if (ur->cq_map && ur->cq_map != ur->sq_map)
+        (void)munmap(ur->cq_map, ur->cq_maplen);
+    if (ur->sq_map)
+        (void)munmap(ur->sq_map, ur->sq_maplen);
+
+    _sir_safeclose(&ur->ring);
+    _sir_safeclose(&ur->fd);
+}
+
+/** Releases a buffer the kernel is done with, writing whatever it did not. */
+static
+void _sir_uring_complete(sir_uring* ur, uint64_t idx, int32_t res) {
+    SIR_ASSERT(idx < SIR_URING_NBUFS && ur->bufs[idx].busy);
+    if (idx >= SIR_URING_NBUFS || !ur->bufs[idx].busy)
+        return;
+
+    uint32_t written = res > 0 ? (uint32_t)res : 0U;
+    if (written < ur->bufs[idx].len) {
+        if (res < 0)
+            _sir_selflog("error: write of %" PRIu32 " bytes failed (%" PRId32 "); retrying"
+                         " with write(2)", ur->bufs[idx].len, -res);
+
+        const char* rest = ur->mem + (idx * ur->bufsize) + written;
+        size_t left      = ur->bufs[idx].len - written;
+        off_t offset     = (off_t)(ur->bufs[idx].offset + written);
+
+        while (left > 0) {
+            ssize_t wrote = pwrite(ur->fd, rest, left, offset);
+            if (-1 == wrote) {
+                if (EINTR == errno)
+                    continue;
+                _sir_handleerr(errno);
+                break;
+            }
+
+            rest   += wrote;
+            left   -= (size_t)wrote;
+            offset += wrote;
+        }
+    }
+
+    ur->bufs[idx].busy = false;
+    ur->inflight--;
+}
+
+/** Waits for at least one write to complete, then reaps. */
+static
+bool _sir_uring_wait(sir_uring* ur) {
+    if (-1 == _sir_uring_enter(ur, 1)) {
+        _sir_handleerr(errno);
+        return false;
+    }
+
+    _sir_uring_reap(ur);
+    return true;
+}
+
+/** Hands the current buffer to the kernel, then moves on to the next one. */
+static
+bool _sir_uring_submit(sir_uring* ur) {
+    if (0 == ur->fill)
+        return true;
+
+    uint32_t idx  = ur->cur;
+    unsigned tail = *ur->sq_tail;
+    unsigned slot = tail & *ur->sq_mask;
+
+    struct io_uring_sqe* sqe = &ur->sqes[slot];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode    = ur->fixedbufs ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+    sqe->fd        = ur->fixedfile ? 0 : ur->fd;
+    sqe->flags     = ur->fixedfile ? IOSQE_FIXED_FILE : 0;
+    sqe->addr      = (uint64_t)(uintptr_t)(ur->mem + ((size_t)idx * ur->bufsize));
+    sqe->len       = ur->fill;
+    sqe->off       = ur->offset;
+    sqe->buf_index = (uint16_t)idx;
+    sqe->user_data = idx;
+
+    ur->sq_array[slot] = slot;
+    __atomic_store_n(ur->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    ur->bufs[idx].offset = ur->offset;
+    ur->bufs[idx].len    = ur->fill;
+    ur->bufs[idx].busy   = true;
+    ur->inflight++;
+    ur->unsubmitted++;
+
+    ur->offset += ur->fill;
+    ur->fill    = 0;
+    ur->cur     = (ur->cur + 1) % SIR_URING_NBUFS;
+
+    /* if the kernel can't take it now (e.g. EAGAIN), the next enter retries. */
+    if (-1 == _sir_uring_enter(ur, 0))
+        _sir_selflog("warning: io_uring_enter failed (%d); will retry", errno);
+
+    _sir_uring_reap(ur);
+
+    while (ur->bufs[ur->cur].busy) {
+        if (!_sir_uring_wait(ur))
+            return false;
+    }
+
+    return true;
+}
+
+sir_uring* _sir_uring_create(const char* path, uint32_t bufsize, uint64_t offset) {
+    if (!_sir_validstr(path))
+        return NULL;
+
+    sir_uring* ur = (sir_uring*)calloc(1, sizeof(sir_uring));
+    if (!ur) {
+        _sir_handleerr(errno);
+        return NULL;
+    }
+
+    ur->ring    = -1;
+    ur->fd      = -1;
+    ur->bufsize = bufsize < SIR_MAXOUTPUT ? SIR_MAXOUTPUT : bufsize;
+    ur->offset  = offset;
+
+    if (!_sir_uring_setup(ur, path)) {
+        _sir_selflog("error: failed to set up io_uring for '%s'!", path);
+        _sir_uring_teardown(ur);
+        _sir_safefree(&ur);
+        return NULL;
+    }
+
+    _sir_selflog("io_uring for '%s': %d x %" PRIu32 " bytes (fixed buffers: %d, fixed file: %d)",
+        path, SIR_URING_NBUFS, ur->bufsize, ur->fixedbufs, ur->fixedfile);
+    return ur;
+}
+
+bool _sir_uring_write(sir_uring* ur, const char* data, size_t len) {
+    if (!_sir_validptr(ur) || !_sir_validptr(data))
+        return false;
+
+    SIR_ASSERT(len <= ur->bufsize);
+    if (len > ur->bufsize)
+        return false;
+
+    if (len > ur->bufsize - ur->fill && !_sir_uring_submit(ur))
+        return false;
+
+    memcpy(ur->mem + ((size_t)ur->cur * ur->bufsize) + ur->fill, data, len);
+    ur->fill += (uint32_t)len;
+
+    return true;
+}
+
+bool _sir_uring_flush(sir_uring* ur) {
+    if (!_sir_validptr(ur))
+        return false;
+
+    bool flushed = _sir_uring_submit(ur);
+    while (flushed && ur->inflight > 0)
+        flushed = _sir_uring_wait(ur);
+
+    return flushed;
+}
+
+void _sir_uring_reap(sir_uring* ur) {
+    if (!_sir_validptrnofail(ur))
+        return;
+
+    unsigned head = *ur->cq_head;
+    unsigned tail = __atomic_load_n(ur->cq_tail, __ATOMIC_ACQUIRE);
+    unsigned mask = *ur->cq_mask;
+
+    for (; head != tail; head++) {
+        const struct io_uring_cqe* cqe = &ur->cqes[head & mask];
+        _sir_uring_complete(ur, cqe->user_data, cqe->res);
+    }
+
+    __atomic_store_n(ur->cq_head, head, __ATOMIC_RELEASE);
+}
+
+void _sir_uring_destroy(sir_uring** ur) {
+    if (!ur || !*ur)
+        return;
+
+    if (!_sir_uring_flush(*ur))
+        _sir_selflog("error: failed to flush io_uring writes!");
+
+    _sir_uring_teardown(*ur);
+    _sir_safefree(ur);
+}
+
+#else /* !SIR_IOURING_ENABLED */
+
+sir_uring* _sir_uring_create(const char* path, uint32_t bufsize, uint64_t offset) {
+    _SIR_UNUSED(path);
+    _SIR_UNUSED(bufsize);
+    _SIR_UNUSED(offset);
+    _sir_selflog("libsir was built without io_uring support; using stdio for '%s'", path);
+    return NULL;
+}
+
+bool _sir_uring_write(sir_uring* ur, const char* data, size_t len) {
+    _SIR_UNUSED(ur);
+    _SIR_UNUSED(data);
+    _SIR_UNUSED(len);
+    return false;
+}
+
+bool _sir_uring_flush(sir_uring* ur) {
+    _SIR_UNUSED(ur);
+    return false;
+}
+
+void _sir_uring_reap(sir_uring* ur) {
+    _SIR_UNUSED(ur);
+}
+
+void _sir_uring_destroy(sir_uring** ur) {
+    _SIR_UNUSED(ur);
+}
+
+#endif /* SIR_IOURING_ENABLED */
@@ -0,0 +1,54 @@
+/*
+ * siruring.h
+ *
+ * Author:    Ryan M. Lederman <lederman@gmail.com>
+ * Copyright: Copyright (c) 2018-2023
+ * Version:   2.2.0
+ * License:   The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef _SIR_URING_H_INCLUDED
+# define _SIR_URING_H_INCLUDED
+
+# include "sirtypes.h"
+
+/**
+ * Sets up an io_uring instance that writes to the file at `path`, starting at
+ * `offset`, using ::SIR_URING_NBUFS buffers of `bufsize` bytes each. Returns
+ * NULL if libsir was not built with io_uring support, or if the kernel does not
+ * allow its use; the caller then falls back to stdio.
+ */
+sir_uring* _sir_uring_create(const char* path, uint32_t bufsize, uint64_t offset);
+
+/**
+ * Appends `len` bytes to the current buffer, handing it to the kernel first if
+ * it is too full. Only waits if every buffer is still being written.
+ */
+bool _sir_uring_write(sir_uring* ur, const char* data, size_t len);
+
+/** Submits the current buffer, then waits until everything has been written. */
+bool _sir_uring_flush(sir_uring* ur);
+
+/** Collects completed writes without waiting for any. */
+void _sir_uring_reap(sir_uring* ur);
+
+/** Flushes and tears down an io_uring instance. */
+void _sir_uring_destroy(sir_uring** ur);
+
+#endif /* !_SIR_URING_H_INCLUDED */
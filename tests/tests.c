@@ -49,7 +49,32 @@ static sir_test sir_tests[] = {
     {"sanity-update-config",    sirtest_updatesanity, false, true},
     {"syslog",                  sirtest_syslog, false, true},
     {"os_log",                  sirtest_os_log, false, true},
-    {"filesystem",              sirtest_filesystem, false, true}
+    {"filesystem",              sirtest_filesystem, false, true},
+    {"async-delivery",          sirtest_asyncdelivery, false, true},
+    {"thread-name",             sirtest_threadname, false, true},
+    {"min-level-macros",        sirtest_minlevelmacros, false, true},
+    {"deferred-formatting",     sirtest_deferredformat, false, true},
+    {"fork-pid",                sirtest_forkpid, false, true},
+    {"file-parallel-writes",    sirtest_fileparallelwrites, false, true},
+    {"file-size-tracking",      sirtest_filesizetracking, false, true},
+    {"file-policy",             sirtest_filepolicy, false, true},
+    {"file-uring",              sirtest_fileuring, false, true},
+    {"file-mmap",               sirtest_filemmap, false, true},
+    {"file-background-roll",    sirtest_filebackgroundroll, false, true},
+    {"file-compress",           sirtest_filecompress, false, true},
+    {"file-retention",          sirtest_fileretention, false, true},
+    {"file-roll-policy",        sirtest_filerollpolicy, false, true},
+    {"level-routing",           sirtest_levelrouting, false, true},
+    {"native-syslog",           sirtest_syslogsocket, false, true},
+    {"remote-syslog",           sirtest_remotesyslog, false, true},
+    {"journald",                sirtest_journal, false, true},
+    {"custom-dest",             sirtest_customdest, false, true},
+    {"reentrant-dest",          sirtest_reentrantdest, false, true},
+    {"shm-ring",                sirtest_shmring, false, true},
+    {"time-stamp-rollover",     sirtest_timestamprollover, false, true},
+    {"config-while-logging",    sirtest_configwhilelogging, false, true},
+    {"format-per-options",      sirtest_formatperoptions, false, true},
+    {"deferred-boundary",       sirtest_deferredboundary, false, true}
 };
 
 int main(int argc, char** argv) {
@@ -187,19 +212,24 @@ bool sirtest_failnooutputdest(void) {
 
     static const char* logfilename = "nodestination.log";
 
+    pass &= !sir_levelenabled(SIRL_INFO);
     pass &= !sir_info("this goes nowhere!");
 
     if (pass) {
         print_expected_error();
 
         pass &= sir_stdoutlevels(SIRL_INFO);
+        pass &= sir_levelenabled(SIRL_INFO) && !sir_levelenabled(SIRL_DEBUG);
         pass &= sir_info("this goes to stdout");
         pass &= sir_stdoutlevels(SIRL_NONE);
+        pass &= !sir_levelenabled(SIRL_INFO);
 
         sirfileid fid = sir_addfile(logfilename, SIRL_INFO, SIRO_DEFAULT);
         pass &= NULL != fid;
+        pass &= sir_levelenabled(SIRL_INFO);
         pass &= sir_info("this goes to %s", logfilename);
         pass &= sir_filelevels(fid, SIRL_NONE);
+        pass &= !sir_levelenabled(SIRL_INFO);
         pass &= !sir_info("this goes nowhere!");
 
         if (NULL != fid)
@@ -230,13 +260,14 @@ bool sirtest_filecachesanity(void) {
     INIT(si, SIRL_ALL, 0, 0, 0);
     bool pass = si_init;
 
-    size_t numfiles               = SIR_MAXFILES + 1;
-    sirfileid ids[SIR_MAXFILES] = {0};
+    /* enough that the cache has to grow a few times. */
+    enum { numfiles = SIR_FCACHE_INITSIZE * 4 };
+    sirfileid ids[numfiles] = {0};
 
     sir_options even = SIRO_MSGONLY;
     sir_options odd  = SIRO_ALL;
 
-    for (size_t n = 0; n < numfiles - 1; n++) {
+    for (size_t n = 0; n < numfiles; n++) {
         char path[SIR_MAXPATH] = {0};
         snprintf(path, SIR_MAXPATH, "test-%zu.log", n);
         rmfile(path);
@@ -246,8 +277,8 @@ bool sirtest_filecachesanity(void) {
 
     pass &= sir_info("test test test");
 
-    /* this one should fail; max files already added. */
-    pass &= NULL == sir_addfile("should-fail.log", SIRL_ALL, SIRO_MSGONLY);
+    /* this one should fail; already managing a file at that path. */
+    pass &= NULL == sir_addfile("test-0.log", SIRL_ALL, SIRO_MSGONLY);
 
     if (pass)
         print_expected_error();
@@ -255,17 +286,17 @@ bool sirtest_filecachesanity(void) {
     sir_info("test test test");
 
     /* now remove previously added files in a different order. */
-    size_t removeorder[SIR_MAXFILES];
+    size_t removeorder[numfiles];
     memset(removeorder, -1, sizeof(removeorder));
 
     long processed = 0;
     printf("\tcreating random file ID order...\n");
 
     do {
-        size_t rnd = (size_t)getrand(SIR_MAXFILES);
+        size_t rnd = (size_t)getrand(numfiles);
         bool skip  = false;
 
-        for (size_t n = 0; n < SIR_MAXFILES; n++)
+        for (size_t n = 0; n < numfiles; n++)
             if (removeorder[n] == rnd) {
                 skip = true;
                 break;
@@ -276,21 +307,25 @@ bool sirtest_filecachesanity(void) {
 
         removeorder[processed++] = rnd;
 
-        if (processed == SIR_MAXFILES)
+        if (processed == numfiles)
             break;
     } while (true);
 
     printf("\tremove order: {");
-    for (size_t n = 0; n < SIR_MAXFILES; n++)
-        printf(" %zu%s", removeorder[n], (n < SIR_MAXFILES - 1) ? "," : "");
+    for (size_t n = 0; n < numfiles; n++)
+        printf(" %zu%s", removeorder[n], (n < numfiles - 1) ? "," : "");
     printf(" }...\n");
 
-    for (size_t n = 0; n < SIR_MAXFILES; n++) {
+    for (size_t n = 0; n < numfiles; n++) {
         pass &= sir_remfile(ids[removeorder[n]]);
 
         char path[SIR_MAXPATH] = {0};
         snprintf(path, SIR_MAXPATH, "test-%zu.log", removeorder[n]);
         rmfile(path);
+
+        /* the files that remain can still be found after the others moved. */
+        for (size_t i = n + 1; i < numfiles; i++)
+            pass &= sir_filelevels(ids[removeorder[i]], SIRL_ALL);
     }
 
     pass &= sir_info("test test test");
@@ -551,6 +586,7 @@ bool sirtest_errorsanity(void) {
         {SIR_E_UNAVAIL,   "SIR_E_UNAVAIL"},   /**< Feature is disabled or unavailable (13) */
         {SIR_E_INTERNAL,  "SIR_E_INTERNAL"},  /**< An internal error has occurred (14) */
         {SIR_E_PLATFORM,  "SIR_E_PLATFORM"},  /**< Platform error code %d: %s (15) */
+        {SIR_E_DCFULL,    "SIR_E_DCFULL"},    /**< Maximum number of custom destinations already added (16) */
         {SIR_E_UNKNOWN,   "SIR_E_UNKNOWN"},   /**< Error is not known (4095) */
     };
 
@@ -728,6 +764,8 @@ bool sirtest_optionssanity(void) {
     printf(INDENT_ITEM WHITE("valid option: %08" PRIx32) "\n", SIRO_NOTID);
     pass &= _sir_validopts(SIRO_NOHDR);
     printf(INDENT_ITEM WHITE("valid option: %08" PRIx32) "\n", SIRO_NOHDR);
+    pass &= _sir_validopts(SIRO_QUEUED);
+    printf(INDENT_ITEM WHITE("valid option: %08" PRIx32) "\n", SIRO_QUEUED);
     pass &= _sir_validopts(SIRO_MSGONLY);
     printf(INDENT_ITEM WHITE("valid option: %08" PRIx32) "\n", SIRO_MSGONLY);
     PRINT_PASS(pass, "\t--- individual valid options: %s ---\n\n", PRN_PASS(pass));
@@ -742,7 +780,8 @@ bool sirtest_optionssanity(void) {
         SIRO_NOMSEC,
         SIRO_NOPID,
         SIRO_NOTID,
-        SIRO_NOHDR
+        SIRO_NOHDR,
+        SIRO_QUEUED
     };
 
     printf("\t" WHITEB("--- random bitmask of valid options ---") "\n");
@@ -798,10 +837,10 @@ bool sirtest_optionssanity(void) {
         printf(INDENT_ITEM WHITE("SIRO_MSGONLY >< SIRO_NOHDR: %08" PRIx32) "\n", o);
     }
 
-    /* greater than SIRO_NOHDR. */
-    invalid = (0xFFFF0000 & ~SIRO_NOHDR);
+    /* greater than SIRO_QUEUED. */
+    invalid = (0xFFFF0000 & ~(SIRO_NOHDR | SIRO_QUEUED));
     pass &= !_sir_validopts(invalid);
-    printf(INDENT_ITEM WHITE("greater than SIRO_NOHDR: %08" PRIx32) "\n", invalid);
+    printf(INDENT_ITEM WHITE("greater than SIRO_QUEUED: %08" PRIx32) "\n", invalid);
 
     PRINT_PASS(pass, "\t--- invalid values: %s ---\n\n", PRN_PASS(pass));
 
@@ -898,6 +937,62 @@ bool sirtest_levelssanity(void) {
     return print_result_and_return(pass);
 }
 
+static int compare_floats(const void* a, const void* b) {
+    float fa = *(const float*)a;
+    float fb = *(const float*)b;
+    return (fa > fb) - (fa < fb);
+}
+
+/** Median time spent in the logging call (not delivery) in deferred async mode. */
+static bool perf_deferred_median(const char* logfilename, float* median) {
+    static const size_t rounds = 10;
+    static const size_t calls  = 32768;
+
+    float* samples = calloc(rounds * calls, sizeof(float));
+    if (!samples) {
+        handle_os_error(true, "calloc(%zu) failed!", rounds * calls * sizeof(float));
+        return false;
+    }
+
+    printf("\t" BLUE("%zu lines libsir(log file, async, deferred)...") "\n", rounds * calls);
+
+    /* the cost of reading the timer itself, subtracted from each sample. */
+    sir_timer timer = {0};
+    for (size_t n = 0; n < calls; n++) {
+        startsirtimer(&timer);
+        samples[n] = sirtimerelapsed(&timer);
+    }
+    qsort(samples, calls, sizeof(float), compare_floats);
+    float overhead = samples[calls / 2];
+
+    bool pass = true;
+    for (size_t r = 0; pass && r < rounds; r++) {
+        INIT_SL(si, 0, 0, 0, 0, "");
+        si.async.enabled    = true;
+        si.async.deferred   = true;
+        si.async.queue_size = (uint32_t)calls * 2;
+        si_init             = sir_init(&si);
+        pass &= si_init;
+
+        sirfileid logid = sir_addfile(logfilename, SIRL_ALL, SIRO_NOMSEC | SIRO_NONAME);
+        pass &= NULL != logid;
+
+        for (size_t n = 0; pass && n < calls; n++) {
+            startsirtimer(&timer);
+            pass &= sir_info("lorem ipsum foo bar %s: %zu", "baz", 1234 + n);
+            samples[(r * calls) + n] = sirtimerelapsed(&timer) - overhead;
+        }
+
+        pass &= sir_cleanup();
+    }
+
+    qsort(samples, rounds * calls, sizeof(float), compare_floats);
+    *median = samples[(rounds * calls) / 2] * 1e6f;
+
+    free(samples);
+    return pass;
+}
+
 bool sirtest_perf(void) {
     static const char* logbasename = "libsir-perf";
     static const char* logext      = ".log";
@@ -915,6 +1010,7 @@ bool sirtest_perf(void) {
         float printfelapsed = 0.0f;
         float stdioelapsed  = 0.0f;
         float fileelapsed   = 0.0f;
+        float deferredmedian = 0.0f;
 
         printf("\t" BLUE("%zu lines printf...") "\n", perflines);
 
@@ -963,6 +1059,11 @@ bool sirtest_perf(void) {
             pass &= sir_remfile(logid);
         }
 
+        if (pass) {
+            sir_cleanup();
+            pass &= perf_deferred_median(logfilename, &deferredmedian);
+        }
+
         if (pass) {
             printf("\t" WHITEB("printf: ") CYAN("%zu lines in %.3fsec (%.1f lines/sec)") "\n",
                 perflines, printfelapsed / 1e3, perflines / (printfelapsed / 1e3));
@@ -972,6 +1073,8 @@ bool sirtest_perf(void) {
             printf("\t" WHITEB("libsir(log file): ")
                    CYAN("%zu lines in %.3fsec (%.1f lines/sec)") "\n",
                 perflines, fileelapsed / 1e3, perflines / (fileelapsed / 1e3));
+            printf("\t" WHITEB("libsir(deferred, caller): ")
+                   CYAN("median %.1fnsec per call") "\n", deferredmedian);
             printf("\t" WHITEB("timer resolution: ") CYAN("~%ldnsec") "\n", sirtimergetres());
         }
     }
@@ -1088,9 +1191,6 @@ static bool generic_syslog_test(const char* sl_name, const char* identity, const
     static const int runs = 5;
 
     /* repeat initializing, opening, logging, closing, cleaning up n times. */
-    sir_timer timer = {0};
-    pass &= startsirtimer(&timer);
-
     printf("\trunning %d passes of random configs (system logger: '%s', "
            "identity: '%s', category: '%s')...\n",
         runs, sl_name, identity, category);
@@ -1098,10 +1198,10 @@ static bool generic_syslog_test(const char* sl_name, const char* identity, const
     for (int i = 0; i < runs; i++) {
         /* randomly skip setting process name, identity/category to thoroughly
            test fallback routines; randomly update the config mid-run. */
-        bool set_procname = getrand_bool((uint32_t)sirtimerelapsed(&timer));
-        bool set_identity = getrand_bool((uint32_t)sirtimerelapsed(&timer));
-        bool set_category = getrand_bool((uint32_t)sirtimerelapsed(&timer));
-        bool do_update    = getrand_bool((uint32_t)sirtimerelapsed(&timer));
+        bool set_procname = getrand_bool(UINT32_MAX);
+        bool set_identity = getrand_bool(UINT32_MAX);
+        bool set_category = getrand_bool(UINT32_MAX);
+        bool do_update    = getrand_bool(UINT32_MAX);
 
         printf("\tset_procname: %d, set_identity: %d, set_category: %d, do_update: %d\n",
             set_procname, set_identity, set_category, do_update);
@@ -1597,102 +1697,2729 @@ unsigned sirtest_thread(void* arg) {
 #endif
 }
 
-/*
-bool sirtest_XXX(void) {
+bool sirtest_asyncdelivery(void) {
+    static const char* logfilename = "libsir-async.log";
+    static const size_t lines      = 10000;
 
-    INIT(si, SIRL_ALL, 0, 0, 0);
-    bool pass = si_init;
+    INIT_SL(si, 0, 0, 0, 0, "async");
+    si.async.enabled    = true;
+    si.async.queue_size = 16; /* small, so that producers wait on the worker. */
+    si_init             = sir_init(&si);
+    bool pass           = si_init;
 
-    sir_cleanup();
+    rmfile(logfilename);
+
+    sirfileid fid = sir_addfile(logfilename, SIRL_ALL, SIRO_MSGONLY | SIRO_NOHDR);
+    pass &= NULL != fid;
+
+    if (pass) {
+        printf("\t" BLUE("queueing %zu messages...") "\n", lines);
+
+        for (size_t n = 0; n < lines; n++)
+            pass &= sir_info("async #%zu", n);
+    }
+
+    /* everything queued must be in the file once sir_cleanup returns. */
+    pass &= sir_cleanup();
+
+    if (pass) {
+        FILE* f = fopen(logfilename, "r");
+        pass &= NULL != f;
+
+        if (pass) {
+            char line[SIR_MAXOUTPUT] = {0};
+            size_t count             = 0;
+
+            while (pass && NULL != fgets(line, SIR_MAXOUTPUT, f)) {
+                const char* msg = strstr(line, "async #");
+                size_t n        = 0;
+
+                pass &= NULL != msg && 1 == sscanf(msg, "async #%zu", &n) && n == count;
+                count++;
+            }
+
+            pass &= count == lines;
+            printf("\t" WHITE("%zu/%zu lines delivered in order") "\n", count, lines);
+
+            fclose(f);
+        }
+    }
+
+    rmfile(logfilename);
     return print_result_and_return(pass);
 }
-*/
 
-/* ========================== end tests ========================== */
+bool sirtest_deferredformat(void) {
+    static const char* logfilename = "libsir-deferred.log";
 
-bool print_test_error(bool result, bool expected) {
-    char message[SIR_MAXERROR] = {0};
-    uint16_t code              = sir_geterror(message);
+    INIT_SL(si, 0, 0, 0, 0, "deferred");
+    si.async.enabled  = true;
+    si.async.deferred = true;
+    si_init           = sir_init(&si);
+    bool pass         = si_init;
 
-    if (!expected && !result && SIR_E_NOERROR != code)
-        printf("\t" RED("!! Unexpected (%" PRIu16 ", %s)") "\n", code, message);
-    else if (expected)
-        printf("\t" GREEN("Expected (%" PRIu16 ", %s)") "\n", code, message);
+    rmfile(logfilename);
 
-    return result;
+    sirfileid fid = sir_addfile(logfilename, SIRL_ALL, SIRO_MSGONLY | SIRO_NOHDR);
+    pass &= NULL != fid;
+
+    char expected[8][SIR_MAXMESSAGE] = {{0}};
+    char transient[32]               = {0};
+    int width                        = 6;
+
+    if (pass) {
+        /* the string argument is overwritten after each call; it must have
+         * been copied. */
+        _sir_strncpy(transient, sizeof(transient), "transient", sizeof(transient));
+        pass &= sir_info("%s|%-12s|%.4s|%5.2s|%s", transient, "left", "truncated", "ab",
+            (const char*)NULL);
+        snprintf(expected[0], SIR_MAXMESSAGE, "%s|%-12s|%.4s|%5.2s|%s", transient, "left",
+            "truncated", "ab", "(null)");
+        _sir_strncpy(transient, sizeof(transient), "clobbered", sizeof(transient));
+
+        pass &= sir_info("%d %i %+05d %hhd %hd %ld %lld %jd %zd %td", -1, 42, 7, (signed char)-8,
+            (short)-16, -32L, -64LL, (intmax_t)-128, (ssize_t)256, (ptrdiff_t)-512);
+        snprintf(expected[1], SIR_MAXMESSAGE, "%d %i %+05d %hhd %hd %ld %lld %jd %zd %td", -1,
+            42, 7, (signed char)-8, (short)-16, -32L, -64LL, (intmax_t)-128, (ssize_t)256,
+            (ptrdiff_t)-512);
+
+        pass &= sir_info("%u %#o %x %#X %lu %llu %ju %zu %08" PRIx64, 1U, 8U, 255U, 0xabcU,
+            2UL, 3ULL, (uintmax_t)4, (size_t)5, (uint64_t)0xdeadbeef);
+        snprintf(expected[2], SIR_MAXMESSAGE, "%u %#o %x %#X %lu %llu %ju %zu %08" PRIx64, 1U,
+            8U, 255U, 0xabcU, 2UL, 3ULL, (uintmax_t)4, (size_t)5, (uint64_t)0xdeadbeef);
+
+        pass &= sir_info("%f %.3e %G %10.4f %Lg %c%c 100%%", 3.14159, 0.000123, 1e20, -2.5,
+            (long double)1.5, 'o', 'k');
+        snprintf(expected[3], SIR_MAXMESSAGE, "%f %.3e %G %10.4f %Lg %c%c 100%%", 3.14159,
+            0.000123, 1e20, -2.5, (long double)1.5, 'o', 'k');
+
+        pass &= sir_info("%p", (void*)&width);
+        snprintf(expected[4], SIR_MAXMESSAGE, "%p", (void*)&width);
+
+        /* not supported for deferral; formatted by the caller instead. */
+        pass &= sir_info("%*d|%-*s|", width, 12, width, "ab");
+        snprintf(expected[5], SIR_MAXMESSAGE, "%*d|%-*s|", width, 12, width, "ab");
+
+        pass &= sir_info("no arguments at all");
+        snprintf(expected[6], SIR_MAXMESSAGE, "no arguments at all");
+    }
+
+    pass &= sir_cleanup();
+
+    if (pass) {
+        FILE* f = fopen(logfilename, "r");
+        pass &= NULL != f;
+
+        if (pass) {
+            char line[SIR_MAXOUTPUT] = {0};
+            size_t count             = 0;
+
+            while (NULL != fgets(line, SIR_MAXOUTPUT, f)) {
+                line[strcspn(line, "\r\n")] = '\0';
+                bool match = count < 7 && 0 == strcmp(line, expected[count]);
+                PRINT_PASS(match, "\t%s\n", line);
+                pass &= match;
+                count++;
+            }
+
+            pass &= 7 == count;
+            fclose(f);
+        }
+    }
+
+    rmfile(logfilename);
+    return print_result_and_return(pass);
 }
 
-void print_os_error(void) {
-    char message[SIR_MAXERROR] = {0};
-    uint16_t code              = sir_geterror(message);
-    fprintf(stderr, "\t" RED("OS error: (%" PRIu16 ", %s)") "\n", code, message);
+static bool deferencode(char* buf, size_t size, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    bool encoded = _sir_defer_encode(buf, size, format, args);
+    va_end(args);
+    return encoded;
 }
 
-bool filter_error(bool pass, uint16_t err) {
-    if (!pass) {
-        char message[SIR_MAXERROR] = {0};
-        uint16_t code              = sir_geterror(message);
-        if (code != err)
-            return false;
+bool sirtest_deferredboundary(void) {
+    INIT(si, 0, 0, 0, 0);
+    bool pass = si_init;
+
+    /* a buffer the size of a queue slot's, followed by bytes that mustn't be touched. */
+    static const size_t size  = SIR_MAXMESSAGE;
+    static const size_t guard = 64;
+    static char area[SIR_MAXMESSAGE + 64];
+    static char first[SIR_MAXMESSAGE + 1];
+    static char out[SIR_MAXMESSAGE * 2];
+    static char expected[SIR_MAXMESSAGE * 2];
+
+    /* the first string ends around the end of the buffer: after it come its
+     * terminator, the second argument's type, and the second string. */
+    size_t fits = 0;
+    for (size_t len = size - 8; len < size; len++) {
+        memset(first, 'a', len);
+        first[len] = '\0';
+        memset(area, 0x5a, sizeof(area));
+
+        bool encoded = deferencode(area, size, "%s%s", first, "the second argument");
+        bool intact  = true;
+        for (size_t n = size; n < size + guard; n++)
+            intact &= 0x5a == (unsigned char)area[n];
+
+        if (encoded) {
+            _sir_defer_format(out, sizeof(out), "%s%s", area);
+            snprintf(expected, sizeof(expected), "%s%s", first, "the second argument");
+            intact &= 0 == strcmp(out, expected);
+            fits++;
+        }
+
+        PRINT_PASS(intact, "\t%zu-byte string: %s\n", len, encoded ? "recorded" :
+            "not recorded");
+        pass &= intact;
     }
-    return true;
+
+    /* none fit with the second string after it; nothing was written past the end. */
+    pass &= 0 == fits;
+
+    /* the longest string that fits on its own, and one a character longer. */
+    memset(first, 'b', size - 3);
+    first[size - 3] = '\0';
+    pass &= deferencode(area, size, "%s", first);
+    _sir_defer_format(out, sizeof(out), "%s", area);
+    pass &= 0 == strcmp(out, first);
+
+    memset(first, 'b', size - 2);
+    first[size - 2] = '\0';
+    pass &= !deferencode(area, size, "%s", first);
+
+    sir_cleanup();
+    return print_result_and_return(pass);
 }
 
-uint32_t getrand(uint32_t upper_bound) {
-#if !defined(__WIN__)
-# if defined(__MACOS__) || defined(__BSD__)
-    return arc4random_uniform(upper_bound);
-# else
-    return (uint32_t)(random() % upper_bound);
-# endif
-#else /* __WIN__ */
-    uint32_t ctx = 0;
-    if (0 != rand_s(&ctx))
-        ctx = (uint32_t)rand();
-    return ctx % upper_bound;
+bool sirtest_forkpid(void) {
+#if defined(__WIN__)
+    printf("\t" DGRAY("fork() is not available; skipping.") "\n");
+    return true;
+#else
+    static const char* logfilename = "libsir-forkpid.log";
+
+    INIT(si, 0, 0, 0, 0);
+    bool pass = si_init;
+
+    rmfile(logfilename);
+
+    sirfileid fid = sir_addfile(logfilename, SIRL_ALL,
+        SIRO_NOTIME | SIRO_NOHOST | SIRO_NOLEVEL | SIRO_NOTID | SIRO_NOHDR);
+    pass &= NULL != fid;
+
+    char parentpid[SIR_MAXPID] = {0};
+    char childpid[SIR_MAXPID]  = {0};
+
+    if (pass) {
+        snprintf(parentpid, SIR_MAXPID, SIR_PIDFORMAT, PID_CAST getpid());
+        pass &= sir_info("parent");
+
+        /* so that buffered output is not written by both processes. */
+        fflush(NULL);
+
+        pid_t child = fork();
+        if (0 == child) {
+            /* the library's threads were not copied; cleanup must cope. */
+            bool logged = sir_info("child");
+            logged &= sir_cleanup();
+            _exit(logged ? EXIT_SUCCESS : EXIT_FAILURE);
+        } else if (-1 == child) {
+            handle_os_error(true, "fork() failed (%d)!", -1);
+            pass = false;
+        } else {
+            int status = 0;
+            pass &= child == waitpid(child, &status, 0);
+            pass &= WIFEXITED(status) && EXIT_SUCCESS == WEXITSTATUS(status);
+
+            snprintf(childpid, SIR_MAXPID, SIR_PIDFORMAT, PID_CAST child);
+        }
+
+        pass &= sir_info("parent again");
+    }
+
+    sir_cleanup();
+
+    if (pass) {
+        FILE* f = fopen(logfilename, "r");
+        pass &= NULL != f;
+
+        if (pass) {
+            static const char* expected[] = {"parent", "child", "parent again"};
+            char line[SIR_MAXOUTPUT] = {0};
+            size_t count             = 0;
+
+            while (NULL != fgets(line, SIR_MAXOUTPUT, f)) {
+                line[strcspn(line, "\r\n")] = '\0';
+                /* with no name, each line begins with the PID. */
+                const char* pid = 1 == count ? childpid : parentpid;
+                size_t pidlen   = strnlen(pid, SIR_MAXPID);
+                bool match = count < _sir_countof(expected) &&
+                    0 == strncmp(line, pid, pidlen) && (line[pidlen] < '0' || line[pidlen] > '9') &&
+                    NULL != strstr(line, expected[count]);
+                PRINT_PASS(match, "\t%s\n", line);
+                pass &= match;
+                count++;
+            }
+
+            pass &= _sir_countof(expected) == count;
+            fclose(f);
+        }
+    }
+
+    rmfile(logfilename);
+    return print_result_and_return(pass);
 #endif
 }
 
-bool rmfile(const char* filename) {
-    bool removed = false;
+#define PARALLEL_THREADS 4
+#define PARALLEL_LINES   2000
+#define PARALLEL_PADDING "lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod"
+
+/** Arguments passed to sirtest_parallelwriter. */
+typedef struct {
+    size_t index;
+    bool pass;
+} parallel_args;
+
+static sir_thread_ret SIR_THREAD_CALL sirtest_parallelwriter(void* arg) {
+    parallel_args* my_args = (parallel_args*)arg;
+    size_t t               = my_args->index;
+
+    /* even lines go to one file, odd lines to the other. */
+    for (size_t n = 0; n < PARALLEL_LINES; n++) {
+        if (0 == n % 2)
+            my_args->pass &= sir_info("t=%zu n=%zu %s", t, n, PARALLEL_PADDING);
+        else
+            my_args->pass &= sir_warn("t=%zu n=%zu %s", t, n, PARALLEL_PADDING);
+    }
 
-    /* just return true if the file doesn't exist. */
-    struct stat st;
-    if (0 != stat(filename, &st)) {
-        if (ENOENT == errno)
-            return true;
+    return (sir_thread_ret)0;
+}
 
-        handle_os_error(true, "failed to stat %s!", filename);
-        return false;
+bool sirtest_fileparallelwrites(void) {
+    static const char* logfiles[] = {"libsir-parallel-0.log", "libsir-parallel-1.log"};
+    static const char* churnfile  = "libsir-parallel-churn.log";
+
+    INIT(si, 0, 0, 0, 0);
+    bool pass = si_init;
+
+    for (size_t n = 0; n < _sir_countof(logfiles); n++)
+        rmfile(logfiles[n]);
+
+    sirfileid fid0 = sir_addfile(logfiles[0], SIRL_INFO, SIRO_MSGONLY | SIRO_NOHDR);
+    sirfileid fid1 = sir_addfile(logfiles[1], SIRL_WARN, SIRO_MSGONLY | SIRO_NOHDR);
+    pass &= NULL != fid0 && NULL != fid1;
+
+    sir_thread thrds[PARALLEL_THREADS];
+    parallel_args args[PARALLEL_THREADS] = {{0, false}};
+    size_t created = 0;
+
+    for (size_t t = 0; pass && t < PARALLEL_THREADS; t++) {
+        args[t].index = t;
+        args[t].pass  = true;
+        pass &= _sirthread_create(&thrds[t], sirtest_parallelwriter, &args[t]);
+        if (pass)
+            created++;
     }
 
-#if !defined(__WIN__)
-    removed = (0 == remove(filename));
-#else /* __WIN__ */
-    removed = FALSE != DeleteFile(filename);
-#endif
+    /* meanwhile, add and remove another file; writers must not see it half-built. */
+    for (size_t n = 0; pass && n < 50; n++) {
+        sirfileid churn = sir_addfile(churnfile, SIRL_INFO, SIRO_MSGONLY | SIRO_NOHDR);
+        pass &= NULL != churn && sir_remfile(churn);
+    }
 
-    if (!removed) {
-        handle_os_error(false, "failed to delete %s!", filename);
-    } else {
-        printf("\t" DGRAY("deleted %s (%ld bytes)...") "\n", filename,
-            (long)st.st_size);
+    for (size_t t = 0; t < created; t++) {
+        pass &= _sirthread_join(&thrds[t]);
+        pass &= args[t].pass;
     }
 
-    return removed;
+    pass &= sir_cleanup();
+    rmfile(churnfile);
+
+    /* every line must be whole, and each thread's lines must be in order. */
+    for (size_t f = 0; pass && f < _sir_countof(logfiles); f++) {
+        FILE* file = fopen(logfiles[f], "r");
+        pass &= NULL != file;
+
+        if (pass) {
+            char line[SIR_MAXOUTPUT]      = {0};
+            size_t next[PARALLEL_THREADS] = {0};
+            size_t count                  = 0;
+
+            for (size_t t = 0; t < PARALLEL_THREADS; t++)
+                next[t] = f;
+
+            while (pass && NULL != fgets(line, SIR_MAXOUTPUT, file)) {
+                size_t t = 0;
+                size_t n = 0;
+                int off  = 0;
+
+                pass &= 2 == sscanf(line, "t=%zu n=%zu %n", &t, &n, &off) &&
+                    t < PARALLEL_THREADS && n == next[t] &&
+                    0 == strncmp(line + off, PARALLEL_PADDING "\n", sizeof(PARALLEL_PADDING));
+
+                if (pass)
+                    next[t] += 2;
+                count++;
+            }
+
+            pass &= (PARALLEL_THREADS * PARALLEL_LINES / 2) == count;
+            PRINT_PASS(pass, "\t%s: %zu lines\n", logfiles[f], count);
+            fclose(file);
+        }
+    }
+
+    for (size_t n = 0; n < _sir_countof(logfiles); n++)
+        rmfile(logfiles[n]);
+
+    return print_result_and_return(pass);
 }
 
-bool deletefiles(const char* search, const char* filename, unsigned* data) {
-    if (strstr(filename, search)) {
-        rmfile(filename);
-        (*data)++;
+bool sirtest_filesizetracking(void) {
+    static const char* logfilename = "libsir-filesize.log";
+
+    INIT(si, 0, 0, 0, 0);
+    bool pass = si_init;
+
+    rmfile(logfilename);
+
+    sirfileid fid = sir_addfile(logfilename, SIRL_ALL, SIRO_MSGONLY | SIRO_NOHDR);
+    pass &= NULL != fid;
+
+    /* longer than a file header, which used to be the limit for a line. */
+    char msg[201] = {0};
+    for (size_t n = 0; n < sizeof(msg) - 1; n++)
+        msg[n] = (char)('a' + (n % 26));
+
+    const long linesize = (long)sizeof(msg); /* including the newline. */
+
+    for (size_t n = 0; pass && n < 10; n++)
+        pass &= sir_info("%s", msg);
+
+    long tracked = -1;
+    if (pass) {
+        sirfcache* sfc = _sir_locksection(SIRMI_FILECACHE);
+        sirfile* sf    = _sir_fcache_find(sfc, fid, _sir_fcache_pred_id);
+        pass &= NULL != sf;
+        if (pass) {
+            tracked = sf->size;
+            _sir_fflush(sf->f);
+        }
+        _sir_unlocksection(SIRMI_FILECACHE);
+
+        pass &= 10 * linesize == tracked;
+        PRINT_PASS(pass, "\ttracked size after 10 lines: %ld\n", tracked);
     }
-    return true;
+
+    if (pass) {
+        /* as logrotate's copytruncate would. */
+        FILE* f = fopen(logfilename, "w");
+        pass &= NULL != f;
+        if (f)
+            fclose(f);
+
+        /* the size is checked against the disk before the last of these. */
+        for (size_t n = 0; pass && n < SIR_FSIZE_CHK_WRITES; n++)
+            pass &= sir_info("%s", msg);
+    }
+
+    if (pass) {
+        struct stat st = {0};
+        sirfcache* sfc = _sir_locksection(SIRMI_FILECACHE);
+        sirfile* sf    = _sir_fcache_find(sfc, fid, _sir_fcache_pred_id);
+        pass &= NULL != sf;
+        if (pass) {
+            tracked = sf->size;
+            _sir_fflush(sf->f);
+            pass &= 0 == fstat(sf->id, &st);
+        }
+        _sir_unlocksection(SIRMI_FILECACHE);
+
+        /* 10 lines were already on disk before the file was truncated. */
+        pass &= (SIR_FSIZE_CHK_WRITES * linesize) == tracked && (long)st.st_size == tracked;
+        PRINT_PASS(pass, "\ttracked size after truncation: %ld (on disk: %ld)\n", tracked,
+            (long)st.st_size);
+    }
+
+    if (pass) {
+        FILE* f = fopen(logfilename, "r");
+        pass &= NULL != f;
+
+        if (f) {
+            char line[SIR_MAXOUTPUT] = {0};
+            pass &= NULL != fgets(line, SIR_MAXOUTPUT, f) &&
+                0 == strncmp(line, msg, sizeof(msg) - 1) && '\n' == line[sizeof(msg) - 1];
+            fclose(f);
+        }
+    }
+
+    sir_cleanup();
+    rmfile(logfilename);
+    return print_result_and_return(pass);
 }
 
-bool countfiles(const char* search, const char* filename, unsigned* data) {
-    if (strstr(filename, search))
-        (*data)++;
+static long filesizeondisk(const char* filename) {
+    struct stat st = {0};
+    return 0 == stat(filename, &st) ? (long)st.st_size : -1L;
+}
+
+bool sirtest_filepolicy(void) {
+    static const char* logfilename = "libsir-filepolicy.log";
+
+    INIT(si, 0, 0, 0, 0);
+    bool pass = si_init;
+
+    rmfile(logfilename);
+
+    sirfileid fid = sir_addfile(logfilename, SIRL_ALL, SIRO_MSGONLY | SIRO_NOHDR);
+    pass &= NULL != fid;
+
+    sir_file_policy policy = {0};
+    policy.buffer_size     = 64 * 1024;
+    policy.flush_levels    = SIRL_ERROR | SIRL_CRIT | SIRL_ALERT | SIRL_EMERG;
+    pass &= sir_filepolicy(fid, &policy);
+
+    /* invalid policies are rejected. */
+    sir_file_policy bad = policy;
+    bad.buffer_size     = SIR_FMAXBUFSIZE + 1;
+    pass &= !sir_filepolicy(fid, &bad);
+    pass &= !sir_filepolicy(fid, NULL);
+    pass &= print_test_error(pass, pass);
+
+    /* enough of them that the file's size is checked along the way, which
+     * mustn't flush it. */
+    const size_t numlines = SIR_FSIZE_CHK_WRITES + 100;
+    for (size_t n = 0; pass && n < numlines; n++)
+        pass &= sir_info("buffered line %zu", n);
+
+    long size = filesizeondisk(logfilename);
+    pass &= 0L == size;
+    PRINT_PASS(pass, "\tsize after %zu info lines: %ld\n", numlines, size);
+
+    pass &= sir_error("this flushes everything before it");
+
+    size = filesizeondisk(logfilename);
+    pass &= size > 0L;
+    PRINT_PASS(pass, "\tsize after an error: %ld\n", size);
+
+    /* buffered output may now be at most flush_msec old. */
+    policy.flush_msec = 100;
+    pass &= sir_filepolicy(fid, &policy);
+
+    long before = filesizeondisk(logfilename);
+    pass &= sir_info("flushed by the housekeeping thread");
+    pass &= before == filesizeondisk(logfilename);
+
+    sir_event ev;
+    pass &= _sirevent_create(&ev);
+
+    sir_timer timer = {0};
+    pass &= startsirtimer(&timer);
+
+    while (pass && filesizeondisk(logfilename) == before && sirtimerelapsed(&timer) < 5000.0f)
+        (void)_sirevent_wait(&ev, 10);
+
+    size = filesizeondisk(logfilename);
+    pass &= size > before;
+    PRINT_PASS(pass, "\tsize after %.0fms: %ld (was %ld)\n",
+        (double)sirtimerelapsed(&timer), size, before);
+
+    (void)_sirevent_destroy(&ev);
+
+    sir_cleanup();
+    rmfile(logfilename);
+    return print_result_and_return(pass);
+}
+
+/** Checks that a file consists of exactly `numlines` lines of "line n of numlines". */
+static bool checknumberedlines(const char* filename, size_t numlines) {
+    FILE* f = fopen(filename, "r");
+    if (!f)
+        return false;
+
+    char line[SIR_MAXOUTPUT]     = {0};
+    char expected[SIR_MAXOUTPUT] = {0};
+    size_t count = 0;
+    bool pass    = true;
+
+    while (pass && NULL != fgets(line, SIR_MAXOUTPUT, f)) {
+        (void)snprintf(expected, SIR_MAXOUTPUT, "line %zu of %zu\n", count, numlines);
+        pass &= 0 == strcmp(line, expected);
+        count++;
+    }
+
+    fclose(f);
+    pass &= numlines == count;
+    PRINT_PASS(pass, "\tread back %zu of %zu lines, in order\n", count, numlines);
+
+    return pass;
+}
+
+bool sirtest_fileuring(void) {
+    static const char* logfilename = "libsir-fileuring.log";
+    static const size_t numlines   = 5000;
+
+    INIT(si, 0, 0, 0, 0);
+    bool pass = si_init;
+
+    rmfile(logfilename);
+
+    sirfileid fid = sir_addfile(logfilename, SIRL_ALL, SIRO_MSGONLY | SIRO_NOHDR);
+    pass &= NULL != fid;
+
+    /* small buffers, so that many of them are written. */
+    sir_file_policy policy = {0};
+    policy.buffer_size     = 8192;
+    policy.backend         = SIRFB_URING;
+    pass &= sir_filepolicy(fid, &policy);
+
+    if (pass) {
+        sirfcache* sfc = _sir_locksection(SIRMI_FILECACHE);
+        sirfile* sf    = _sir_fcache_find(sfc, fid, _sir_fcache_pred_id);
+        pass &= NULL != sf;
+        if (pass)
+            printf("\t" WHITE("backend in use: %s") "\n", sf->uring ? "io_uring" : "stdio");
+#if defined(SIR_IOURING_ENABLED)
+        if (pass && !sf->uring)
+            printf("\t" YELLOW("io_uring is unavailable; testing the fallback") "\n");
+#endif
+        _sir_unlocksection(SIRMI_FILECACHE);
+    }
+
+    for (size_t n = 0; pass && n < numlines; n++)
+        pass &= sir_info("line %zu of %zu", n, numlines);
+
+    /* returning to the default policy writes everything out. */
+    sir_file_policy defaults = {0};
+    pass &= sir_filepolicy(fid, &defaults);
+    pass &= pass && checknumberedlines(logfilename, numlines);
+
+    sir_cleanup();
+    rmfile(logfilename);
+    return print_result_and_return(pass);
+}
+
+bool sirtest_filemmap(void) {
+    static const char* logfilename = "libsir-filemmap.log";
+    static const size_t numlines   = 5000;
+
+    INIT(si, 0, 0, 0, 0);
+    bool pass = si_init;
+
+    rmfile(logfilename);
+
+    sirfileid fid = sir_addfile(logfilename, SIRL_ALL, SIRO_MSGONLY | SIRO_NOHDR);
+    pass &= NULL != fid;
+
+    /* small chunks, so that the window moves along several times. */
+    sir_file_policy policy = {0};
+    policy.buffer_size     = 16 * 1024;
+    policy.backend         = SIRFB_MMAP;
+    pass &= sir_filepolicy(fid, &policy);
+
+    bool mapped = false;
+    if (pass) {
+        sirfcache* sfc = _sir_locksection(SIRMI_FILECACHE);
+        sirfile* sf    = _sir_fcache_find(sfc, fid, _sir_fcache_pred_id);
+        pass &= NULL != sf;
+        if (pass) {
+            mapped = NULL != sf->map;
+            printf("\t" WHITE("backend in use: %s") "\n", mapped ? "mmap" : "stdio");
+        }
+        _sir_unlocksection(SIRMI_FILECACHE);
+    }
+
+    long written = 0;
+    for (size_t n = 0; pass && n < numlines; n++) {
+        pass &= sir_info("line %zu of %zu", n, numlines);
+        written += (long)snprintf(NULL, 0, "line %zu of %zu\n", n, numlines);
+    }
+
+#if !defined(__WIN__)
+    /* while mapped, the file is preallocated beyond what has been written. */
+    pass &= !mapped || filesizeondisk(logfilename) > written;
+#endif
+
+    /* closing the mapping truncates the file to its actual size. */
+    sir_file_policy defaults = {0};
+    pass &= sir_filepolicy(fid, &defaults);
+    pass &= written == filesizeondisk(logfilename);
+    pass &= pass && checknumberedlines(logfilename, numlines);
+
+    if (pass) {
+        /* as if a process had died without truncating the file. */
+        FILE* f = fopen(logfilename, "a");
+        pass &= NULL != f;
+        if (f) {
+            static const char zeros[1000] = {0};
+            pass &= sizeof(zeros) == fwrite(zeros, 1, sizeof(zeros), f);
+            fclose(f);
+        }
+
+        /* the zeros are trimmed when the file is mapped again. */
+        pass &= sir_filepolicy(fid, &policy);
+        pass &= sir_filepolicy(fid, &defaults);
+
+        long size = filesizeondisk(logfilename);
+        pass &= (mapped ? written : written + 1000L) == size;
+        PRINT_PASS(pass, "\tsize after remapping: %ld (expected %ld)\n", size,
+            mapped ? written : written + 1000L);
+    }
+
+    sir_cleanup();
+    rmfile(logfilename);
+    return print_result_and_return(pass);
+}
+
+/** Waits up to `msec` milliseconds for a log file to reach a roll state. */
+static bool waitforroll(sirfileid fid, sir_fileroll state, uint32_t msec) {
+    sir_event ev;
+    if (!_sirevent_create(&ev))
+        return false;
+
+    sir_timer timer = {0};
+    bool reached    = false;
+
+    if (startsirtimer(&timer)) {
+        do {
+            sirfcache* sfc = _sir_locksection(SIRMI_FILECACHE);
+            sirfile* sf    = _sir_fcache_find(sfc, fid, _sir_fcache_pred_id);
+            if (sf && _sirmutex_lock(&sf->mutex)) {
+                reached = state == sf->roll;
+                _sirmutex_unlock(&sf->mutex);
+            }
+            _sir_unlocksection(SIRMI_FILECACHE);
+        } while (!reached && sirtimerelapsed(&timer) < (float)msec &&
+            !_sirevent_wait(&ev, 10));
+    }
+
+    (void)_sirevent_destroy(&ev);
+    return reached;
+}
+
+bool sirtest_filebackgroundroll(void) {
+#if defined(__WIN__)
+    printf("\t" DGRAY("open files can't be renamed; skipping.") "\n");
+    return true;
+#else
+    static const char* logbasename = "backgroundroll";
+    static const char* logfilename = "backgroundroll.log";
+    static const char* nextname    = "backgroundroll.log" SIR_FNEXTEXT;
+
+    unsigned delcount = 0;
+    (void)enumfiles(logbasename, deletefiles, &delcount);
+
+    /* start out close enough to the roll size that the next file is prepared. */
+    FILE* f = NULL;
+    _sir_fopen(&f, logfilename, "w");
+    if (!f) {
+        print_os_error();
+        return false;
+    }
+
+    bool pass = 0 == fseek(f, SIR_FROLLSIZE - (SIR_FROLLPREPSIZE / 2), SEEK_SET) &&
+        EOF != fputc('\n', f);
+    fclose(f);
+
+    INIT(si, 0, 0, 0, 0);
+    pass &= si_init;
+
+    sirfileid fid = sir_addfile(logfilename, SIRL_ALL, SIRO_MSGONLY);
+    pass &= NULL != fid;
+
+    pass &= sir_info("the file that takes over is opened in the background");
+    pass &= waitforroll(fid, SIRFR_READY, 5000);
+    pass &= 0L <= filesizeondisk(nextname);
+    PRINT_PASS(pass, "\t%s is ready\n", nextname);
+
+    char msg[1001] = {0};
+    memset(msg, 'x', sizeof(msg) - 1);
+
+    /* the logging thread only switches streams; it never waits for the archive. */
+    for (size_t n = 0; pass && n < (SIR_FROLLPREPSIZE / 1000) + 1; n++)
+        pass &= sir_info("%s", msg);
+
+    pass &= waitforroll(fid, SIRFR_NONE, 5000);
+
+    unsigned foundlogs = 0;
+    pass &= enumfiles(logbasename, countfiles, &foundlogs);
+    pass &= 2 == foundlogs && -1L == filesizeondisk(nextname);
+    PRINT_PASS(pass, "\tfound %u log files (expected 2), %s gone\n", foundlogs, nextname);
+
+    if (pass) {
+        /* the new file starts with the header naming the archive. */
+        char line[SIR_MAXOUTPUT] = {0};
+        f = fopen(logfilename, "r");
+        pass &= NULL != f;
+        if (f) {
+            while (NULL != fgets(line, SIR_MAXOUTPUT, f) && '\n' == line[0])
+                ;
+            fclose(f);
+        }
+        pass &= NULL != strstr(line, "archived as") && NULL != strstr(line, logbasename);
+        PRINT_PASS(pass, "\tfirst line: %s", line);
+    }
+
+    sir_cleanup();
+
+    delcount = 0;
+    (void)enumfiles(logbasename, deletefiles, &delcount);
+
+    return print_result_and_return(pass);
+#endif
+}
+
+bool sirtest_filecompress(void) {
+#if defined(__WIN__)
+    printf("\t" DGRAY("open files can't be renamed; skipping.") "\n");
+    return true;
+#else
+    static const char* logbasename = "compressroll";
+    static const char* logfilename = "compressroll.log";
+
+    unsigned delcount = 0;
+    (void)enumfiles(logbasename, deletefiles, &delcount);
+
+    /* fill the file almost up to the roll size with something log-like. */
+    FILE* f = NULL;
+    _sir_fopen(&f, logfilename, "w");
+    if (!f) {
+        print_os_error();
+        return false;
+    }
+
+    bool pass = true;
+    long written = 0L;
+    for (unsigned n = 0; pass && written < SIR_FROLLSIZE - 2000; n++) {
+        int print = fprintf(f, "12:34:56.789 info [compressroll] message number %u\n", n);
+        pass &= print > 0;
+        written += print;
+    }
+    fclose(f);
+
+    INIT(si, 0, 0, 0, 0);
+    pass &= si_init;
+
+    sirfileid fid = sir_addfile(logfilename, SIRL_ALL, SIRO_MSGONLY);
+    pass &= NULL != fid;
+
+    sir_file_policy policy = {0};
+    policy.compress = true;
+    pass &= sir_filepolicy(fid, &policy);
+
+    char msg[1001] = {0};
+    memset(msg, 'x', sizeof(msg) - 1);
+
+    for (size_t n = 0; pass && n < 3; n++)
+        pass &= sir_info("%s", msg);
+
+    /* waits for anything still being compressed. */
+    sir_cleanup();
+
+    unsigned foundlogs = 0;
+    unsigned foundgz   = 0;
+    pass &= enumfiles(logbasename, countfiles, &foundlogs);
+    pass &= enumfiles(logbasename, countgzfiles, &foundgz);
+    pass &= 2 == foundlogs && 1 == foundgz;
+    PRINT_PASS(pass, "\tfound %u log files (expected 2), %u compressed (expected 1)\n",
+        foundlogs, foundgz);
+
+    delcount = 0;
+    (void)enumfiles(logbasename, deletefiles, &delcount);
+
+    return print_result_and_return(pass);
+#endif
+}
+
+bool sirtest_fileretention(void) {
+#if defined(__WIN__)
+    printf("\t" DGRAY("open files can't be renamed; skipping.") "\n");
+    return true;
+#else
+    static const char* logbasename = "retention";
+    static const char* logfilename = "retention.log";
+    static const char* bystander   = "retention-other.log";
+
+    unsigned delcount = 0;
+    (void)enumfiles(logbasename, deletefiles, &delcount);
+
+    /* archives from days gone by, oldest first, and a file that isn't one. */
+    char oldarchives[4][SIR_MAXPATH] = {{0}};
+    bool pass = true;
+
+    for (size_t n = 0; pass && n < _sir_countof(oldarchives); n++) {
+        char stamp[SIR_MAXTIME] = {0};
+        pass &= _sir_formattime(time(NULL) - (time_t)((10 - n) * 86400), stamp,
+            SIR_FNAMETIMEFORMAT);
+        pass &= 0 < snprintf(oldarchives[n], SIR_MAXPATH, SIR_FNAMEFORMAT, logbasename,
+            stamp, "", ".log");
+
+        FILE* f = NULL;
+        pass &= 0 == _sir_fopen(&f, oldarchives[n], "w");
+        if (f) {
+            pass &= 0 < fprintf(f, "archive %zu\n", n);
+            fclose(f);
+        }
+    }
+
+    FILE* f = NULL;
+    pass &= 0 == _sir_fopen(&f, bystander, "w");
+    if (f)
+        fclose(f);
+
+    /* the log file itself is about to be rolled. */
+    pass &= 0 == _sir_fopen(&f, logfilename, "w");
+    if (!f) {
+        print_os_error();
+        return false;
+    }
+
+    pass &= 0 == fseek(f, SIR_FROLLSIZE - 2000, SEEK_SET) && EOF != fputc('\n', f);
+    fclose(f);
+
+    INIT(si, 0, 0, 0, 0);
+    pass &= si_init;
+
+    sirfileid fid = sir_addfile(logfilename, SIRL_ALL, SIRO_MSGONLY);
+    pass &= NULL != fid;
+
+    sir_file_policy policy = {0};
+    policy.max_archives = 3;
+    pass &= sir_filepolicy(fid, &policy);
+
+    char msg[1001] = {0};
+    memset(msg, 'x', sizeof(msg) - 1);
+
+    for (size_t n = 0; pass && n < 3; n++)
+        pass &= sir_info("%s", msg);
+
+    /* waits for the limits to be applied. */
+    sir_cleanup();
+
+    unsigned foundlogs = 0;
+    pass &= enumfiles(logbasename, countfiles, &foundlogs);
+    pass &= 5 == foundlogs;
+    PRINT_PASS(pass, "\tfound %u files (expected 5: the log, 3 archives, %s)\n",
+        foundlogs, bystander);
+
+    for (size_t n = 0; n < _sir_countof(oldarchives); n++) {
+        long size = filesizeondisk(oldarchives[n]);
+        bool kept = n >= 2;
+        pass &= kept == (size >= 0L);
+        PRINT_PASS(pass, "\t%s: %s (expected %s)\n", oldarchives[n],
+            size >= 0L ? "kept" : "deleted", kept ? "kept" : "deleted");
+    }
+
+    pass &= 0L <= filesizeondisk(bystander);
+
+    delcount = 0;
+    (void)enumfiles(logbasename, deletefiles, &delcount);
+
+    return print_result_and_return(pass);
+#endif
+}
+
+/** Moves a file's next time-based roll to `rollat`, returning the old one. */
+static time_t setrollat(sirfileid fid, time_t rollat) {
+    time_t old = 0;
+    sirfcache* sfc = _sir_locksection(SIRMI_FILECACHE);
+    sirfile* sf    = _sir_fcache_find(sfc, fid, _sir_fcache_pred_id);
+    if (sf && _sirmutex_lock(&sf->mutex)) {
+        old = sf->rollat;
+        if (0 != rollat)
+            sf->rollat = rollat;
+        _sirmutex_unlock(&sf->mutex);
+    }
+    _sir_unlocksection(SIRMI_FILECACHE);
+    return old;
+}
+
+bool sirtest_filerollpolicy(void) {
+#if defined(__WIN__)
+    printf("\t" DGRAY("open files can't be renamed; skipping.") "\n");
+    return true;
+#else
+    static const char* logbasename = "rollpolicy";
+    static const char* logfilename = "rollpolicy.log";
+
+    unsigned delcount = 0;
+    (void)enumfiles(logbasename, deletefiles, &delcount);
+
+    INIT(si, 0, 0, 0, 0);
+    bool pass = si_init;
+
+    sirfileid fid = sir_addfile(logfilename, SIRL_ALL, SIRO_MSGONLY);
+    pass &= NULL != fid;
+
+    printf("\t" BLUE("invalid roll sizes and intervals are rejected...") "\n");
+    sir_file_policy policy = {0};
+    policy.roll_size = 10;
+    pass &= !sir_filepolicy(fid, &policy);
+    pass &= print_expected_error();
+
+    policy.roll_size     = 0;
+    policy.roll_interval = (sir_roll_interval)(SIRRI_DAILY + 1);
+    pass &= !sir_filepolicy(fid, &policy);
+    pass &= print_expected_error();
+
+    /* rolled at the policy's size rather than SIR_FROLLSIZE. */
+    policy.roll_size     = 64 * 1024;
+    policy.roll_interval = SIRRI_HOURLY;
+    pass &= sir_filepolicy(fid, &policy);
+
+    char msg[1001] = {0};
+    memset(msg, 'x', sizeof(msg) - 1);
+
+    for (size_t n = 0; pass && n < 200; n++)
+        pass &= sir_info("%s", msg);
+
+    pass &= waitforroll(fid, SIRFR_NONE, 5000);
+
+    unsigned foundlogs = 0;
+    pass &= enumfiles(logbasename, countfiles, &foundlogs);
+    pass &= foundlogs >= 3 && filesizeondisk(logfilename) < 2 * (long)policy.roll_size;
+    PRINT_PASS(pass, "\tfound %u log files (expected >= 3), %s is %ld bytes\n",
+        foundlogs, logfilename, filesizeondisk(logfilename));
+
+    /* the next roll is due at the start of the next hour. */
+    time_t now    = time(NULL);
+    time_t rollat = setrollat(fid, 0);
+    struct tm tmbuf = {0};
+    struct tm* tm   = _sir_localtime(&rollat, &tmbuf);
+    pass &= rollat > now && rollat <= now + 3600 && tm && 0 == tm->tm_min && 0 == tm->tm_sec;
+    PRINT_PASS(pass, "\tnext roll in %ld sec at minute %d\n", (long)(rollat - now),
+        tm ? tm->tm_min : -1);
+
+    /* as if the hour had just turned over. */
+    (void)setrollat(fid, now);
+    pass &= sir_info("first message of the hour");
+    pass &= waitforroll(fid, SIRFR_NONE, 5000);
+
+    unsigned foundafter = 0;
+    pass &= enumfiles(logbasename, countfiles, &foundafter);
+    pass &= foundafter == foundlogs + 1 && setrollat(fid, 0) > now;
+    PRINT_PASS(pass, "\tfound %u log files (expected %u)\n", foundafter, foundlogs + 1);
+
+    sir_cleanup();
+
+    delcount = 0;
+    (void)enumfiles(logbasename, deletefiles, &delcount);
+
+    return print_result_and_return(pass);
+#endif
+}
+
+/** Returns the number of files in the file cache's route for `level`. */
+static size_t routedfiles(sir_level level) {
+    size_t count   = 0;
+    sirfcache* sfc = _sir_locksection(SIRMI_FILECACHE);
+    if (sfc) {
+        size_t idx = _sir_levelindex(level);
+        count = sfc->routeoff[idx + 1] - sfc->routeoff[idx];
+    }
+    _sir_unlocksection(SIRMI_FILECACHE);
+    return count;
+}
+
+bool sirtest_levelrouting(void) {
+    INIT(si, 0, 0, 0, 0);
+    bool pass = si_init;
+
+    /* only one of these wants debug messages; the rest, errors. */
+    enum { numfiles = 40, debugfile = 7 };
+    sirfileid ids[numfiles] = {0};
+
+    for (size_t n = 0; n < numfiles; n++) {
+        char path[SIR_MAXPATH] = {0};
+        snprintf(path, SIR_MAXPATH, "libsir-routing-%zu.log", n);
+        rmfile(path);
+        ids[n] = sir_addfile(path, debugfile == n ? SIRL_DEBUG : SIRL_ERROR,
+            SIRO_MSGONLY | SIRO_NOHDR);
+        pass &= NULL != ids[n];
+    }
+
+    pass &= 1 == routedfiles(SIRL_DEBUG);
+    pass &= numfiles - 1 == routedfiles(SIRL_ERROR);
+    pass &= 0 == routedfiles(SIRL_INFO);
+    pass &= sir_debug("only one file wants this");
+
+    /* this one should fail; nothing wants info messages. */
+    pass &= !sir_info("nobody wants this");
+
+    if (pass)
+        print_expected_error();
+
+    /* the routes follow changes to the levels of files and destinations. */
+    pass &= sir_filelevels(ids[0], SIRL_DEBUG | SIRL_ERROR);
+    pass &= 2 == routedfiles(SIRL_DEBUG);
+    pass &= numfiles - 1 == routedfiles(SIRL_ERROR);
+    pass &= sir_debug("two files want this");
+
+    pass &= sir_stdoutlevels(SIRL_INFO);
+    pass &= sir_info("stdout wants this");
+    pass &= sir_stdoutlevels(SIRL_NONE);
+    pass &= !sir_info("nobody wants this");
+
+    for (size_t n = 0; n < numfiles; n++) {
+        pass &= sir_remfile(ids[n]);
+
+        char path[SIR_MAXPATH] = {0};
+        snprintf(path, SIR_MAXPATH, "libsir-routing-%zu.log", n);
+
+        /* no errors were logged, so only the files that want debug messages
+         * have anything in them. */
+        long size = filesizeondisk(path);
+        pass &= (0 == n || debugfile == n) ? size > 0 : 0 == size;
+        rmfile(path);
+    }
+
+    pass &= 0 == routedfiles(SIRL_DEBUG);
+    pass &= 0 == routedfiles(SIRL_ERROR);
+
+    sir_cleanup();
+    return print_result_and_return(pass);
+}
+
+#if defined(SIR_SYSLOG_ENABLED)
+# define SYSLOG_THREADS 4
+# define SYSLOG_LINES   50
+
+/** Binds a datagram socket at `path`, standing in for the system logger. */
+static int bindsyslogstandin(const char* path) {
+    struct sockaddr_un addr = {0};
+    addr.sun_family = AF_UNIX;
+    _sir_strncpy(addr.sun_path, sizeof(addr.sun_path), path, strlen(path));
+
+    (void)unlink(path);
+    int fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+    if (-1 != fd && 0 != bind(fd, (const struct sockaddr*)&addr, sizeof(addr))) {
+        handle_os_error(true, "bind() to '%s' failed!", path);
+        (void)close(fd);
+        fd = -1;
+    }
+
+    return fd;
+}
+
+/** Receives a frame sent to the stand-in, waiting up to `msec` for one. */
+static bool recvsyslogframe(int fd, char* frame, size_t size, int msec) {
+    struct pollfd pfd = {fd, POLLIN, 0};
+    if (poll(&pfd, 1, msec) <= 0)
+        return false;
+
+    ssize_t len = recv(fd, frame, size - 1, 0);
+    if (len <= 0)
+        return false;
+
+    frame[len] = '\0';
+    return true;
+}
+
+static sir_thread_ret SIR_THREAD_CALL sirtest_syslogwriter(void* arg) {
+    parallel_args* my_args = (parallel_args*)arg;
+
+    for (size_t n = 0; n < SYSLOG_LINES; n++)
+        my_args->pass &= sir_notice("t=%zu n=%zu", my_args->index, n);
+
+    return (sir_thread_ret)0;
+}
+#endif
+
+bool sirtest_syslogsocket(void) {
+#if !defined(SIR_SYSLOG_ENABLED)
+    printf("\t" DGRAY("SIR_SYSLOG_ENABLED is not defined; skipping.") "\n");
+    return true;
+#else
+    static const char* sockname = "libsir-syslog.sock";
+
+    int standin = bindsyslogstandin(sockname);
+    bool pass   = -1 != standin;
+    _sir_syslogsock_setpath(sockname);
+# if defined(SIR_JOURNAL_ENABLED)
+    _sir_journal_setpath("libsir-nojournal.sock");
+# endif
+
+    INIT_SL(si, 0, 0, 0, 0, "");
+    si.d_syslog.opts   = SIRO_MSGONLY & ~SIRO_NOPID;
+    si.d_syslog.levels = SIRL_NOTICE;
+    _sir_strncpy(si.d_syslog.identity, SIR_MAX_SYSLOG_ID, "sirtests", SIR_MAX_SYSLOG_ID);
+    si_init = sir_init(&si);
+    pass &= si_init;
+
+    char pri[16]   = {0};
+    char ident[64] = {0};
+    snprintf(pri, sizeof(pri), "<%d>", LOG_USER | LOG_NOTICE);
+    snprintf(ident, sizeof(ident), " sirtests[%d]: ", (int)getpid());
+
+    /* every message arrives whole and framed, from threads logging at once. */
+    sir_thread thrds[SYSLOG_THREADS];
+    parallel_args args[SYSLOG_THREADS] = {{0, false}};
+    size_t created = 0;
+
+    for (size_t t = 0; pass && t < SYSLOG_THREADS; t++) {
+        args[t].index = t;
+        args[t].pass  = true;
+        pass &= _sirthread_create(&thrds[t], sirtest_syslogwriter, &args[t]);
+        if (pass)
+            created++;
+    }
+
+    bool seen[SYSLOG_THREADS][SYSLOG_LINES] = {{false}};
+    char frame[SIR_SYSLOG_MAXFRAME]         = {0};
+    size_t received                         = 0;
+
+    while (pass && received < created * SYSLOG_LINES) {
+        pass &= recvsyslogframe(standin, frame, sizeof(frame), 2000);
+
+        /* "<PRI>Mmm dd hh:mm:ss sirtests[pid]: t=... n=..." */
+        const char* id = pass ? strstr(frame, ident) : NULL;
+        size_t t = 0;
+        size_t n = 0;
+
+        pass &= 0 == strncmp(frame, pri, strlen(pri)) && NULL != id &&
+            id - frame == (ptrdiff_t)(strlen(pri) + 15) &&
+            2 == sscanf(id + strlen(ident), "t=%zu n=%zu", &t, &n) &&
+            t < SYSLOG_THREADS && n < SYSLOG_LINES && !seen[t][n];
+
+        if (pass) {
+            seen[t][n] = true;
+            received++;
+        }
+    }
+
+    for (size_t t = 0; t < created; t++) {
+        pass &= _sirthread_join(&thrds[t]);
+        pass &= args[t].pass;
+    }
+
+    printf("\treceived %zu frames from %zu threads\n", received, created);
+
+    /* the system logger restarts: reconnected to right away. */
+    (void)close(standin);
+    standin = bindsyslogstandin(sockname);
+    pass &= -1 != standin;
+    pass &= sir_notice("after restart");
+    pass &= recvsyslogframe(standin, frame, sizeof(frame), 1000) &&
+        NULL != strstr(frame, ": after restart");
+
+    /* it goes away for a while: messages are dropped until it's retried. */
+    (void)close(standin);
+    (void)unlink(sockname);
+    pass &= sir_notice("while gone");
+
+    standin = bindsyslogstandin(sockname);
+    pass &= -1 != standin;
+    pass &= sir_notice("too soon");
+    pass &= !recvsyslogframe(standin, frame, sizeof(frame), 100);
+
+    _sirthread_sleep(SIR_SYSLOG_RETRYMSEC);
+    pass &= sir_syslogopts(SIRO_MSGONLY);
+    pass &= sir_notice("back again");
+    pass &= recvsyslogframe(standin, frame, sizeof(frame), 1000) &&
+        NULL != strstr(frame, " sirtests: back again");
+
+    sir_cleanup();
+    (void)close(standin);
+    (void)unlink(sockname);
+    _sir_syslogsock_setpath(NULL);
+# if defined(SIR_JOURNAL_ENABLED)
+    _sir_journal_setpath(NULL);
+# endif
+
+    return print_result_and_return(pass);
+#endif
+}
+
+#if !defined(__WIN__)
+# define REMOTE_UDP_LINES 20
+# define REMOTE_TCP_LINES 100
+
+/** Listens on a loopback port (a free one if `*port` is 0), standing in for a collector. */
+static int listenlocal(int type, uint16_t* port) {
+    struct sockaddr_in addr = {0};
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons(*port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int on = 1;
+    socklen_t len = sizeof(addr);
+    int fd = socket(AF_INET, type, 0);
+    if (-1 == fd || 0 != setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) ||
+        0 != bind(fd, (const struct sockaddr*)&addr, sizeof(addr)) ||
+        (SOCK_STREAM == type && 0 != listen(fd, 1)) ||
+        0 != getsockname(fd, (struct sockaddr*)&addr, &len)) {
+        handle_os_error(true, "failed to listen on port %u!", (unsigned)*port);
+        if (-1 != fd)
+            (void)close(fd);
+        return -1;
+    }
+
+    *port = ntohs(addr.sin_port);
+    return fd;
+}
+
+/** Accepts a connection to the stand-in, waiting up to `msec` for one. */
+static int acceptremote(int listener, int msec) {
+    struct pollfd pfd = {listener, POLLIN, 0};
+    return poll(&pfd, 1, msec) > 0 ? accept(listener, NULL, NULL) : -1;
+}
+
+/** Receives exactly `size` bytes of the stream, waiting up to `msec` for each part. */
+static bool recvall(int fd, char* out, size_t size, int msec) {
+    for (size_t got = 0; got < size;) {
+        struct pollfd pfd = {fd, POLLIN, 0};
+        if (poll(&pfd, 1, msec) <= 0)
+            return false;
+
+        ssize_t len = recv(fd, out + got, size - got, 0);
+        if (len <= 0)
+            return false;
+        got += (size_t)len;
+    }
+
+    return true;
+}
+
+/** Receives an octet-counted (RFC 6587) message from the stream. */
+static bool recvcounted(int fd, char* msg, size_t size, int msec) {
+    size_t len = 0;
+    char digit = 0;
+
+    while (recvall(fd, &digit, 1, msec) && ' ' != digit) {
+        if (digit < '0' || digit > '9')
+            return false;
+        len = (len * 10) + (size_t)(digit - '0');
+    }
+
+    if (' ' != digit || 0 == len || len >= size || !recvall(fd, msg, len, msec))
+        return false;
+
+    msg[len] = '\0';
+    return true;
+}
+
+/**
+ * Checks that `msg` is an RFC 5424 notice from this process, with a timestamp
+ * `stamplen` characters long (0 for none), and `host`/`pid` present or not.
+ * Returns the free-form message part, or NULL.
+ */
+static const char* checkrfc5424(const char* msg, size_t stamplen, bool host, bool pid) {
+    char stamp[SIR_MAXTIME]     = {0};
+    char hostname[SIR_MAXHOST]  = {0};
+    char app[SIR_MAX_SYSLOG_ID] = {0};
+    char procid[SIR_MAXPID]     = {0};
+    char ourpid[SIR_MAXPID]     = {0};
+    int off                     = 0;
+
+    (void)snprintf(ourpid, sizeof(ourpid), "%d", (int)getpid());
+
+    if (4 != sscanf(msg, "<13>1 %63s %63s %63s %15s - - %n", stamp, hostname, app,
+        procid, &off) || 0 == off)
+        return NULL;
+
+    bool stampok = 0 == stamplen ? 0 == strcmp(stamp, "-")
+        : strlen(stamp) == stamplen && 'T' == stamp[10] && 'Z' == stamp[stamplen - 1];
+
+    if (!stampok || host == (0 == strcmp(hostname, "-")) || 0 != strcmp(app, "sirtests") ||
+        0 != strcmp(procid, pid ? ourpid : "-"))
+        return NULL;
+
+    return msg + off;
+}
+#endif
+
+bool sirtest_remotesyslog(void) {
+#if defined(__WIN__)
+    printf("\t" DGRAY("remote syslog is not available on Windows; skipping.") "\n");
+    return true;
+#else
+    char msg[SIR_REMOTE_MAXRECORD] = {0};
+    char expect[64]                = {0};
+    uint16_t port                  = 0;
+
+    /* UDP: one message per datagram, without a count. */
+    int listener = listenlocal(SOCK_DGRAM, &port);
+    bool pass    = -1 != listener;
+
+    INIT_SL(si, 0, 0, 0, 0, "sirtests");
+    si.d_syslog.levels    = SIRL_NONE;
+    si.d_remote.levels    = SIRL_NOTICE;
+    si.d_remote.port      = port;
+    si.d_remote.transport = SIRRT_UDP;
+    _sir_strncpy(si.d_remote.host, SIR_MAXHOST, "127.0.0.1", SIR_MAXHOST);
+    si_init = sir_init(&si);
+    pass &= si_init;
+
+    for (size_t n = 0; pass && n < REMOTE_UDP_LINES; n++)
+        pass &= sir_notice("udp n=%zu", n);
+
+    for (size_t n = 0; pass && n < REMOTE_UDP_LINES; n++) {
+        struct pollfd pfd = {listener, POLLIN, 0};
+        ssize_t len = poll(&pfd, 1, 2000) > 0 ? recv(listener, msg, sizeof(msg) - 1, 0) : -1;
+        pass &= len > 0;
+        if (pass) {
+            msg[len] = '\0';
+            (void)snprintf(expect, sizeof(expect), "udp n=%zu", n);
+            const char* text = checkrfc5424(msg, 24, true, true);
+            pass &= NULL != text && 0 == strcmp(text, expect);
+        }
+    }
+
+    printf("\treceived %d datagrams\n", pass ? REMOTE_UDP_LINES : -1);
+    sir_cleanup();
+    (void)close(listener);
+
+    /* TCP: octet-counted messages, in order. */
+    port     = 0;
+    listener = listenlocal(SOCK_STREAM, &port);
+    pass    &= -1 != listener;
+
+    si.d_remote.port      = port;
+    si.d_remote.transport = SIRRT_TCP;
+    si_init = sir_init(&si);
+    pass &= si_init;
+
+    for (size_t n = 0; pass && n < REMOTE_TCP_LINES; n++)
+        pass &= sir_notice("tcp n=%zu", n);
+
+    int conn = acceptremote(listener, 2000);
+    pass &= -1 != conn;
+
+    for (size_t n = 0; pass && n < REMOTE_TCP_LINES; n++) {
+        pass &= recvcounted(conn, msg, sizeof(msg), 2000);
+        (void)snprintf(expect, sizeof(expect), "tcp n=%zu", n);
+        const char* text = pass ? checkrfc5424(msg, 24, true, true) : NULL;
+        pass &= NULL != text && 0 == strcmp(text, expect);
+    }
+
+    printf("\treceived %d octet-counted messages\n", pass ? REMOTE_TCP_LINES : -1);
+
+    /* the collector goes away, and comes back: reconnected to with backoff,
+     * and nothing logged meanwhile is lost. */
+    (void)close(conn);
+    (void)close(listener);
+    pass &= sir_notice("during outage");
+    _sirthread_sleep(SIR_REMOTE_MINBACKOFF);
+
+    listener = listenlocal(SOCK_STREAM, &port);
+    pass &= -1 != listener;
+    conn = acceptremote(listener, 3000);
+    pass &= -1 != conn;
+    pass &= recvcounted(conn, msg, sizeof(msg), 2000);
+    const char* text = pass ? checkrfc5424(msg, 24, true, true) : NULL;
+    pass &= NULL != text && 0 == strcmp(text, "during outage");
+
+    /* options leave fields out. */
+    pass &= sir_remoteopts(SIRO_NOHOST | SIRO_NOPID | SIRO_NOMSEC);
+    pass &= sir_notice("fewer fields");
+    pass &= recvcounted(conn, msg, sizeof(msg), 2000);
+    text = pass ? checkrfc5424(msg, 20, false, false) : NULL;
+    pass &= NULL != text && 0 == strcmp(text, "fewer fields");
+
+    pass &= sir_remoteopts(SIRO_NOTIME);
+    pass &= sir_notice("no time");
+    pass &= recvcounted(conn, msg, sizeof(msg), 2000);
+    text = pass ? checkrfc5424(msg, 0, true, true) : NULL;
+    pass &= NULL != text && 0 == strcmp(text, "no time");
+
+    sir_cleanup();
+    if (-1 != conn)
+        (void)close(conn);
+    if (-1 != listener)
+        (void)close(listener);
+
+    return print_result_and_return(pass);
+#endif
+}
+
+#if defined(SIR_JOURNAL_ENABLED)
+# define JOURNAL_MAXDGRAM  (SIR_MAXMESSAGE * 4)
+# define JOURNAL_LARGEMSG  (4 * 1024 * 1024)
+
+/**
+ * Receives an entry sent to the journal's stand-in, waiting up to `msec` for
+ * one; if it was passed in a sealed memfd, it's read from that (`*memfd` is
+ * set). Returns the entry (free it), or NULL.
+ */
+static char* recvjournalentry(int fd, size_t* len, bool* memfd, int msec) {
+    struct pollfd pfd = {fd, POLLIN, 0};
+    char* entry       = poll(&pfd, 1, msec) > 0 ? (char*)malloc(JOURNAL_MAXDGRAM) : NULL;
+    if (!entry)
+        return NULL;
+
+    union {
+        struct cmsghdr hdr;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } control;
+    memset(&control, 0, sizeof(control));
+
+    struct iovec iov = {entry, JOURNAL_MAXDGRAM};
+    struct msghdr mh = {0};
+    mh.msg_iov        = &iov;
+    mh.msg_iovlen     = 1;
+    mh.msg_control    = control.buf;
+    mh.msg_controllen = sizeof(control.buf);
+
+    ssize_t got          = recvmsg(fd, &mh, 0);
+    struct cmsghdr* cmsg = got >= 0 ? CMSG_FIRSTHDR(&mh) : NULL;
+    *memfd               = false;
+
+    if (cmsg && SOL_SOCKET == cmsg->cmsg_level && SCM_RIGHTS == cmsg->cmsg_type) {
+        int efd = -1;
+        memcpy(&efd, CMSG_DATA(cmsg), sizeof(int));
+
+        struct stat st = {0};
+        int seals      = fcntl(efd, F_GET_SEALS);
+        got            = -1;
+
+        if (0 == fstat(efd, &st) && -1 != seals && 0 != (seals & F_SEAL_WRITE) &&
+            0 != (seals & F_SEAL_SHRINK) && st.st_size > 0) {
+            char* whole = (char*)realloc(entry, (size_t)st.st_size);
+            if (whole) {
+                entry  = whole;
+                got    = pread(efd, entry, (size_t)st.st_size, 0);
+                *memfd = true;
+            }
+        }
+
+        (void)close(efd);
+    }
+
+    if (got <= 0) {
+        _sir_safefree(&entry);
+        return NULL;
+    }
+
+    *len = (size_t)got;
+    return entry;
+}
+
+/**
+ * Looks up a field in an entry in the journal's native format, and copies its
+ * value to `value` (unless NULL). Returns the length of the value, or -1 if
+ * the field isn't there.
+ */
+static long journalfield(const char* entry, size_t len, const char* name, char* value,
+    size_t size) {
+    const char* pos = entry;
+    const char* end = entry + len;
+
+    while (pos < end) {
+        const char* eol = (const char*)memchr(pos, '\n', (size_t)(end - pos));
+        if (!eol)
+            return -1;
+
+        const char* eq  = (const char*)memchr(pos, '=', (size_t)(eol - pos));
+        const char* val = NULL;
+        size_t vallen   = 0;
+        size_t namelen  = 0;
+
+        if (eq) {
+            namelen = (size_t)(eq - pos);
+            val     = eq + 1;
+            vallen  = (size_t)(eol - val);
+        } else {
+            /* NAME, newline, 64-bit little-endian length, value, newline. */
+            if (end - eol < 9)
+                return -1;
+            namelen = (size_t)(eol - pos);
+            for (size_t n = 0; n < sizeof(uint64_t); n++)
+                vallen |= (size_t)(uint8_t)eol[1 + n] << (n * 8);
+            val = eol + 1 + sizeof(uint64_t);
+            if (vallen >= (size_t)(end - val) || '\n' != val[vallen])
+                return -1;
+            eol = val + vallen;
+        }
+
+        if (strlen(name) == namelen && 0 == memcmp(pos, name, namelen)) {
+            if (value) {
+                size_t copy = vallen < size ? vallen : size - 1;
+                memcpy(value, val, copy);
+                value[copy] = '\0';
+            }
+            return (long)vallen;
+        }
+
+        pos = eol + 1;
+    }
+
+    return -1;
+}
+#endif
+
+bool sirtest_journal(void) {
+#if !defined(SIR_JOURNAL_ENABLED)
+    printf("\t" DGRAY("SIR_JOURNAL_ENABLED is not defined; skipping.") "\n");
+    return true;
+#else
+    static const char* sockname = "libsir-journal.sock";
+
+    int standin = bindsyslogstandin(sockname);
+    bool pass   = -1 != standin;
+    _sir_journal_setpath(sockname);
+
+    INIT_SL(si, 0, 0, 0, 0, "");
+    si.d_syslog.levels = SIRL_NOTICE | SIRL_ERROR;
+    _sir_strncpy(si.d_syslog.identity, SIR_MAX_SYSLOG_ID, "sirtests", SIR_MAX_SYSLOG_ID);
+    si_init = sir_init(&si);
+    pass &= si_init;
+
+    char value[SIR_MAXMESSAGE] = {0};
+    char tid[SIR_MAXPID]       = {0};
+    size_t len                 = 0;
+    bool memfd                 = false;
+    (void)snprintf(tid, sizeof(tid), SIR_PIDFORMAT, PID_CAST _sir_gettid());
+
+    /* logged with a macro: where from comes along with the message. */
+    const uint32_t line = __LINE__ + 1;
+    pass &= SIR_NOTICE("structured %s", "entry");
+
+    char* entry = recvjournalentry(standin, &len, &memfd, 1000);
+    pass &= NULL != entry && !memfd;
+    if (entry) {
+        pass &= 0 < journalfield(entry, len, "MESSAGE", value, sizeof(value)) &&
+            0 == strcmp(value, "structured entry");
+        pass &= 0 < journalfield(entry, len, "PRIORITY", value, sizeof(value)) &&
+            0 == strcmp(value, "5");
+        pass &= 0 < journalfield(entry, len, "SYSLOG_IDENTIFIER", value, sizeof(value)) &&
+            0 == strcmp(value, "sirtests");
+        pass &= 0 < journalfield(entry, len, "CODE_FILE", value, sizeof(value)) &&
+            NULL != strstr(value, "tests.c");
+        pass &= 0 < journalfield(entry, len, "CODE_LINE", value, sizeof(value)) &&
+            line == (uint32_t)strtoul(value, NULL, 10);
+        pass &= 0 < journalfield(entry, len, "CODE_FUNC", value, sizeof(value)) &&
+            0 == strcmp(value, "sirtest_journal");
+        pass &= 0 < journalfield(entry, len, "TID", value, sizeof(value)) &&
+            0 == strcmp(value, tid);
+        _sir_safefree(&entry);
+    }
+
+    /* logged with a function: no location. newlines need the binary form. */
+    pass &= sir_error("first line\nsecond line");
+
+    entry = recvjournalentry(standin, &len, &memfd, 1000);
+    pass &= NULL != entry && !memfd;
+    if (entry) {
+        pass &= 0 < journalfield(entry, len, "MESSAGE", value, sizeof(value)) &&
+            0 == strcmp(value, "first line\nsecond line");
+        pass &= 0 < journalfield(entry, len, "PRIORITY", value, sizeof(value)) &&
+            0 == strcmp(value, "3");
+        pass &= -1 == journalfield(entry, len, "CODE_FILE", NULL, 0);
+        pass &= 0 < journalfield(entry, len, "TID", NULL, 0);
+        _sir_safefree(&entry);
+    }
+
+    printf("\treceived structured entries as datagrams\n");
+
+    /* too large for a datagram: passed in a sealed memfd instead. */
+    sirbuf* big = (sirbuf*)calloc(1, sizeof(sirbuf));
+    char* text  = (char*)malloc(JOURNAL_LARGEMSG + 1);
+    pass &= NULL != big && NULL != text;
+
+    if (big && text) {
+        memset(text, 'x', JOURNAL_LARGEMSG);
+        text[JOURNAL_LARGEMSG] = '\0';
+        big->message = text;
+        pass &= _sir_journal_write(LOG_INFO, big, &si.d_syslog);
+
+        entry = recvjournalentry(standin, &len, &memfd, 1000);
+        pass &= NULL != entry && memfd;
+        if (entry) {
+            pass &= JOURNAL_LARGEMSG == journalfield(entry, len, "MESSAGE", NULL, 0);
+            pass &= 0 < journalfield(entry, len, "PRIORITY", value, sizeof(value)) &&
+                0 == strcmp(value, "6");
+            _sir_safefree(&entry);
+        }
+
+        printf("\treceived a %d byte message in a memfd\n", pass ? JOURNAL_LARGEMSG : -1);
+    }
+
+    _sir_safefree(&text);
+    _sir_safefree(&big);
+
+    sir_cleanup();
+    (void)close(standin);
+    (void)unlink(sockname);
+    _sir_journal_setpath(NULL);
+
+    return print_result_and_return(pass);
+#endif
+}
+
+/** A custom destination that records what is written to it. */
+typedef struct {
+    volatile bool open; /**< Writes wait (up to 5 seconds) while false. */
+    volatile uint32_t writes;
+    volatile uint32_t flushes;
+    volatile uint32_t closes;
+    sir_level level;
+    size_t len;
+    char last[SIR_MAXOUTPUT];
+} customdest;
+
+static bool customdest_write(void* ctx, const char* line, size_t len, sir_level level) {
+    customdest* cd = (customdest*)ctx;
+    for (uint32_t waited = 0; !cd->open && waited < 5000; waited++)
+        _sirthread_sleep(1);
+
+    memcpy(cd->last, line, len);
+    cd->last[len] = '\0';
+    cd->len       = len;
+    cd->level     = level;
+    cd->writes++;
+    return true;
+}
+
+static void customdest_flush(void* ctx) {
+    ((customdest*)ctx)->flushes++;
+}
+
+static void customdest_close(void* ctx) {
+    ((customdest*)ctx)->closes++;
+}
+
+bool sirtest_customdest(void) {
+    INIT(si, 0, 0, 0, 0);
+    bool pass = si_init;
+
+    static const sir_dest_ops ops = {customdest_write, customdest_flush, customdest_close};
+    static customdest inl;
+    static customdest que;
+    memset(&inl, 0, sizeof(inl));
+    memset(&que, 0, sizeof(que));
+    inl.open = true;
+
+    sirdestid inlid = sir_adddest(&ops, &inl, SIRL_ALL, SIRO_MSGONLY);
+    sirdestid queid = sir_adddest(&ops, &que, SIRL_DEFAULT, SIRO_DEFAULT | SIRO_QUEUED);
+    pass &= 0 != inlid && 0 != queid;
+
+    /* written by the logging thread before it returns. */
+    pass &= sir_info("inline %d", 1);
+    pass &= 1 == inl.writes && SIRL_INFO == inl.level && 0 == strcmp(inl.last, "inline 1\n") &&
+        strlen(inl.last) == inl.len;
+
+    /* the queued destination is stuck: it must hold up neither the logging
+     * thread nor the inline destination, and messages that don't fit in its
+     * queue are dropped. */
+    uint32_t accepted = 1;
+    uint32_t dropped  = 0;
+    for (uint32_t n = 0; n < SIR_DEST_QUEUESIZE * 2; n++) {
+        if (sir_notice("message %" PRIu32, n))
+            accepted++;
+        else
+            dropped++;
+    }
+
+    pass &= 1 + SIR_DEST_QUEUESIZE * 2 == inl.writes && 0 < dropped && 0 == que.writes;
+    printf("\tinline: %" PRIu32 " written; queued: %" PRIu32 " accepted, %" PRIu32 " dropped\n",
+        inl.writes, accepted, dropped);
+
+    /* removing it writes the rest of its queue, then flushes and closes it. */
+    que.open = true;
+    pass &= sir_remdest(queid);
+    pass &= accepted == que.writes && 0 < que.flushes && 1 == que.closes;
+    pass &= NULL != strstr(que.last, "message") && SIRL_NOTICE == que.level;
+    printf("\tqueued: %" PRIu32 " written, %" PRIu32 " flush(es), %" PRIu32 " close(s)\n",
+        que.writes, que.flushes, que.closes);
+
+    pass &= !sir_remdest(queid);
+    if (pass)
+        print_expected_error();
+
+    /* a stale id doesn't refer to a destination added after it was removed,
+     * even if the new one takes the old one's memory. */
+    static const sir_dest_ops reused = {customdest_write, NULL, NULL};
+    sirdestid newid = sir_adddest(&reused, &que, SIRL_DEBUG, SIRO_MSGONLY);
+    pass &= 0 != newid && newid != queid;
+    pass &= !sir_destlevels(queid, SIRL_NONE);
+    if (pass)
+        print_expected_error();
+
+    uint32_t quewrites = que.writes;
+    pass &= sir_debug("still registered") && quewrites + 1 == que.writes;
+    pass &= sir_remdest(newid);
+
+    /* levels and options can be changed. */
+    uint32_t writes = inl.writes;
+    pass &= sir_destlevels(inlid, SIRL_ERROR);
+    pass &= !sir_info("nobody wants this") && writes == inl.writes;
+    pass &= sir_destopts(inlid, SIRO_NOTIME | SIRO_NOHOST | SIRO_NOPID | SIRO_NOTID);
+    pass &= sir_error("formatted") && writes + 1 == inl.writes && SIRL_ERROR == inl.level;
+    pass &= NULL != strstr(inl.last, SIRL_S_ERROR) && inl.len > strlen("formatted\n");
+
+    /* only so many can be added. */
+    static const sir_dest_ops writeonly = {customdest_write, NULL, NULL};
+    for (size_t n = 1; n < SIR_MAXDESTS; n++)
+        pass &= 0 != sir_adddest(&writeonly, &inl, SIRL_EMERG, SIRO_DEFAULT);
+
+    pass &= 0 == sir_adddest(&writeonly, &inl, SIRL_EMERG, SIRO_DEFAULT);
+    if (pass)
+        print_expected_error();
+
+    pass &= 0 == sir_adddest(NULL, &inl, SIRL_DEFAULT, SIRO_DEFAULT);
+
+    sir_cleanup();
+    pass &= 1 == inl.closes;
+
+    return print_result_and_return(pass);
+}
+
+/** A custom destination that logs from within its own write function. */
+typedef struct {
+    sirdestid id;
+    volatile bool done; /**< Set once the logging thread is finished. */
+    uint32_t depth;
+    uint32_t writes;
+    uint32_t nested;
+    bool pass;
+} reentrantdest;
+
+static bool reentrantdest_write(void* ctx, const char* line, size_t len, sir_level level) {
+    _SIR_UNUSED(line);
+    _SIR_UNUSED(len);
+    _SIR_UNUSED(level);
+
+    reentrantdest* rd = (reentrantdest*)ctx;
+    if (0 < rd->depth) {
+        rd->nested++;
+        return true;
+    }
+
+    rd->depth++;
+    rd->writes++;
+
+    /* give the other thread time to start waiting to change the destinations. */
+    _sirthread_sleep(20);
+    rd->pass &= sir_info("nested %" PRIu32, rd->writes);
+
+    /* the destinations can't be changed from here, but trying must not hang. */
+    static const sir_dest_ops ops = {reentrantdest_write, NULL, NULL};
+    rd->pass &= 0 == sir_adddest(&ops, rd, SIRL_ALL, SIRO_MSGONLY);
+
+    rd->depth--;
+    return true;
+}
+
+static sir_thread_ret SIR_THREAD_CALL sirtest_destchanger(void* arg) {
+    reentrantdest* rd = (reentrantdest*)arg;
+    while (!rd->done)
+        rd->pass &= sir_destlevels(rd->id, SIRL_ALL);
+
+    return (sir_thread_ret)0;
+}
+
+bool sirtest_reentrantdest(void) {
+    INIT(si, 0, 0, 0, 0);
+    bool pass = si_init;
+
+    static const sir_dest_ops ops = {reentrantdest_write, NULL, NULL};
+    static reentrantdest rd;
+    memset(&rd, 0, sizeof(rd));
+    rd.pass = true;
+
+    rd.id = sir_adddest(&ops, &rd, SIRL_ALL, SIRO_MSGONLY);
+    pass &= 0 != rd.id;
+
+    /* while another thread keeps locking the destinations exclusively, a write
+     * that logs again must neither deadlock nor be left out. */
+    sir_thread changer;
+    bool created = pass && _sirthread_create(&changer, sirtest_destchanger, &rd);
+    pass &= created;
+
+    for (uint32_t n = 0; pass && n < 10; n++)
+        pass &= sir_info("outer %" PRIu32, n);
+
+    rd.done = true;
+    if (created)
+        pass &= _sirthread_join(&changer);
+
+    pass &= rd.pass && 10 == rd.writes && 10 == rd.nested;
+    printf("	%" PRIu32 " write(s), %" PRIu32 " nested\n", rd.writes, rd.nested);
+
+    pass &= sir_cleanup();
+    return print_result_and_return(pass);
+}
+
+#if defined(SIR_SHMRING_ENABLED)
+/** What sirtest_shmring expects to read from the ring next. */
+typedef struct {
+    const char* prefix; /**< Messages are "<prefix> <n>\n", n counting up from 0. */
+    uint32_t count;
+    bool ok;
+} shmringreader;
+
+static void shmring_read(void* ctx, sir_level level, const char* msg, size_t len) {
+    shmringreader* rd = (shmringreader*)ctx;
+    char expected[SIR_MAXMESSAGE] = {0};
+    (void)snprintf(expected, sizeof(expected), "%s %" PRIu32 "\n", rd->prefix, rd->count);
+
+    bool ok = len == strlen(expected) && 0 == memcmp(msg, expected, len) &&
+        (0 == rd->count % 2 ? SIRL_INFO : SIRL_WARN) == level;
+    if (!ok && rd->ok)
+        printf("\t" RED("unexpected message %" PRIu32 ": '%.*s'") "\n", rd->count, (int)len, msg);
+
+    rd->ok &= ok;
+    rd->count++;
+}
+
+static void shmring_count(void* ctx, sir_level level, const char* msg, size_t len) {
+    _SIR_UNUSED(level)
+    _SIR_UNUSED(msg)
+    _SIR_UNUSED(len)
+    (*(uint32_t*)ctx)++;
+}
+#endif
+
+bool sirtest_shmring(void) {
+#if !defined(SIR_SHMRING_ENABLED)
+    printf("\t" DGRAY("SIR_SHMRING_ENABLED is not defined; skipping.") "\n");
+    return true;
+#else
+    char name[SIR_MAXPATH] = {0};
+    (void)snprintf(name, sizeof(name), "libsir-tests-%d", (int)getpid());
+
+    INIT(si, 0, 0, 0, 0);
+    bool pass = si_init;
+
+    sirdestid id      = sir_addshmring(name, SIRL_INFO | SIRL_WARN, SIRO_MSGONLY);
+    sir_shmring* ring = _sir_shmring_open(name, true);
+    pass &= 0 != id && NULL != ring;
+
+    /* one consumer at a time. */
+    sir_shmring* second = _sir_shmring_open(name, true);
+    pass &= NULL == second;
+    if (pass)
+        print_expected_error();
+    _sir_shmring_close(&second);
+
+    shmringreader rd = {"message", 0, true};
+    for (uint32_t n = 0; n < 100; n++)
+        pass &= 0 == n % 2 ? sir_info("message %" PRIu32, n) : sir_warn("message %" PRIu32, n);
+
+    pass &= NULL != ring && 100 == _sir_shmring_drain(ring, shmring_read, &rd) && rd.ok;
+    printf("\tread %" PRIu32 " messages written by this process\n", rd.count);
+
+    /* another process writing to the same ring. */
+    pid_t child = fork();
+    if (0 == child) {
+        sir_shmring* writer = _sir_shmring_open(name, false);
+        bool wrote = NULL != writer;
+        for (uint32_t n = 0; wrote && n < 100; n++) {
+            char msg[32] = {0};
+            int len = snprintf(msg, sizeof(msg), "child %" PRIu32 "\n", n);
+            wrote &= _sir_shmring_write(writer, 0 == n % 2 ? SIRL_INFO : SIRL_WARN, msg,
+                (size_t)len);
+        }
+        _sir_shmring_close(&writer);
+        _exit(wrote ? EXIT_SUCCESS : EXIT_FAILURE);
+    } else if (-1 == child) {
+        handle_os_error(true, "fork() failed (%d)!", -1);
+        pass = false;
+    } else {
+        int status = 0;
+        pass &= child == waitpid(child, &status, 0);
+        pass &= WIFEXITED(status) && EXIT_SUCCESS == WEXITSTATUS(status);
+
+        rd = (shmringreader){"child", 0, true};
+        pass &= NULL != ring && 100 == _sir_shmring_drain(ring, shmring_read, &rd) && rd.ok;
+        printf("\tread %" PRIu32 " messages written by process %d\n", rd.count, (int)child);
+    }
+
+    /* a message that is reserved, but not yet written, holds up those after it. */
+    uint64_t heldpos = 0;
+    char* held       = NULL != ring ? _sir_shmring_reserve(ring, strlen("held 0\n"), &heldpos) : NULL;
+    pass &= NULL != held;
+    for (uint32_t n = 1; held && n < 4; n++)
+        pass &= 0 == n % 2 ? sir_info("held %" PRIu32, n) : sir_warn("held %" PRIu32, n);
+
+    rd = (shmringreader){"held", 0, true};
+    pass &= NULL != ring && 0 == _sir_shmring_drain(ring, shmring_read, &rd);
+    if (held) {
+        memcpy(held, "held 0\n", strlen("held 0\n"));
+        pass &= _sir_shmring_commit(ring, heldpos, SIRL_INFO);
+    }
+    pass &= NULL != ring && 4 == _sir_shmring_drain(ring, shmring_read, &rd) && rd.ok;
+    printf("\tread %" PRIu32 " messages once the first was written\n", rd.count);
+
+    /* a writer that dies before writing what it reserved costs only that
+     * message, and the space it reserved is reused. */
+    pid_t dead = fork();
+    if (0 == dead) {
+        sir_shmring* writer = _sir_shmring_open(name, false);
+        uint64_t pos        = 0;
+        bool reserved       = NULL != writer &&
+            NULL != _sir_shmring_reserve(writer, SIR_SHMRING_SIZE / 8, &pos);
+        _exit(reserved ? EXIT_SUCCESS : EXIT_FAILURE);
+    } else if (-1 == dead) {
+        handle_os_error(true, "fork() failed (%d)!", -1);
+        pass = false;
+    } else {
+        int status = 0;
+        pass &= dead == waitpid(dead, &status, 0);
+        pass &= WIFEXITED(status) && EXIT_SUCCESS == WEXITSTATUS(status);
+
+        uint64_t before = NULL != ring ? _sir_shmring_dropped(ring) : 0;
+        for (uint32_t n = 0; n < 100; n++)
+            pass &= 0 == n % 2 ? sir_info("after %" PRIu32, n) : sir_warn("after %" PRIu32, n);
+
+        rd = (shmringreader){"after", 0, true};
+        pass &= NULL != ring && 100 == _sir_shmring_drain(ring, shmring_read, &rd) && rd.ok &&
+            before + 1 == _sir_shmring_dropped(ring);
+        printf("\tread %" PRIu32 " messages after one process %d never wrote\n", rd.count,
+            (int)dead);
+    }
+
+    /* when nothing drains the ring, it fills up, and messages are dropped. */
+    char filler[1000];
+    memset(filler, 'x', sizeof(filler) - 1);
+    filler[sizeof(filler) - 1] = '\0';
+
+    uint64_t dropped  = NULL != ring ? _sir_shmring_dropped(ring) : 0;
+    uint32_t accepted = 0;
+    while (accepted < SIR_SHMRING_SIZE / 512 && sir_info("%s", filler))
+        accepted++;
+
+    pass &= NULL != ring && SIR_SHMRING_SIZE / 1024 <= accepted && accepted < SIR_SHMRING_SIZE / 512 &&
+        dropped + 1 == _sir_shmring_dropped(ring);
+    printf("\t%" PRIu32 " messages fit in the ring before one was dropped\n", accepted);
+
+    uint32_t drained = 0;
+    pass &= NULL != ring && accepted == _sir_shmring_drain(ring, shmring_count, &drained);
+
+    /* the ring has wrapped around by now. */
+    rd = (shmringreader){"again", 0, true};
+    for (uint32_t n = 0; n < 100; n++)
+        pass &= 0 == n % 2 ? sir_info("again %" PRIu32, n) : sir_warn("again %" PRIu32, n);
+
+    pass &= NULL != ring && 100 == _sir_shmring_drain(ring, shmring_read, &rd) && rd.ok;
+    printf("\tread %" PRIu32 " messages after wrapping around\n", rd.count);
+
+    pass &= sir_remdest(id);
+    _sir_shmring_close(&ring);
+    pass &= _sir_shmring_unlink(name);
+
+    sir_cleanup();
+    return print_result_and_return(pass);
+#endif
+}
+
+bool sirtest_timestamprollover(void) {
+    static const char* logfilename = "libsir-timestamps.log";
+
+    INIT(si, 0, 0, 0, 0);
+    bool pass = si_init;
+
+    rmfile(logfilename);
+
+    /* nothing but the time stamp and the message. */
+    sirfileid fid = sir_addfile(logfilename, SIRL_ALL, SIRO_NOHOST | SIRO_NOLEVEL |
+        SIRO_NONAME | SIRO_NOPID | SIRO_NOTID | SIRO_NOHDR);
+    pass &= NULL != fid;
+
+    /* the second each message was logged in lies between these. */
+    time_t before[1000] = {0};
+    time_t after[1000]  = {0};
+    size_t numlines     = 0;
+
+    time_t start = 0;
+    pass &= _sir_clock_gettime(&start, NULL);
+
+    /* until the second after the first message's has begun. */
+    time_t now = start;
+    while (pass && numlines < _sir_countof(before) && now == start) {
+        pass &= _sir_clock_gettime(&before[numlines], NULL);
+        pass &= sir_info("line %zu", numlines);
+        pass &= _sir_clock_gettime(&after[numlines], NULL);
+        now = after[numlines++];
+        _sirthread_sleep(5);
+    }
+
+    pass &= sir_remfile(fid);
+
+    FILE* f = pass ? fopen(logfilename, "r") : NULL;
+    pass &= NULL != f;
+
+    if (f) {
+        char line[SIR_MAXOUTPUT]     = {0};
+        char lower[SIR_MAXTIME]      = {0};
+        char upper[SIR_MAXTIME]      = {0};
+        char message[SIR_MAXMESSAGE] = {0};
+        char previous[SIR_MAXTIME]   = {0};
+        uint64_t last    = 0;
+        size_t count     = 0;
+        size_t rollovers = 0;
+
+        while (pass && count < numlines && NULL != fgets(line, SIR_MAXOUTPUT, f)) {
+            pass &= _sir_formattime(before[count], lower, SIR_TIMEFORMAT) &&
+                _sir_formattime(after[count], upper, SIR_TIMEFORMAT);
+
+            /* the time stamp is that of the second the message was logged in. */
+            size_t stamplen = strnlen(lower, SIR_MAXTIME);
+            time_t second   = 0 == strncmp(line, lower, stamplen) ? before[count] :
+                0 == strncmp(line, upper, strnlen(upper, SIR_MAXTIME)) ? after[count] : 0;
+            pass &= 0 != second;
+
+            /* followed by the milliseconds. */
+            const char* msecpos = line + stamplen;
+            while ('\0' != *msecpos && (*msecpos < '0' || *msecpos > '9'))
+                msecpos++;
+            char* end = NULL;
+            long msec = strtol(msecpos, &end, 10);
+            pass &= end > msecpos && msec >= 0 && msec <= 999;
+
+            (void)snprintf(message, sizeof(message), "line %zu\n", count);
+            pass &= NULL != strstr(line, message);
+
+            /* never going backwards, which is what reusing the time stamp of
+             * the previous second with the milliseconds of the next would do. */
+            uint64_t stamp = ((uint64_t)second * 1000) + (uint64_t)msec;
+            pass &= stamp >= last;
+            last = stamp;
+
+            if (0 != count && 0 != strncmp(line, previous, stamplen))
+                rollovers++;
+            _sir_strncpy(previous, SIR_MAXTIME, line, stamplen);
+
+            if (!pass) {
+                line[strcspn(line, "\r\n")] = '\0';
+                printf("\t" RED("line %zu: '%s' (expected %s or %s)") "\n", count, line,
+                    lower, upper);
+            }
+            count++;
+        }
+
+        fclose(f);
+
+        pass &= numlines == count && rollovers > 0;
+        PRINT_PASS(pass, "\tread %zu of %zu lines; the second changed %zu time(s)\n",
+            count, numlines, rollovers);
+    }
+
+    sir_cleanup();
+    rmfile(logfilename);
+    return print_result_and_return(pass);
+}
+
+#if !defined(__WIN__)
+/** Sends `stream` to a new file at `path`; returns the descriptor it had, or -1. */
+static int redirectstdio(FILE* stream, const char* path) {
+    (void)fflush(stream);
+
+    int saved = dup(fileno(stream));
+    int fd    = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+
+    bool redirected = -1 != saved && -1 != fd && -1 != dup2(fd, fileno(stream));
+
+    if (-1 != fd)
+        (void)close(fd);
+    if (!redirected && -1 != saved) {
+        (void)close(saved);
+        saved = -1;
+    }
+
+    return saved;
+}
+
+/** Undoes ::redirectstdio. */
+static void restorestdio(FILE* stream, int saved) {
+    (void)fflush(stream);
+    if (-1 != saved) {
+        (void)dup2(saved, fileno(stream));
+        (void)close(saved);
+    }
+}
+
+# define CONFIG_THREADS 4
+# define CONFIG_UPDATES 300
+
+/** State shared by sirtest_configwhilelogging and its logging threads. */
+typedef struct {
+    sir_mutex mutex;
+    size_t seq;                   /**< The number of option changes so far. */
+    size_t acked[CONFIG_THREADS]; /**< The `seq` each thread last logged with. */
+    bool stop;
+} config_shared;
+
+/** Arguments passed to sirtest_configlogger. */
+typedef struct {
+    config_shared* shared;
+    size_t index;
+    bool pass;
+} config_args;
+
+static sir_thread_ret SIR_THREAD_CALL sirtest_configlogger(void* arg) {
+    config_args* my_args  = (config_args*)arg;
+    config_shared* shared = my_args->shared;
+
+    /* numbered, so that none of them are squelched as repeats. */
+    for (size_t n = 0;; n++) {
+        size_t seq = 0;
+        bool stop  = true;
+        if (_sirmutex_lock(&shared->mutex)) {
+            seq  = shared->seq;
+            stop = shared->stop;
+            (void)_sirmutex_unlock(&shared->mutex);
+        }
+
+        if (stop)
+            break;
+
+        my_args->pass &= sir_info("t=%zu seq=%zu n=%zu", my_args->index, seq, n);
+
+        if (_sirmutex_lock(&shared->mutex)) {
+            shared->acked[my_args->index] = seq;
+            (void)_sirmutex_unlock(&shared->mutex);
+        }
+
+        _sirthread_yield();
+    }
+
+    return (sir_thread_ret)0;
+}
+
+/**
+ * Returns which of sirtest_configwhilelogging's options a line of stdout
+ * output was formatted with, or -1 if none of them.
+ */
+static int configshape(const char* line) {
+    /* past the text style. */
+    if ('\x1b' == *line) {
+        const char* end = strchr(line, 'm');
+        line = end ? end + 1 : line;
+    }
+
+    if (0 == strncmp(line, "t=", 2))
+        return 0;
+
+    static const char* level = SIR_LEVELPREFIX SIRL_S_INFO SIR_LEVELSUFFIX ": t=";
+    if (0 == strncmp(line, level, strlen(level)))
+        return 1;
+
+    const char* msg = strstr(line, ": t=");
+    if (line[0] >= '0' && line[0] <= '9' && msg && !memchr(line, '[', (size_t)(msg - line)))
+        return 2;
+
+    return -1;
+}
+#endif
+
+bool sirtest_configwhilelogging(void) {
+#if defined(__WIN__)
+    printf("\t" DGRAY("the console can't be redirected to a file; skipping.") "\n");
+    return true;
+#else
+    static const char* logfilename = "libsir-config.log";
+
+    /* each of them formats messages recognizably differently. */
+    static const sir_options opts[] = {
+        SIRO_MSGONLY,
+        SIRO_NOTIME | SIRO_NOHOST | SIRO_NONAME | SIRO_NOPID | SIRO_NOTID,
+        SIRO_NOMSEC | SIRO_NOHOST | SIRO_NONAME | SIRO_NOPID | SIRO_NOTID | SIRO_NOLEVEL
+    };
+
+    INIT(si, SIRL_INFO, opts[0], 0, 0);
+    bool pass = si_init;
+
+    rmfile(logfilename);
+
+    /* stdout goes to the file meanwhile. */
+    int saved = redirectstdio(stdout, logfilename);
+    pass &= -1 != saved;
+
+    config_shared shared = {0};
+    pass &= _sirmutex_create(&shared.mutex);
+
+    sir_thread thrds[CONFIG_THREADS];
+    config_args args[CONFIG_THREADS] = {{NULL, 0, false}};
+    size_t created = 0;
+
+    for (size_t t = 0; pass && t < CONFIG_THREADS; t++) {
+        args[t].shared = &shared;
+        args[t].index  = t;
+        args[t].pass   = true;
+        pass &= _sirthread_create(&thrds[t], sirtest_configlogger, &args[t]);
+        if (pass)
+            created++;
+    }
+
+    for (size_t seq = 1; pass && seq <= CONFIG_UPDATES; seq++) {
+        pass &= sir_stdoutopts(opts[seq % _sir_countof(opts)]);
+
+        /* once the change has been made, this thread sees nothing older... */
+        pass &= sir_info("t=%d seq=%zu", CONFIG_THREADS, seq);
+
+        if (_sirmutex_lock(&shared.mutex)) {
+            shared.seq = seq;
+            (void)_sirmutex_unlock(&shared.mutex);
+        }
+
+        /* ...and nor do the others, once they know about it. before the next
+         * change, each of them logs after learning of this one. */
+        for (bool acked = false; pass && !acked;) {
+            acked = true;
+            if (_sirmutex_lock(&shared.mutex)) {
+                for (size_t t = 0; t < created; t++)
+                    acked &= shared.acked[t] >= seq;
+                (void)_sirmutex_unlock(&shared.mutex);
+            }
+            if (!acked)
+                _sirthread_yield();
+        }
+    }
+
+    if (_sirmutex_lock(&shared.mutex)) {
+        shared.stop = true;
+        (void)_sirmutex_unlock(&shared.mutex);
+    }
+
+    for (size_t t = 0; t < created; t++) {
+        pass &= _sirthread_join(&thrds[t]);
+        pass &= args[t].pass;
+    }
+
+    pass &= sir_cleanup();
+    (void)_sirmutex_destroy(&shared.mutex);
+
+    restorestdio(stdout, saved);
+
+    FILE* f = pass ? fopen(logfilename, "r") : NULL;
+    pass &= NULL != f;
+
+    if (f) {
+        char line[SIR_MAXOUTPUT] = {0};
+        size_t count             = 0;
+
+        while (pass && NULL != fgets(line, SIR_MAXOUTPUT, f)) {
+            size_t t   = 0;
+            size_t seq = 0;
+            int shape  = configshape(line);
+
+            const char* msg = strstr(line, "t=");
+            pass &= shape >= 0 && msg && 2 == sscanf(msg, "t=%zu seq=%zu", &t, &seq);
+
+            /* a logging thread may already see the change after the one it
+             * knows about, but no earlier one. */
+            size_t known = (size_t)shape;
+            pass &= seq % _sir_countof(opts) == known || (t < CONFIG_THREADS &&
+                (seq + 1) % _sir_countof(opts) == known);
+
+            if (!pass) {
+                line[strcspn(line, "\r\n")] = '\0';
+                printf("\t" RED("unexpected line %zu: '%s'") "\n", count, line);
+            }
+            count++;
+        }
+
+        fclose(f);
+
+        PRINT_PASS(pass, "\tread %zu lines logged during %d option changes\n", count,
+            CONFIG_UPDATES);
+    }
+
+    rmfile(logfilename);
+    return print_result_and_return(pass);
+#endif
+}
+
+#if !defined(__WIN__)
+/** Reads up to `max` lines containing `marker` from a file; returns how many. */
+static size_t readmarkedlines(const char* path, const char* marker,
+    char (*lines)[SIR_MAXOUTPUT], size_t max) {
+    FILE* f = fopen(path, "r");
+    if (!f)
+        return 0;
+
+    char line[SIR_MAXOUTPUT] = {0};
+    size_t count             = 0;
+
+    while (count < max && NULL != fgets(line, SIR_MAXOUTPUT, f)) {
+        if (strstr(line, marker))
+            (void)snprintf(lines[count++], SIR_MAXOUTPUT, "%s", line);
+    }
+
+    fclose(f);
+    return count;
+}
+
+# define FMTOPTS_NUMOPTS  5
+# define FMTOPTS_NUMFILES 6
+# define FMTOPTS_NUMMSGS  2
+#endif
+
+bool sirtest_formatperoptions(void) {
+#if defined(__WIN__)
+    printf("\t" DGRAY("the console can't be redirected to a file; skipping.") "\n");
+    return true;
+#else
+    static const char* outpath = "libsir-fmtopts-stdout.log";
+    static const char* errpath = "libsir-fmtopts-stderr.log";
+    static const char* refpath = "libsir-fmtopts-ref.log";
+    static const char* messages[FMTOPTS_NUMMSGS] = {"msg-first", "msg-second"};
+
+    static const sir_options opts[FMTOPTS_NUMOPTS] = {
+        SIRO_MSGONLY,
+        SIRO_NOTIME | SIRO_NOHOST | SIRO_NONAME | SIRO_NOPID | SIRO_NOTID,
+        SIRO_NOTIME | SIRO_NOHOST | SIRO_NOLEVEL | SIRO_NOTID,
+        SIRO_NOTIME | SIRO_NOHOST | SIRO_NONAME | SIRO_NOLEVEL,
+        SIRO_NOTIME | SIRO_NOHOST
+    };
+
+    /* the options (indexes into opts) of each file, before and after some of
+     * them are changed; several are the same, and there are more kinds of
+     * output than SIR_MAXFMTCACHE. */
+    static const size_t fileopts[FMTOPTS_NUMMSGS][FMTOPTS_NUMFILES] = {
+        {0, 1, 2, 3, 4, 2},
+        {3, 1, 2, 3, 4, 1}
+    };
+    static const size_t stdoutopts[FMTOPTS_NUMMSGS] = {0, 4};
+    static const size_t stderropts[FMTOPTS_NUMMSGS] = {1, 1};
+
+    /* what a file, stdout and stderr get with each of the options. */
+    static char expected[3][FMTOPTS_NUMOPTS][FMTOPTS_NUMMSGS][SIR_MAXOUTPUT];
+    static char lines[(FMTOPTS_NUMOPTS + 1) * FMTOPTS_NUMMSGS][SIR_MAXOUTPUT];
+
+    INIT_N(si, SIRL_NONE, 0, SIRL_NONE, 0, "fmtopts");
+    bool pass = si_init;
+
+    char paths[FMTOPTS_NUMFILES][SIR_MAXPATH] = {{0}};
+    for (size_t n = 0; n < FMTOPTS_NUMFILES; n++) {
+        (void)snprintf(paths[n], SIR_MAXPATH, "libsir-fmtopts-%zu.log", n);
+        rmfile(paths[n]);
+    }
+    rmfile(refpath);
+
+    /* stdout and stderr go to files meanwhile. */
+    int savedout = redirectstdio(stdout, outpath);
+    int savederr = redirectstdio(stderr, errpath);
+    pass &= -1 != savedout && -1 != savederr;
+
+    /* first, each destination on its own, with each of the options. */
+    for (size_t o = 0; pass && o < FMTOPTS_NUMOPTS; o++) {
+        sirfileid ref = sir_addfile(refpath, SIRL_INFO, opts[o]);
+        pass &= NULL != ref;
+        for (size_t m = 0; pass && m < FMTOPTS_NUMMSGS; m++)
+            pass &= sir_info("%s", messages[m]);
+        pass &= sir_remfile(ref);
+
+        pass &= sir_stdoutopts(opts[o]) && sir_stdoutlevels(SIRL_INFO);
+        for (size_t m = 0; pass && m < FMTOPTS_NUMMSGS; m++)
+            pass &= sir_info("%s", messages[m]);
+        pass &= sir_stdoutlevels(SIRL_NONE);
+
+        pass &= sir_stderropts(opts[o]) && sir_stderrlevels(SIRL_INFO);
+        for (size_t m = 0; pass && m < FMTOPTS_NUMMSGS; m++)
+            pass &= sir_info("%s", messages[m]);
+        pass &= sir_stderrlevels(SIRL_NONE);
+    }
+
+    (void)fflush(stdout);
+    (void)fflush(stderr);
+
+    const char* refpaths[3] = {refpath, outpath, errpath};
+    for (size_t d = 0; pass && d < 3; d++) {
+        size_t count = readmarkedlines(refpaths[d], "msg-", lines, _sir_countof(lines));
+        pass &= FMTOPTS_NUMOPTS * FMTOPTS_NUMMSGS == count;
+        for (size_t n = 0; pass && n < count; n++)
+            memcpy(expected[d][n / FMTOPTS_NUMMSGS][n % FMTOPTS_NUMMSGS], lines[n],
+                SIR_MAXOUTPUT);
+    }
+
+    /* then all of them at once. */
+    sirfileid fids[FMTOPTS_NUMFILES] = {NULL};
+    for (size_t n = 0; pass && n < FMTOPTS_NUMFILES; n++) {
+        fids[n] = sir_addfile(paths[n], SIRL_INFO, opts[fileopts[0][n]]);
+        pass &= NULL != fids[n];
+    }
+
+    for (size_t m = 0; pass && m < FMTOPTS_NUMMSGS; m++) {
+        for (size_t n = 0; pass && n < FMTOPTS_NUMFILES; n++)
+            pass &= sir_fileopts(fids[n], opts[fileopts[m][n]]);
+        pass &= sir_stdoutopts(opts[stdoutopts[m]]) && sir_stdoutlevels(SIRL_INFO);
+        pass &= sir_stderropts(opts[stderropts[m]]) && sir_stderrlevels(SIRL_INFO);
+        pass &= sir_info("%s", messages[m]);
+    }
+
+    pass &= sir_cleanup();
+
+    restorestdio(stdout, savedout);
+    restorestdio(stderr, savederr);
+
+    for (size_t n = 0; pass && n < FMTOPTS_NUMFILES + 2; n++) {
+        /* stdout and stderr come after the lines logged to them on their own. */
+        bool isfile      = n < FMTOPTS_NUMFILES;
+        size_t dest      = isfile ? 0 : n - FMTOPTS_NUMFILES + 1;
+        const char* path = isfile ? paths[n] : refpaths[dest];
+        size_t skip      = isfile ? 0 : FMTOPTS_NUMOPTS * FMTOPTS_NUMMSGS;
+
+        size_t count = readmarkedlines(path, "msg-", lines, _sir_countof(lines));
+        pass &= skip + FMTOPTS_NUMMSGS == count;
+
+        for (size_t m = 0; pass && m < FMTOPTS_NUMMSGS; m++) {
+            size_t o = isfile ? fileopts[m][n] : 1 == dest ? stdoutopts[m] : stderropts[m];
+            const char* want = expected[dest][o][m];
+            const char* got  = lines[skip + m];
+
+            bool match = 0 == strcmp(want, got);
+            PRINT_PASS(match, "\t%s, message %zu: '%.*s'\n", path, m,
+                (int)strcspn(got, "\r\n"), got);
+            pass &= match;
+        }
+    }
+
+    for (size_t n = 0; n < FMTOPTS_NUMFILES; n++)
+        rmfile(paths[n]);
+    rmfile(refpath);
+    rmfile(outpath);
+    rmfile(errpath);
+
+    return print_result_and_return(pass);
+#endif
+}
+
+#if !defined(__WIN__)
+static void* sirtest_namedthread(void* arg) {
+#else /* __WIN__ */
+static unsigned sirtest_namedthread(void* arg) {
+#endif
+    thread_args* my_args = (thread_args*)arg;
+
+    my_args->pass = sir_info("before rename");
+    my_args->pass &= sir_setthreadname("sir-renamed");
+    my_args->pass &= sir_info("after rename");
+
+#if !defined(__WIN__)
+    return NULL;
+#else /* __WIN__ */
+    return 0;
+#endif
+}
+
+bool sirtest_threadname(void) {
+    static const char* logfilename = "libsir-threadname.log";
+
+    INIT(si, 0, 0, 0, 0);
+    bool pass = si_init;
+
+    printf("\t" BLUE("names >= SIR_MAXPID chars are rejected...") "\n");
+    pass &= !sir_setthreadname("this-name-is-too-long");
+    pass &= print_expected_error();
+
+    rmfile(logfilename);
+
+    sirfileid fid = sir_addfile(logfilename, SIRL_ALL,
+        SIRO_NOTIME | SIRO_NOHOST | SIRO_NOLEVEL | SIRO_NONAME | SIRO_NOPID | SIRO_NOHDR);
+    pass &= NULL != fid;
+
+    thread_args args = {{0}, false};
+
+    if (pass) {
+#if !defined(__WIN__)
+        pthread_t thrd;
+        int create = pthread_create(&thrd, NULL, sirtest_namedthread, (void*)&args);
+        if (0 != create) {
+            errno = create;
+            handle_os_error(true, "pthread_create() failed! (%d)", create);
+            pass = false;
+        } else {
+            pass &= 0 == pthread_join(thrd, NULL);
+        }
+#else /* __WIN__ */
+        uintptr_t thrd = _beginthreadex(NULL, 0, sirtest_namedthread, (void*)&args, 0, NULL);
+        if (0 == thrd) {
+            handle_os_error(true, "_beginthreadex() failed! (%d)", errno);
+            pass = false;
+        } else {
+            pass &= WAIT_OBJECT_0 == WaitForSingleObject((HANDLE)thrd, INFINITE);
+            CloseHandle((HANDLE)thrd);
+        }
+#endif
+        pass &= args.pass;
+    }
+
+    pass &= sir_cleanup();
+
+    if (pass) {
+        FILE* f = fopen(logfilename, "r");
+        pass &= NULL != f;
+
+        if (pass) {
+            char line[SIR_MAXOUTPUT] = {0};
+            bool found               = false;
+
+            /* the new name must be visible right away, despite caching. */
+            while (NULL != fgets(line, SIR_MAXOUTPUT, f)) {
+                if (NULL != strstr(line, "after rename")) {
+                    found = NULL != strstr(line, "sir-renamed");
+                    printf("\t" WHITE("%s") "", line);
+                }
+            }
+
+            pass &= found;
+            fclose(f);
+        }
+    }
+
+    rmfile(logfilename);
+    return print_result_and_return(pass);
+}
+
+bool sirtest_minlevelmacros(void) {
+    INIT(si, SIRL_ALL, SIRO_NOHOST, 0, 0);
+    bool pass = si_init;
+
+    int evaluated = 0;
+
+    /* the default threshold lets everything through. */
+    pass &= SIR_DEBUG("debug macro (%d)", ++evaluated);
+    pass &= SIR_EMERG("emergency macro (%d)", ++evaluated);
+    pass &= 2 == evaluated;
+
+#undef SIR_MIN_LEVEL
+#define SIR_MIN_LEVEL SIRL_WARN
+
+    /* below the threshold: neither logged, nor are arguments evaluated. */
+    pass &= !SIR_DEBUG("should not be logged (%d)", ++evaluated);
+    pass &= !SIR_NOTICE("should not be logged (%d)", ++evaluated);
+    pass &= SIR_WARN("warning macro (%d)", ++evaluated);
+    pass &= 3 == evaluated;
+
+#undef SIR_MIN_LEVEL
+#define SIR_MIN_LEVEL SIRL_NONE
+
+    pass &= !SIR_EMERG("should not be logged (%d)", ++evaluated);
+    pass &= 3 == evaluated;
+
+#undef SIR_MIN_LEVEL
+#define SIR_MIN_LEVEL SIRL_DEBUG
+
+    printf("\t" WHITE("arguments evaluated %d time(s)") "\n", evaluated);
+
+    sir_cleanup();
+    return print_result_and_return(pass);
+}
+
+/*
+bool sirtest_XXX(void) {
+
+    INIT(si, SIRL_ALL, 0, 0, 0);
+    bool pass = si_init;
+
+    sir_cleanup();
+    return print_result_and_return(pass);
+}
+*/
+
+/* ========================== end tests ========================== */
+
+bool print_test_error(bool result, bool expected) {
+    char message[SIR_MAXERROR] = {0};
+    uint16_t code              = sir_geterror(message);
+
+    if (!expected && !result && SIR_E_NOERROR != code)
+        printf("\t" RED("!! Unexpected (%" PRIu16 ", %s)") "\n", code, message);
+    else if (expected)
+        printf("\t" GREEN("Expected (%" PRIu16 ", %s)") "\n", code, message);
+
+    return result;
+}
+
+void print_os_error(void) {
+    char message[SIR_MAXERROR] = {0};
+    uint16_t code              = sir_geterror(message);
+    fprintf(stderr, "\t" RED("OS error: (%" PRIu16 ", %s)") "\n", code, message);
+}
+
+bool filter_error(bool pass, uint16_t err) {
+    if (!pass) {
+        char message[SIR_MAXERROR] = {0};
+        uint16_t code              = sir_geterror(message);
+        if (code != err)
+            return false;
+    }
+    return true;
+}
+
+uint32_t getrand(uint32_t upper_bound) {
+#if !defined(__WIN__)
+# if defined(__MACOS__) || defined(__BSD__)
+    return arc4random_uniform(upper_bound);
+# else
+    return (uint32_t)(random() % upper_bound);
+# endif
+#else /* __WIN__ */
+    uint32_t ctx = 0;
+    if (0 != rand_s(&ctx))
+        ctx = (uint32_t)rand();
+    return ctx % upper_bound;
+#endif
+}
+
+bool rmfile(const char* filename) {
+    bool removed = false;
+
+    /* just return true if the file doesn't exist. */
+    struct stat st;
+    if (0 != stat(filename, &st)) {
+        if (ENOENT == errno)
+            return true;
+
+        handle_os_error(true, "failed to stat %s!", filename);
+        return false;
+    }
+
+#if !defined(__WIN__)
+    removed = (0 == remove(filename));
+#else /* __WIN__ */
+    removed = FALSE != DeleteFile(filename);
+#endif
+
+    if (!removed) {
+        handle_os_error(false, "failed to delete %s!", filename);
+    } else {
+        printf("\t" DGRAY("deleted %s (%ld bytes)...") "\n", filename,
+            (long)st.st_size);
+    }
+
+    return removed;
+}
+
+bool deletefiles(const char* search, const char* filename, unsigned* data) {
+    if (strstr(filename, search)) {
+        rmfile(filename);
+        (*data)++;
+    }
+    return true;
+}
+
+bool countfiles(const char* search, const char* filename, unsigned* data) {
+    if (strstr(filename, search))
+        (*data)++;
+    return true;
+}
+
+bool countgzfiles(const char* search, const char* filename, unsigned* data) {
+    size_t len    = strlen(filename);
+    size_t extlen = strlen(SIR_FGZEXT);
+
+    if (!strstr(filename, search) || len <= extlen ||
+        0 != strcmp(filename + len - extlen, SIR_FGZEXT))
+        return true;
+
+    /* only complete files count: the gzip magic number, and smaller than the
+     * archive it replaced. */
+    unsigned char magic[2] = {0};
+    FILE* f = fopen(filename, "rb");
+    if (f) {
+        if (sizeof(magic) == fread(magic, 1, sizeof(magic), f) &&
+            0x1f == magic[0] && 0x8b == magic[1] &&
+            filesizeondisk(filename) < SIR_FROLLSIZE / 2)
+            (*data)++;
+        fclose(f);
+    }
+
     return true;
 }
 
@@ -1752,8 +4479,8 @@ float sirtimerelapsed(const sir_timer* timer) {
 #if !defined(__WIN__)
     struct timespec now;
     if (0 == clock_gettime(SIRTEST_CLOCK, &now)) {
-        return (float)((now.tv_sec * 1e3) + (now.tv_nsec / 1e6) - (timer->ts.tv_sec * 1e3) +
-            (timer->ts.tv_nsec / 1e6));
+        return (float)(((now.tv_sec - timer->ts.tv_sec) * 1e3) +
+            ((now.tv_nsec - timer->ts.tv_nsec) / 1e6));
     } else {
         handle_os_error(true, "clock_gettime(%d) failed!", SIRTEST_CLOCK);
     }
@@ -33,10 +33,17 @@
 # include <sirfilesystem.h>
 # include <sirhelpers.h>
 # include <sirtextstyle.h>
+# include <sirthread.h>
+# include <sirmutex.h>
+# include <sirsyslog.h>
+# include <sirjournal.h>
+# include <sirshmring.h>
+# include <sirdefer.h>
 # include <siransimacros.h>
 
 # if !defined(__WIN__)
 #  include <dirent.h>
+#  include <sys/wait.h>
 #  if defined(CLOCK_MONOTONIC_RAW)
 #   define SIRTEST_CLOCK CLOCK_MONOTONIC_RAW
 #  else
@@ -229,6 +236,183 @@ bool sirtest_os_log(void);
  */
 bool sirtest_filesystem(void);
 
+/**
+ * @test Properly queue messages for asynchronous delivery, and drain the queue
+ * in order upon cleanup.
+ * @returns bool `true` if the test passed, `false` otherwise.
+ */
+bool sirtest_asyncdelivery(void);
+
+/**
+ * @test Properly name the calling thread, and use the new name in output.
+ * @returns bool `true` if the test passed, `false` otherwise.
+ */
+bool sirtest_threadname(void);
+
+/**
+ * @test Properly compile out logging macros below ::SIR_MIN_LEVEL, without
+ * evaluating their arguments.
+ * @returns bool `true` if the test passed, `false` otherwise.
+ */
+bool sirtest_minlevelmacros(void);
+
+/**
+ * @test Properly defer formatting to the async worker, producing the same text
+ * as the calling thread would have, and fall back for unsupported formats.
+ * @returns bool `true` if the test passed, `false` otherwise.
+ */
+bool sirtest_deferredformat(void);
+
+/**
+ * @test Properly record string arguments for deferred formatting that end at
+ * (or run past) the end of the buffer, never writing outside of it.
+ * @returns bool `true` if the test passed, `false` otherwise.
+ */
+bool sirtest_deferredboundary(void);
+
+/**
+ * @test Properly use the child's PID in output after fork().
+ * @note Disabled on Windows.
+ * @returns bool `true` if the test passed, `false` otherwise.
+ */
+bool sirtest_forkpid(void);
+
+/**
+ * @test Properly write to several files from several threads at once, while
+ * files are added and removed, without losing or tearing any lines.
+ * @returns bool `true` if the test passed, `false` otherwise.
+ */
+bool sirtest_fileparallelwrites(void);
+
+/**
+ * @test Properly track the size of a log file as it is written, and notice when
+ * another process truncates it.
+ * @returns bool `true` if the test passed, `false` otherwise.
+ */
+bool sirtest_filesizetracking(void);
+
+/**
+ * @test Properly buffer a log file's output according to its policy, flushing
+ * it for important messages and after the configured interval.
+ * @returns bool `true` if the test passed, `false` otherwise.
+ */
+bool sirtest_filepolicy(void);
+
+/**
+ * @test Properly write a log file with io_uring (or the stdio fallback, where it
+ * is unavailable), without losing or reordering any lines.
+ * @returns bool `true` if the test passed, `false` otherwise.
+ */
+bool sirtest_fileuring(void);
+
+/**
+ * @test Properly write a memory-mapped log file (or the stdio fallback, where
+ * unavailable), leaving it at its actual size once it is unmapped.
+ * @returns bool `true` if the test passed, `false` otherwise.
+ */
+bool sirtest_filemmap(void);
+
+/**
+ * @test Properly roll a log file in the background: the file that takes over is
+ * opened ahead of time, and the old one is archived by the housekeeping thread.
+ * @returns bool `true` if the test passed, `false` otherwise.
+ */
+bool sirtest_filebackgroundroll(void);
+
+/**
+ * @test Properly compress archived log files in the background, replacing each
+ * archive with a complete gzip file.
+ * @returns bool `true` if the test passed, `false` otherwise.
+ */
+bool sirtest_filecompress(void);
+
+/**
+ * @test Properly apply a log file's archive retention limits after a roll,
+ * deleting the oldest archives (and nothing else) first.
+ * @returns bool `true` if the test passed, `false` otherwise.
+ */
+bool sirtest_fileretention(void);
+
+/**
+ * @test Properly roll a log file at the size set by its policy, and at the
+ * boundaries of its roll interval.
+ * @returns bool `true` if the test passed, `false` otherwise.
+ */
+bool sirtest_filerollpolicy(void);
+
+/**
+ * @test Properly route messages only to the destinations that want their
+ * level, as levels change and files come and go.
+ * @returns bool `true` if the test passed, `false` otherwise.
+ */
+bool sirtest_levelrouting(void);
+
+/**
+ * @test Properly frame and batch messages sent over the system logger's socket
+ * (a local stand-in for it), and reconnect when the system logger restarts.
+ * @returns bool `true` if the test passed, `false` otherwise.
+ */
+bool sirtest_syslogsocket(void);
+
+/**
+ * @test Send RFC 5424 messages to a remote syslog collector (a local stand-in
+ * for one) over UDP and TCP, and reconnect when the collector comes back.
+ * @returns bool `true` if the test passed, `false` otherwise.
+ */
+bool sirtest_remotesyslog(void);
+
+/**
+ * @test Send structured entries to systemd's journal (a local stand-in for
+ * it) over its native protocol, passing those too large for a datagram in a
+ * sealed memfd.
+ * @returns bool `true` if the test passed, `false` otherwise.
+ */
+bool sirtest_journal(void);
+
+/**
+ * @test Properly deliver to custom destinations: inline ones from the logging
+ * thread, and queued ones from a thread of their own, which drops messages
+ * when its queue is full rather than hold up the logging thread.
+ * @returns bool `true` if the test passed, `false` otherwise.
+ */
+bool sirtest_customdest(void);
+
+/**
+ * @test Let an inline custom destination log from within its write function,
+ * without deadlocking while another thread waits to change the destinations.
+ * @returns bool `true` if the test passed, `false` otherwise.
+ */
+bool sirtest_reentrantdest(void);
+
+/**
+ * @test Properly write to a shared-memory ring, from this process and another,
+ * skip only the message of a writer that died before writing it, and drop
+ * messages rather than wait when it is full.
+ * @returns bool `true` if the test passed, `false` otherwise.
+ */
+bool sirtest_shmring(void);
+
+/**
+ * @test Properly roll the cached time stamp and the milliseconds over from one
+ * second to the next.
+ * @returns bool `true` if the test passed, `false` otherwise.
+ */
+bool sirtest_timestamprollover(void);
+
+/**
+ * @test Properly apply changes to the configuration made while other threads
+ * are logging, as soon as the change has been made.
+ * @returns bool `true` if the test passed, `false` otherwise.
+ */
+bool sirtest_configwhilelogging(void);
+
+/**
+ * @test Properly format each message for every destination according to its
+ * own options, whether or not other destinations share them.
+ * @returns bool `true` if the test passed, `false` otherwise.
+ */
+bool sirtest_formatperoptions(void);
+
 /** @} */
 
 /**
@@ -312,6 +496,7 @@ bool getrand_bool(uint32_t upper_bound) {
 bool rmfile(const char* filename);
 bool deletefiles(const char* search, const char* filename, unsigned* data);
 bool countfiles(const char* search, const char* filename, unsigned* data);
+bool countgzfiles(const char* search, const char* filename, unsigned* data);
 
 typedef bool (*fileenumproc)(const char* search, const char* filename, unsigned* data);
 bool enumfiles(const char* search, fileenumproc cb, unsigned* data);